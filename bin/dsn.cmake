@@ -301,6 +301,23 @@ function(dsn_setup_system_libs)
     endif()
     set(DSN_SYSTEM_LIBS ${DSN_SYSTEM_LIBS} ${DSN_LIB_CRYPTO})
 
+    # optional codecs for rpc body compression, built in only if both the library
+    # and the header are found
+    find_library(DSN_LIB_LZ4 NAMES lz4)
+    find_path(DSN_LZ4_INCLUDE_DIR NAMES lz4.h)
+    if(DSN_LIB_LZ4 AND DSN_LZ4_INCLUDE_DIR)
+        add_definitions(-DDSN_HAS_LZ4)
+        include_directories(${DSN_LZ4_INCLUDE_DIR})
+        set(DSN_SYSTEM_LIBS ${DSN_SYSTEM_LIBS} ${DSN_LIB_LZ4})
+    endif()
+    find_library(DSN_LIB_ZSTD NAMES zstd)
+    find_path(DSN_ZSTD_INCLUDE_DIR NAMES zstd.h)
+    if(DSN_LIB_ZSTD AND DSN_ZSTD_INCLUDE_DIR)
+        add_definitions(-DDSN_HAS_ZSTD)
+        include_directories(${DSN_ZSTD_INCLUDE_DIR})
+        set(DSN_SYSTEM_LIBS ${DSN_SYSTEM_LIBS} ${DSN_LIB_ZSTD})
+    endif()
+
     if(ENABLE_GPERF)
         set(DSN_SYSTEM_LIBS ${DSN_SYSTEM_LIBS} tcmalloc)
     endif()
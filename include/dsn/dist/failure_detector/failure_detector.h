@@ -62,6 +62,7 @@
 #pragma once
 
 #include <dsn/tool-api/zlocks.h>
+#include <dsn/utility/synchronize.h>
 #include <dsn/dist/failure_detector/fd.client.h>
 #include <dsn/dist/failure_detector/fd.server.h>
 #include <dsn/perf_counter/perf_counter_wrapper.h>
@@ -119,6 +120,10 @@ public:
 
     virtual bool is_master_connected(::dsn::rpc_address node) const;
 
+    // the end of the lease granted by the master, i.e., the send time of the latest beacon
+    // acked by it plus the lease period, or 0 if the master is not registered
+    uint64_t get_master_lease_expire_ms(::dsn::rpc_address node) const;
+
     // ATTENTION: be very careful to set is_connected to false as
     // workers are always considered *connected* initially which is ok even when workers think
     // master is disconnected
@@ -136,7 +141,7 @@ public:
 
     bool remove_from_allow_list(::dsn::rpc_address node);
 
-    int worker_count() const { return static_cast<int>(_workers.size()); }
+    int worker_count() const;
 
     int master_count() const { return static_cast<int>(_masters.size()); }
 
@@ -153,6 +158,11 @@ protected:
 private:
     void check_all_records();
 
+    // send beacons to all the masters in one round
+    void send_beacons();
+    // send one more beacon to the master out of the rounds, e.g., when it is just registered
+    void send_beacon_later(::dsn::rpc_address target, uint32_t delay_milliseconds);
+
 private:
     class master_record
     {
@@ -161,7 +171,6 @@ private:
         uint64_t last_send_time_for_beacon_with_ack;
         bool is_alive;
         bool rejected;
-        task_ptr send_beacon_timer;
 
         // masters are always considered *disconnected* initially which is ok even when master
         // thinks workers are connected
@@ -180,6 +189,8 @@ private:
         ::dsn::rpc_address node;
         uint64_t last_beacon_recv_time;
         bool is_alive;
+        // the check tick in the expiry wheel, 0 if not scheduled
+        uint64_t expire_tick;
 
         // workers are always considered *connected* initially which is ok even when workers think
         // master is disconnected
@@ -188,18 +199,57 @@ private:
             this->node = node;
             this->last_beacon_recv_time = last_beacon_recv_time;
             is_alive = true;
+            expire_tick = 0;
         }
     };
 
+    typedef std::unordered_map<::dsn::rpc_address, worker_record> worker_map;
+
+    //
+    // workers are sharded so that beacons from the alive workers, which only refresh the
+    // records, are handled under the shard locks rather than _lock.
+    //
+    // the records are scheduled in a wheel of check ticks by their grace deadlines, which are
+    // not moved on beacons but checked lazily when the ticks are due, so that check_all_records
+    // visits each alive worker about once per grace period instead of scanning all of them.
+    //
+    class worker_shard
+    {
+    public:
+        mutable ::dsn::utils::ex_lock_nr_spin lock;
+        worker_map workers;
+        // (node, tick) entries, indexed by tick % wheel.size()
+        std::vector<std::vector<std::pair<::dsn::rpc_address, uint64_t>>> wheel;
+        uint64_t next_tick;
+    };
+
+    static const int WORKER_SHARD_COUNT = 16;
+
+    worker_shard &get_worker_shard(::dsn::rpc_address node)
+    {
+        return _worker_shards[std::hash<::dsn::rpc_address>()(node) % WORKER_SHARD_COUNT];
+    }
+    const worker_shard &get_worker_shard(::dsn::rpc_address node) const
+    {
+        return _worker_shards[std::hash<::dsn::rpc_address>()(node) % WORKER_SHARD_COUNT];
+    }
+    uint64_t to_check_tick(uint64_t ms) const { return ms / _check_interval_milliseconds; }
+
+    // assert(shard.lock.locked())
+    void schedule_worker_expire(worker_shard &shard, worker_record &record, uint64_t min_tick);
+    // assert(shard.lock.locked())
+    void expire_workers(worker_shard &shard,
+                        uint64_t now,
+                        /*out*/ std::vector<::dsn::rpc_address> &expire);
+
 private:
     typedef std::unordered_map<::dsn::rpc_address, master_record> master_map;
-    typedef std::unordered_map<::dsn::rpc_address, worker_record> worker_map;
 
     // allow list are set on machine name (port can vary)
     typedef std::unordered_set<::dsn::rpc_address> allow_list;
 
     master_map _masters;
-    worker_map _workers;
+    worker_shard _worker_shards[WORKER_SHARD_COUNT];
 
     uint32_t _check_interval_milliseconds;
     uint32_t _beacon_interval_milliseconds;
@@ -208,11 +258,14 @@ private:
     uint32_t _grace_milliseconds;
     bool _is_started;
     ::dsn::task_ptr _check_task;
+    ::dsn::task_ptr _send_beacon_task;
 
     bool _use_allow_list;
     allow_list _allow_list;
 
     perf_counter_wrapper _recent_beacon_fail_count;
+    perf_counter_wrapper _beacon_process_latency_ns;
+    perf_counter_wrapper _beacon_ack_latency_ms;
 
 protected:
     mutable zlock _lock;
@@ -129,6 +129,13 @@ MAKE_EVENT_CODE_RPC(RPC_QUERY_PN_DECREE, TASK_PRIORITY_HIGH)
 MAKE_EVENT_CODE_RPC(RPC_QUERY_REPLICA_INFO, TASK_PRIORITY_HIGH)
 MAKE_EVENT_CODE_RPC(RPC_PREPARE, TASK_PRIORITY_HIGH)
 MAKE_EVENT_CODE(LPC_DELAY_PREPARE, TASK_PRIORITY_HIGH)
+MAKE_EVENT_CODE(LPC_DELAY_COMMIT_FOR_READ_LEASE, TASK_PRIORITY_HIGH)
+MAKE_EVENT_CODE_RPC(RPC_PREPARE_BATCH, TASK_PRIORITY_HIGH)
+MAKE_EVENT_CODE_RPC(RPC_PREPARE_ACK_BATCH, TASK_PRIORITY_HIGH)
+MAKE_EVENT_CODE(LPC_PREPARE_IN_BATCH, TASK_PRIORITY_HIGH)
+MAKE_EVENT_CODE(LPC_PREPARE_ACK_IN_BATCH, TASK_PRIORITY_HIGH)
+MAKE_EVENT_CODE(LPC_PREPARE_BATCH_FLUSH, TASK_PRIORITY_HIGH)
+MAKE_EVENT_CODE(LPC_PREPARE_BATCH_SWEEP, TASK_PRIORITY_COMMON)
 MAKE_EVENT_CODE_RPC(RPC_GROUP_CHECK, TASK_PRIORITY_HIGH)
 MAKE_EVENT_CODE_RPC(RPC_QUERY_APP_INFO, TASK_PRIORITY_COMMON)
 MAKE_EVENT_CODE_RPC(RPC_LEARN, TASK_PRIORITY_HIGH)
@@ -154,6 +161,7 @@ MAKE_EVENT_CODE(LPC_WRITE, TASK_PRIORITY_COMMON)
 MAKE_EVENT_CODE(LPC_LEARN_REMOTE_DELTA_FILES, TASK_PRIORITY_COMMON)
 MAKE_EVENT_CODE_AIO(LPC_REPLICATION_COPY_REMOTE_FILES, TASK_PRIORITY_COMMON)
 MAKE_EVENT_CODE(LPC_GARBAGE_COLLECT_LOGS_AND_REPLICAS, TASK_PRIORITY_COMMON)
+MAKE_EVENT_CODE(LPC_FILL_LOG_SEGMENT_POOL, TASK_PRIORITY_LOW)
 MAKE_EVENT_CODE(LPC_OPEN_REPLICA, TASK_PRIORITY_COMMON)
 MAKE_EVENT_CODE(LPC_CLOSE_REPLICA, TASK_PRIORITY_COMMON)
 MAKE_EVENT_CODE(LPC_CHECKPOINT_REPLICA, TASK_PRIORITY_COMMON)
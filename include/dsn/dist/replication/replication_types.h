@@ -1603,12 +1603,19 @@ inline std::ostream &operator<<(std::ostream &out, const replica_server_info &ob
 
 typedef struct _configuration_query_by_node_request__isset
 {
-    _configuration_query_by_node_request__isset() : node(false), stored_replicas(false), info(false)
+    _configuration_query_by_node_request__isset()
+        : node(false),
+          stored_replicas(false),
+          info(false),
+          last_sync_epoch(false),
+          last_sync_version(false)
     {
     }
     bool node : 1;
     bool stored_replicas : 1;
     bool info : 1;
+    bool last_sync_epoch : 1;
+    bool last_sync_version : 1;
 } _configuration_query_by_node_request__isset;
 
 class configuration_query_by_node_request
@@ -1618,12 +1625,14 @@ public:
     configuration_query_by_node_request(configuration_query_by_node_request &&);
     configuration_query_by_node_request &operator=(const configuration_query_by_node_request &);
     configuration_query_by_node_request &operator=(configuration_query_by_node_request &&);
-    configuration_query_by_node_request() {}
+    configuration_query_by_node_request() : last_sync_epoch(0), last_sync_version(0) {}
 
     virtual ~configuration_query_by_node_request() throw();
     ::dsn::rpc_address node;
     std::vector<replica_info> stored_replicas;
     replica_server_info info;
+    int64_t last_sync_epoch;
+    int64_t last_sync_version;
 
     _configuration_query_by_node_request__isset __isset;
 
@@ -1633,6 +1642,10 @@ public:
 
     void __set_info(const replica_server_info &val);
 
+    void __set_last_sync_epoch(const int64_t val);
+
+    void __set_last_sync_version(const int64_t val);
+
     bool operator==(const configuration_query_by_node_request &rhs) const
     {
         if (!(node == rhs.node))
@@ -1645,6 +1658,14 @@ public:
             return false;
         else if (__isset.info && !(info == rhs.info))
             return false;
+        if (__isset.last_sync_epoch != rhs.__isset.last_sync_epoch)
+            return false;
+        else if (__isset.last_sync_epoch && !(last_sync_epoch == rhs.last_sync_epoch))
+            return false;
+        if (__isset.last_sync_version != rhs.__isset.last_sync_version)
+            return false;
+        else if (__isset.last_sync_version && !(last_sync_version == rhs.last_sync_version))
+            return false;
         return true;
     }
     bool operator!=(const configuration_query_by_node_request &rhs) const
@@ -1671,12 +1692,20 @@ inline std::ostream &operator<<(std::ostream &out, const configuration_query_by_
 typedef struct _configuration_query_by_node_response__isset
 {
     _configuration_query_by_node_response__isset()
-        : err(false), partitions(false), gc_replicas(false)
+        : err(false),
+          partitions(false),
+          gc_replicas(false),
+          sync_epoch(false),
+          sync_version(false),
+          is_delta(false)
     {
     }
     bool err : 1;
     bool partitions : 1;
     bool gc_replicas : 1;
+    bool sync_epoch : 1;
+    bool sync_version : 1;
+    bool is_delta : 1;
 } _configuration_query_by_node_response__isset;
 
 class configuration_query_by_node_response
@@ -1686,12 +1715,15 @@ public:
     configuration_query_by_node_response(configuration_query_by_node_response &&);
     configuration_query_by_node_response &operator=(const configuration_query_by_node_response &);
     configuration_query_by_node_response &operator=(configuration_query_by_node_response &&);
-    configuration_query_by_node_response() {}
+    configuration_query_by_node_response() : sync_epoch(0), sync_version(0), is_delta(0) {}
 
     virtual ~configuration_query_by_node_response() throw();
     ::dsn::error_code err;
     std::vector<configuration_update_request> partitions;
     std::vector<replica_info> gc_replicas;
+    int64_t sync_epoch;
+    int64_t sync_version;
+    bool is_delta;
 
     _configuration_query_by_node_response__isset __isset;
 
@@ -1701,6 +1733,12 @@ public:
 
     void __set_gc_replicas(const std::vector<replica_info> &val);
 
+    void __set_sync_epoch(const int64_t val);
+
+    void __set_sync_version(const int64_t val);
+
+    void __set_is_delta(const bool val);
+
     bool operator==(const configuration_query_by_node_response &rhs) const
     {
         if (!(err == rhs.err))
@@ -1711,6 +1749,18 @@ public:
             return false;
         else if (__isset.gc_replicas && !(gc_replicas == rhs.gc_replicas))
             return false;
+        if (__isset.sync_epoch != rhs.__isset.sync_epoch)
+            return false;
+        else if (__isset.sync_epoch && !(sync_epoch == rhs.sync_epoch))
+            return false;
+        if (__isset.sync_version != rhs.__isset.sync_version)
+            return false;
+        else if (__isset.sync_version && !(sync_version == rhs.sync_version))
+            return false;
+        if (__isset.is_delta != rhs.__isset.is_delta)
+            return false;
+        else if (__isset.is_delta && !(is_delta == rhs.is_delta))
+            return false;
         return true;
     }
     bool operator!=(const configuration_query_by_node_response &rhs) const
@@ -83,6 +83,10 @@ public:
     virtual void aio(aio_task *aio) = 0;
     virtual disk_aio *prepare_aio_context(aio_task *) = 0;
 
+    // max number of buffers in a vectored write (see disk_aio::write_buffers),
+    // 0 means vectored writes are not supported by this provider
+    virtual int max_write_buffer_count() const { return 0; }
+
     virtual void start() = 0;
 
 protected:
@@ -51,6 +51,14 @@ extern error_code close(disk_file *file);
 /// flush the buffer of the given file
 extern error_code flush(disk_file *file);
 
+/// flush the buffer of the given file asynchronously, the callback is invoked
+/// after the data written by the completed writes is durable
+extern aio_task_ptr flush(disk_file *file,
+                          task_code callback_code,
+                          task_tracker *tracker,
+                          aio_handler &&callback,
+                          int hash = 0);
+
 inline aio_task_ptr
 create_aio_task(task_code code, task_tracker *tracker, aio_handler &&callback, int hash = 0)
 {
@@ -44,6 +44,8 @@
 #include <dsn/utility/utils.h>
 #include <dsn/utility/blob.h>
 #include <dsn/utility/dlib.h>
+#include <atomic>
+#include <memory>
 #include <vector>
 
 namespace dsn {
@@ -51,12 +53,17 @@ class message_reader
 {
 public:
     explicit message_reader(int buffer_block_size)
-        : _buffer_occupied(0), _buffer_block_size(buffer_block_size)
+        : _buffer_occupied(0),
+          _buffer_block_size(buffer_block_size),
+          _slab_size(0),
+          _pinned_bytes(std::make_shared<std::atomic<int64_t>>(0))
     {
     }
     ~message_reader() {}
 
     // called before read to extend read buffer
+    // the buffers are taken from message_buffer_pool, and the current one is reused in place
+    // if none of the messages parsed from it is alive
     DSN_API char *read_buffer_ptr(unsigned int read_next);
 
     // get remaining buffer capacity
@@ -68,10 +75,28 @@ public:
     // discard read data
     void truncate_read() { _buffer_occupied = 0; }
 
+    // bytes of the buffers allocated by this reader and still referred to, by the reader
+    // itself or by the messages parsed from them
+    int64_t pinned_bytes() const { return _pinned_bytes->load(std::memory_order_relaxed); }
+
 public:
     dsn::blob _buffer;
     unsigned int _buffer_occupied;
     unsigned int _buffer_block_size;
+
+private:
+    // point _buffer to the whole slab through a new view, see _slab_view_released
+    void assign_slab_view();
+
+private:
+    // the whole buffer, held by the reader and by the views of it
+    std::shared_ptr<char> _slab;
+    unsigned int _slab_size;
+    // _buffer and the messages parsed from it refer to the slab through a view, whose
+    // deleter sets this flag once the last of them is gone, so that the slab can be
+    // safely reused in place after the reader drops its own reference
+    std::shared_ptr<std::atomic<bool>> _slab_view_released;
+    std::shared_ptr<std::atomic<int64_t>> _pinned_bytes;
 };
 
 class message_parser;
@@ -96,6 +121,10 @@ public:
     // reset the parser
     virtual void reset() {}
 
+    // called when the parser is owned by one connection-oriented rpc_session, through which
+    // messages are sent and received in order, so the parser may keep states of the session
+    virtual void on_bound_to_session(rpc_session *session) {}
+
     // after read, see if we can compose a message
     // if read_next returns -1, indicated the the message is corrupted
     virtual message_ex *get_message_on_receive(message_reader *reader, /*out*/ int &read_next) = 0;
@@ -114,7 +143,7 @@ public:
 
     // get max buffer count needed by get_buffers_on_send().
     // may be invoked for mutiple times if the message is reused for resending.
-    int get_buffer_count_on_send(message_ex *msg) const
+    virtual int get_buffer_count_on_send(message_ex *msg) const
     {
         return static_cast<int>(msg->buffers.size());
     }
@@ -39,9 +39,11 @@
 #include <dsn/utility/synchronize.h>
 #include <dsn/tool-api/message_parser.h>
 #include <dsn/tool-api/rpc_address.h>
+#include <dsn/perf_counter/perf_counter_wrapper.h>
 #include <dsn/utility/exp_delay.h>
 #include <dsn/utility/dlib.h>
 #include <atomic>
+#include <memory>
 
 namespace dsn {
 
@@ -135,6 +137,10 @@ public:
     network_header_format client_hdr_format() const { return _client_hdr_format; }
     network_header_format unknown_msg_hdr_format() const { return _unknown_msg_header_format; }
     int message_buffer_block_size() const { return _message_buffer_block_size; }
+    bool compact_message_header() const { return _compact_message_header; }
+    size_t send_coalesce_threshold() const { return _send_coalesce_threshold; }
+    size_t send_coalesce_buffer_size() const { return _send_coalesce_buffer_size; }
+    int send_cork_delay_us() const { return _send_cork_delay_us; }
 
 protected:
     DSN_API static uint32_t get_local_ipv4();
@@ -146,6 +152,10 @@ protected:
     int _message_buffer_block_size;
     int _max_buffer_block_count_per_send;
     int _send_queue_threshold;
+    bool _compact_message_header;
+    size_t _send_coalesce_threshold;
+    size_t _send_coalesce_buffer_size;
+    int _send_cork_delay_us;
 
 private:
     friend class rpc_engine;
@@ -219,6 +229,7 @@ public:
     dsn::rpc_address remote_address() const { return _remote_addr; }
     connection_oriented_network &net() const { return _net; }
     message_parser_ptr parser() const { return _parser; }
+    int64_t recv_buffer_pinned_bytes() const { return _reader.pinned_bytes(); }
 
     ///
     /// rpc_session's interface for sending and receiving
@@ -250,6 +261,11 @@ public:
     virtual void send(uint64_t signature) = 0;
     void on_send_completed(uint64_t signature = 0);
 
+    // called out of lock when sending is corked (see _cork_delay_us), the subclass should
+    // call flush_corked_messages() after delay_us
+    virtual void send_corked(int delay_us) { flush_corked_messages(); }
+    void flush_corked_messages();
+
 protected:
     ///
     /// fields related to sending messages
@@ -276,9 +292,20 @@ protected:
     std::vector<message_ex *> _sending_msgs;
     std::vector<message_parser::send_buf> _sending_buffers;
 
+    // the small buffers of _sending_msgs are copied here and sent as one block,
+    // which is allocated on demand and reused for every batch
+    std::unique_ptr<char[]> _coalesce_buffer;
+    size_t _coalesce_used;
+    std::vector<message_parser::send_buf> _message_buffers; // buffers of one message
+
     uint64_t _message_sent;
     // ]
 
+    // if not zero, sending of a few messages is held for so many microseconds, so that
+    // the messages sent meanwhile are batched, which is only set by the subclasses
+    // supporting send_corked()
+    int _cork_delay_us;
+
 protected:
     ///
     /// change status and check status
@@ -296,6 +323,9 @@ protected:
     void clear_send_queue(bool resend_msgs);
     bool on_disconnected(bool is_write);
 
+private:
+    void append_sending_buffer(const message_parser::send_buf &buf);
+
 protected:
     // constant info
     connection_oriented_network &_net;
@@ -303,6 +333,7 @@ protected:
     int _max_buffer_block_count_per_send;
     message_reader _reader;
     message_parser_ptr _parser;
+    perf_counter_wrapper _recv_buffer_pinned_bytes; // updated on each read
 
 private:
     const bool _is_client;
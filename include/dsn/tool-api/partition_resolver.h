@@ -78,14 +78,16 @@ public:
     /**
     * resolve partition_hash into IP or group addresses to know what to connect next
     *
-    * \param partition_hash the partition hash
-    * \param callback       callback invoked on completion or timeout
-    * \param timeout_ms     timeout to execute the callback
+    * \param partition_hash   the partition hash
+    * \param allow_stale_read whether the request may be served by the secondaries
+    * \param callback         callback invoked on completion or timeout
+    * \param timeout_ms       timeout to execute the callback
     *
     * \return see \ref resolve_result for details
     */
     virtual void
     resolve(uint64_t partition_hash,
+            bool allow_stale_read,
             std::function<void(dist::partition_resolver::resolve_result &&)> &&callback,
             int timeout_ms) = 0;
 
@@ -67,10 +67,14 @@ typedef union msg_context
     {
         uint64_t is_request : 1;           ///< whether the RPC message is a request or response
         uint64_t is_forwarded : 1;         ///< whether the msg is forwarded or not
-        uint64_t unused : 4;               ///< not used yet
+        uint64_t allow_stale_read : 1;     ///< whether the read may be served by a secondary
+        uint64_t unused : 3;               ///< not used yet
         uint64_t serialize_format : 4;     ///< dsn_msg_serialize_format
         uint64_t is_forward_supported : 1; ///< whether support forwarding a message to real leader
-        uint64_t reserved : 53;
+        uint64_t compress_type : 2;        ///< rpc_compress_type_t of the body on the wire
+        uint64_t request_compress_mask : 2;  ///< in requests: codecs the client can decompress
+        uint64_t response_compress_mask : 2; ///< in responses: codecs the server can decompress
+        uint64_t reserved : 47;
     } u;
     uint64_t context; ///< msg_context is of sizeof(uint64_t)
 } msg_context_t;
@@ -143,6 +147,14 @@ public:
     dsn::task_code local_rpc_code;
     network_header_format hdr_format;
     int send_retry_count;
+    // the header on the wire, if the parser sends one other than "header", e.g.,
+    // the compact dsn header, which must be kept until the message is sent
+    blob send_header;
+    // the compressed body sent to the peers able to decompress it instead of the buffers,
+    // which is prepared once by the parser, see dsn_message_parser::prepare_on_send
+    blob send_body;
+    uint32_t send_body_crc32;
+    int send_body_compress_type; // rpc_compress_type_t, or -1 if not worth compressing
 
     // by message queuing
     dlink dl;
@@ -196,6 +208,9 @@ public:
     //
     DSN_API void write_next(void **ptr, size_t *size, size_t min_size);
     DSN_API void write_commit(size_t size);
+    // append the data to the body without copying it, the data must be kept immutable
+    // as it may be shared by several messages
+    DSN_API void write_append(const blob &data);
     DSN_API bool read_next(void **ptr, size_t *size);
     bool read_next(blob &data);
     DSN_API void read_commit(size_t size);
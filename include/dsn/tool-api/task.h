@@ -43,6 +43,7 @@
 #include <dsn/utility/callocator.h>
 #include <dsn/utility/utils.h>
 #include <dsn/utility/apply.h>
+#include <dsn/utility/link.h>
 #include <dsn/utility/binary_writer.h>
 #include <dsn/tool-api/task_spec.h>
 #include <dsn/tool-api/task_tracker.h>
@@ -318,6 +319,14 @@ private:
 public:
     // used by task queue only
     task *next;
+    // set by task queue if the task is run in a strand, i.e., one by one with all the other
+    // tasks of the same hash, while maybe by different workers, see thread_access_checker
+    bool is_strand_serialized;
+
+    // used by timer service only, see timer_service::remove_timer
+    dlink timer_dl;
+    uint64_t timer_expire_tick;
+    std::atomic<timer_service *> timer_svc;
 };
 typedef dsn::ref_ptr<dsn::task> task_ptr;
 
@@ -537,7 +546,8 @@ enum aio_type
 {
     AIO_Invalid,
     AIO_Read,
-    AIO_Write
+    AIO_Write,
+    AIO_Flush
 };
 
 class disk_engine;
@@ -555,6 +565,9 @@ public:
     disk_engine *engine;
     void *file_object;
 
+    // for vectored writes only, in which case buffer is null and buffer_size is the total size
+    std::vector<dsn_file_buffer_t> write_buffers;
+
     disk_aio()
         : file(nullptr),
           buffer(nullptr),
@@ -74,6 +74,18 @@ public:
     // returned batch size is stored in parameter batch_size
     virtual task *dequeue(/*inout*/ int &batch_size) = 0;
 
+    // work stealing support, see task_worker::loop
+    // - is_work_stealing: whether the queue is bound to a single worker, and whether
+    //   dequeue may return no task (batch_size = 0) so the worker can go stealing
+    // - steal: called by other workers of the same pool to take the tasks that are
+    //   not pinned to this queue's worker, returned batch size is stored in batch_size
+    virtual bool is_work_stealing() const { return false; }
+    virtual task *steal(/*inout*/ int &batch_size)
+    {
+        batch_size = 0;
+        return nullptr;
+    }
+
     int count() const { return _queue_length.load(std::memory_order_relaxed); }
     int decrease_count(int count = 1)
     {
@@ -87,6 +99,7 @@ public:
     }
     const std::string &get_name() { return _name; }
     task_worker_pool *pool() const { return _pool; }
+    const threadpool_spec &pool_spec() const { return *_spec; }
     bool is_shared() const { return _worker_count > 1; }
     int worker_count() const { return _worker_count; }
     task_worker *owner_worker() const { return _owner_worker; } // when not is_shared()
@@ -98,7 +111,13 @@ public:
 
 private:
     friend class task_worker_pool;
-    void set_owner_worker(task_worker *worker) { _owner_worker = worker; }
+    void set_owner_worker(task_worker *worker)
+    {
+        _owner_worker = worker;
+        if (worker != nullptr) {
+            _worker_count = 1;
+        }
+    }
     void enqueue_internal(task *task);
 
 private:
@@ -102,6 +102,21 @@ ENUM_REG(TM_REJECT)
 ENUM_REG(TM_DELAY)
 ENUM_END(throttling_mode_t)
 
+// the values are sent on the wire, see msg_context_t::compress_type
+typedef enum rpc_compress_type_t {
+    RPC_COMPRESS_NONE = 0, // the body is sent as is
+    RPC_COMPRESS_LZ4 = 1,
+    RPC_COMPRESS_ZSTD = 2,
+    RPC_COMPRESS_COUNT,
+    RPC_COMPRESS_INVALID
+} rpc_compress_type_t;
+
+ENUM_BEGIN(rpc_compress_type_t, RPC_COMPRESS_INVALID)
+ENUM_REG(RPC_COMPRESS_NONE)
+ENUM_REG(RPC_COMPRESS_LZ4)
+ENUM_REG(RPC_COMPRESS_ZSTD)
+ENUM_END(rpc_compress_type_t)
+
 typedef enum dsn_msg_serialize_format {
     DSF_INVALID = 0,
     DSF_THRIFT_BINARY = 1,
@@ -184,6 +199,8 @@ public:
     dsn_msg_serialize_format rpc_msg_payload_serialize_default_format;
     rpc_channel rpc_call_channel;
     bool rpc_message_crc_required;
+    rpc_compress_type_t rpc_message_compress_type;
+    uint32_t rpc_message_compress_threshold; // bodies shorter than this are never compressed
 
     int32_t rpc_timeout_milliseconds;
     int32_t rpc_request_resend_timeout_milliseconds;  // 0 for no auto-resend
@@ -292,6 +309,18 @@ CONFIG_FLD(bool,
            rpc_message_crc_required,
            false,
            "whether to calculate the crc checksum when send request/response")
+CONFIG_FLD_ENUM(rpc_compress_type_t,
+                rpc_message_compress_type,
+                RPC_COMPRESS_NONE,
+                RPC_COMPRESS_INVALID,
+                false,
+                "how to compress the body when send request/response to the peers supporting it: "
+                "RPC_COMPRESS_NONE, RPC_COMPRESS_LZ4, RPC_COMPRESS_ZSTD")
+CONFIG_FLD(uint32_t,
+           uint64,
+           rpc_message_compress_threshold,
+           4096,
+           "bodies shorter than this (in bytes) are never compressed")
 CONFIG_FLD(int32_t,
            uint64,
            rpc_timeout_milliseconds,
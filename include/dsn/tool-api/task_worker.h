@@ -94,6 +94,10 @@ private:
     utils::notify_event _started;
     int _processed_task_count;
 
+    // only for work stealing queues
+    perf_counter_wrapper _steal_count;
+    perf_counter_wrapper _idle_count;
+
 public:
     DSN_API static void set_name(const char *name);
     DSN_API static void set_priority(worker_priority_t pri);
@@ -101,6 +105,7 @@ public:
 
 private:
     void run_internal();
+    task *steal_from_siblings(/*inout*/ int &batch_size);
 
 public:
     /*!
@@ -30,6 +30,8 @@ namespace dsn {
 ///
 /// a simple class used to check if some code is accessed by only one thread.
 /// please refer to @replica.h and @lock_struct.h for a sample usage
+/// the thread may change only between the tasks of the strand which accessed it the last time,
+/// see task::is_strand_serialized
 ///
 class thread_access_checker
 {
@@ -42,6 +44,7 @@ public:
 private:
     // TODO: the implementation is not thread safe. use atomic variable to reimplement this
     int _access_thread_id;
+    int _access_strand_hash; // hash of the strand whose task accessed it, 0 if none
     bool _access_thread_id_inited;
 };
 }
@@ -68,6 +68,11 @@ public:
     // after milliseconds, the provider should call task->enqueue()
     virtual void add_timer(task *task) = 0;
 
+    // called when a task is cancelled after task->timer_svc is set to this provider by
+    // add_timer(), so that the provider may drop the task and release the ref count added
+    // by task::enqueue for add_timer, rather than keeping it until it expires
+    virtual void remove_timer(task *task) {}
+
     // inquery
     service_node *node() const { return _node; }
 
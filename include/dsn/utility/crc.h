@@ -8,8 +8,27 @@
 namespace dsn {
 namespace utils {
 
+//
+// crc32_calc and crc64_calc choose the fastest implementation supported by the cpu at runtime,
+// all the implementations give the same results
+//
+enum class crc_impl
+{
+    table,        // byte at a time
+    slicing_by_8, // 8 bytes at a time with 8 tables
+    sse42,        // the crc32 instruction, crc32 only
+    pclmul,       // folding with carry-less multiplication
+};
+
+bool crc32_impl_supported(crc_impl impl);
+bool crc64_impl_supported(crc_impl impl);
+const char *crc_impl_to_string(crc_impl impl);
+
 uint32_t crc32_calc(const void *ptr, size_t size, uint32_t init_crc);
 
+// with the given implementation, which must be supported
+uint32_t crc32_calc(crc_impl impl, const void *ptr, size_t size, uint32_t init_crc);
+
 //
 // Given
 //      x_final = crc32_calc(x_ptr, x_size, x_init);
@@ -29,6 +48,9 @@ uint32_t crc32_concat(uint32_t xy_init,
 
 uint64_t crc64_calc(const void *ptr, size_t size, uint64_t init_crc);
 
+// with the given implementation, which must be supported
+uint64_t crc64_calc(crc_impl impl, const void *ptr, size_t size, uint64_t init_crc);
+
 //
 // Given
 //      x_final = crc64_calc(x_ptr, x_size, x_init);
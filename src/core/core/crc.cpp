@@ -1,6 +1,14 @@
 #include <cstdio>
+#include <cstring>
+#include <initializer_list>
 #include <dsn/utility/crc.h>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define DSN_CRC_X86_64 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 namespace dsn {
 namespace utils {
 
@@ -59,6 +67,77 @@ struct crc_generator
         return (uCrc);
     };
 
+    //
+    // update the (not inverted) CRC byte by byte
+    //
+    static uintxx_t update_bytes(const uint8_t *pData, size_t uSize, uintxx_t uCrc)
+    {
+        for (; uSize > 0; uSize -= 1, pData += 1)
+            uCrc = _crc_table[(uint8_t)(uCrc ^ pData[0])] ^ (uCrc >> 8);
+        return (uCrc);
+    }
+
+    //
+    // slicing-by-8 tables: _slicing_table[k][i] is the CRC of byte i followed by k zero bytes
+    //
+    struct slicing_tables
+    {
+        uintxx_t t[8][256];
+
+        slicing_tables()
+        {
+            for (size_t i = 0; i < 256; ++i)
+                t[0][i] = _crc_table[i];
+            for (size_t k = 1; k < 8; ++k) {
+                for (size_t i = 0; i < 256; ++i)
+                    t[k][i] = (t[k - 1][i] >> 8) ^ _crc_table[(uint8_t)t[k - 1][i]];
+            }
+        }
+    };
+
+    static const slicing_tables &get_slicing_tables()
+    {
+        static slicing_tables s_tables;
+        return s_tables;
+    }
+
+    //
+    // update the (not inverted) CRC 8 bytes at a time, see "A Systematic Approach to
+    // Building High Performance Software-based CRC Generators" (Kounavis and Berry, 2005)
+    //
+    static uintxx_t update_slicing_by_8(const uint8_t *pData, size_t uSize, uintxx_t uCrc)
+    {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        const uintxx_t(*t)[256] = get_slicing_tables().t;
+
+        for (; uSize > 7; uSize -= 8, pData += 8) {
+            uint64_t w;
+            memcpy(&w, pData, sizeof(w));
+            w ^= (uint64_t)uCrc;
+            uCrc = t[7][(uint8_t)w] ^ t[6][(uint8_t)(w >> 8)] ^ t[5][(uint8_t)(w >> 16)] ^
+                   t[4][(uint8_t)(w >> 24)] ^ t[3][(uint8_t)(w >> 32)] ^
+                   t[2][(uint8_t)(w >> 40)] ^ t[1][(uint8_t)(w >> 48)] ^ t[0][(uint8_t)(w >> 56)];
+        }
+#endif
+        return update_bytes(pData, uSize, uCrc);
+    }
+
+    static uintxx_t compute_slicing_by_8(const void *pSrc, size_t uSize, uintxx_t uCrc)
+    {
+        return ~update_slicing_by_8((const uint8_t *)pSrc, uSize, ~uCrc);
+    }
+
+    //
+    // Returns (x ** n) mod POLY in the 64-bit "reversed" order used by carry-less multiplication,
+    // i.e., for 32-bit CRC the coefficient of x**0 is moved from bit 31 to bit 63
+    //
+    static uint64_t ReflectedX_N(uint64_t n)
+    {
+        // x ** n = x ** (8 * (n / 8)) * x ** (n % 8)
+        uintxx_t r = MulPoly(ComputeX_N(n / 8), MSB >> (n % 8));
+        return ((uint64_t)r) << (64 - 8 * sizeof(uintxx_t));
+    }
+
     //
     // Returns (a * b) mod POLY.
     // "a" and "b" are represented in "reversed" order -- LSB is x**(XX-1) coefficient, MSB is x^0
@@ -418,9 +497,248 @@ uint64_t crc64::_crc_table[sizeof(crc64::_crc_table) / sizeof(crc64::_crc_table[
 
 namespace dsn {
 namespace utils {
+
+#ifdef DSN_CRC_X86_64
+
+static bool cpu_has_sse42()
+{
+    unsigned int eax, ebx, ecx, edx;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2) != 0;
+}
+
+static bool cpu_has_pclmul()
+{
+    unsigned int eax, ebx, ecx, edx;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_PCLMUL) != 0 &&
+           (ecx & bit_SSE4_1) != 0;
+}
+
+//
+// crc32 happens to use the Castagnoli polynomial, which is what the SSE4.2 crc32 instruction
+// computes
+//
+__attribute__((target("sse4.2"))) static uint32_t
+crc32_sse42(const void *ptr, size_t size, uint32_t init_crc)
+{
+    const uint8_t *p = (const uint8_t *)ptr;
+    uint64_t crc = (uint32_t)~init_crc;
+
+    for (; size > 7; size -= 8, p += 8) {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        crc = _mm_crc32_u64(crc, w);
+    }
+
+    uint32_t crc32 = (uint32_t)crc;
+    for (; size > 0; size -= 1, p += 1) {
+        crc32 = _mm_crc32_u8(crc32, *p);
+    }
+    return ~crc32;
+}
+
+//
+// constants for folding a 128-bit chunk forward by 512 and 128 bits:
+// for a chunk (H * x**64 + L) followed by D bits, H is multiplied by x**(D+63) and L by
+// x**(D-1), where the missing x is made up by the one-bit shift of the reflected carry-less
+// multiplication
+//
+struct crc_fold_constants
+{
+    uint64_t h512, l512;
+    uint64_t h128, l128;
+};
+
+template <typename crc_type>
+static const crc_fold_constants &get_fold_constants()
+{
+    static const crc_fold_constants s_constants = {crc_type::ReflectedX_N(512 + 63),
+                                                   crc_type::ReflectedX_N(512 - 1),
+                                                   crc_type::ReflectedX_N(128 + 63),
+                                                   crc_type::ReflectedX_N(128 - 1)};
+    return s_constants;
+}
+
+__attribute__((target("pclmul,sse4.1"))) static inline __m128i fold_128(__m128i x, __m128i k)
+{
+    return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11));
+}
+
+//
+// fold the leading multiple-of-16 bytes (at least 64) of the buffer, whose first bytes are
+// xor-ed with the (not inverted) crc, into 16 bytes with the same remainder, see
+// "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" (Intel, 2009)
+//
+// returns the number of bytes folded
+//
+__attribute__((target("pclmul,sse4.1"))) static size_t fold_pclmul(const uint8_t *p,
+                                                                   size_t size,
+                                                                   uint64_t crc,
+                                                                   const crc_fold_constants &c,
+                                                                   /*out*/ uint8_t folded[16])
+{
+    const uint8_t *start = p;
+
+    __m128i x0 = _mm_loadu_si128((const __m128i *)(p + 0));
+    __m128i x1 = _mm_loadu_si128((const __m128i *)(p + 16));
+    __m128i x2 = _mm_loadu_si128((const __m128i *)(p + 32));
+    __m128i x3 = _mm_loadu_si128((const __m128i *)(p + 48));
+    x0 = _mm_xor_si128(x0, _mm_cvtsi64_si128((long long)crc));
+    p += 64;
+    size -= 64;
+
+    __m128i k = _mm_set_epi64x((long long)c.l512, (long long)c.h512);
+    for (; size >= 64; size -= 64, p += 64) {
+        x0 = _mm_xor_si128(fold_128(x0, k), _mm_loadu_si128((const __m128i *)(p + 0)));
+        x1 = _mm_xor_si128(fold_128(x1, k), _mm_loadu_si128((const __m128i *)(p + 16)));
+        x2 = _mm_xor_si128(fold_128(x2, k), _mm_loadu_si128((const __m128i *)(p + 32)));
+        x3 = _mm_xor_si128(fold_128(x3, k), _mm_loadu_si128((const __m128i *)(p + 48)));
+    }
+
+    k = _mm_set_epi64x((long long)c.l128, (long long)c.h128);
+    __m128i x = _mm_xor_si128(fold_128(x0, k), x1);
+    x = _mm_xor_si128(fold_128(x, k), x2);
+    x = _mm_xor_si128(fold_128(x, k), x3);
+    for (; size >= 16; size -= 16, p += 16) {
+        x = _mm_xor_si128(fold_128(x, k), _mm_loadu_si128((const __m128i *)p));
+    }
+
+    _mm_storeu_si128((__m128i *)folded, x);
+    return (size_t)(p - start);
+}
+
+template <typename crc_type>
+static typename crc_type::uint crc_pclmul(const void *ptr, size_t size, typename crc_type::uint crc)
+{
+    const uint8_t *p = (const uint8_t *)ptr;
+    crc = ~crc;
+
+    if (size >= 64) {
+        uint8_t folded[16];
+        size_t n = fold_pclmul(p, size, (uint64_t)crc, get_fold_constants<crc_type>(), folded);
+        crc = crc_type::update_slicing_by_8(folded, sizeof(folded), 0);
+        p += n;
+        size -= n;
+    }
+
+    return ~crc_type::update_slicing_by_8(p, size, crc);
+}
+
+#endif // DSN_CRC_X86_64
+
+bool crc32_impl_supported(crc_impl impl)
+{
+    switch (impl) {
+    case crc_impl::table:
+    case crc_impl::slicing_by_8:
+        return true;
+#ifdef DSN_CRC_X86_64
+    case crc_impl::sse42:
+        return cpu_has_sse42();
+    case crc_impl::pclmul:
+        return cpu_has_pclmul();
+#endif
+    default:
+        return false;
+    }
+}
+
+bool crc64_impl_supported(crc_impl impl)
+{
+    // there is no instruction for the 64-bit polynomial
+    return impl != crc_impl::sse42 && crc32_impl_supported(impl);
+}
+
+const char *crc_impl_to_string(crc_impl impl)
+{
+    switch (impl) {
+    case crc_impl::table:
+        return "table";
+    case crc_impl::slicing_by_8:
+        return "slicing_by_8";
+    case crc_impl::sse42:
+        return "sse42";
+    case crc_impl::pclmul:
+        return "pclmul";
+    default:
+        return "unknown";
+    }
+}
+
+typedef uint32_t (*crc32_func)(const void *ptr, size_t size, uint32_t init_crc);
+typedef uint64_t (*crc64_func)(const void *ptr, size_t size, uint64_t init_crc);
+
+static crc32_func get_crc32_func(crc_impl impl)
+{
+    switch (impl) {
+#ifdef DSN_CRC_X86_64
+    case crc_impl::sse42:
+        return crc32_sse42;
+    case crc_impl::pclmul:
+        return crc_pclmul<crc32>;
+#endif
+    case crc_impl::slicing_by_8:
+        return crc32::compute_slicing_by_8;
+    default:
+        return crc32::compute;
+    }
+}
+
+static crc64_func get_crc64_func(crc_impl impl)
+{
+    switch (impl) {
+#ifdef DSN_CRC_X86_64
+    case crc_impl::pclmul:
+        return crc_pclmul<crc64>;
+#endif
+    case crc_impl::slicing_by_8:
+        return crc64::compute_slicing_by_8;
+    default:
+        return crc64::compute;
+    }
+}
+
+#ifdef DSN_CRC_X86_64
+// folding pays off only when there are enough chunks to fold
+static const size_t s_crc32_pclmul_min_size = 256;
+
+static uint32_t crc32_sse42_pclmul(const void *ptr, size_t size, uint32_t init_crc)
+{
+    return size < s_crc32_pclmul_min_size ? crc32_sse42(ptr, size, init_crc)
+                                          : crc_pclmul<crc32>(ptr, size, init_crc);
+}
+#endif
+
+static crc32_func select_crc32_func()
+{
+#ifdef DSN_CRC_X86_64
+    if (cpu_has_sse42() && cpu_has_pclmul())
+        return crc32_sse42_pclmul;
+#endif
+    for (crc_impl impl : {crc_impl::sse42, crc_impl::pclmul, crc_impl::slicing_by_8}) {
+        if (crc32_impl_supported(impl))
+            return get_crc32_func(impl);
+    }
+    return crc32::compute;
+}
+
+static crc64_func select_crc64_func()
+{
+    for (crc_impl impl : {crc_impl::pclmul, crc_impl::slicing_by_8}) {
+        if (crc64_impl_supported(impl))
+            return get_crc64_func(impl);
+    }
+    return crc64::compute;
+}
+
 uint32_t crc32_calc(const void *ptr, size_t size, uint32_t init_crc)
 {
-    return dsn::utils::crc32::compute(ptr, size, init_crc);
+    static const crc32_func s_func = select_crc32_func();
+    return s_func(ptr, size, init_crc);
+}
+
+uint32_t crc32_calc(crc_impl impl, const void *ptr, size_t size, uint32_t init_crc)
+{
+    return get_crc32_func(impl)(ptr, size, init_crc);
 }
 
 uint32_t crc32_concat(uint32_t xy_init,
@@ -437,7 +755,13 @@ uint32_t crc32_concat(uint32_t xy_init,
 
 uint64_t crc64_calc(const void *ptr, size_t size, uint64_t init_crc)
 {
-    return dsn::utils::crc64::compute(ptr, size, init_crc);
+    static const crc64_func s_func = select_crc64_func();
+    return s_func(ptr, size, init_crc);
+}
+
+uint64_t crc64_calc(crc_impl impl, const void *ptr, size_t size, uint64_t init_crc)
+{
+    return get_crc64_func(impl)(ptr, size, init_crc);
 }
 
 uint64_t crc64_concat(uint32_t xy_init,
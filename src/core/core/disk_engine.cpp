@@ -183,6 +183,30 @@ error_code disk_engine::flush(disk_file *fh)
     }
 }
 
+void disk_engine::flush(aio_task *aio)
+{
+    if (!_is_running) {
+        aio->enqueue(ERR_SERVICE_NOT_FOUND, 0);
+        return;
+    }
+
+    if (!aio->spec().on_aio_call.execute(task::get_current_task(), aio, true)) {
+        aio->enqueue(ERR_FILE_OPERATION_FAILED, 0);
+        return;
+    }
+
+    auto dio = aio->aio();
+    auto df = (disk_file *)dio->file;
+    dio->file = df->native_handle();
+    dio->file_object = df;
+    dio->engine = this;
+    dio->type = AIO_Flush;
+
+    // flush does not go through the read/write queues, as it only covers the completed writes
+    aio->add_ref(); // released in complete_io
+    return _provider->aio(aio);
+}
+
 void disk_engine::read(aio_task *aio)
 {
     if (!_is_running) {
@@ -260,16 +284,51 @@ void disk_engine::write(aio_task *aio)
 
 void disk_engine::process_write(aio_task *aio, uint32_t sz)
 {
+    int max_buffer_count = _provider->max_write_buffer_count();
+
     // no batching
     if (aio->aio()->buffer_size == sz) {
-        aio->collapse();
+        if (!aio->_unmerged_write_buffers.empty() &&
+            (int)aio->_unmerged_write_buffers.size() <= max_buffer_count) {
+            // write the buffers in place
+            aio->aio()->write_buffers = aio->_unmerged_write_buffers;
+        } else {
+            aio->collapse();
+        }
         return _provider->aio(aio);
     }
 
     // batching
-    else {
-        // merge the buffers
-        auto bb = tls_trans_mem_alloc_blob((size_t)sz);
+    std::vector<dsn_file_buffer_t> buffers;
+    if (max_buffer_count > 0) {
+        auto current_wk = aio;
+        do {
+            if (!current_wk->_unmerged_write_buffers.empty()) {
+                buffers.insert(buffers.end(),
+                               current_wk->_unmerged_write_buffers.begin(),
+                               current_wk->_unmerged_write_buffers.end());
+            } else {
+                dsn_file_buffer_t buffer;
+                buffer.buffer = current_wk->aio()->buffer;
+                buffer.size = (int)current_wk->aio()->buffer_size;
+                buffers.push_back(buffer);
+            }
+            current_wk = (aio_task *)current_wk->next;
+        } while (current_wk && (int)buffers.size() <= max_buffer_count);
+
+        if ((int)buffers.size() > max_buffer_count) {
+            buffers.clear();
+        }
+    }
+
+    blob bb;
+    if (buffers.empty()) {
+        // merge the buffers, into a page aligned buffer in case the file is opened with
+        // O_DIRECT, in which case the offsets and sizes of the batched writes are aligned too
+        const size_t alignment = 4096;
+        bb = tls_trans_mem_alloc_blob((size_t)sz + alignment);
+        size_t misalignment = (size_t)(uintptr_t)bb.data() % alignment;
+        bb = bb.range(misalignment == 0 ? 0 : (int)(alignment - misalignment), sz);
         char *ptr = (char *)bb.data();
         auto current_wk = aio;
         do {
@@ -283,22 +342,23 @@ void disk_engine::process_write(aio_task *aio, uint32_t sz)
                 (uint64_t)(ptr),
                 (uint64_t)(bb.data()),
                 bb.length());
+    }
 
-        // setup io task
-        auto new_task = new batch_write_io_task(aio, bb);
-        auto dio = new_task->aio();
-        dio->buffer = (void *)bb.data();
-        dio->buffer_size = sz;
-        dio->file_offset = aio->aio()->file_offset;
-
-        dio->file = aio->aio()->file;
-        dio->file_object = aio->aio()->file_object;
-        dio->engine = aio->aio()->engine;
-        dio->type = AIO_Write;
+    // setup io task, the batched tasks (and so their buffers) are alive until it completes
+    auto new_task = new batch_write_io_task(aio, bb);
+    auto dio = new_task->aio();
+    dio->buffer = (void *)bb.data();
+    dio->buffer_size = sz;
+    dio->write_buffers = std::move(buffers);
+    dio->file_offset = aio->aio()->file_offset;
+
+    dio->file = aio->aio()->file;
+    dio->file_object = aio->aio()->file_object;
+    dio->engine = aio->aio()->engine;
+    dio->type = AIO_Write;
 
-        new_task->add_ref(); // released in complete_io
-        return _provider->aio(new_task);
-    }
+    new_task->add_ref(); // released in complete_io
+    return _provider->aio(new_task);
 }
 
 void disk_engine::complete_io(aio_task *aio, error_code err, uint32_t bytes, int delay_milliseconds)
@@ -316,6 +376,12 @@ void disk_engine::complete_io(aio_task *aio, error_code err, uint32_t bytes, int
         aio->release_ref(); // added in process_write
     }
 
+    // flush
+    else if (aio->aio()->type == AIO_Flush) {
+        aio->enqueue(err, (size_t)bytes);
+        aio->release_ref(); // added in flush
+    }
+
     // no batching
     else {
         auto df = (disk_file *)(aio->aio()->file_object);
@@ -80,6 +80,7 @@ public:
     disk_file *open(const char *file_name, int flag, int pmode);
     error_code close(disk_file *fh);
     error_code flush(disk_file *fh);
+    void flush(aio_task *aio);
     void read(aio_task *aio);
     void write(aio_task *aio);
 
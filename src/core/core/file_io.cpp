@@ -40,6 +40,24 @@ namespace file {
 
 /*extern*/ error_code flush(disk_file *file) { return task::get_current_disk()->flush(file); }
 
+/*extern*/ aio_task_ptr flush(disk_file *file,
+                              task_code callback_code,
+                              task_tracker *tracker,
+                              aio_handler &&callback,
+                              int hash /*= 0*/)
+{
+    auto cb = create_aio_task(callback_code, tracker, std::move(callback), hash);
+    cb->aio()->buffer = nullptr;
+    cb->aio()->buffer_size = 0;
+    cb->aio()->engine = nullptr;
+    cb->aio()->file = file;
+    cb->aio()->file_offset = 0;
+    cb->aio()->type = AIO_Flush;
+
+    task::get_current_disk()->flush(cb);
+    return cb;
+}
+
 /*extern*/ aio_task_ptr read(disk_file *file,
                              char *buffer,
                              int count,
@@ -0,0 +1,137 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     size-classed pool of the receive buffers of message_reader
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "message_buffer_pool.h"
+#include <dsn/utility/config_api.h>
+
+namespace dsn {
+
+/*static*/ message_buffer_pool &message_buffer_pool::instance()
+{
+    static message_buffer_pool *pool = new message_buffer_pool();
+    return *pool;
+}
+
+message_buffer_pool::message_buffer_pool() : _free_bytes(0)
+{
+    _max_free_bytes =
+        dsn_config_get_value_uint64("network",
+                                    "recv_buffer_pool_max_free_bytes",
+                                    64 * 1024 * 1024,
+                                    "max bytes of the idle receive buffers kept for reuse");
+
+    _hit_count.init_global_counter("replica",
+                                   "network",
+                                   "recv.buffer.pool.hit.count",
+                                   COUNTER_TYPE_RATE,
+                                   "receive buffers reused from the pool per second");
+    _miss_count.init_global_counter("replica",
+                                    "network",
+                                    "recv.buffer.pool.miss.count",
+                                    COUNTER_TYPE_RATE,
+                                    "receive buffers newly allocated per second");
+    _pinned_bytes.init_global_counter(
+        "replica",
+        "network",
+        "recv.buffer.pinned.bytes",
+        COUNTER_TYPE_NUMBER,
+        "bytes of the receive buffers held by the sessions and the messages parsed from them");
+}
+
+std::shared_ptr<char>
+message_buffer_pool::allocate(unsigned int min_size,
+                              /*out*/ unsigned int &slab_size,
+                              const std::shared_ptr<std::atomic<int64_t>> &pinned_bytes)
+{
+    int bits = min_size_class_bits;
+    while (bits <= max_size_class_bits && (1u << bits) < min_size) {
+        ++bits;
+    }
+
+    char *slab = nullptr;
+    if (bits <= max_size_class_bits) {
+        slab_size = 1u << bits;
+        size_class &c = _classes[bits - min_size_class_bits];
+        {
+            utils::auto_lock<utils::ex_lock_nr_spin> l(c.lock);
+            if (!c.free_slabs.empty()) {
+                slab = c.free_slabs.back();
+                c.free_slabs.pop_back();
+            }
+        }
+        if (slab != nullptr) {
+            _free_bytes.fetch_sub(slab_size, std::memory_order_relaxed);
+            _hit_count->increment();
+        }
+    } else {
+        slab_size = min_size;
+    }
+
+    if (slab == nullptr) {
+        slab = new char[slab_size];
+        _miss_count->increment();
+    }
+
+    pinned_bytes->fetch_add(slab_size, std::memory_order_relaxed);
+    _pinned_bytes->add(slab_size);
+
+    unsigned int size = slab_size;
+    std::shared_ptr<std::atomic<int64_t>> pinned = pinned_bytes;
+    return std::shared_ptr<char>(slab, [this, size, pinned](char *p) {
+        pinned->fetch_sub(size, std::memory_order_relaxed);
+        _pinned_bytes->add(-static_cast<int64_t>(size));
+        release(p, size);
+    });
+}
+
+void message_buffer_pool::release(char *slab, unsigned int slab_size)
+{
+    if (slab_size <= (1u << max_size_class_bits)) {
+        if (_free_bytes.fetch_add(slab_size, std::memory_order_relaxed) + slab_size <=
+            _max_free_bytes) {
+            int bits = min_size_class_bits;
+            while ((1u << bits) < slab_size) {
+                ++bits;
+            }
+            size_class &c = _classes[bits - min_size_class_bits];
+            utils::auto_lock<utils::ex_lock_nr_spin> l(c.lock);
+            c.free_slabs.push_back(slab);
+            return;
+        }
+        _free_bytes.fetch_sub(slab_size, std::memory_order_relaxed);
+    }
+    delete[] slab;
+}
+}
@@ -0,0 +1,88 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     size-classed pool of the receive buffers of message_reader
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#pragma once
+
+#include <dsn/perf_counter/perf_counter_wrapper.h>
+#include <dsn/utility/synchronize.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace dsn {
+
+//
+// the slabs are of power-of-two sizes, and shared by the messages parsed from them
+// through blobs. a slab goes back to the pool when the last message referring to it
+// is released, on whichever thread that happens.
+//
+class message_buffer_pool
+{
+public:
+    // never destroyed, as slabs may still be released by messages during exit
+    static message_buffer_pool &instance();
+
+    // returns a slab of at least min_size bytes, whose real size is put in slab_size.
+    // pinned_bytes is increased by slab_size until the slab is released.
+    std::shared_ptr<char> allocate(unsigned int min_size,
+                                   /*out*/ unsigned int &slab_size,
+                                   const std::shared_ptr<std::atomic<int64_t>> &pinned_bytes);
+
+private:
+    message_buffer_pool();
+    ~message_buffer_pool() {}
+
+    void release(char *slab, unsigned int slab_size);
+
+private:
+    static const int min_size_class_bits = 12; // 4 KB
+    static const int max_size_class_bits = 22; // 4 MB, the larger slabs are not pooled
+    static const int size_class_count = max_size_class_bits - min_size_class_bits + 1;
+
+    struct size_class
+    {
+        ::dsn::utils::ex_lock_nr_spin lock;
+        std::vector<char *> free_slabs;
+    };
+    size_class _classes[size_class_count];
+
+    uint64_t _max_free_bytes;
+    std::atomic<uint64_t> _free_bytes;
+
+    perf_counter_wrapper _hit_count;
+    perf_counter_wrapper _miss_count;
+    perf_counter_wrapper _pinned_bytes;
+};
+}
@@ -34,6 +34,7 @@
  */
 
 #include "message_parser_manager.h"
+#include "message_buffer_pool.h"
 #include <dsn/service_api_c.h>
 
 namespace dsn {
@@ -135,23 +136,39 @@ std::string header_type::debug_string() const
 char *message_reader::read_buffer_ptr(unsigned int read_next)
 {
     if (read_next + _buffer_occupied > _buffer.length()) {
-        // remember currently read content
-        blob rb;
-        if (_buffer_occupied > 0)
-            rb = _buffer.range(0, _buffer_occupied);
-
-        // switch to next
         unsigned int sz =
             (read_next + _buffer_occupied > _buffer_block_size ? read_next + _buffer_occupied
                                                                : _buffer_block_size);
-        _buffer.assign(dsn::utils::make_shared_array<char>(sz), 0, sz);
-        _buffer_occupied = 0;
-
-        // copy
-        if (rb.length() > 0) {
-            // every read buffer_block_size data may cause one copy
-            memcpy((void *)_buffer.data(), (const void *)rb.data(), rb.length());
-            _buffer_occupied = rb.length();
+
+        // drop the reader's own view of the slab, the unread content stays valid as long
+        // as _slab (or the old buffer if not taken from the slab) is held
+        blob old_buffer = _buffer;
+        _buffer = blob();
+        const char *pending = old_buffer.data();
+        bool from_slab = (_slab != nullptr && old_buffer.buffer_ptr() == _slab.get());
+        if (from_slab) {
+            old_buffer = blob();
+        }
+
+        // no message parsed from the current slab is alive, so move the unparsed content
+        // to its front instead of switching to a new slab
+        if (from_slab && _slab_view_released->load(std::memory_order_acquire) &&
+            sz <= _slab_size) {
+            if (_buffer_occupied > 0) {
+                memmove(_slab.get(), pending, _buffer_occupied);
+            }
+            assign_slab_view();
+        } else {
+            // switch to next, which is large enough for the whole pending message, so
+            // the content is copied at most once for each message
+            std::shared_ptr<char> old_slab = std::move(_slab);
+            _slab = message_buffer_pool::instance().allocate(sz, _slab_size, _pinned_bytes);
+            assign_slab_view();
+
+            // copy currently read content
+            if (_buffer_occupied > 0) {
+                memcpy((void *)_buffer.data(), (const void *)pending, _buffer_occupied);
+            }
         }
 
         dassert(read_next + _buffer_occupied <= _buffer.length(),
@@ -165,6 +182,18 @@ char *message_reader::read_buffer_ptr(unsigned int read_next)
     return (char *)(_buffer.data() + _buffer_occupied);
 }
 
+void message_reader::assign_slab_view()
+{
+    // the view keeps the slab alive, and releasing the view happens-before the flag is
+    // seen set by the reader, so are all the accesses of the messages through it
+    auto released = std::make_shared<std::atomic<bool>>(false);
+    std::shared_ptr<char> view(_slab.get(), [ slab = _slab, released ](char *) {
+        released->store(true, std::memory_order_release);
+    });
+    _slab_view_released = std::move(released);
+    _buffer.assign(std::move(view), 0, _slab_size);
+}
+
 //-------------------- msg parser manager --------------------
 message_parser_manager::message_parser_manager() {}
 
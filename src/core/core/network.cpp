@@ -25,9 +25,11 @@
  */
 
 #include <dsn/tool-api/network.h>
+#include <dsn/tool_api.h>
 #include <dsn/utility/factory_store.h>
 #include "message_parser_manager.h"
 #include "rpc_engine.h"
+#include <climits>
 
 namespace dsn {
 /*static*/ join_point<void, rpc_session *>
@@ -168,6 +170,7 @@ inline bool rpc_session::unlink_message_for_send()
     dbg_dassert(0 == _sending_msgs.size(),
                 "sending_msgs should be empty, but size = %d",
                 (int)_sending_msgs.size());
+    _coalesce_used = 0;
 
     while (n != &_messages) {
         auto lmsg = CONTAINING_RECORD(n, message_ex, dl);
@@ -176,12 +179,14 @@ inline bool rpc_session::unlink_message_for_send()
             break;
         }
 
-        _sending_buffers.resize(bcount + lcount);
-        auto rcount = _parser->get_buffers_on_send(lmsg, &_sending_buffers[bcount]);
+        if ((int)_message_buffers.size() < lcount)
+            _message_buffers.resize(lcount);
+        auto rcount = _parser->get_buffers_on_send(lmsg, _message_buffers.data());
         dassert(lcount >= rcount, "%d VS %d", lcount, rcount);
-        if (lcount != rcount)
-            _sending_buffers.resize(bcount + rcount);
-        bcount += rcount;
+        for (int i = 0; i < rcount; i++) {
+            append_sending_buffer(_message_buffers[i]);
+        }
+        bcount = (int)_sending_buffers.size();
         _sending_msgs.push_back(lmsg);
 
         n = n->next();
@@ -193,10 +198,39 @@ inline bool rpc_session::unlink_message_for_send()
     return _sending_msgs.size() > 0;
 }
 
+inline void rpc_session::append_sending_buffer(const message_parser::send_buf &buf)
+{
+    size_t capacity = _net.send_coalesce_buffer_size();
+    if (buf.sz > _net.send_coalesce_threshold() || _coalesce_used + buf.sz > capacity) {
+        _sending_buffers.push_back(buf);
+        return;
+    }
+
+    if (_coalesce_buffer == nullptr) {
+        _coalesce_buffer.reset(new char[capacity]);
+    }
+    char *ptr = _coalesce_buffer.get() + _coalesce_used;
+    memcpy(ptr, buf.buf, buf.sz);
+    _coalesce_used += buf.sz;
+
+    // extend the last block if it is the coalesced one just ahead
+    if (!_sending_buffers.empty()) {
+        auto &last = _sending_buffers.back();
+        char *last_ptr = (char *)last.buf;
+        if (last_ptr >= _coalesce_buffer.get() && last_ptr + last.sz == ptr) {
+            last.sz += buf.sz;
+            return;
+        }
+    }
+    _sending_buffers.push_back(message_parser::send_buf{ptr, buf.sz});
+}
+
 DEFINE_TASK_CODE(LPC_DELAY_RPC_REQUEST_RATE, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
 
 void rpc_session::start_read_next(int read_next)
 {
+    _recv_buffer_pinned_bytes->set(recv_buffer_pinned_bytes());
+
     // server only
     if (!is_client()) {
         int delay_ms = _delay_server_receive_ms.exchange(0);
@@ -234,6 +268,7 @@ int rpc_session::prepare_parser()
         }
     }
     _parser = _net.new_message_parser(hdr_format);
+    _parser->on_bound_to_session(this);
     dinfo("message parser created, remote_client = %s, header_format = %s",
           _remote_addr.to_string(),
           hdr_format.to_string());
@@ -258,14 +293,50 @@ void rpc_session::send_message(message_ex *msg)
 
         if (SS_CONNECTED == _connect_state && !_is_sending_next) {
             _is_sending_next = true;
-            sig = _message_sent + 1;
-            unlink_message_for_send();
+
+            // hold the few messages a while for the others to come, which are sent in
+            // the same batch; _is_sending_next keeps them queued meanwhile
+            if (_cork_delay_us > 0 && _message_count < _max_buffer_block_count_per_send) {
+                sig = 0;
+            } else {
+                sig = _message_sent + 1;
+                unlink_message_for_send();
+            }
         } else {
             return;
         }
     }
 
-    this->send(sig);
+    if (sig == 0) {
+        send_corked(_cork_delay_us);
+    } else {
+        this->send(sig);
+    }
+}
+
+void rpc_session::flush_corked_messages()
+{
+    uint64_t sig = 0;
+    bool disconnected = false;
+    {
+        utils::auto_lock<utils::ex_lock_nr> l(_lock);
+        dassert(_is_sending_next, "corked messages must be sending");
+
+        if (SS_CONNECTED == _connect_state && unlink_message_for_send()) {
+            sig = _message_sent + 1;
+        } else {
+            _is_sending_next = false;
+            disconnected = (SS_CONNECTED != _connect_state);
+        }
+    }
+
+    if (sig != 0) {
+        this->send(sig);
+    } else if (disconnected) {
+        // no write fails to clear the messages if the session is disconnected by reading
+        // meanwhile, so fail them here
+        clear_send_queue(false);
+    }
 }
 
 bool rpc_session::cancel(message_ex *request)
@@ -333,7 +404,9 @@ rpc_session::rpc_session(connection_oriented_network &net,
     : _connect_state(is_client ? SS_DISCONNECTED : SS_CONNECTED),
       _message_count(0),
       _is_sending_next(false),
+      _coalesce_used(0),
       _message_sent(0),
+      _cork_delay_us(0),
 
       _net(net),
       _remote_addr(remote_addr),
@@ -345,6 +418,19 @@ rpc_session::rpc_session(connection_oriented_network &net,
       _matcher(_net.engine()->matcher()),
       _delay_server_receive_ms(0)
 {
+    if (_parser) {
+        _parser->on_bound_to_session(this);
+    }
+
+    std::string counter_name = std::string("session.") + (is_client ? "client." : "server.") +
+                               remote_addr.to_std_string() + ".recv.buffer.pinned.bytes";
+    _recv_buffer_pinned_bytes.init_global_counter(
+        ::dsn::tools::get_service_node_name(net.node()),
+        "network",
+        counter_name.c_str(),
+        COUNTER_TYPE_NUMBER,
+        "bytes of the receive buffers held by the session and the messages parsed from them");
+
     if (!is_client) {
         on_rpc_session_connected.execute(this);
     }
@@ -420,7 +506,20 @@ network::network(rpc_engine *srv, network *inner_provider)
     : _engine(srv), _client_hdr_format(NET_HDR_DSN), _unknown_msg_header_format(NET_HDR_INVALID)
 {
     _message_buffer_block_size = 1024 * 64;
-    _max_buffer_block_count_per_send = 64; // TODO: windows, how about the other platforms?
+    _max_buffer_block_count_per_send =
+        (int)dsn_config_get_value_uint64("network",
+                                         "max_buffer_block_count_per_send",
+                                         64,
+                                         "max buffer blocks sent by one batch, i.e., one writev");
+#ifdef IOV_MAX
+    if (_max_buffer_block_count_per_send > IOV_MAX) {
+        dwarn("max_buffer_block_count_per_send(%d) is larger than IOV_MAX(%d), reset to IOV_MAX",
+              _max_buffer_block_count_per_send,
+              IOV_MAX);
+        _max_buffer_block_count_per_send = IOV_MAX;
+    }
+#endif
+    dassert(_max_buffer_block_count_per_send > 0, "max_buffer_block_count_per_send must be > 0");
     _send_queue_threshold =
         (int)dsn_config_get_value_uint64("network",
                                          "send_queue_threshold",
@@ -434,6 +533,28 @@ network::network(rpc_engine *srv, network *inner_provider)
             NET_HDR_INVALID.to_string(),
             "format for unknown message headers, default is NET_HDR_INVALID"),
         NET_HDR_INVALID);
+
+    _compact_message_header = dsn_config_get_value_bool(
+        "network",
+        "compact_message_header",
+        true,
+        "whether to send dsn messages with the compact header once the peer accepts it");
+
+    _send_coalesce_threshold = (size_t)dsn_config_get_value_uint64(
+        "network",
+        "send_coalesce_threshold",
+        512,
+        "buffers not larger than this are copied together and sent as one block, 0 to disable");
+    _send_coalesce_buffer_size =
+        (size_t)dsn_config_get_value_uint64("network",
+                                            "send_coalesce_buffer_size",
+                                            16 * 1024,
+                                            "size of the per-session buffer for coalescing");
+    _send_cork_delay_us = (int)dsn_config_get_value_uint64(
+        "network",
+        "send_cork_delay_us",
+        0,
+        "microseconds to hold a few sending messages for batching, 0 to disable");
 }
 
 void network::reset_parser_attr(network_header_format client_hdr_format,
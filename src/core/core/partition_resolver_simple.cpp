@@ -52,6 +52,7 @@ partition_resolver_simple::partition_resolver_simple(rpc_address meta_server, co
 }
 
 void partition_resolver_simple::resolve(uint64_t partition_hash,
+                                        bool allow_stale_read,
                                         std::function<void(resolve_result &&)> &&callback,
                                         int timeout_ms)
 {
@@ -59,7 +60,7 @@ void partition_resolver_simple::resolve(uint64_t partition_hash,
     if (_app_partition_count != -1) {
         idx = get_partition_index(_app_partition_count, partition_hash);
         rpc_address target;
-        if (ERR_OK == get_address(idx, target)) {
+        if (ERR_OK == get_address(idx, allow_stale_read, target)) {
             callback(resolve_result{ERR_OK, target, {_app_id, idx}});
             return;
         }
@@ -67,6 +68,7 @@ void partition_resolver_simple::resolve(uint64_t partition_hash,
 
     auto rc = new request_context();
     rc->partition_hash = partition_hash;
+    rc->allow_stale_read = allow_stale_read;
     rc->callback = std::move(callback);
     rc->partition_index = idx;
     rc->timeout_timer = nullptr;
@@ -156,7 +158,7 @@ void partition_resolver_simple::call(request_context_ptr &&request, bool from_me
     if (-1 != pindex) {
         // fill target address if possible
         rpc_address addr;
-        auto err = get_address(pindex, addr);
+        auto err = get_address(pindex, request->allow_stale_read, addr);
 
         // target address known
         if (err == ERR_OK) {
@@ -394,7 +396,7 @@ void partition_resolver_simple::handle_pending_requests(std::deque<request_conte
     for (auto &req : reqs) {
         if (err == ERR_OK) {
             rpc_address addr;
-            err = get_address(req->partition_index, addr);
+            err = get_address(req->partition_index, req->allow_stale_read, addr);
             if (err == ERR_OK) {
                 end_request(std::move(req), err, addr);
             } else {
@@ -411,9 +413,18 @@ void partition_resolver_simple::handle_pending_requests(std::deque<request_conte
 }
 
 /*search in cache*/
-rpc_address partition_resolver_simple::get_address(const partition_configuration &config) const
+rpc_address partition_resolver_simple::get_address(const partition_configuration &config,
+                                                   bool allow_stale_read) const
 {
     if (_app_is_stateful) {
+        // spread the reads over the primary and the secondaries, which forward the reads to the
+        // primary if they are too stale, see replica::on_client_read
+        if (allow_stale_read && !config.primary.is_invalid() && !config.secondaries.empty()) {
+            uint32_t r = rand::next_u32(0, static_cast<uint32_t>(config.secondaries.size()));
+            if (r < config.secondaries.size()) {
+                return config.secondaries[r];
+            }
+        }
         return config.primary;
     } else {
         if (config.last_drops.size() == 0) {
@@ -422,35 +433,14 @@ rpc_address partition_resolver_simple::get_address(const partition_configuration
             return config.last_drops[rand::next_u32(0, config.last_drops.size() - 1)];
         }
     }
-
-    // if (is_write || semantic == read_semantic::ReadLastUpdate)
-    //    return config.primary;
-
-    //// readsnapshot or readoutdated, using random
-    // else
-    //{
-    //    bool has_primary = false;
-    //    int N = static_cast<int>(config.secondaries.size());
-    //    if (!config.primary.is_invalid())
-    //    {
-    //        N++;
-    //        has_primary = true;
-    //    }
-
-    //    if (0 == N) return config.primary;
-
-    //    int r = random32(0, 1000) % N;
-    //    if (has_primary && r == N - 1)
-    //        return config.primary;
-    //    else
-    //        return config.secondaries[r];
-    //}
 }
 
 // ERR_OBJECT_NOT_FOUND  not in cache.
 // ERR_IO_PENDING        in cache but invalid, remove from cache.
 // ERR_OK                in cache and valid
-error_code partition_resolver_simple::get_address(int partition_index, /*out*/ rpc_address &addr)
+error_code partition_resolver_simple::get_address(int partition_index,
+                                                  bool allow_stale_read,
+                                                  /*out*/ rpc_address &addr)
 {
     // partition_configuration config;
     {
@@ -458,7 +448,7 @@ error_code partition_resolver_simple::get_address(int partition_index, /*out*/ r
         auto it = _config_cache.find(partition_index);
         if (it != _config_cache.end()) {
             // config = it->second->config;
-            addr = get_address(it->second->config);
+            addr = get_address(it->second->config, allow_stale_read);
             if (addr.is_invalid()) {
                 return ERR_IO_PENDING;
             } else {
@@ -41,6 +41,8 @@
 #include <dsn/service_api_c.h>
 #include <dsn/cpp/serialization_helper/dsn.layer2_types.h>
 
+class replication_service_test_app;
+
 namespace dsn {
 namespace dist {
 #pragma pack(push, 4)
@@ -52,6 +54,7 @@ public:
     virtual ~partition_resolver_simple();
 
     virtual void resolve(uint64_t partition_hash,
+                         bool allow_stale_read,
                          std::function<void(resolve_result &&)> &&callback,
                          int timeout_ms) override;
 
@@ -62,6 +65,8 @@ public:
     int get_partition_count() const { return _app_partition_count; }
 
 private:
+    friend class ::replication_service_test_app;
+
     struct partition_info
     {
         int timeout_count;
@@ -79,6 +84,7 @@ private:
     {
         int partition_index;
         uint64_t partition_hash;
+        bool allow_stale_read;
         callback_t callback;
         int timeout_ms;         // init timeout
         uint64_t timeout_ts_us; // timeout at this timing point
@@ -107,8 +113,8 @@ private:
 
 private:
     // local routines
-    rpc_address get_address(const partition_configuration &config) const;
-    error_code get_address(int partition_index, /*out*/ rpc_address &addr);
+    rpc_address get_address(const partition_configuration &config, bool allow_stale_read) const;
+    error_code get_address(int partition_index, bool allow_stale_read, /*out*/ rpc_address &addr);
     void handle_pending_requests(std::deque<request_context_ptr> &reqs, error_code err);
     void clear_all_pending_requests();
 
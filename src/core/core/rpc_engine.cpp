@@ -46,62 +46,115 @@ namespace dsn {
 
 DEFINE_TASK_CODE(LPC_RPC_TIMEOUT, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
 
-class rpc_timeout_task : public task
+rpc_client_matcher::rpc_client_matcher(rpc_engine *engine)
+    : _engine(engine), _next_sweep_ms(UINT64_MAX), _sweep_requests(0), _overflow_count(0)
 {
-public:
-    rpc_timeout_task(rpc_client_matcher *matcher, uint64_t id, service_node *node)
-        : task(LPC_RPC_TIMEOUT, 0, node)
-    {
-        _matcher = matcher;
-        _id = id;
+    uint64_t slot_count = dsn_config_get_value_uint64(
+        "network",
+        "rpc_matcher_slot_count",
+        16384,
+        "slot count of the table matching rpc responses with calls, rounded up to power of 2");
+    uint64_t n = 1;
+    while (n < slot_count) {
+        n <<= 1;
     }
+    _slots.reset(new match_slot[n]);
+    _slot_mask = n - 1;
 
-    virtual void exec() { _matcher->on_rpc_timeout(_id); }
-private:
-    // use the following if the matcher is per rpc session
-    // rpc_client_matcher_ptr _matcher;
+    uint64_t word_count = (n + 63) / 64;
+    _occupied.reset(new std::atomic<uint64_t>[word_count]);
+    for (uint64_t i = 0; i < word_count; i++) {
+        _occupied[i].store(0);
+    }
+    _summary_count = (word_count + 63) / 64;
+    _occupied_summary.reset(new std::atomic<uint64_t>[_summary_count]);
+    for (uint64_t i = 0; i < _summary_count; i++) {
+        _occupied_summary[i].store(0);
+    }
 
-    rpc_client_matcher *_matcher;
-    uint64_t _id;
-};
+    _sweep_interval_ms =
+        dsn_config_get_value_uint64("network",
+                                    "rpc_timeout_sweep_interval_ms",
+                                    10,
+                                    "min interval of the sweeps retiring the timed out rpc calls");
+}
 
 rpc_client_matcher::~rpc_client_matcher()
 {
-    for (int i = 0; i < MATCHER_BUCKET_NR; i++) {
-        dassert(_requests[i].size() == 0,
+    for (uint64_t i = 0; i <= _slot_mask; i++) {
+        dassert(_slots[i].key.load() == 0,
                 "all rpc entries must be removed before the matcher ends");
     }
+    dassert(_overflow.size() == 0, "all rpc entries must be removed before the matcher ends");
 }
 
-bool rpc_client_matcher::on_recv_reply(network *net, uint64_t key, message_ex *reply, int delay_ms)
+void rpc_client_matcher::mark_occupied(uint64_t slot)
 {
-    rpc_response_task_ptr call;
-    task_ptr timeout_task;
-    int bucket_index = key % MATCHER_BUCKET_NR;
+    uint64_t w = slot >> 6;
+    _occupied[w].fetch_or(1ULL << (slot & 63));
+
+    // the sweeper clears a summary bit before checking the word again, so a bit seen set here
+    // is either kept or set back by the sweeper
+    uint64_t summary_bit = 1ULL << (w & 63);
+    if ((_occupied_summary[w >> 6].load() & summary_bit) == 0) {
+        _occupied_summary[w >> 6].fetch_or(summary_bit);
+    }
+}
 
-    {
-        utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_requests_lock[bucket_index]);
-        auto it = _requests[bucket_index].find(key);
-        if (it != _requests[bucket_index].end()) {
-            call = std::move(it->second.resp_task);
-            timeout_task = std::move(it->second.timeout_task);
-            _requests[bucket_index].erase(it);
-        } else {
-            if (reply) {
-                dassert(reply->get_count() == 0,
-                        "reply should not be referenced by anybody so far");
-                delete reply;
-            }
-            return false;
+void rpc_client_matcher::clear_occupied(uint64_t slot)
+{
+    _occupied[slot >> 6].fetch_and(~(1ULL << (slot & 63)));
+}
+
+bool rpc_client_matcher::take(uint64_t key, /*out*/ match_entry &entry)
+{
+    match_slot &s = _slots[key & _slot_mask];
+    while (true) {
+        uint64_t k = key;
+        if (s.key.compare_exchange_strong(k, slot_busy, std::memory_order_acquire)) {
+            entry.resp_task = std::move(s.resp_task);
+            entry.deadline_ms = s.deadline_ms.load(std::memory_order_relaxed);
+            entry.timeout_ts_ms = s.timeout_ts_ms;
+            clear_occupied(key & _slot_mask);
+            s.key.store(0, std::memory_order_release);
+            return true;
+        }
+
+        // otherwise the slot is being updated by the sweeper or claimed by another call,
+        // both of which end in no time
+        if (k != slot_busy) {
+            break;
         }
     }
 
-    dbg_dassert(call != nullptr, "rpc response task cannot be empty");
-    dbg_dassert(timeout_task != nullptr, "rpc timeout task cannot be empty");
+    if (_overflow_count.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
 
-    if (timeout_task != task::get_current_task()) {
-        timeout_task->cancel(false); // no need to wait
+    utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_overflow_lock);
+    auto it = _overflow.find(key);
+    if (it == _overflow.end()) {
+        return false;
     }
+    entry = std::move(it->second);
+    _overflow.erase(it);
+    _overflow_count.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool rpc_client_matcher::on_recv_reply(network *net, uint64_t key, message_ex *reply, int delay_ms)
+{
+    match_entry entry;
+    if (!take(key, entry)) {
+        if (reply) {
+            dassert(reply->get_count() == 0, "reply should not be referenced by anybody so far");
+            delete reply;
+        }
+        return false;
+    }
+
+    rpc_response_task_ptr call = std::move(entry.resp_task);
+    dbg_dassert(call != nullptr, "rpc response task cannot be empty");
 
     auto req = call->get_request();
     auto spec = task_spec::get(req->local_rpc_code);
@@ -146,6 +199,10 @@ bool rpc_client_matcher::on_recv_reply(network *net, uint64_t key, message_ex *r
                 break;
             }
             break;
+        case HOST_TYPE_URI:
+            // e.g., stale reads forwarded by a secondary to the primary, which the resolver
+            // does not need to know
+            break;
         default:
             dassert(false, "not implemented");
             break;
@@ -174,6 +231,8 @@ bool rpc_client_matcher::on_recv_reply(network *net, uint64_t key, message_ex *r
                     break;
                 }
                 break;
+            case HOST_TYPE_URI:
+                break;
             default:
                 dassert(false, "not implemented");
                 break;
@@ -196,119 +255,199 @@ bool rpc_client_matcher::on_recv_reply(network *net, uint64_t key, message_ex *r
     return true;
 }
 
-void rpc_client_matcher::on_rpc_timeout(uint64_t key)
+// the call is found expired by the sweeper, which has removed it from the table unless it is
+// to be resent
+static bool need_resend(uint64_t timeout_ts_ms, const rpc_response_task_ptr &call, uint64_t now_ms)
 {
-    rpc_response_task_ptr call;
-    int bucket_index = key % MATCHER_BUCKET_NR;
-    uint64_t timeout_ts_ms;
-    bool resend = false;
+    // resend when timeout is not yet, and the call is not cancelled
+    // TODO: time overflow
+    return timeout_ts_ms > 0 && now_ms < timeout_ts_ms && call->state() == TASK_STATE_READY;
+}
 
-    {
-        utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_requests_lock[bucket_index]);
-        auto it = _requests[bucket_index].find(key);
-        if (it != _requests[bucket_index].end()) {
-            timeout_ts_ms = it->second.timeout_ts_ms;
-            call = it->second.resp_task;
-            if (timeout_ts_ms == 0) {
-                _requests[bucket_index].erase(it);
-            }
+void rpc_client_matcher::on_rpc_timeout(uint64_t key, match_entry &entry, uint64_t now_ms)
+{
+    dbg_dassert(
+        entry.resp_task != nullptr, "rpc response task is missing for rpc request %" PRIu64, key);
 
-            // resend is enabled
-            else {
-                // do it in next check so we can do expensive things
-                // outside of the lock
-                resend = true;
-            }
-        } else {
+    // if timeout
+    if (entry.timeout_ts_ms == 0) {
+        entry.resp_task->enqueue(ERR_TIMEOUT, nullptr);
+        return;
+    }
+
+    auto req = entry.resp_task->get_request();
+    dinfo("resend request message for rpc trace_id = %016" PRIx64 ", key = %" PRIu64,
+          req->header->trace_id,
+          key);
+
+    // resend without handling rpc_matcher, use the same request_id
+    _engine->call_ip(req->to_address, req, nullptr);
+}
+
+void rpc_client_matcher::arm_sweep(uint64_t deadline_ms)
+{
+    uint64_t next_ms = _next_sweep_ms.load();
+    while (deadline_ms < next_ms) {
+        if (_next_sweep_ms.compare_exchange_weak(next_ms, deadline_ms)) {
+            uint64_t now_ms = dsn_now_ms();
+            task *sweep_task(
+                new raw_task(LPC_RPC_TIMEOUT, [this]() { sweep(); }, 0, _engine->node()));
+            sweep_task->set_delay(
+                deadline_ms > now_ms ? static_cast<int>(deadline_ms - now_ms) : 0);
+            sweep_task->enqueue();
             return;
         }
     }
+}
 
-    dbg_dassert(call != nullptr, "rpc response task is missing for rpc request %" PRIu64, key);
+void rpc_client_matcher::sweep()
+{
+    // only one sweep runs at a time, and it sweeps again for the ones requested meanwhile,
+    // as they may be armed for the calls it has just missed
+    if (_sweep_requests.fetch_add(1) > 0) {
+        return;
+    }
 
-    // if timeout
-    if (!resend) {
-        call->enqueue(ERR_TIMEOUT, nullptr);
+    int handled = 1;
+    do {
+        sweep_once();
+    } while ((handled = _sweep_requests.fetch_sub(handled) - handled) > 0);
+}
+
+void rpc_client_matcher::sweep_slot(uint64_t slot, uint64_t now_ms, /*inout*/ uint64_t &next_ms)
+{
+    match_slot &s = _slots[slot];
+    uint64_t k = s.key.load(std::memory_order_acquire);
+    if (k == 0 || k == slot_busy) {
         return;
     }
 
-    // prepare resend context and check again
-    uint64_t now_ts_ms = dsn_now_ms();
+    uint64_t deadline_ms = s.deadline_ms.load(std::memory_order_relaxed);
+    if (deadline_ms > now_ms) {
+        next_ms = std::min(next_ms, deadline_ms);
+        return;
+    }
 
-    // resend when timeout is not yet, and the call is not cancelled
-    // TODO: time overflow
-    resend = (now_ts_ms < timeout_ts_ms && call->state() == TASK_STATE_READY);
+    // lose to the reply
+    if (!s.key.compare_exchange_strong(k, slot_busy, std::memory_order_acquire)) {
+        return;
+    }
 
-    // TODO: memory pool for this task
-    task_ptr new_timeout_task;
-    if (resend) {
-        new_timeout_task = new rpc_timeout_task(this, key, call->node());
+    if (need_resend(s.timeout_ts_ms, s.resp_task, now_ms)) {
+        // use rest of the timeout to resend once only
+        _expired.emplace_back(k, match_entry{s.resp_task, deadline_ms, s.timeout_ts_ms});
+        s.deadline_ms.store(s.timeout_ts_ms, std::memory_order_relaxed);
+        next_ms = std::min(next_ms, s.timeout_ts_ms);
+        s.timeout_ts_ms = 0;
+        s.key.store(k, std::memory_order_release);
+    } else {
+        _expired.emplace_back(k, match_entry{std::move(s.resp_task), deadline_ms, 0});
+        clear_occupied(slot);
+        s.key.store(0, std::memory_order_release);
     }
+}
 
-    {
-        utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_requests_lock[bucket_index]);
-        auto it = _requests[bucket_index].find(key);
-        if (it != _requests[bucket_index].end()) {
-            // timeout
-            if (!resend) {
-                _requests[bucket_index].erase(it);
+void rpc_client_matcher::sweep_once()
+{
+    // calls registered from now on arm their own sweeps if needed, as this one may miss them
+    _next_sweep_ms.store(UINT64_MAX);
+
+    uint64_t now_ms = dsn_now_ms();
+    uint64_t next_ms = UINT64_MAX;
+    for (uint64_t si = 0; si < _summary_count; si++) {
+        uint64_t words = _occupied_summary[si].load();
+        while (words != 0) {
+            uint64_t j = __builtin_ctzll(words);
+            words &= words - 1;
+
+            uint64_t w = (si << 6) + j;
+            uint64_t bits = _occupied[w].load();
+            if (bits == 0) {
+                // set back if a slot of the word is claimed meanwhile, whose call arms its own
+                // sweep
+                _occupied_summary[si].fetch_and(~(1ULL << j));
+                if (_occupied[w].load() != 0) {
+                    _occupied_summary[si].fetch_or(1ULL << j);
+                }
+                continue;
             }
 
-            // resend
-            else {
-                // reset timeout task
-                it->second.timeout_task = new_timeout_task;
+            while (bits != 0) {
+                uint64_t i = __builtin_ctzll(bits);
+                bits &= bits - 1;
+                sweep_slot((w << 6) + i, now_ms, next_ms);
             }
         }
+    }
 
-        // response is received
-        else {
-            resend = false;
+    if (_overflow_count.load(std::memory_order_acquire) > 0) {
+        utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_overflow_lock);
+        for (auto it = _overflow.begin(); it != _overflow.end();) {
+            match_entry &e = it->second;
+            if (e.deadline_ms > now_ms) {
+                next_ms = std::min(next_ms, e.deadline_ms);
+                ++it;
+            } else if (need_resend(e.timeout_ts_ms, e.resp_task, now_ms)) {
+                _expired.emplace_back(it->first, e);
+                e.deadline_ms = e.timeout_ts_ms;
+                next_ms = std::min(next_ms, e.deadline_ms);
+                e.timeout_ts_ms = 0;
+                ++it;
+            } else {
+                _expired.emplace_back(it->first, std::move(e));
+                _expired.back().second.timeout_ts_ms = 0;
+                it = _overflow.erase(it);
+                _overflow_count.fetch_sub(1, std::memory_order_relaxed);
+            }
         }
     }
 
-    if (resend) {
-        auto req = call->get_request();
-        dinfo("resend request message for rpc trace_id = %016" PRIx64 ", key = %" PRIu64,
-              req->header->trace_id,
-              key);
-
-        // resend without handling rpc_matcher, use the same request_id
-        _engine->call_ip(req->to_address, req, nullptr);
+    for (auto &kv : _expired) {
+        on_rpc_timeout(kv.first, kv.second, now_ms);
+    }
+    _expired.clear();
 
-        // use rest of the timeout to resend once only
-        new_timeout_task->set_delay(static_cast<int>(timeout_ts_ms - now_ts_ms));
-        new_timeout_task->enqueue();
+    if (next_ms != UINT64_MAX) {
+        arm_sweep(std::max(next_ms, now_ms + _sweep_interval_ms));
     }
 }
 
 void rpc_client_matcher::on_call(message_ex *request, const rpc_response_task_ptr &call)
 {
     message_header &hdr = *request->header;
-    int bucket_index = hdr.id % MATCHER_BUCKET_NR;
     auto sp = task_spec::get(request->local_rpc_code);
     int timeout_ms = hdr.client.timeout_ms;
+    uint64_t now_ms = dsn_now_ms();
     uint64_t timeout_ts_ms = 0;
 
     // reset timeout when resend is enabled
     if (sp->rpc_request_resend_timeout_milliseconds > 0 &&
         timeout_ms > sp->rpc_request_resend_timeout_milliseconds) {
-        timeout_ts_ms = dsn_now_ms() + timeout_ms; // non-zero for resend
+        timeout_ts_ms = now_ms + timeout_ms; // non-zero for resend
         timeout_ms = sp->rpc_request_resend_timeout_milliseconds;
     }
 
     dbg_dassert(call != nullptr, "rpc response task cannot be empty");
-    task *timeout_task(new rpc_timeout_task(this, hdr.id, call->node()));
-
-    {
-        utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_requests_lock[bucket_index]);
-        auto pr =
-            _requests[bucket_index].emplace(hdr.id, match_entry{call, timeout_task, timeout_ts_ms});
+    uint64_t deadline_ms = now_ms + timeout_ms;
+
+    match_slot &s = _slots[hdr.id & _slot_mask];
+    uint64_t k = 0;
+    if (s.key.compare_exchange_strong(k, slot_busy, std::memory_order_acquire)) {
+        s.resp_task = call;
+        s.deadline_ms.store(deadline_ms, std::memory_order_relaxed);
+        s.timeout_ts_ms = timeout_ts_ms;
+        s.key.store(hdr.id, std::memory_order_release);
+        mark_occupied(hdr.id & _slot_mask);
+    } else {
+        // the slot is still occupied by an old call
+        dassert(k != hdr.id, "the message is already on the fly!!!");
+        utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_overflow_lock);
+        auto pr = _overflow.emplace(hdr.id, match_entry{call, deadline_ms, timeout_ts_ms});
         dassert(pr.second, "the message is already on the fly!!!");
+        _overflow_count.fetch_add(1, std::memory_order_release);
     }
 
-    timeout_task->set_delay(timeout_ms);
-    timeout_task->enqueue();
+    arm_sweep(deadline_ms);
 }
 
 //----------------------------------------------------------------------------------------------
@@ -705,6 +844,7 @@ void rpc_engine::call_uri(rpc_address addr, message_ex *request, const rpc_respo
         }
 
         resolver->resolve(hdr.client.partition_hash,
+                          hdr.context.u.allow_stale_read,
                           [=](dist::partition_resolver::resolve_result &&result) mutable {
                               if (result.err == ERR_OK) {
                                   // update gpid when necessary
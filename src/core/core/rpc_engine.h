@@ -51,17 +51,27 @@ class uri_resolver_manager;
 // (due to
 // less std::shared_ptr<rpc_client_matcher> operations in rpc_timeout_task
 //
-#define MATCHER_BUCKET_NR 13
+// outstanding calls are kept in a preallocated open-addressing table indexed by the request id,
+// whose slots are claimed and released with a CAS on the slot key, so neither on_call nor
+// on_recv_reply allocates or takes a shared lock. as the request ids are increasing, a slot is
+// only found occupied when the call on it outlives [network] rpc_matcher_slot_count newer calls,
+// and then the call goes to a small overflow map.
+//
+// instead of a timer task per call, timeouts are retired in bulk by a sweep of the table, which
+// is armed for the earliest deadline but at most once per [network] rpc_timeout_sweep_interval_ms.
+// the occupied slots are tracked in a two-level bitmap, so a sweep only visits the calls on the
+// fly rather than all the slots.
+//
 class rpc_client_matcher : public ref_counter
 {
 public:
-    rpc_client_matcher(rpc_engine *engine) : _engine(engine) {}
+    rpc_client_matcher(rpc_engine *engine);
 
     ~rpc_client_matcher();
 
     //
     // when a two-way RPC call is made, register the requst id and the callback
-    // which also registers a timer for timeout tracking
+    // which is also tracked by the sweeps for timeout
     //
     void on_call(message_ex *request, const rpc_response_task_ptr &call);
 
@@ -76,20 +86,59 @@ public:
     bool on_recv_reply(network *net, uint64_t key, message_ex *reply, int delay_ms);
 
 private:
-    friend class rpc_timeout_task;
-    void on_rpc_timeout(uint64_t key);
-
-private:
-    rpc_engine *_engine;
     struct match_entry
     {
         rpc_response_task_ptr resp_task;
-        task_ptr timeout_task;
+        uint64_t deadline_ms;
         uint64_t timeout_ts_ms; // > 0 for auto-resent msgs
     };
-    typedef std::unordered_map<uint64_t, match_entry> rpc_requests;
-    rpc_requests _requests[MATCHER_BUCKET_NR];
-    ::dsn::utils::ex_lock_nr_spin _requests_lock[MATCHER_BUCKET_NR];
+
+    struct match_slot
+    {
+        match_slot() : key(0), deadline_ms(0), timeout_ts_ms(0) {}
+
+        std::atomic<uint64_t> key; // 0 if free, slot_busy if being updated by its owner
+        std::atomic<uint64_t> deadline_ms;
+        uint64_t timeout_ts_ms;
+        rpc_response_task_ptr resp_task;
+    };
+
+    static const uint64_t slot_busy = ~0ULL;
+
+    // remove the call of the key from the table, return false if not found
+    bool take(uint64_t key, /*out*/ match_entry &entry);
+
+    // set after the slot is claimed, and cleared before it is released by its owner
+    void mark_occupied(uint64_t slot);
+    void clear_occupied(uint64_t slot);
+
+    // make sure a sweep happens no later than deadline_ms
+    void arm_sweep(uint64_t deadline_ms);
+    void sweep();
+    void sweep_once();
+    void sweep_slot(uint64_t slot, uint64_t now_ms, /*inout*/ uint64_t &next_ms);
+    void on_rpc_timeout(uint64_t key, match_entry &entry, uint64_t now_ms);
+
+private:
+    rpc_engine *_engine;
+    std::unique_ptr<match_slot[]> _slots;
+    uint64_t _slot_mask;
+    uint64_t _sweep_interval_ms;
+
+    // bit i of _occupied[w] is set when slot (w * 64 + i) holds a call, and bit j of
+    // _occupied_summary[s] is set when _occupied[s * 64 + j] may be non-zero, which is cleared
+    // by the sweeps only
+    std::unique_ptr<std::atomic<uint64_t>[]> _occupied;
+    std::unique_ptr<std::atomic<uint64_t>[]> _occupied_summary;
+    uint64_t _summary_count;
+
+    std::atomic<uint64_t> _next_sweep_ms; // UINT64_MAX if no sweep is armed
+    std::atomic<int> _sweep_requests;
+    std::vector<std::pair<uint64_t, match_entry>> _expired; // used by sweep only
+
+    std::atomic<int> _overflow_count;
+    std::unordered_map<uint64_t, match_entry> _overflow;
+    ::dsn::utils::ex_lock_nr_spin _overflow_lock;
 };
 
 class rpc_server_dispatcher
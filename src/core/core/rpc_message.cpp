@@ -55,6 +55,8 @@ message_ex::message_ex()
       local_rpc_code(::dsn::TASK_CODE_INVALID),
       hdr_format(NET_HDR_INVALID),
       send_retry_count(0),
+      send_body_crc32(0),
+      send_body_compress_type(0),
       _rw_index(-1),
       _rw_offset(0),
       _rw_committed(true),
@@ -247,12 +249,18 @@ message_ex *message_ex::copy_and_prepare_send(bool clone_content)
     auto copy = this->copy(clone_content, false);
 
     if (_is_read) {
-        // the message_header is hidden ahead of the buffer, expose it to buffer
-        dassert(buffers.size() == 1, "there must be only one buffer for read msg");
-        dassert((char *)header + sizeof(message_header) == (char *)buffers[0].data(),
-                "header and content must be contigous");
+        if ((char *)header == buffers[0].data()) {
+            // the message_header is standalone in the first buffer, which is already the
+            // layout of a sending message
+            dassert(buffers.size() == 2, "there must be header and content for read msg");
+        } else {
+            // the message_header is hidden ahead of the buffer, expose it to buffer
+            dassert(buffers.size() == 1, "there must be only one buffer for read msg");
+            dassert((char *)header + sizeof(message_header) == (char *)buffers[0].data(),
+                    "header and content must be contigous");
 
-        copy->buffers[0] = copy->buffers[0].range(-(int)sizeof(message_header));
+            copy->buffers[0] = copy->buffers[0].range(-(int)sizeof(message_header));
+        }
 
         // switch the flag
         copy->_is_read = false;
@@ -428,6 +436,24 @@ void message_ex::write_commit(size_t size)
     this->header->body_length += (int)size;
 }
 
+void message_ex::write_append(const blob &data)
+{
+    dassert(!this->_is_read && this->_rw_committed,
+            "there are pending msg write not committed"
+            ", please invoke dsn_msg_write_next and dsn_msg_write_commit in pairs");
+    if (data.length() == 0) {
+        return;
+    }
+
+    this->_rw_index++;
+    this->_rw_offset = data.length();
+    this->buffers.push_back(data);
+    this->header->body_length += data.length();
+
+    dassert(this->_rw_index + 1 == (int)this->buffers.size(),
+            "message write buffer count is not right");
+}
+
 bool message_ex::read_next(void **ptr, size_t *size)
 {
     // printf("%p %s %d\n", this, __FUNCTION__, utils::get_current_tid());
@@ -121,6 +121,9 @@ task::task(dsn::task_code code, int hash, service_node *node)
     _wait_for_cancel = false;
     _is_null = false;
     next = nullptr;
+    is_strand_serialized = false;
+    timer_expire_tick = 0;
+    timer_svc.store(nullptr, std::memory_order_relaxed);
 
     if (node != nullptr) {
         _node = node;
@@ -368,6 +371,13 @@ bool task::cancel(bool wait_until_finished, /*out*/ bool *finished /*= nullptr*/
     if (finished)
         *finished = finish;
 
+    // let the timer service drop the cancelled task right away instead of on expiration,
+    // notice this may release the last reference of the task
+    timer_service *timer = succ ? timer_svc.load(std::memory_order_acquire) : nullptr;
+    if (timer != nullptr) {
+        timer->remove_timer(this);
+    }
+
     return succ;
 }
 
@@ -42,7 +42,7 @@ using namespace dsn::utils;
 namespace dsn {
 
 task_worker_pool::task_worker_pool(const threadpool_spec &opts, task_engine *owner)
-    : _spec(opts), _owner(owner), _node(owner->node()), _is_running(false)
+    : _spec(opts), _owner(owner), _node(owner->node()), _is_running(false), _next_queue(0)
 {
 }
 
@@ -60,6 +60,11 @@ void task_worker_pool::create()
         }
         _queues.push_back(q);
 
+        // work stealing queues are always bound to a single worker, even for shared pools
+        if (i == 0 && q->is_work_stealing()) {
+            qCount = _spec.worker_count;
+        }
+
         if (_spec.admission_controller_factory_name != "") {
             admission_controller *controller = factory_store<admission_controller>::create(
                 _spec.admission_controller_factory_name.c_str(),
@@ -78,7 +83,8 @@ void task_worker_pool::create()
         }
     }
 
-    for (int i = 0; i < qCount; ++i) {
+    int tCount = _spec.partitioned ? _spec.worker_count : 1;
+    for (int i = 0; i < tCount; ++i) {
         auto tsvc = factory_store<timer_service>::create(
                 service_engine::instance().spec().timer_factory_name.c_str(),
             PROVIDER_TYPE_MAIN,
@@ -100,7 +106,7 @@ void task_worker_pool::create()
                 it->c_str(), PROVIDER_TYPE_ASPECT, this, q, i, worker);
         }
         task_worker::on_create.execute(worker);
-        q->set_owner_worker(spec().partitioned ? worker : nullptr);
+        q->set_owner_worker(qCount == 1 ? nullptr : worker);
 
         _workers.push_back(worker);
     }
@@ -151,10 +157,20 @@ void task_worker_pool::enqueue(task *t)
             "worker pool %s must be started before enqueue task %s",
             spec().name.c_str(),
             t->spec().name.c_str());
-    unsigned int idx =
-        (_spec.partitioned
-             ? static_cast<unsigned int>(t->hash()) % static_cast<unsigned int>(_queues.size())
-             : 0);
+    unsigned int idx = 0;
+    if (_spec.partitioned) {
+        idx = static_cast<unsigned int>(t->hash()) % static_cast<unsigned int>(_queues.size());
+    } else if (_queues.size() > 1) {
+        // per-worker queues of a shared pool: keep the task local if enqueued by
+        // one of our workers, or else spread the tasks in round-robin
+        task_worker *current = task_worker::current();
+        if (current != nullptr && current->pool() == this) {
+            idx = static_cast<unsigned int>(current->index());
+        } else {
+            idx = _next_queue.fetch_add(1, std::memory_order_relaxed) %
+                  static_cast<unsigned int>(_queues.size());
+        }
+    }
     return _queues[idx]->enqueue_internal(t);
 }
 
@@ -93,6 +93,7 @@ private:
     std::vector<timer_service *> _per_queue_timer_svcs;
 
     bool _is_running;
+    std::atomic<unsigned int> _next_queue;
 };
 
 class task_engine
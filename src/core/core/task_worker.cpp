@@ -52,6 +52,20 @@ task_worker::task_worker(task_worker_pool *pool,
 
     _thread = nullptr;
     _processed_task_count = 0;
+
+    if (q->is_work_stealing()) {
+        std::string prefix = pool->spec().name + '.' + std::to_string(index);
+        _steal_count.init_global_counter(pool->node()->full_name(),
+                                         "engine",
+                                         (prefix + ".steal.count").c_str(),
+                                         COUNTER_TYPE_RATE,
+                                         "tasks stolen from sibling queues per second");
+        _idle_count.init_global_counter(pool->node()->full_name(),
+                                        "engine",
+                                        (prefix + ".idle.count").c_str(),
+                                        COUNTER_TYPE_RATE,
+                                        "times per second the worker finds its own queue empty");
+    }
 }
 
 task_worker::~task_worker()
@@ -202,6 +216,12 @@ void task_worker::loop()
 
         q->decrease_count(batch_size);
 
+        if (batch_size == 0 && q->is_work_stealing()) {
+            _idle_count->increment();
+            batch_size = best_batch_size;
+            task = steal_from_siblings(batch_size);
+        }
+
 #ifndef NDEBUG
         int count = 0;
 #endif
@@ -226,6 +246,28 @@ void task_worker::loop()
     }
 }
 
+task *task_worker::steal_from_siblings(/*inout*/ int &batch_size)
+{
+    auto &queues = pool()->queues();
+    int count = static_cast<int>(queues.size());
+    int max_batch_size = batch_size;
+
+    // start from the next sibling so that the idle workers do not all rush to the same victim
+    for (int i = 1; i < count; i++) {
+        task_queue *victim = queues[(_index + i) % count];
+        batch_size = max_batch_size;
+        task *head = victim->steal(batch_size);
+        if (batch_size > 0) {
+            victim->decrease_count(batch_size);
+            _steal_count->add(batch_size);
+            return head;
+        }
+    }
+
+    batch_size = 0;
+    return nullptr;
+}
+
 const threadpool_spec &task_worker::pool_spec() const { return pool()->spec(); }
 
 } // end namespace
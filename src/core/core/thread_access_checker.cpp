@@ -26,20 +26,35 @@
 #include <dsn/utility/process_utils.h>
 #include <dsn/tool-api/thread_access_checker.h>
 #include <dsn/c/api_utilities.h>
+#include <dsn/tool-api/task.h>
 
 namespace dsn {
 
-thread_access_checker::thread_access_checker() { _access_thread_id_inited = false; }
+thread_access_checker::thread_access_checker()
+{
+    _access_strand_hash = 0;
+    _access_thread_id_inited = false;
+}
 
 thread_access_checker::~thread_access_checker() { _access_thread_id_inited = false; }
 
 void thread_access_checker::only_one_thread_access()
 {
+    // the tasks of a strand in work stealing queues are run one by one, but maybe by different
+    // workers, so the ownership is handed over between them only
+    task *current = task::get_current_task();
+    int strand_hash = (current != nullptr && current->is_strand_serialized) ? current->hash() : 0;
+
     if (_access_thread_id_inited) {
-        dassert(::dsn::utils::get_current_tid() == _access_thread_id,
+        if (::dsn::utils::get_current_tid() == _access_thread_id) {
+            return;
+        }
+        dassert(strand_hash != 0 && strand_hash == _access_strand_hash,
                 "the service is assumed to be accessed by one thread only!");
+        _access_thread_id = ::dsn::utils::get_current_tid();
     } else {
         _access_thread_id = ::dsn::utils::get_current_tid();
+        _access_strand_hash = strand_hash;
         _access_thread_id_inited = true;
     }
 }
@@ -39,6 +39,7 @@
 #include <dsn/service_api_cpp.h>
 
 #include <gtest/gtest.h>
+#include <atomic>
 #include "test_utils.h"
 
 using namespace ::dsn;
@@ -141,6 +142,33 @@ TEST(core, aio)
     utils::filesystem::remove_path("tmp");
 }
 
+TEST(core, aio_flush)
+{
+    // if in dsn_mimic_app() and disk_io_mode == IOE_PER_QUEUE
+    if (task::get_current_disk() == nullptr)
+        return;
+
+    const char *buffer = "hello, world";
+    int len = (int)strlen(buffer);
+
+    auto fp = file::open("tmp", O_RDWR | O_CREAT | O_BINARY, 0666);
+    EXPECT_TRUE(fp != nullptr);
+
+    auto t = ::dsn::file::write(fp, buffer, len, 0, LPC_AIO_TEST, nullptr, nullptr);
+    t->wait();
+    EXPECT_TRUE(t->error() == ERR_OK);
+
+    t = ::dsn::file::flush(fp, LPC_AIO_TEST, nullptr, nullptr);
+    t->wait();
+    EXPECT_TRUE(t->error() == ERR_OK);
+    EXPECT_TRUE(t->get_transferred_size() == 0);
+
+    auto err = file::close(fp);
+    EXPECT_TRUE(err == ERR_OK);
+
+    utils::filesystem::remove_path("tmp");
+}
+
 TEST(core, aio_share)
 {
     // if in dsn_mimic_app() and disk_io_mode == IOE_PER_QUEUE
@@ -206,3 +234,205 @@ TEST(core, operation_failed)
 
     EXPECT_TRUE(utils::filesystem::remove_path("tmp_test_file"));
 }
+
+TEST(core, aio_many_files)
+{
+    // if in dsn_mimic_app() and disk_io_mode == IOE_PER_QUEUE
+    if (task::get_current_disk() == nullptr)
+        return;
+
+    // with a few concurrent ops per file, the files together keep more iocbs in flight than
+    // the native aio context holds, see config-test-native-aio.ini
+    const int file_count = 16;
+    const int write_count = 50;
+    const int len = 16;
+    std::vector<disk_file *> files;
+    for (int i = 0; i < file_count; i++) {
+        auto fp = file::open(("tmp." + std::to_string(i)).c_str(),
+                             O_RDWR | O_CREAT | O_TRUNC | O_BINARY,
+                             0666);
+        ASSERT_TRUE(fp != nullptr);
+        files.push_back(fp);
+    }
+
+    std::vector<std::string> contents(file_count);
+    std::atomic<int> callback_count(0);
+    std::atomic<int> fail_count(0);
+    std::list<aio_task_ptr> tasks;
+    for (int j = 0; j < write_count; j++) {
+        for (int i = 0; i < file_count; i++) {
+            char buffer[len + 1];
+            snprintf(buffer, sizeof(buffer), "%07d-%07d\n", i, j);
+            contents[i].append(buffer, len);
+        }
+    }
+    for (int j = 0; j < write_count; j++) {
+        for (int i = 0; i < file_count; i++) {
+            auto t = ::dsn::file::write(files[i],
+                                        contents[i].data() + (size_t)j * len,
+                                        len,
+                                        (uint64_t)j * len,
+                                        LPC_AIO_TEST,
+                                        nullptr,
+                                        [&callback_count, &fail_count](error_code err, size_t n) {
+                                            if (err != ERR_OK || n != (size_t)len) {
+                                                ++fail_count;
+                                            }
+                                            ++callback_count;
+                                        });
+            tasks.push_back(t);
+        }
+    }
+    for (auto &t : tasks) {
+        t->wait();
+    }
+    ASSERT_EQ(file_count * write_count, callback_count.load());
+    ASSERT_EQ(0, fail_count.load());
+
+    std::vector<std::string> results(file_count, std::string((size_t)write_count * len, '\0'));
+    tasks.clear();
+    for (int i = 0; i < file_count; i++) {
+        tasks.push_back(::dsn::file::read(files[i],
+                                          &results[i][0],
+                                          write_count * len,
+                                          0,
+                                          LPC_AIO_TEST,
+                                          nullptr,
+                                          nullptr));
+    }
+    for (auto &t : tasks) {
+        t->wait();
+        ASSERT_EQ(ERR_OK, t->error());
+        ASSERT_EQ((size_t)write_count * len, t->get_transferred_size());
+    }
+    for (int i = 0; i < file_count; i++) {
+        ASSERT_EQ(contents[i], results[i]);
+        ASSERT_EQ(ERR_OK, file::close(files[i]));
+        utils::filesystem::remove_path("tmp." + std::to_string(i));
+    }
+}
+
+TEST(core, aio_overflow)
+{
+    // if in dsn_mimic_app() and disk_io_mode == IOE_PER_QUEUE
+    if (task::get_current_disk() == nullptr)
+        return;
+
+    // each file has one read in flight, so the files together hold many times the iocbs the
+    // native aio context takes, with only one reaper to complete them, see
+    // config-test-native-aio.ini; the reads complete without the reaper waiting for itself
+    const int file_count = 64;
+    const std::string content = "overflow";
+    std::vector<disk_file *> files;
+    for (int i = 0; i < file_count; i++) {
+        std::string name = "tmp.overflow." + std::to_string(i);
+        auto fp = file::open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0666);
+        ASSERT_TRUE(fp != nullptr);
+        auto t = ::dsn::file::write(
+            fp, content.data(), (int)content.size(), 0, LPC_AIO_TEST, nullptr, nullptr);
+        t->wait();
+        ASSERT_EQ(ERR_OK, t->error());
+        files.push_back(fp);
+    }
+
+    for (int round = 0; round < 4; round++) {
+        std::vector<std::string> results(file_count, std::string(content.size(), '\0'));
+        std::list<aio_task_ptr> tasks;
+        for (int i = 0; i < file_count; i++) {
+            tasks.push_back(::dsn::file::read(files[i],
+                                              &results[i][0],
+                                              (int)content.size(),
+                                              0,
+                                              LPC_AIO_TEST,
+                                              nullptr,
+                                              nullptr));
+        }
+        for (auto &t : tasks) {
+            ASSERT_TRUE(t->wait(10000));
+            ASSERT_EQ(ERR_OK, t->error());
+            ASSERT_EQ(content.size(), t->get_transferred_size());
+        }
+        for (int i = 0; i < file_count; i++) {
+            ASSERT_EQ(content, results[i]);
+        }
+    }
+
+    for (int i = 0; i < file_count; i++) {
+        ASSERT_EQ(ERR_OK, file::close(files[i]));
+        utils::filesystem::remove_path("tmp.overflow." + std::to_string(i));
+    }
+}
+
+TEST(core, aio_adjacent_writes)
+{
+    // if in dsn_mimic_app() and disk_io_mode == IOE_PER_QUEUE
+    if (task::get_current_disk() == nullptr)
+        return;
+
+    // writes issued back-to-back are queued behind the in-flight ones, and the adjacent ones
+    // are then batched by disk_engine::process_write, plain and vectored writes mixed
+    const int write_count = 64;
+    const int piece_len = 8;
+    const int vector_size = 3;
+    auto fp = file::open("tmp_adjacent", O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0666);
+    ASSERT_TRUE(fp != nullptr);
+
+    std::string content;
+    std::vector<uint64_t> offsets;
+    std::vector<int> lengths;
+    for (int i = 0; i < write_count; i++) {
+        int pieces = (i % 2 == 0) ? 1 : vector_size;
+        offsets.push_back(content.size());
+        lengths.push_back(pieces * piece_len);
+        for (int j = 0; j < pieces; j++) {
+            char piece[piece_len + 1];
+            snprintf(piece, sizeof(piece), "%04d-%02d\n", i, j);
+            content.append(piece, piece_len);
+        }
+    }
+
+    std::vector<std::atomic<int>> callback_counts(write_count);
+    std::vector<size_t> transferred(write_count, 0);
+    std::vector<error_code> errors(write_count, ERR_UNKNOWN);
+    std::vector<dsn_file_buffer_t> buffers(write_count * vector_size);
+    std::list<aio_task_ptr> tasks;
+    for (int i = 0; i < write_count; i++) {
+        callback_counts[i] = 0;
+        auto callback = [i, &callback_counts, &transferred, &errors](error_code err, size_t n) {
+            errors[i] = err;
+            transferred[i] = n;
+            ++callback_counts[i];
+        };
+        const char *data = content.data() + offsets[i];
+        if (lengths[i] == piece_len) {
+            tasks.push_back(
+                file::write(fp, data, piece_len, offsets[i], LPC_AIO_TEST, nullptr, callback));
+        } else {
+            dsn_file_buffer_t *bufs = &buffers[i * vector_size];
+            for (int j = 0; j < vector_size; j++) {
+                bufs[j].buffer = (void *)(data + j * piece_len);
+                bufs[j].size = piece_len;
+            }
+            tasks.push_back(file::write_vector(
+                fp, bufs, vector_size, offsets[i], LPC_AIO_TEST, nullptr, callback));
+        }
+    }
+    for (auto &t : tasks) {
+        t->wait();
+    }
+    for (int i = 0; i < write_count; i++) {
+        ASSERT_EQ(1, callback_counts[i].load()) << "write " << i;
+        ASSERT_EQ(ERR_OK, errors[i]) << "write " << i;
+        ASSERT_EQ((size_t)lengths[i], transferred[i]) << "write " << i;
+    }
+
+    std::string result(content.size(), '\0');
+    auto t = file::read(fp, &result[0], (int)result.size(), 0, LPC_AIO_TEST, nullptr, nullptr);
+    t->wait();
+    ASSERT_EQ(ERR_OK, t->error());
+    ASSERT_EQ(content.size(), t->get_transferred_size());
+    ASSERT_EQ(content, result);
+
+    ASSERT_EQ(ERR_OK, file::close(fp));
+    utils::filesystem::remove_path("tmp_adjacent");
+}
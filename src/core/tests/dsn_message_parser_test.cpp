@@ -0,0 +1,340 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for the compact header of dsn_message_parser.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "dsn_message_parser.h"
+#include "message_compressor.h"
+#include <dsn/tool-api/rpc_message.h>
+#include <dsn/tool-api/task_spec.h>
+#include <gtest/gtest.h>
+
+using namespace ::dsn;
+
+DEFINE_TASK_CODE_RPC(RPC_CODE_FOR_COMPACT_HEADER_TEST,
+                     TASK_PRIORITY_COMMON,
+                     ::dsn::THREAD_POOL_DEFAULT)
+
+static const char *test_body = "adaoihfeuifgggggisdosghkbvjhzxvdafdiofgeof";
+
+static void write_test_body(message_ex *msg)
+{
+    size_t data_size = strlen(test_body);
+    void *ptr;
+    size_t sz;
+    msg->write_next(&ptr, &sz, data_size);
+    memcpy(ptr, test_body, data_size);
+    msg->write_commit(data_size);
+}
+
+static std::string send_message(dsn_message_parser &parser, message_ex *msg)
+{
+    parser.prepare_on_send(msg);
+    std::vector<message_parser::send_buf> buffers(parser.get_buffer_count_on_send(msg));
+    int count = parser.get_buffers_on_send(msg, buffers.data());
+
+    std::string bytes;
+    for (int i = 0; i < count; ++i) {
+        bytes.append((const char *)buffers[i].buf, buffers[i].sz);
+    }
+    return bytes;
+}
+
+static message_ex *receive_message(dsn_message_parser &parser, const std::string &bytes)
+{
+    message_reader reader(4096);
+    char *ptr = reader.read_buffer_ptr(bytes.length());
+    memcpy(ptr, bytes.data(), bytes.length());
+    reader.mark_read(bytes.length());
+
+    int read_next;
+    message_ex *msg = parser.get_message_on_receive(&reader, read_next);
+    if (msg != nullptr) {
+        EXPECT_EQ(0u, reader._buffer_occupied);
+    }
+    return msg;
+}
+
+static std::string read_test_body(message_ex *msg)
+{
+    void *ptr;
+    size_t sz;
+    EXPECT_TRUE(msg->read_next(&ptr, &sz));
+    std::string body((const char *)ptr, sz);
+    msg->read_commit(sz);
+    return body;
+}
+
+TEST(core, dsn_message_parser_compact_header)
+{
+    dsn_message_parser client, server;
+    client.enable_compact_header();
+    server.enable_compact_header();
+
+    // the first request advertises the compact header with the full header
+    message_ptr request = message_ex::create_request(RPC_CODE_FOR_COMPACT_HEADER_TEST, 100, 1, 2);
+    request->header->trace_id = 12345;
+    request->header->gpid = gpid(3, 7);
+    request->header->from_address = rpc_address("127.0.0.1", 34801);
+    write_test_body(request.get());
+    std::string bytes = send_message(client, request.get());
+    ASSERT_EQ(sizeof(message_header) + strlen(test_body), bytes.length());
+
+    message_ptr received = receive_message(server, bytes);
+    ASSERT_NE(nullptr, received.get());
+    ASSERT_EQ(DSN_HDR_VERSION_COMPACT_ACCEPTED, received->header->hdr_version);
+    ASSERT_TRUE(server.is_sending_compact_header());
+    ASSERT_FALSE(client.is_sending_compact_header());
+
+    // the response is sent with the compact header, which carries the names of the codes
+    received->rpc_code();
+    message_ptr response = received->create_response();
+    response->header->server.error_code.local_code = ERR_OBJECT_NOT_FOUND;
+    response->header->server.error_code.local_hash = message_ex::s_local_hash;
+    strcpy(response->header->server.error_name, ERR_OBJECT_NOT_FOUND.to_string());
+    write_test_body(response.get());
+    bytes = send_message(server, response.get());
+    size_t first_compact_length = bytes.length();
+    ASSERT_GT(sizeof(message_header), first_compact_length - strlen(test_body));
+
+    received = receive_message(client, bytes);
+    ASSERT_NE(nullptr, received.get());
+    ASSERT_TRUE(client.is_sending_compact_header());
+    message_header &h = *received->header;
+    ASSERT_EQ(DSN_HDR_VERSION_COMPACT, h.hdr_version);
+    ASSERT_EQ(request->header->id, h.id);
+    ASSERT_EQ(12345u, h.trace_id);
+    ASSERT_EQ(gpid(3, 7), h.gpid);
+    ASSERT_FALSE(h.context.u.is_request);
+    ASSERT_EQ(strlen(test_body), h.body_length);
+    ASSERT_STREQ(response->header->rpc_name, h.rpc_name);
+    ASSERT_STREQ(ERR_OBJECT_NOT_FOUND.to_string(), h.server.error_name);
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND, received->error());
+    ASSERT_EQ(test_body, read_test_body(received.get()));
+
+    // the later requests are sent with the compact header, and only the first one carries
+    // the name of the rpc code
+    size_t last_length = 0;
+    for (int i = 0; i < 2; ++i) {
+        request = message_ex::create_request(RPC_CODE_FOR_COMPACT_HEADER_TEST, 200, 3, 4);
+        request->header->from_address = rpc_address("127.0.0.1", 34801);
+        write_test_body(request.get());
+        bytes = send_message(client, request.get());
+        ASSERT_LT(bytes.length(), first_compact_length);
+        if (i > 0) {
+            ASSERT_LE(bytes.length() + strlen(RPC_CODE_FOR_COMPACT_HEADER_TEST.to_string()),
+                      last_length);
+        }
+        last_length = bytes.length();
+
+        received = receive_message(server, bytes);
+        ASSERT_NE(nullptr, received.get());
+        message_header &h = *received->header;
+        ASSERT_EQ(request->header->id, h.id);
+        ASSERT_TRUE(h.context.u.is_request);
+        ASSERT_EQ(RPC_CODE_FOR_COMPACT_HEADER_TEST, received->rpc_code());
+        ASSERT_STREQ(request->header->rpc_name, h.rpc_name);
+        ASSERT_EQ(200, h.client.timeout_ms);
+        ASSERT_EQ(3, h.client.thread_hash);
+        ASSERT_EQ(4u, h.client.partition_hash);
+        ASSERT_EQ(rpc_address("127.0.0.1", 34801), h.from_address);
+        ASSERT_EQ(0u, h.gpid.value());
+        ASSERT_EQ(test_body, read_test_body(received.get()));
+    }
+}
+
+TEST(core, dsn_message_parser_compact_header_with_old_peer)
+{
+    dsn_message_parser client, server;
+    client.enable_compact_header();
+
+    message_ptr request = message_ex::create_request(RPC_CODE_FOR_COMPACT_HEADER_TEST, 100, 1, 2);
+    write_test_body(request.get());
+    message_ptr received = receive_message(server, send_message(client, request.get()));
+    ASSERT_NE(nullptr, received.get());
+    ASSERT_FALSE(server.is_sending_compact_header());
+
+    // an old server echoes hdr_version of the request in its response
+    received->rpc_code();
+    message_ptr response = received->create_response();
+    write_test_body(response.get());
+    std::string bytes;
+    for (const blob &buf : response->buffers) {
+        bytes.append(buf.data(), buf.length());
+    }
+    ASSERT_EQ(sizeof(message_header) + strlen(test_body), bytes.length());
+
+    received = receive_message(client, bytes);
+    ASSERT_NE(nullptr, received.get());
+    ASSERT_EQ(DSN_HDR_VERSION_COMPACT_ACCEPTED, received->header->hdr_version);
+    ASSERT_FALSE(client.is_sending_compact_header());
+    ASSERT_EQ(test_body, read_test_body(received.get()));
+}
+
+TEST(core, dsn_message_parser_compact_header_corrupted)
+{
+    dsn_message_parser client, server;
+    client.enable_compact_header();
+    server.enable_compact_header();
+
+    message_ptr request = message_ex::create_request(RPC_CODE_FOR_COMPACT_HEADER_TEST, 100, 1, 2);
+    write_test_body(request.get());
+    message_ptr received = receive_message(server, send_message(client, request.get()));
+    ASSERT_NE(nullptr, received.get());
+
+    received->rpc_code();
+    message_ptr response = received->create_response();
+    write_test_body(response.get());
+    std::string bytes = send_message(server, response.get());
+
+    // refer to a code which is never interned
+    dsn_message_parser another_client;
+    another_client.enable_compact_header();
+    std::string second = send_message(server, response.get());
+    ASSERT_EQ(nullptr, receive_message(another_client, second));
+
+    // truncate the varint fields
+    std::string truncated = bytes;
+    reinterpret_cast<compact_message_header *>(&truncated[0])->hdr_length =
+        sizeof(compact_message_header) + 1;
+    ASSERT_EQ(nullptr, receive_message(client, truncated));
+}
+
+TEST(core, dsn_message_parser_compressed_body)
+{
+    uint32_t supported = message_compressor::supported_mask();
+    if (supported == 0) {
+        return;
+    }
+    rpc_compress_type_t type = (supported & message_compressor::type_mask(RPC_COMPRESS_LZ4))
+                                   ? RPC_COMPRESS_LZ4
+                                   : RPC_COMPRESS_ZSTD;
+    task_spec *request_spec = task_spec::get(RPC_CODE_FOR_COMPACT_HEADER_TEST);
+    task_spec *response_spec = task_spec::get(request_spec->rpc_paired_code);
+    request_spec->rpc_message_compress_type = type;
+    response_spec->rpc_message_compress_type = type;
+
+    std::string body;
+    for (int i = 0; body.length() < 8192; ++i) {
+        body.append(test_body).append(std::to_string(i));
+    }
+    auto write_body = [&body](message_ex *msg) {
+        void *ptr;
+        size_t sz;
+        msg->write_next(&ptr, &sz, body.length());
+        memcpy(ptr, body.data(), body.length());
+        msg->write_commit(body.length());
+    };
+
+    for (bool compact : {false, true}) {
+        dsn_message_parser client, server;
+        if (compact) {
+            client.enable_compact_header();
+            server.enable_compact_header();
+        }
+
+        // the client does not know whether the server could decompress yet
+        message_ptr request =
+            message_ex::create_request(RPC_CODE_FOR_COMPACT_HEADER_TEST, 100, 1, 2);
+        write_body(request.get());
+        std::string bytes = send_message(client, request.get());
+        ASSERT_EQ(sizeof(message_header) + body.length(), bytes.length());
+
+        message_ptr received = receive_message(server, bytes);
+        ASSERT_NE(nullptr, received.get());
+        ASSERT_EQ(body, read_test_body(received.get()));
+
+        // then both sides send compressed bodies, leaving the raw messages untouched
+        received->rpc_code();
+        message_ptr response = received->create_response();
+        write_body(response.get());
+        bytes = send_message(server, response.get());
+        ASSERT_LT(bytes.length(), body.length());
+        ASSERT_EQ(body.length(), response->header->body_length);
+
+        received = receive_message(client, bytes);
+        ASSERT_NE(nullptr, received.get());
+        ASSERT_EQ(0, received->header->context.u.compress_type);
+        ASSERT_EQ(body.length(), received->header->body_length);
+        ASSERT_EQ(body, read_test_body(received.get()));
+
+        request = message_ex::create_request(RPC_CODE_FOR_COMPACT_HEADER_TEST, 100, 1, 2);
+        write_body(request.get());
+        bytes = send_message(client, request.get());
+        ASSERT_LT(bytes.length(), body.length());
+        ASSERT_EQ((int)type, request->send_body_compress_type);
+
+        received = receive_message(server, bytes);
+        ASSERT_NE(nullptr, received.get());
+        ASSERT_EQ(request->header->id, received->header->id);
+        ASSERT_EQ(body, read_test_body(received.get()));
+
+        // the corrupted body is rejected
+        bytes[bytes.length() - 8] ^= 0x5a;
+        bytes[bytes.length() - 4] ^= 0x5a;
+        dsn_message_parser another_server;
+        message_ex *corrupted = receive_message(another_server, bytes);
+        if (corrupted != nullptr) {
+            ASSERT_NE(body, read_test_body(corrupted));
+            delete corrupted;
+        }
+    }
+
+    request_spec->rpc_message_compress_type = RPC_COMPRESS_NONE;
+    response_spec->rpc_message_compress_type = RPC_COMPRESS_NONE;
+}
+
+TEST(core, message_compressor_max_body_size)
+{
+    uint32_t supported = message_compressor::supported_mask();
+    for (rpc_compress_type_t type : {RPC_COMPRESS_LZ4, RPC_COMPRESS_ZSTD}) {
+        if ((supported & message_compressor::type_mask(type)) == 0) {
+            continue;
+        }
+
+        std::string body(4096, 'x');
+        blob compressed;
+        ASSERT_TRUE(
+            message_compressor::instance().compress(type, body.data(), body.length(), compressed));
+        blob decompressed;
+        ASSERT_TRUE(message_compressor::instance().decompress(type, compressed, decompressed));
+        ASSERT_EQ(body, decompressed.to_string());
+
+        // a peer claiming a huge raw body is rejected before anything is allocated
+        std::string bytes = compressed.to_string();
+        uint32_t raw_length = 0xffffffff;
+        memcpy(&bytes[0], &raw_length, sizeof(raw_length));
+        ASSERT_FALSE(message_compressor::instance().decompress(
+            type, blob::create_from_bytes(std::move(bytes)), decompressed));
+    }
+}
@@ -0,0 +1,141 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for message_reader.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include <dsn/tool-api/message_parser.h>
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace ::dsn;
+
+static void read_bytes(message_reader &reader, unsigned int sz)
+{
+    char *ptr = reader.read_buffer_ptr(sz);
+    memset(ptr, 'x', sz);
+    reader.mark_read(sz);
+}
+
+// parse a message of sz bytes from the head of the reader
+static blob consume_bytes(message_reader &reader, unsigned int sz)
+{
+    blob msg = reader._buffer.range(0, sz);
+    reader._buffer = reader._buffer.range(sz);
+    reader._buffer_occupied -= sz;
+    return msg;
+}
+
+TEST(core, message_reader_reuse_in_place)
+{
+    message_reader reader(4096);
+    read_bytes(reader, 3000);
+    ASSERT_EQ(4096, reader.pinned_bytes());
+    const char *slab = reader._buffer.data();
+
+    // the consumed message is released, so the tail is moved to the front of the same slab
+    consume_bytes(reader, 2000);
+    read_bytes(reader, 2000);
+    ASSERT_EQ(slab, reader._buffer.data());
+    ASSERT_EQ(3000u, reader._buffer_occupied);
+    ASSERT_EQ(4096, reader.pinned_bytes());
+
+    // the consumed message is still alive, so switch to a new slab
+    blob msg = consume_bytes(reader, 2000);
+    read_bytes(reader, 2000);
+    ASSERT_NE(slab, reader._buffer.data());
+    ASSERT_EQ(3000u, reader._buffer_occupied);
+    ASSERT_EQ(8192, reader.pinned_bytes());
+
+    // the old slab is unpinned once the message is released
+    msg = blob();
+    ASSERT_EQ(4096, reader.pinned_bytes());
+}
+
+TEST(core, message_reader_reuse_after_release_on_other_thread)
+{
+    message_reader reader(4096);
+    read_bytes(reader, 3000);
+    const char *slab = reader._buffer.data();
+
+    // the message is read and released by another thread, after which the slab is
+    // reused in place
+    blob msg = consume_bytes(reader, 2000);
+    std::thread t([m = std::move(msg)]() mutable {
+        ASSERT_EQ('x', m.data()[1999]);
+        m = blob();
+    });
+    t.join();
+    read_bytes(reader, 2000);
+    ASSERT_EQ(slab, reader._buffer.data());
+    ASSERT_EQ(4096, reader.pinned_bytes());
+
+    // a copy of the message held elsewhere keeps the slab from being reused
+    msg = consume_bytes(reader, 1000);
+    blob copy = msg;
+    msg = blob();
+    read_bytes(reader, 2000);
+    ASSERT_NE(slab, reader._buffer.data());
+    ASSERT_EQ(4000u, reader._buffer_occupied);
+    ASSERT_EQ(8192, reader.pinned_bytes());
+    copy = blob();
+    ASSERT_EQ(4096, reader.pinned_bytes());
+}
+
+TEST(core, message_reader_large_message)
+{
+    message_reader reader(4096);
+    read_bytes(reader, 100);
+
+    // the new slab is large enough for the whole message
+    read_bytes(reader, 100000);
+    ASSERT_EQ(100100u, reader._buffer_occupied);
+    ASSERT_LE(100100u, reader._buffer.length());
+    ASSERT_EQ(reader._buffer.length(), reader.pinned_bytes());
+
+    blob msg = consume_bytes(reader, 100100);
+    ASSERT_EQ(msg.length(), 100100u);
+    ASSERT_EQ('x', msg.data()[100099]);
+}
+
+TEST(core, message_reader_pinned_bytes_outlive_reader)
+{
+    blob msg;
+    std::unique_ptr<message_reader> reader(new message_reader(4096));
+    read_bytes(*reader, 100);
+    msg = consume_bytes(*reader, 100);
+    reader.reset();
+
+    // the slab is kept by the message
+    ASSERT_EQ('x', msg.data()[99]);
+    msg = blob();
+}
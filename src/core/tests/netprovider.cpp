@@ -33,6 +33,7 @@
  *     xxxx-xx-xx, author, fix bug about xxx
  */
 
+#include <atomic>
 #include <memory>
 #include <thread>
 
@@ -40,11 +41,15 @@
 
 #include <dsn/tool-api/aio_provider.h>
 #include <dsn/service_api_cpp.h>
+#include <dsn/perf_counter/perf_counters.h>
+#include <dsn/utility/config_api.h>
 
 #include <dsn/tool-api/task.h>
 #include <dsn/tool-api/task_spec.h>
 
 #include "../tools/common/asio_net_provider.h"
+#include "../tools/common/asio_rpc_session.h"
+#include "../tools/common/loopback_net_provider.h"
 #include "../tools/common/network.sim.h"
 #include "../core/service_engine.h"
 #include "../core/rpc_engine.h"
@@ -200,6 +205,203 @@ TEST(tools_common, asio_udp_provider)
     TEST_PORT++;
 }
 
+static int64_t asio_session_count(const std::string &net_name)
+{
+    const char *node_name = ::dsn::tools::get_service_node_name(task::get_current_rpc()->node());
+    perf_counter_ptr c = perf_counters::instance().get_global_counter(
+        node_name,
+        "network",
+        (net_name + ".reactor.0.session.count").c_str(),
+        COUNTER_TYPE_NUMBER,
+        "",
+        false);
+    return c == nullptr ? -1 : c->get_integer_value();
+}
+
+TEST(tools_common, asio_net_provider_counters)
+{
+    if (dsn::service_engine::instance().spec().semaphore_factory_name ==
+        "dsn::tools::sim_semaphore_provider")
+        return;
+
+    ASSERT_TRUE(dsn_rpc_register_handler(
+        RPC_TEST_NETPROVIDER, "rpc.test.netprovider", rpc_server_response));
+
+    // sessions may be created before start, when there is no counter yet
+    asio_network_provider *client_net = new asio_network_provider(task::get_current_rpc(), nullptr);
+    rpc_session_ptr unstarted_session =
+        client_net->create_client_session(rpc_address("localhost", TEST_PORT));
+    ASSERT_EQ(ERR_OK, client_net->start(RPC_CHANNEL_TCP, TEST_PORT, true));
+    unstarted_session = nullptr;
+    ASSERT_GE(asio_session_count("asio.client.NET_HDR_DSN"), 0);
+
+    // the server counters are named by the port, apart from the client ones
+    std::string server_name = "asio.server." + std::to_string(TEST_PORT);
+    ASSERT_EQ(-1, asio_session_count(server_name));
+    asio_network_provider *server_net = new asio_network_provider(task::get_current_rpc(), nullptr);
+    ASSERT_EQ(ERR_OK, server_net->start(RPC_CHANNEL_TCP, TEST_PORT, false));
+    ASSERT_EQ(0, asio_session_count(server_name));
+
+    rpc_session_ptr client_session =
+        client_net->create_client_session(rpc_address("localhost", TEST_PORT));
+    ASSERT_GE(asio_session_count("asio.client.NET_HDR_DSN"), 1);
+    client_session->connect();
+    rpc_client_session_send(client_session);
+    ASSERT_EQ(1, asio_session_count(server_name));
+
+    ASSERT_TRUE(dsn_rpc_unregiser_handler(RPC_TEST_NETPROVIDER));
+
+    TEST_PORT++;
+}
+
+TEST(tools_common, asio_net_provider_restart_after_failure)
+{
+    if (dsn::service_engine::instance().spec().semaphore_factory_name ==
+        "dsn::tools::sim_semaphore_provider")
+        return;
+
+    ASSERT_TRUE(dsn_rpc_register_handler(
+        RPC_TEST_NETPROVIDER, "rpc.test.netprovider", rpc_server_response));
+
+    // the port is taken by a listener without SO_REUSEPORT
+    asio_network_provider *holder_net = new asio_network_provider(task::get_current_rpc(), nullptr);
+    ASSERT_EQ(ERR_OK, holder_net->start(RPC_CHANNEL_TCP, TEST_PORT, false));
+
+    // each reactor listens by itself
+    dsn_config_set("network", "io_service_count", "2", "");
+    dsn_config_set("network", "io_service_reuse_port", "true", "");
+    asio_network_provider *server_net = new asio_network_provider(task::get_current_rpc(), nullptr);
+    error_code start_result = server_net->start(RPC_CHANNEL_TCP, TEST_PORT, false);
+    dsn_config_set("network", "io_service_count", "1", "");
+    dsn_config_set("network", "io_service_reuse_port", "false", "");
+    ASSERT_EQ(ERR_NETWORK_INIT_FAILED, start_result);
+
+    // the failed start leaves no listener behind, so it may be retried on another port
+    ASSERT_EQ(ERR_OK, server_net->start(RPC_CHANNEL_TCP, TEST_PORT + 1, false));
+    asio_network_provider *client_net = new asio_network_provider(task::get_current_rpc(), nullptr);
+    ASSERT_EQ(ERR_OK, client_net->start(RPC_CHANNEL_TCP, TEST_PORT + 1, true));
+    rpc_session_ptr client_session =
+        client_net->create_client_session(rpc_address("localhost", TEST_PORT + 1));
+    client_session->connect();
+    rpc_client_session_send(client_session);
+
+    ASSERT_TRUE(dsn_rpc_unregiser_handler(RPC_TEST_NETPROVIDER));
+
+    TEST_PORT += 2;
+}
+
+// an asio network whose sessions cork sending for delay_us
+class corked_asio_network_provider : public asio_network_provider
+{
+public:
+    corked_asio_network_provider(int delay_us)
+        : asio_network_provider(task::get_current_rpc(), nullptr)
+    {
+        _send_cork_delay_us = delay_us;
+    }
+};
+
+// send count requests on the session without waiting, and count the responses by error
+void rpc_client_session_send_many(rpc_session_ptr client_session,
+                                  int count,
+                                  std::atomic<int> &ok_count,
+                                  std::atomic<int> &failed_count)
+{
+    for (int i = 0; i < count; i++) {
+        std::string request = "hello world " + std::to_string(i);
+        message_ex *msg = message_ex::create_request(RPC_TEST_NETPROVIDER, 0, 0);
+        ::dsn::marshall(msg, request);
+        rpc_response_task *t = new rpc_response_task(
+            msg,
+            [request, &ok_count, &failed_count](
+                dsn::error_code ec, dsn::message_ex *req, dsn::message_ex *resp) {
+                if (ERR_OK == ec) {
+                    std::string response;
+                    ::dsn::unmarshall(resp, response);
+                    ASSERT_EQ(request, response);
+                    ++ok_count;
+                } else {
+                    ++failed_count;
+                }
+            },
+            0);
+        client_session->net().engine()->matcher()->on_call(msg, t);
+        client_session->send_message(msg);
+    }
+}
+
+void wait_count(const std::atomic<int> &count, int expected)
+{
+    for (int i = 0; i < 100 && count.load() < expected; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+TEST(tools_common, asio_net_provider_cork)
+{
+    if (dsn::service_engine::instance().spec().semaphore_factory_name ==
+        "dsn::tools::sim_semaphore_provider")
+        return;
+
+    ASSERT_TRUE(dsn_rpc_register_handler(
+        RPC_TEST_NETPROVIDER, "rpc.test.netprovider", rpc_server_response));
+
+    asio_network_provider *server_net = new asio_network_provider(task::get_current_rpc(), nullptr);
+    ASSERT_EQ(ERR_OK, server_net->start(RPC_CHANNEL_TCP, TEST_PORT, false));
+
+    asio_network_provider *client_net = new corked_asio_network_provider(1000);
+    ASSERT_EQ(ERR_OK, client_net->start(RPC_CHANNEL_TCP, TEST_PORT, true));
+
+    rpc_session_ptr client_session =
+        client_net->create_client_session(rpc_address("localhost", TEST_PORT));
+    client_session->connect();
+
+    // connected, and then the requests are corked and flushed by the timer
+    rpc_client_session_send(client_session);
+    std::atomic<int> ok_count(0), failed_count(0);
+    rpc_client_session_send_many(client_session, 20, ok_count, failed_count);
+    wait_count(ok_count, 20);
+    ASSERT_EQ(20, ok_count.load());
+    ASSERT_EQ(0, failed_count.load());
+
+    ASSERT_TRUE(dsn_rpc_unregiser_handler(RPC_TEST_NETPROVIDER));
+
+    TEST_PORT++;
+}
+
+TEST(tools_common, asio_net_provider_close_while_corked)
+{
+    if (dsn::service_engine::instance().spec().semaphore_factory_name ==
+        "dsn::tools::sim_semaphore_provider")
+        return;
+
+    ASSERT_TRUE(dsn_rpc_register_handler(
+        RPC_TEST_NETPROVIDER, "rpc.test.netprovider", rpc_server_response));
+
+    asio_network_provider *server_net = new asio_network_provider(task::get_current_rpc(), nullptr);
+    ASSERT_EQ(ERR_OK, server_net->start(RPC_CHANNEL_TCP, TEST_PORT, false));
+
+    // long enough for the session to be closed before the timer fires
+    asio_network_provider *client_net = new corked_asio_network_provider(500000);
+    ASSERT_EQ(ERR_OK, client_net->start(RPC_CHANNEL_TCP, TEST_PORT, true));
+
+    rpc_session_ptr client_session =
+        client_net->create_client_session(rpc_address("localhost", TEST_PORT));
+    client_session->connect();
+    rpc_client_session_send(client_session);
+
+    // the corked requests fail once the timer finds the session closed
+    std::atomic<int> ok_count(0), failed_count(0);
+    rpc_client_session_send_many(client_session, 10, ok_count, failed_count);
+    client_session->close();
+    wait_count(failed_count, 10);
+    ASSERT_EQ(0, ok_count.load());
+    ASSERT_EQ(10, failed_count.load());
+
+    ASSERT_TRUE(dsn_rpc_unregiser_handler(RPC_TEST_NETPROVIDER));
+
+    TEST_PORT++;
+}
+
 TEST(tools_common, sim_net_provider)
 {
     if (dsn::service_engine::instance().spec().semaphore_factory_name ==
@@ -228,3 +430,53 @@ TEST(tools_common, sim_net_provider)
 
     TEST_PORT++;
 }
+
+TEST(tools_common, loopback_net_provider)
+{
+    if (dsn::service_engine::instance().spec().semaphore_factory_name ==
+        "dsn::tools::sim_semaphore_provider")
+        return;
+
+    ASSERT_TRUE(dsn_rpc_register_handler(
+        RPC_TEST_NETPROVIDER, "rpc.test.netprovider", rpc_server_response));
+
+    loopback_network_provider *server_net =
+        new loopback_network_provider(task::get_current_rpc(), nullptr);
+    ASSERT_EQ(ERR_OK, server_net->start(RPC_CHANNEL_TCP, TEST_PORT, false));
+    ASSERT_EQ(server_net, loopback_network_provider::find(rpc_address("localhost", TEST_PORT)));
+    ASSERT_EQ(server_net, loopback_network_provider::find(server_net->address()));
+
+    loopback_network_provider *client_net =
+        new loopback_network_provider(task::get_current_rpc(), nullptr);
+    ASSERT_EQ(ERR_OK, client_net->start(RPC_CHANNEL_TCP, TEST_PORT + 1, true));
+    ASSERT_EQ(nullptr, loopback_network_provider::find(client_net->address()));
+
+    // the servers out of this process are connected through tcp
+    rpc_session_ptr tcp_session =
+        client_net->create_client_session(rpc_address("localhost", TEST_PORT + 2));
+    ASSERT_NE(nullptr, dynamic_cast<asio_rpc_session *>(tcp_session.get()));
+
+    rpc_session_ptr client_session =
+        client_net->create_client_session(rpc_address("localhost", TEST_PORT));
+    ASSERT_NE(nullptr, dynamic_cast<loopback_rpc_session *>(client_session.get()));
+    client_session->connect();
+    ASSERT_NE(nullptr, server_net->get_server_session(client_net->address()));
+
+    rpc_client_session_send(client_session);
+
+    // each batch is delivered and completed at once, which sends the next batch in a loop
+    // rather than recursively
+    std::atomic<int> ok_count(0), failed_count(0);
+    rpc_client_session_send_many(client_session, 10000, ok_count, failed_count);
+    wait_count(ok_count, 10000);
+    ASSERT_EQ(10000, ok_count.load());
+    ASSERT_EQ(0, failed_count.load());
+
+    // closing either side disconnects both
+    client_session->close();
+    ASSERT_EQ(nullptr, server_net->get_server_session(client_net->address()));
+
+    ASSERT_TRUE(dsn_rpc_unregiser_handler(RPC_TEST_NETPROVIDER));
+
+    TEST_PORT += 3;
+}
@@ -0,0 +1,146 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <dsn/service_api_cpp.h>
+#include "../core/rpc_engine.h"
+#include "test_utils.h"
+
+DEFINE_TASK_CODE_RPC(RPC_TEST_CLIENT_MATCHER, TASK_PRIORITY_COMMON, THREAD_POOL_TEST_SERVER)
+
+using namespace ::dsn;
+
+static rpc_response_task_ptr make_call(int timeout_ms, /*out*/ error_code &result)
+{
+    message_ex *msg = message_ex::create_request(RPC_TEST_CLIENT_MATCHER, timeout_ms, 0);
+    return rpc_response_task_ptr(new rpc_response_task(
+        msg, [&result](error_code err, message_ex *, message_ex *) { result = err; }, 0));
+}
+
+TEST(core, rpc_client_matcher_reply)
+{
+    rpc_client_matcher *matcher = task::get_current_rpc()->matcher();
+
+    error_code results[2];
+    rpc_response_task_ptr calls[2] = {make_call(10000, results[0]), make_call(10000, results[1])};
+
+    // let the second call collide with the first one on the same slot
+    uint64_t id = calls[0]->get_request()->header->id;
+    uint64_t collided_id = id + (1ULL << 40);
+    calls[1]->get_request()->header->id = collided_id;
+
+    matcher->on_call(calls[0]->get_request(), calls[0]);
+    matcher->on_call(calls[1]->get_request(), calls[1]);
+
+    // early terminate the calls with empty replies
+    ASSERT_TRUE(matcher->on_recv_reply(nullptr, collided_id, nullptr, 0));
+    ASSERT_TRUE(matcher->on_recv_reply(nullptr, id, nullptr, 0));
+    for (int i = 0; i < 2; i++) {
+        ASSERT_TRUE(calls[i]->wait(10000));
+        ASSERT_EQ(ERR_NETWORK_FAILURE, results[i]);
+    }
+
+    // the calls are gone
+    ASSERT_FALSE(matcher->on_recv_reply(nullptr, id, nullptr, 0));
+    ASSERT_FALSE(matcher->on_recv_reply(nullptr, collided_id, nullptr, 0));
+}
+
+TEST(core, rpc_client_matcher_timeout)
+{
+    rpc_client_matcher *matcher = task::get_current_rpc()->matcher();
+
+    error_code results[3];
+    int timeouts_ms[3] = {500, 100, 200};
+    rpc_response_task_ptr calls[3];
+    uint64_t start_ms = dsn_now_ms();
+    for (int i = 0; i < 3; i++) {
+        calls[i] = make_call(timeouts_ms[i], results[i]);
+        matcher->on_call(calls[i]->get_request(), calls[i]);
+    }
+
+    // all the calls are retired by the sweeps, no matter in which order they are registered
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(calls[i]->wait(10000));
+        ASSERT_EQ(ERR_TIMEOUT, results[i]);
+        ASSERT_GE(dsn_now_ms() - start_ms, (uint64_t)timeouts_ms[i]);
+        ASSERT_FALSE(
+            matcher->on_recv_reply(nullptr, calls[i]->get_request()->header->id, nullptr, 0));
+    }
+}
+
+static std::atomic<int> s_dropped_resends(0);
+
+// drop the requests resent by the matcher, which are sent without any response task
+static bool drop_resend(task *, message_ex *, rpc_response_task *call)
+{
+    if (call == nullptr) {
+        s_dropped_resends.fetch_add(1);
+    }
+    return false;
+}
+
+TEST(core, rpc_client_matcher_resend)
+{
+    rpc_engine *engine = task::get_current_rpc();
+    rpc_client_matcher *matcher = engine->matcher();
+    task_spec *sp = task_spec::get(RPC_TEST_CLIENT_MATCHER);
+    int old_resend_ms = sp->rpc_request_resend_timeout_milliseconds;
+    sp->rpc_request_resend_timeout_milliseconds = 100;
+    sp->on_rpc_call.put_native(drop_resend);
+
+    error_code results[2];
+    rpc_response_task_ptr calls[2] = {make_call(400, results[0]), make_call(400, results[1])};
+    uint64_t start_ms = dsn_now_ms();
+    for (int i = 0; i < 2; i++) {
+        message_ex *req = calls[i]->get_request();
+        req->header->from_address = engine->primary_address();
+        req->to_address = rpc_address("127.0.0.1", 20301);
+        matcher->on_call(req, calls[i]);
+    }
+
+    // resent once the resend timeout expires, and the calls are still matchable
+    for (int i = 0; i < 1000 && s_dropped_resends.load() < 2; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(2, s_dropped_resends.load());
+    ASSERT_GE(dsn_now_ms() - start_ms, 100u);
+    ASSERT_TRUE(matcher->on_recv_reply(nullptr, calls[1]->get_request()->header->id, nullptr, 0));
+    ASSERT_TRUE(calls[1]->wait(10000));
+    ASSERT_EQ(ERR_NETWORK_FAILURE, results[1]);
+
+    // then timed out with the full timeout, without being resent again
+    ASSERT_TRUE(calls[0]->wait(10000));
+    ASSERT_EQ(ERR_TIMEOUT, results[0]);
+    ASSERT_GE(dsn_now_ms() - start_ms, 400u);
+    ASSERT_EQ(2, s_dropped_resends.load());
+    ASSERT_FALSE(matcher->on_recv_reply(nullptr, calls[0]->get_request()->header->id, nullptr, 0));
+
+    sp->on_rpc_call.remove("native");
+    sp->rpc_request_resend_timeout_milliseconds = old_resend_ms;
+}
@@ -151,6 +151,38 @@ TEST(core, message_ex)
         request->release_ref();
     }
 
+    { // write_append
+        message_ex *request = message_ex::create_request(RPC_CODE_FOR_TEST, 100, 1);
+        const char *data = "adaoihfeuifgggggisdosghkbvjhzxvdafdiofgeof";
+        size_t data_size = strlen(data);
+
+        std::shared_ptr<char> buffer(dsn::utils::make_shared_array<char>(data_size));
+        memcpy(buffer.get(), data, data_size);
+        blob bb(buffer, (int)data_size);
+
+        request->write_append(bb);
+        ASSERT_EQ(2u, request->buffers.size());
+        ASSERT_EQ(bb.data(), request->buffers[1].data());
+        ASSERT_EQ(data_size, request->body_size());
+
+        // empty data is not appended
+        request->write_append(blob());
+        ASSERT_EQ(2u, request->buffers.size());
+
+        void *ptr;
+        size_t sz;
+        request->write_next(&ptr, &sz, data_size);
+        memcpy(ptr, data, data_size);
+        request->write_commit(data_size);
+        ASSERT_EQ(3u, request->buffers.size());
+        ASSERT_EQ(data_size * 2, request->body_size());
+        ASSERT_EQ((void *)bb.data(), request->rw_ptr(0));
+        ASSERT_EQ(ptr, request->rw_ptr(data_size));
+
+        request->add_ref();
+        request->release_ref();
+    }
+
     { // read
         message_ex *request = message_ex::create_request(RPC_CODE_FOR_TEST, 100, 1);
         const char *data = "adaoihfeuifgggggisdosghkbvjhzxvdafdiofgeof";
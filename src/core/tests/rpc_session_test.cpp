@@ -0,0 +1,292 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for the sending of rpc_session, i.e., coalescing and corking.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include <dsn/tool-api/network.h>
+#include <dsn/tool-api/task.h>
+#include <dsn/cpp/serialization.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "../tools/common/asio_net_provider.h"
+#include "test_utils.h"
+
+using namespace ::dsn;
+
+DEFINE_TASK_CODE_RPC(RPC_TEST_RPC_SESSION, TASK_PRIORITY_COMMON, THREAD_POOL_TEST_SERVER)
+
+// a server session whose sends are recorded instead of written, and completed by the test
+class send_recording_session : public rpc_session
+{
+public:
+    send_recording_session(connection_oriented_network &net, message_parser_ptr &parser)
+        : rpc_session(net, rpc_address("127.0.0.1", 1), parser, false), last_signature(0)
+    {
+    }
+
+    virtual void connect() override {}
+    virtual void close() override {}
+    virtual void do_read(int read_next) override {}
+
+    virtual void send(uint64_t signature) override
+    {
+        std::vector<std::string> batch;
+        for (auto &buf : _sending_buffers) {
+            batch.emplace_back((const char *)buf.buf, buf.sz);
+        }
+        batches.push_back(std::move(batch));
+        batch_sizes.push_back(_sending_msgs.size());
+        last_signature = signature;
+    }
+
+    virtual void send_corked(int delay_us) override { cork_delays.push_back(delay_us); }
+
+    void complete_send() { on_send_completed(last_signature); }
+    void set_cork_delay_us(int delay_us) { _cork_delay_us = delay_us; }
+    void disconnect(bool is_write) { on_disconnected(is_write); }
+
+    std::vector<std::vector<std::string>> batches; // the buffers of each sent batch
+    std::vector<size_t> batch_sizes;               // the message count of each sent batch
+    std::vector<int> cork_delays;
+    uint64_t last_signature;
+};
+
+class rpc_session_test : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        _net.reset(new tools::asio_network_provider(task::get_current_rpc(), nullptr));
+        _parser = _net->new_message_parser(NET_HDR_DSN);
+        _session = new send_recording_session(*_net, _parser);
+    }
+
+    void TearDown() override
+    {
+        for (auto msg : _messages) {
+            msg->release_ref();
+        }
+        _session = nullptr;
+    }
+
+    // send a request with a body of about body_size bytes, and keep it for checking
+    message_ex *send(size_t body_size)
+    {
+        message_ex *msg = message_ex::create_request(RPC_TEST_RPC_SESSION, 0, 0);
+        ::dsn::marshall(msg, std::string(body_size, 'a' + (char)(_messages.size() % 26)));
+        msg->add_ref(); // released in TearDown
+        _messages.push_back(msg);
+        _session->send_message(msg);
+        return msg;
+    }
+
+    // the bytes of the messages [begin, end) as laid out by the parser
+    std::string expected_bytes(size_t begin, size_t end)
+    {
+        std::string bytes;
+        for (size_t i = begin; i < end; i++) {
+            std::vector<message_parser::send_buf> bufs(
+                _parser->get_buffer_count_on_send(_messages[i]));
+            int count = _parser->get_buffers_on_send(_messages[i], bufs.data());
+            for (int j = 0; j < count; j++) {
+                bytes.append((const char *)bufs[j].buf, bufs[j].sz);
+            }
+        }
+        return bytes;
+    }
+
+    static std::string join(const std::vector<std::string> &batch)
+    {
+        std::string bytes;
+        for (auto &b : batch) {
+            bytes += b;
+        }
+        return bytes;
+    }
+
+protected:
+    std::unique_ptr<tools::asio_network_provider> _net;
+    message_parser_ptr _parser;
+    dsn::ref_ptr<send_recording_session> _session;
+    std::vector<message_ex *> _messages;
+};
+
+TEST_F(rpc_session_test, coalesce_small_buffers)
+{
+    ASSERT_GT(_net->send_coalesce_threshold(), 0u);
+
+    // the first message is sent at once, and the ones sent meanwhile are batched
+    send(10);
+    for (int i = 0; i < 10; i++) {
+        send(10);
+    }
+    ASSERT_EQ(1u, _session->batches.size());
+    ASSERT_EQ(expected_bytes(0, 1), join(_session->batches[0]));
+
+    // the small buffers of the batch are copied together into one block
+    _session->complete_send();
+    ASSERT_EQ(2u, _session->batches.size());
+    ASSERT_EQ(10u, _session->batch_sizes[1]);
+    ASSERT_EQ(1u, _session->batches[1].size());
+    ASSERT_EQ(expected_bytes(1, 11), join(_session->batches[1]));
+
+    _session->complete_send();
+    ASSERT_EQ(2u, _session->batches.size());
+}
+
+TEST_F(rpc_session_test, coalesce_with_large_buffers)
+{
+    size_t large = _net->send_coalesce_threshold() * 4;
+    send(10);
+    send(10);
+    send(large);
+    send(10);
+    send(10);
+    _session->complete_send();
+    ASSERT_EQ(2u, _session->batches.size());
+    ASSERT_EQ(4u, _session->batch_sizes[1]);
+
+    // the large body is sent in place, between the coalesced blocks before and after it
+    auto &batch = _session->batches[1];
+    ASSERT_GE(batch.size(), 3u);
+    bool large_in_place = false;
+    for (auto &b : batch) {
+        large_in_place |= (b.size() >= large);
+    }
+    ASSERT_TRUE(large_in_place);
+    ASSERT_EQ(expected_bytes(1, 5), join(batch));
+    _session->complete_send();
+}
+
+TEST_F(rpc_session_test, coalesce_buffer_overflow)
+{
+    // more small messages than one coalescing buffer holds
+    size_t capacity = _net->send_coalesce_buffer_size();
+    size_t body = _net->send_coalesce_threshold() / 4;
+    int count = (int)(capacity / body) * 2;
+    send(body);
+    for (int i = 0; i < count; i++) {
+        send(body);
+    }
+
+    // once the coalescing buffer is full, the rest of the batch is sent in place, and the
+    // batch is cut at the block count limit
+    _session->complete_send();
+    auto &batch = _session->batches[1];
+    ASSERT_GT(batch.size(), 1u);
+    ASSERT_LE(batch[0].size(), capacity);
+    ASSERT_GT(batch[0].size(), capacity / 2);
+    ASSERT_LE(batch.size(), (size_t)_net->max_buffer_block_count_per_send());
+
+    // all are sent in order over the batches
+    size_t sent = 1;
+    for (size_t i = 1;; i++) {
+        ASSERT_EQ(i + 1, _session->batches.size());
+        size_t batch_size = _session->batch_sizes[i];
+        ASSERT_EQ(expected_bytes(sent, sent + batch_size), join(_session->batches[i]));
+        sent += batch_size;
+        _session->complete_send();
+        if (sent == _messages.size()) {
+            break;
+        }
+    }
+    ASSERT_GE(_session->batches.size(), 3u);
+}
+
+TEST_F(rpc_session_test, cork)
+{
+    _session->set_cork_delay_us(1000);
+
+    // the first message is held, and the ones sent meanwhile join it
+    send(10);
+    ASSERT_EQ(0u, _session->batches.size());
+    ASSERT_EQ(std::vector<int>({1000}), _session->cork_delays);
+    send(10);
+    send(10);
+    ASSERT_EQ(1u, _session->cork_delays.size());
+
+    _session->flush_corked_messages();
+    ASSERT_EQ(1u, _session->batches.size());
+    ASSERT_EQ(3u, _session->batch_sizes[0]);
+    ASSERT_EQ(expected_bytes(0, 3), join(_session->batches[0]));
+
+    // messages sent while writing are batched as usual, without corking
+    send(10);
+    _session->complete_send();
+    ASSERT_EQ(2u, _session->batches.size());
+    ASSERT_EQ(1u, _session->cork_delays.size());
+    _session->complete_send();
+
+    // once idle, the next message is corked again
+    send(10);
+    ASSERT_EQ(2u, _session->cork_delays.size());
+    _session->flush_corked_messages();
+    ASSERT_EQ(3u, _session->batches.size());
+    _session->complete_send();
+}
+
+TEST_F(rpc_session_test, disconnect_on_write_while_corked)
+{
+    _session->set_cork_delay_us(1000);
+    send(10);
+    send(10);
+    ASSERT_EQ(1u, _session->cork_delays.size());
+
+    // the queued messages are dropped on disconnection, and the cork finds nothing to send
+    _session->disconnect(true);
+    for (auto msg : _messages) {
+        ASSERT_EQ(1, msg->get_count()); // only referenced by the test
+    }
+    _session->flush_corked_messages();
+    ASSERT_EQ(0u, _session->batches.size());
+}
+
+TEST_F(rpc_session_test, disconnect_on_read_while_corked)
+{
+    _session->set_cork_delay_us(1000);
+    send(10);
+    send(10);
+
+    // the queue is kept when disconnected by reading, until the cork fails the messages
+    _session->disconnect(false);
+    for (auto msg : _messages) {
+        ASSERT_EQ(2, msg->get_count());
+    }
+    _session->flush_corked_messages();
+    ASSERT_EQ(0u, _session->batches.size());
+    for (auto msg : _messages) {
+        ASSERT_EQ(1, msg->get_count());
+    }
+}
@@ -38,6 +38,12 @@
 #include <dsn/tool_api.h>
 #include <gtest/gtest.h>
 #include <sstream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <set>
+#include <dsn/utility/process_utils.h>
+#include <dsn/tool-api/thread_access_checker.h>
 
 using namespace ::dsn;
 
@@ -67,6 +73,10 @@ void task_engine_module_init()
 
 DEFINE_THREAD_POOL_CODE(THREAD_POOL_FOR_TEST_1)
 DEFINE_THREAD_POOL_CODE(THREAD_POOL_FOR_TEST_2)
+DEFINE_THREAD_POOL_CODE(THREAD_POOL_FOR_TEST_3)
+DEFINE_THREAD_POOL_CODE(THREAD_POOL_FOR_TEST_4)
+DEFINE_TASK_CODE(LPC_WORK_STEALING_TEST, TASK_PRIORITY_COMMON, THREAD_POOL_FOR_TEST_3)
+DEFINE_TASK_CODE(LPC_WORK_STEALING_PINNED_TEST, TASK_PRIORITY_COMMON, THREAD_POOL_FOR_TEST_4)
 
 TEST(core, task_engine)
 {
@@ -130,6 +140,151 @@ TEST(core, task_engine)
     ASSERT_EQ(2u, controllers2.size());
     ASSERT_EQ(nullptr, controllers2[0]);
     ASSERT_EQ(nullptr, controllers2[1]);
+
+    // work stealing queues are bound to workers even if the pool is not partitioned
+    task_worker_pool *pool3 = engine->get_pool(THREAD_POOL_FOR_TEST_3);
+    ASSERT_NE(nullptr, pool3);
+    std::vector<task_queue *> queues3 = pool3->queues();
+    ASSERT_EQ(4u, queues3.size());
+    for (size_t i = 0; i < queues3.size(); ++i) {
+        ASSERT_TRUE(queues3[i]->is_work_stealing());
+        ASSERT_FALSE(queues3[i]->is_shared());
+        ASSERT_EQ(pool3->workers()[i], queues3[i]->owner_worker());
+    }
+
+    task_worker_pool *pool4 = engine->get_pool(THREAD_POOL_FOR_TEST_4);
+    ASSERT_NE(nullptr, pool4);
+    ASSERT_EQ(4u, pool4->queues().size());
+}
+
+TEST(core, work_stealing_task_queue)
+{
+    if (dsn::service_engine::instance().spec().tool == "simulator")
+        return;
+
+    const int task_count = 1000;
+    std::atomic<int> done_count(0);
+    std::vector<task_ptr> tasks;
+    for (int i = 0; i < task_count; ++i) {
+        // tasks enqueued from a worker go to its own queue and may be stolen by the others
+        task_ptr t(new raw_task(LPC_WORK_STEALING_TEST, [&done_count]() {
+            task_ptr child(new raw_task(LPC_WORK_STEALING_TEST, [&done_count]() {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                ++done_count;
+            }));
+            child->enqueue();
+            ++done_count;
+        }));
+        t->enqueue();
+        tasks.push_back(t);
+    }
+    for (auto &t : tasks) {
+        t->wait();
+    }
+
+    for (int i = 0; i < 1000 && done_count.load() < 2 * task_count; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(2 * task_count, done_count.load());
+}
+
+TEST(core, work_stealing_local_tasks)
+{
+    if (dsn::service_engine::instance().spec().tool == "simulator")
+        return;
+
+    // all the children are enqueued by one worker to its own queue, the others must steal them
+    const int task_count = 200;
+    std::atomic<int> done_count(0);
+    std::mutex tids_lock;
+    std::set<int> tids;
+    task_ptr parent(new raw_task(LPC_WORK_STEALING_TEST, [&]() {
+        for (int i = 0; i < task_count; ++i) {
+            task_ptr child(new raw_task(LPC_WORK_STEALING_TEST, [&]() {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                {
+                    std::lock_guard<std::mutex> l(tids_lock);
+                    tids.insert(utils::get_current_tid());
+                }
+                ++done_count;
+            }));
+            child->enqueue();
+        }
+    }));
+    parent->enqueue();
+    parent->wait();
+
+    for (int i = 0; i < 1000 && done_count.load() < task_count; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(task_count, done_count.load());
+    ASSERT_GT(tids.size(), 1u);
+}
+
+TEST(core, work_stealing_pinned_tasks)
+{
+    if (dsn::service_engine::instance().spec().tool == "simulator")
+        return;
+
+    struct hash_state
+    {
+        std::atomic<int> running_count{0};
+        int next_seq = 0;
+        bool is_serial = true;
+        thread_access_checker checker;
+    };
+
+    // all the hashes are pinned to the first of the 4 workers, whose siblings must steal
+    // them while keeping the tasks of each hash in order and one at a time
+    const int hash_count = 8;
+    const int task_count_per_hash = 100;
+    std::unique_ptr<hash_state[]> states(new hash_state[hash_count]);
+    std::mutex tids_lock;
+    std::set<int> tids;
+    auto run_round = [&](int first_seq) {
+        std::vector<task_ptr> tasks;
+        for (int seq = first_seq; seq < first_seq + task_count_per_hash; ++seq) {
+            for (int h = 0; h < hash_count; ++h) {
+                hash_state *state = &states[h];
+                task_ptr t(new raw_task(LPC_WORK_STEALING_PINNED_TEST,
+                                        [state, seq, &tids_lock, &tids]() {
+                                            // asserts if the hash is run by another thread
+                                            // without being handed over
+                                            state->checker.only_one_thread_access();
+                                            if (++state->running_count != 1 ||
+                                                state->next_seq != seq) {
+                                                state->is_serial = false;
+                                            }
+                                            state->next_seq++;
+                                            std::this_thread::sleep_for(
+                                                std::chrono::microseconds(200));
+                                            {
+                                                std::lock_guard<std::mutex> l(tids_lock);
+                                                tids.insert(utils::get_current_tid());
+                                            }
+                                            --state->running_count;
+                                        },
+                                        (h + 1) * 4));
+                t->enqueue();
+                tasks.push_back(t);
+            }
+        }
+        for (auto &t : tasks) {
+            t->wait();
+        }
+    };
+
+    // the strands drained in the first round are removed, and created again in the second
+    // one, which may be run by other workers
+    run_round(0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    run_round(task_count_per_hash);
+
+    for (int h = 0; h < hash_count; ++h) {
+        ASSERT_TRUE(states[h].is_serial);
+        ASSERT_EQ(2 * task_count_per_hash, states[h].next_seq);
+    }
+    ASSERT_GT(tids.size(), 1u);
 }
 
 /*
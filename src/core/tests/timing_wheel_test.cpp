@@ -0,0 +1,96 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "core/tools/common/timing_wheel_timer_service.h"
+#include <gtest/gtest.h>
+#include <dsn/service_api_cpp.h>
+#include "test_utils.h"
+
+DEFINE_TASK_CODE(LPC_TIMING_WHEEL_TEST, TASK_PRIORITY_COMMON, THREAD_POOL_TEST_SERVER)
+
+using namespace ::dsn;
+
+static void add_timer(timer_service &svc, task *t, int delay_ms)
+{
+    t->set_delay(delay_ms);
+    t->add_ref(); // released by the timer service, just like what task::enqueue does
+    svc.add_timer(t);
+}
+
+TEST(core, timing_wheel_timer_service_fire)
+{
+    tools::timing_wheel_timer_service svc(task::get_current_node(), nullptr);
+    svc.start();
+
+    // cover timers on level 0, and the ones cascaded from level 1
+    std::vector<int> delays = {1, 20, 255, 300, 600};
+    std::vector<uint64_t> fired_ms(delays.size(), 0);
+    std::vector<task_ptr> tasks;
+    uint64_t start_ms = dsn_now_ms();
+    for (size_t i = 0; i < delays.size(); i++) {
+        task_ptr t(new raw_task(LPC_TIMING_WHEEL_TEST,
+                                [&fired_ms, i]() { fired_ms[i] = dsn_now_ms(); }));
+        add_timer(svc, t, delays[i]);
+        tasks.push_back(t);
+    }
+    ASSERT_EQ(delays.size(), svc.timer_count());
+
+    for (size_t i = 0; i < delays.size(); i++) {
+        ASSERT_TRUE(tasks[i]->wait(10000));
+        ASSERT_GE(fired_ms[i] - start_ms, (uint64_t)delays[i]);
+    }
+    ASSERT_EQ(0u, svc.timer_count());
+}
+
+TEST(core, timing_wheel_timer_service_cancel)
+{
+    tools::timing_wheel_timer_service svc(task::get_current_node(), nullptr);
+    svc.start();
+
+    bool fired = false;
+    task_ptr near_task(new raw_task(LPC_TIMING_WHEEL_TEST, [&fired]() { fired = true; }));
+    task_ptr far_task(new raw_task(LPC_TIMING_WHEEL_TEST, [&fired]() { fired = true; }));
+    add_timer(svc, near_task, 100);
+    add_timer(svc, far_task, 24 * 3600 * 1000); // beyond the span of the wheel
+    ASSERT_EQ(2u, svc.timer_count());
+    ASSERT_EQ(2, near_task->get_count());
+
+    // the cancelled task is removed from the wheel at once, with its ref count released
+    ASSERT_TRUE(near_task->cancel(false));
+    ASSERT_EQ(1u, svc.timer_count());
+    ASSERT_EQ(1, near_task->get_count());
+
+    ASSERT_TRUE(far_task->cancel(false));
+    ASSERT_EQ(0u, svc.timer_count());
+    ASSERT_EQ(1, far_task->get_count());
+
+    // cancel again takes no effect
+    ASSERT_FALSE(near_task->cancel(false));
+    ASSERT_EQ(1, near_task->get_count());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    ASSERT_FALSE(fired);
+}
@@ -44,6 +44,8 @@
 #include <gtest/gtest.h>
 #include <dsn/utility/rand.h>
 
+#include <vector>
+
 using namespace ::dsn;
 using namespace ::dsn::utils;
 
@@ -70,6 +72,45 @@ TEST(core, crc)
     EXPECT_TRUE(c3 == c4);
 }
 
+static const crc_impl all_crc_impls[] = {
+    crc_impl::table, crc_impl::slicing_by_8, crc_impl::sse42, crc_impl::pclmul};
+
+TEST(core, crc_impls)
+{
+    // the check values of crc32c and crc64/nvme
+    EXPECT_EQ(0xe3069283, dsn::utils::crc32_calc("123456789", 9, 0));
+    EXPECT_EQ(0xae8b14860a799888, dsn::utils::crc64_calc("123456789", 9, 0));
+
+    std::vector<char> buffer(8192 + 64);
+    for (auto &c : buffer) {
+        c = (char)rand::next_u32(0, 255);
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        // cover the unaligned heads and all the sizes around the folding blocks
+        size_t offset = rand::next_u32(0, 63);
+        size_t size = (i < 500 ? i : rand::next_u32(0, 8192));
+        uint32_t init32 = rand::next_u32();
+        uint64_t init64 = rand::next_u64();
+
+        uint32_t crc32 = crc32_calc(crc_impl::table, buffer.data() + offset, size, init32);
+        uint64_t crc64 = crc64_calc(crc_impl::table, buffer.data() + offset, size, init64);
+        EXPECT_EQ(crc32, crc32_calc(buffer.data() + offset, size, init32));
+        EXPECT_EQ(crc64, crc64_calc(buffer.data() + offset, size, init64));
+
+        for (crc_impl impl : all_crc_impls) {
+            if (crc32_impl_supported(impl)) {
+                EXPECT_EQ(crc32, crc32_calc(impl, buffer.data() + offset, size, init32))
+                    << crc_impl_to_string(impl) << ", size = " << size;
+            }
+            if (crc64_impl_supported(impl)) {
+                EXPECT_EQ(crc64, crc64_calc(impl, buffer.data() + offset, size, init64))
+                    << crc_impl_to_string(impl) << ", size = " << size;
+            }
+        }
+    }
+}
+
 TEST(core, binary_io)
 {
     int value = 0xdeadbeef;
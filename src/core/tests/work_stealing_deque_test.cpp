@@ -0,0 +1,109 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "work_stealing_deque.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace ::dsn::tools;
+
+TEST(core, work_stealing_deque_owner)
+{
+    // start small to go through growing
+    work_stealing_deque<int64_t> q(2);
+    int64_t v;
+    ASSERT_TRUE(q.empty());
+    ASSERT_FALSE(q.pop(v));
+    ASSERT_FALSE(q.steal(v));
+
+    for (int64_t i = 0; i < 100; i++) {
+        q.push(i);
+    }
+    ASSERT_EQ(100, q.size());
+
+    // thieves take the oldest, the owner takes the newest
+    ASSERT_TRUE(q.steal(v));
+    ASSERT_EQ(0, v);
+    ASSERT_TRUE(q.pop(v));
+    ASSERT_EQ(99, v);
+    for (int64_t i = 98; i >= 1; i--) {
+        ASSERT_TRUE(q.pop(v));
+        ASSERT_EQ(i, v);
+    }
+    ASSERT_FALSE(q.pop(v));
+    ASSERT_TRUE(q.empty());
+}
+
+TEST(core, work_stealing_deque_concurrent)
+{
+    const int64_t item_count = 200000;
+    const int thief_count = 3;
+
+    work_stealing_deque<int64_t> q(4);
+    std::vector<std::atomic<int>> taken(item_count);
+    for (auto &t : taken) {
+        t.store(0);
+    }
+    std::atomic<int64_t> total(0);
+    std::atomic<bool> done(false);
+
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < thief_count; i++) {
+        thieves.emplace_back([&]() {
+            int64_t v;
+            while (!done.load() || !q.empty()) {
+                if (q.steal(v)) {
+                    taken[v]++;
+                    total++;
+                }
+            }
+        });
+    }
+
+    int64_t v;
+    for (int64_t i = 0; i < item_count; i++) {
+        q.push(i);
+        if (i % 3 == 0 && q.pop(v)) {
+            taken[v]++;
+            total++;
+        }
+    }
+    while (q.pop(v)) {
+        taken[v]++;
+        total++;
+    }
+    done.store(true);
+    for (auto &t : thieves) {
+        t.join();
+    }
+
+    ASSERT_EQ(item_count, total.load());
+    for (auto &t : taken) {
+        ASSERT_EQ(1, t.load());
+    }
+}
@@ -33,9 +33,19 @@ namespace dsn {
 namespace tools {
 
 asio_network_provider::asio_network_provider(rpc_engine *srv, network *inner_provider)
-    : connection_oriented_network(srv, inner_provider)
+    : connection_oriented_network(srv, inner_provider), _next_reactor(0)
 {
     _acceptor = nullptr;
+
+    int io_service_count = (int)dsn_config_get_value_uint64(
+        "network",
+        "io_service_count",
+        1,
+        "number of io services (reactors), among which the sessions are distributed");
+    dassert(io_service_count > 0, "io_service_count must be > 0");
+    for (int i = 0; i < io_service_count; i++) {
+        _reactors.emplace_back(new asio_reactor(i));
+    }
 }
 
 asio_network_provider::~asio_network_provider()
@@ -43,7 +53,12 @@ asio_network_provider::~asio_network_provider()
     if (_acceptor) {
         _acceptor->close();
     }
-    _io_service.stop();
+    for (auto &r : _reactors) {
+        if (r->acceptor) {
+            r->acceptor->close();
+        }
+        r->ios.stop();
+    }
     for (auto &w : _workers) {
         w->join();
     }
@@ -51,30 +66,78 @@ asio_network_provider::~asio_network_provider()
 
 error_code asio_network_provider::start(rpc_channel channel, int port, bool client_only)
 {
-    if (_acceptor != nullptr)
+    if (_acceptor != nullptr || (!_reactors.empty() && _reactors[0]->acceptor != nullptr))
         return ERR_SERVICE_ALREADY_RUNNING;
 
-    int io_service_worker_count =
-        (int)dsn_config_get_value_uint64("network",
-                                         "io_service_worker_count",
-                                         1,
-                                         "thread number for io service (timer and boost network)");
-    for (int i = 0; i < io_service_worker_count; i++) {
-        _workers.push_back(std::make_shared<std::thread>([this, i]() {
-            task::set_tls_dsn_context(node(), nullptr);
-
-            const char *name = ::dsn::tools::get_service_node_name(node());
-            char buffer[128];
-            sprintf(buffer, "%s.asio.%d", name, i);
-            task_worker::set_name(buffer);
-
-            boost::asio::io_service::work work(_io_service);
-            boost::system::error_code ec;
-            _io_service.run(ec);
-            if (ec) {
-                dassert(false, "boost::asio::io_service run failed: err(%s)", ec.message().data());
+    int io_service_worker_count = (int)dsn_config_get_value_uint64(
+        "network",
+        "io_service_worker_count",
+        1,
+        "thread number for each io service (timer and boost network)");
+    bool pin_cores = dsn_config_get_value_bool(
+        "network",
+        "io_service_pin_cores",
+        false,
+        "whether to pin the threads of the i-th io service to the i-th core (mod core count)");
+    bool reuse_port =
+        dsn_config_get_value_bool("network",
+                                  "io_service_reuse_port",
+                                  false,
+                                  "whether each io service listens the port by itself with "
+                                  "SO_REUSEPORT, instead of sharing one listener");
+
+    const char *node_name = ::dsn::tools::get_service_node_name(node());
+    int nr_cpu = static_cast<int>(std::thread::hardware_concurrency());
+
+    // the reactors are set up by the first start only, and the counters are named by the
+    // role and the port, as a process may run several providers
+    if (_workers.empty()) {
+        std::string net_name = client_only
+                                   ? std::string("asio.client.") + _client_hdr_format.to_string()
+                                   : std::string("asio.server.") + std::to_string(port);
+        for (auto &r : _reactors) {
+            asio_reactor *reactor = r.get();
+            std::string prefix = net_name + ".reactor." + std::to_string(reactor->index);
+            reactor->session_count.init_global_counter(node_name,
+                                                       "network",
+                                                       (prefix + ".session.count").c_str(),
+                                                       COUNTER_TYPE_NUMBER,
+                                                       "sessions served by the io service");
+            reactor->accept_count.init_global_counter(
+                node_name,
+                "network",
+                (prefix + ".accept.count").c_str(),
+                COUNTER_TYPE_RATE,
+                "sessions accepted by the io service per second");
+
+            for (int i = 0; i < io_service_worker_count; i++) {
+                int worker_index = (int)_workers.size();
+                _workers.push_back(std::make_shared<std::thread>([=]() {
+                    task::set_tls_dsn_context(node(), nullptr);
+
+                    const char *name = ::dsn::tools::get_service_node_name(node());
+                    char buffer[128];
+                    sprintf(buffer, "%s.asio.%d", name, worker_index);
+                    task_worker::set_name(buffer);
+
+                    if (pin_cores && nr_cpu > 0) {
+                        int core = reactor->index % nr_cpu;
+                        if (core < 64) {
+                            task_worker::set_affinity((uint64_t)1 << core);
+                        }
+                    }
+
+                    boost::asio::io_service::work work(reactor->ios);
+                    boost::system::error_code ec;
+                    reactor->ios.run(ec);
+                    if (ec) {
+                        dassert(false,
+                                "boost::asio::io_service run failed: err(%s)",
+                                ec.message().data());
+                    }
+                }));
             }
-        }));
+        }
     }
 
     _acceptor = nullptr;
@@ -86,52 +149,111 @@ error_code asio_network_provider::start(rpc_channel channel, int port, bool clie
     _address.assign_ipv4(get_local_ipv4(), port);
 
     if (!client_only) {
-        auto v4_addr = boost::asio::ip::address_v4::any(); //(ntohl(_address.ip));
-        ::boost::asio::ip::tcp::endpoint endpoint(v4_addr, _address.port());
-        boost::system::error_code ec;
-        _acceptor.reset(new boost::asio::ip::tcp::acceptor(_io_service));
-        _acceptor->open(endpoint.protocol(), ec);
-        if (ec) {
-            derror("asio tcp acceptor open failed, error = %s", ec.message().c_str());
-            _acceptor.reset();
-            return ERR_NETWORK_INIT_FAILED;
+#ifndef SO_REUSEPORT
+        if (reuse_port) {
+            dwarn("SO_REUSEPORT is not supported, share one listener among the io services");
+            reuse_port = false;
         }
-        _acceptor->set_option(boost::asio::socket_base::reuse_address(true));
-        _acceptor->bind(endpoint, ec);
-        if (ec) {
-            derror("asio tcp acceptor bind failed, error = %s", ec.message().c_str());
-            _acceptor.reset();
-            return ERR_NETWORK_INIT_FAILED;
+#endif
+        if (reuse_port && _reactors.size() > 1) {
+            for (auto &r : _reactors) {
+                error_code err = open_acceptor(*r, true, r->acceptor);
+                if (err != ERR_OK) {
+                    // close the listeners opened so far, so that start may be retried
+                    for (auto &opened : _reactors) {
+                        if (opened->acceptor) {
+                            opened->acceptor->close();
+                            opened->acceptor.reset();
+                        }
+                    }
+                    return err;
+                }
+            }
+            for (auto &r : _reactors) {
+                do_accept(r.get());
+            }
+        } else {
+            error_code err = open_acceptor(*_reactors[0], false, _acceptor);
+            if (err != ERR_OK) {
+                return err;
+            }
+            do_accept(nullptr);
         }
-        int backlog = boost::asio::socket_base::max_connections;
-        _acceptor->listen(backlog, ec);
+    }
+
+    return ERR_OK;
+}
+
+error_code asio_network_provider::open_acceptor(
+    asio_reactor &r,
+    bool reuse_port,
+    /*out*/ std::shared_ptr<boost::asio::ip::tcp::acceptor> &acceptor)
+{
+    auto v4_addr = boost::asio::ip::address_v4::any(); //(ntohl(_address.ip));
+    ::boost::asio::ip::tcp::endpoint endpoint(v4_addr, _address.port());
+    boost::system::error_code ec;
+    acceptor.reset(new boost::asio::ip::tcp::acceptor(r.ios));
+    acceptor->open(endpoint.protocol(), ec);
+    if (ec) {
+        derror("asio tcp acceptor open failed, error = %s", ec.message().c_str());
+        acceptor.reset();
+        return ERR_NETWORK_INIT_FAILED;
+    }
+    acceptor->set_option(boost::asio::socket_base::reuse_address(true));
+#ifdef SO_REUSEPORT
+    if (reuse_port) {
+        typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>
+            reuse_port_option;
+        acceptor->set_option(reuse_port_option(true), ec);
         if (ec) {
-            derror("asio tcp acceptor listen failed, port = %u, error = %s",
-                   _address.port(),
-                   ec.message().c_str());
-            _acceptor.reset();
+            derror("asio tcp acceptor set SO_REUSEPORT failed, error = %s", ec.message().c_str());
+            acceptor.reset();
             return ERR_NETWORK_INIT_FAILED;
         }
-        do_accept();
     }
-
+#endif
+    acceptor->bind(endpoint, ec);
+    if (ec) {
+        derror("asio tcp acceptor bind failed, error = %s", ec.message().c_str());
+        acceptor.reset();
+        return ERR_NETWORK_INIT_FAILED;
+    }
+    int backlog = boost::asio::socket_base::max_connections;
+    acceptor->listen(backlog, ec);
+    if (ec) {
+        derror("asio tcp acceptor listen failed, port = %u, error = %s",
+               _address.port(),
+               ec.message().c_str());
+        acceptor.reset();
+        return ERR_NETWORK_INIT_FAILED;
+    }
     return ERR_OK;
 }
 
+asio_reactor &asio_network_provider::next_reactor()
+{
+    unsigned int i = _next_reactor.fetch_add(1, std::memory_order_relaxed);
+    return *_reactors[i % _reactors.size()];
+}
+
 rpc_session_ptr asio_network_provider::create_client_session(::dsn::rpc_address server_addr)
 {
-    auto sock = std::shared_ptr<boost::asio::ip::tcp::socket>(
-        new boost::asio::ip::tcp::socket(_io_service));
+    asio_reactor &r = next_reactor();
+    auto sock =
+        std::shared_ptr<boost::asio::ip::tcp::socket>(new boost::asio::ip::tcp::socket(r.ios));
     message_parser_ptr parser(new_message_parser(_client_hdr_format));
-    return rpc_session_ptr(new asio_rpc_session(*this, server_addr, sock, parser, true));
+    return rpc_session_ptr(new asio_rpc_session(*this, server_addr, sock, parser, true, r));
 }
 
-void asio_network_provider::do_accept()
+// r is the reactor listening by itself, or nullptr for the shared listener
+void asio_network_provider::do_accept(asio_reactor *r)
 {
+    asio_reactor &target = (r != nullptr ? *r : next_reactor());
+    auto &acceptor = (r != nullptr ? r->acceptor : _acceptor);
     auto socket = std::shared_ptr<boost::asio::ip::tcp::socket>(
-        new boost::asio::ip::tcp::socket(_io_service));
+        new boost::asio::ip::tcp::socket(target.ios));
 
-    _acceptor->async_accept(*socket, [this, socket](boost::system::error_code ec) {
+    acceptor->async_accept(*socket, [this, r, &target, socket](boost::system::error_code ec) {
         if (!ec) {
             auto remote = socket->remote_endpoint(ec);
             if (ec) {
@@ -147,7 +269,9 @@ void asio_network_provider::do_accept()
                                          client_addr,
                                          (std::shared_ptr<boost::asio::ip::tcp::socket> &)socket,
                                          null_parser,
-                                         false);
+                                         false,
+                                         target);
+                target.accept_count->increment();
                 on_server_session_accepted(s);
 
                 // we should start read immediately after the rpc session is completely created.
@@ -155,7 +279,7 @@ void asio_network_provider::do_accept()
             }
         }
 
-        do_accept();
+        do_accept(r);
     });
 }
 
@@ -27,11 +27,33 @@
 #pragma once
 
 #include <dsn/tool_api.h>
+#include <dsn/perf_counter/perf_counter_wrapper.h>
 #include <boost/asio.hpp>
+#include <atomic>
 
 namespace dsn {
 namespace tools {
 
+// an io_service with the threads running it, to which sessions are affine
+struct asio_reactor
+{
+    explicit asio_reactor(int index) : index(index) {}
+
+    int index;
+    boost::asio::io_service ios;
+
+    // the listener of this reactor, if the port is listened with SO_REUSEPORT
+    std::shared_ptr<boost::asio::ip::tcp::acceptor> acceptor;
+
+    perf_counter_wrapper session_count;
+    perf_counter_wrapper accept_count;
+};
+
+//
+// the sessions are distributed among [network] io_service_count reactors, each of which
+// is run by io_service_worker_count threads. with one thread for each reactor, all the
+// handlers of a session run on the same thread, which may be pinned to a core.
+//
 class asio_network_provider : public connection_oriented_network
 {
 public:
@@ -44,13 +66,19 @@ public:
     virtual rpc_session_ptr create_client_session(::dsn::rpc_address server_addr) override;
 
 private:
-    void do_accept();
+    error_code open_acceptor(asio_reactor &r,
+                             bool reuse_port,
+                             /*out*/ std::shared_ptr<boost::asio::ip::tcp::acceptor> &acceptor);
+    void do_accept(asio_reactor *r);
+    asio_reactor &next_reactor();
 
 private:
     friend class asio_rpc_session;
 
+    // the shared listener, unless each reactor has its own
     std::shared_ptr<boost::asio::ip::tcp::acceptor> _acceptor;
-    boost::asio::io_service _io_service;
+    std::vector<std::unique_ptr<asio_reactor>> _reactors;
+    std::atomic<unsigned int> _next_reactor;
     std::vector<std::shared_ptr<std::thread>> _workers;
     ::dsn::rpc_address _address;
 };
@@ -38,7 +38,12 @@
 namespace dsn {
 namespace tools {
 
-asio_rpc_session::~asio_rpc_session() {}
+asio_rpc_session::~asio_rpc_session()
+{
+    if (_session_count != nullptr) {
+        _session_count->decrement();
+    }
+}
 
 void asio_rpc_session::set_options()
 {
@@ -138,14 +143,17 @@ void asio_rpc_session::do_read(int read_next)
 
 void asio_rpc_session::write(uint64_t signature)
 {
-    std::vector<boost::asio::const_buffer> buffers2;
     int bcount = (int)_sending_buffers.size();
 
     // prepare buffers
-    buffers2.resize(bcount);
+    _write_buffers.resize(bcount);
     for (int i = 0; i < bcount; i++) {
-        buffers2[i] = boost::asio::const_buffer(_sending_buffers[i].buf, _sending_buffers[i].sz);
+        _write_buffers[i] =
+            boost::asio::const_buffer(_sending_buffers[i].buf, _sending_buffers[i].sz);
     }
+    write_buffer_sequence buffers2;
+    buffers2._begin = _write_buffers.data();
+    buffers2._end = _write_buffers.data() + bcount;
 
     add_ref();
     boost::asio::async_write(
@@ -166,12 +174,32 @@ asio_rpc_session::asio_rpc_session(asio_network_provider &net,
                                    ::dsn::rpc_address remote_addr,
                                    std::shared_ptr<boost::asio::ip::tcp::socket> &socket,
                                    message_parser_ptr &parser,
-                                   bool is_client)
-    : rpc_session(net, remote_addr, parser, is_client), _socket(socket)
+                                   bool is_client,
+                                   asio_reactor &reactor)
+    : rpc_session(net, remote_addr, parser, is_client),
+      _socket(socket),
+      _reactor(reactor),
+      _session_count(reactor.session_count.get()),
+      _cork_timer(reactor.ios)
 {
+    if (_session_count != nullptr) {
+        _session_count->increment();
+    }
+    _cork_delay_us = net.send_cork_delay_us();
     set_options();
 }
 
+void asio_rpc_session::send_corked(int delay_us)
+{
+    add_ref();
+    _cork_timer.expires_from_now(boost::posix_time::microseconds(delay_us));
+    _cork_timer.async_wait([this](const boost::system::error_code &ec) {
+        // the timer is never cancelled, and only one cork is on the fly
+        flush_corked_messages();
+        release_ref();
+    });
+}
+
 void asio_rpc_session::on_failure(bool is_write)
 {
     if (on_disconnected(is_write)) {
@@ -51,9 +51,11 @@ public:
                      ::dsn::rpc_address remote_addr,
                      std::shared_ptr<boost::asio::ip::tcp::socket> &socket,
                      message_parser_ptr &parser,
-                     bool is_client);
+                     bool is_client,
+                     asio_reactor &reactor);
     virtual ~asio_rpc_session();
     virtual void send(uint64_t signature) override { return write(signature); }
+    virtual void send_corked(int delay_us) override;
     virtual void close() override { safe_close(); }
 
 public:
@@ -73,7 +75,28 @@ private:
     void safe_close();
 
 private:
+    // a view of _write_buffers, so that async_write doesn't copy the vector
+    struct write_buffer_sequence
+    {
+        typedef boost::asio::const_buffer value_type;
+        typedef const boost::asio::const_buffer *const_iterator;
+
+        const_iterator begin() const { return _begin; }
+        const_iterator end() const { return _end; }
+
+        const_iterator _begin;
+        const_iterator _end;
+    };
+
     std::shared_ptr<boost::asio::ip::tcp::socket> _socket;
+    asio_reactor &_reactor;
+    // the session count of the reactor, or nullptr if the provider is not started yet
+    perf_counter *_session_count;
+
+    // reused by all the writes, only one of which is on the fly
+    std::vector<boost::asio::const_buffer> _write_buffers;
+
+    boost::asio::deadline_timer _cork_timer;
 };
 }
 }
@@ -34,12 +34,25 @@
  */
 
 #include "dsn_message_parser.h"
+#include "message_compressor.h"
 #include <dsn/service_api_c.h>
+#include <dsn/tool-api/network.h>
 #include <dsn/utility/crc.h>
+#include <dsn/utility/transient_memory.h>
 
 namespace dsn {
 void dsn_message_parser::reset() { _header_checked = false; }
 
+void dsn_message_parser::on_bound_to_session(rpc_session *session)
+{
+    if (session->net().compact_message_header()) {
+        enable_compact_header();
+    }
+}
+
+// hdr_type and hdr_version, which are in the same place of both formats
+static const unsigned int header_prefix_length = 2 * sizeof(uint32_t);
+
 message_ex *dsn_message_parser::get_message_on_receive(message_reader *reader,
                                                        /*out*/ int &read_next)
 {
@@ -49,6 +62,15 @@ message_ex *dsn_message_parser::get_message_on_receive(message_reader *reader,
     char *buf_ptr = (char *)buf.data();
     unsigned int buf_len = reader->_buffer_occupied;
 
+    if (buf_len < header_prefix_length) {
+        read_next = header_prefix_length - buf_len;
+        return nullptr;
+    }
+
+    if (((message_header *)buf_ptr)->hdr_version == DSN_HDR_VERSION_COMPACT) {
+        return get_compact_message_on_receive(reader, read_next);
+    }
+
     if (buf_len >= sizeof(message_header)) {
         if (!_header_checked) {
             if (!is_right_header(buf_ptr)) {
@@ -80,10 +102,22 @@ message_ex *dsn_message_parser::get_message_on_receive(message_reader *reader,
                 reader->_buffer = buf.range(msg_sz);
                 reader->_buffer_occupied -= msg_sz;
                 _header_checked = false;
-                read_next = (reader->_buffer_occupied >= sizeof(message_header)
+                read_next = (reader->_buffer_occupied >= header_prefix_length
                                  ? 0
-                                 : sizeof(message_header) - reader->_buffer_occupied);
+                                 : header_prefix_length - reader->_buffer_occupied);
                 msg->hdr_format = NET_HDR_DSN;
+
+                // only requests are checked, as the responses of the old versions copy
+                // hdr_version from the requests
+                if (_compact_header_enabled && msg->header->context.u.is_request &&
+                    msg->header->hdr_version == DSN_HDR_VERSION_COMPACT_ACCEPTED) {
+                    _peer_accepts_compact_header.store(true, std::memory_order_relaxed);
+                }
+
+                msg = decompress_on_receive(msg);
+                if (msg == nullptr) {
+                    read_next = -1;
+                }
                 return msg;
             }
         } else { // buf_len < msg_sz
@@ -101,6 +135,19 @@ void dsn_message_parser::prepare_on_send(message_ex *msg)
     auto &header = msg->header;
     auto &buffers = msg->buffers;
 
+    // hdr_version may be copied from a received message, e.g., by create_response()
+    header->hdr_version =
+        _compact_header_enabled ? DSN_HDR_VERSION_COMPACT_ACCEPTED : DSN_HDR_VERSION_DEFAULT;
+
+    // advertise the codecs we are able to decompress, with a separate field for the responses
+    // as the old versions copy the whole request header into the responses
+    if (header->context.u.is_request) {
+        header->context.u.request_compress_mask = message_compressor::supported_mask();
+        header->context.u.response_compress_mask = 0;
+    } else {
+        header->context.u.response_compress_mask = message_compressor::supported_mask();
+    }
+
 #ifndef NDEBUG
     int i_max = (int)buffers.size() - 1;
     size_t len = 0;
@@ -143,10 +190,162 @@ void dsn_message_parser::prepare_on_send(message_ex *msg)
         header->hdr_crc32 = CRC_INVALID;
         header->hdr_crc32 = dsn::utils::crc32_calc(header, sizeof(message_header), 0);
     }
+
+    compress_on_send(msg);
+}
+
+void dsn_message_parser::compress_on_send(message_ex *msg)
+{
+    // compressed already, or not worth compressing
+    if (msg->send_body_compress_type != RPC_COMPRESS_NONE) {
+        return;
+    }
+
+    task_spec *sp = task_spec::get(msg->local_rpc_code);
+    rpc_compress_type_t type = sp->rpc_message_compress_type;
+    message_header *header = msg->header;
+    if (type == RPC_COMPRESS_NONE || header->body_length < sp->rpc_message_compress_threshold ||
+        (_peer_compress_mask.load(std::memory_order_relaxed) &
+         message_compressor::type_mask(type)) == 0) {
+        return;
+    }
+
+    // the codecs take contiguous input, so gather the body if it is fragmented
+    std::vector<std::pair<const char *, size_t>> pieces;
+    for (size_t i = 0; i < msg->buffers.size(); i++) {
+        const char *data = msg->buffers[i].data();
+        size_t sz = msg->buffers[i].length();
+        if (i == 0) {
+            data += sizeof(message_header);
+            sz -= sizeof(message_header);
+        }
+        if (sz > 0) {
+            pieces.emplace_back(data, sz);
+        }
+    }
+
+    const char *body = nullptr;
+    std::unique_ptr<char[]> gathered;
+    if (pieces.size() == 1) {
+        body = pieces[0].first;
+    } else {
+        gathered.reset(new char[header->body_length]);
+        char *p = gathered.get();
+        for (auto &piece : pieces) {
+            memcpy(p, piece.first, piece.second);
+            p += piece.second;
+        }
+        body = gathered.get();
+    }
+
+    blob compressed;
+    if (!message_compressor::instance().compress(type, body, header->body_length, compressed)) {
+        msg->send_body_compress_type = -1;
+        return;
+    }
+
+    msg->send_body_crc32 =
+        header->body_crc32 != CRC_INVALID
+            ? dsn::utils::crc32_calc(compressed.data(), (size_t)compressed.length(), 0)
+            : CRC_INVALID;
+    msg->send_body = std::move(compressed);
+    msg->send_body_compress_type = type;
+}
+
+bool dsn_message_parser::is_sending_compressed_body(message_ex *msg) const
+{
+    return msg->send_body_compress_type > RPC_COMPRESS_NONE &&
+           (_peer_compress_mask.load(std::memory_order_relaxed) &
+            message_compressor::type_mask(msg->send_body_compress_type)) != 0;
+}
+
+message_ex *dsn_message_parser::decompress_on_receive(message_ex *msg)
+{
+    message_header *header = msg->header;
+    _peer_compress_mask.store(header->context.u.is_request
+                                  ? (uint32_t)header->context.u.request_compress_mask
+                                  : (uint32_t)header->context.u.response_compress_mask,
+                              std::memory_order_relaxed);
+
+    int type = header->context.u.compress_type;
+    if (type == RPC_COMPRESS_NONE) {
+        return msg;
+    }
+
+    // the body follows the full header, or the standalone header for the compact one
+    blob body = msg->buffers.size() == 1 ? msg->buffers[0].range(sizeof(message_header))
+                                         : msg->buffers.back();
+    blob raw;
+    if (!message_compressor::instance().decompress((rpc_compress_type_t)type, body, raw)) {
+        derror("dsn message body decompression failed, compress_type = %d, id = %" PRIu64
+               ", trace_id = %016" PRIx64 ", rpc_name = %s, from_addr = %s",
+               type,
+               header->id,
+               header->trace_id,
+               header->rpc_name,
+               header->from_address.to_string());
+        delete msg;
+        return nullptr;
+    }
+
+    // the crc of the compressed body is checked already
+    message_ex *raw_msg = message_ex::create_receive_message_with_standalone_header(raw);
+    memcpy(raw_msg->header, header, sizeof(message_header));
+    raw_msg->header->body_length = raw.length();
+    raw_msg->header->hdr_crc32 = CRC_INVALID;
+    raw_msg->header->body_crc32 = CRC_INVALID;
+    raw_msg->header->context.u.compress_type = RPC_COMPRESS_NONE;
+    raw_msg->hdr_format = msg->hdr_format;
+    delete msg;
+    return raw_msg;
+}
+
+int dsn_message_parser::get_buffer_count_on_send(message_ex *msg) const
+{
+    // one more for the compact header, which is decided when getting the buffers, and
+    // at least two for the standalone header and the compressed body
+    return std::max(static_cast<int>(msg->buffers.size()), 2) + (_compact_header_enabled ? 1 : 0);
 }
 
 int dsn_message_parser::get_buffers_on_send(message_ex *msg, /*out*/ send_buf *buffers)
 {
+    if (is_sending_compressed_body(msg)) {
+        message_header header = *msg->header;
+        header.body_length = static_cast<uint32_t>(msg->send_body.length());
+        header.body_crc32 =
+            msg->header->body_crc32 != CRC_INVALID ? msg->send_body_crc32 : CRC_INVALID;
+        header.context.u.compress_type = msg->send_body_compress_type;
+        if (is_sending_compact_header()) {
+            return get_compact_buffers_on_send(msg, &header, &msg->send_body, buffers);
+        }
+
+        // send a copy of the full header, as the one ahead of the raw body is left untouched
+        if (header.hdr_crc32 != CRC_INVALID) {
+            header.hdr_crc32 = CRC_INVALID;
+            header.hdr_crc32 = dsn::utils::crc32_calc(&header, sizeof(message_header), 0);
+        }
+
+        void *ptr;
+        size_t size;
+        tls_trans_mem_next(&ptr, &size, sizeof(message_header));
+        memcpy(ptr, &header, sizeof(message_header));
+        msg->send_header =
+            blob(*tls_trans_memory.block,
+                 static_cast<int>(static_cast<char *>(ptr) - tls_trans_memory.block->get()),
+                 static_cast<int>(sizeof(message_header)));
+        tls_trans_mem_commit(sizeof(message_header));
+
+        buffers[0].buf = (void *)msg->send_header.data();
+        buffers[0].sz = sizeof(message_header);
+        buffers[1].buf = (void *)msg->send_body.data();
+        buffers[1].sz = msg->send_body.length();
+        return 2;
+    }
+
+    if (is_sending_compact_header()) {
+        return get_compact_buffers_on_send(msg, msg->header, nullptr, buffers);
+    }
+
     int i = 0;
     for (auto &buf : msg->buffers) {
         buffers[i].buf = (void *)buf.data();
@@ -186,6 +385,10 @@ int dsn_message_parser::get_buffers_on_send(message_ex *msg, /*out*/ send_buf *b
         uint32_t crc32 = 0;
         size_t len = 0;
         for (int i = 0; i <= i_max; i++) {
+            // skip the standalone header of the messages received with the compact header
+            if (buffers[i].data() == (const char *)header) {
+                continue;
+            }
             const void *ptr = (const void *)buffers[i].data();
             size_t sz = (size_t)buffers[i].length();
 
@@ -209,4 +412,442 @@ int dsn_message_parser::get_buffers_on_send(message_ex *msg, /*out*/ send_buf *b
         return true;
     }
 }
+
+//
+// the compact header:
+//   compact_message_header                       fixed 20 bytes
+//   id                                           varint
+//   rpc code                                     code reference
+//   context                                      varint
+//   body_crc32             (CF_BODY_CRC32)       4 bytes
+//   trace_id               (CF_TRACE_ID)         varint
+//   gpid                   (CF_GPID)             zigzag app_id, zigzag partition_index
+//   from_address           (CF_FROM_ADDRESS)     4 bytes ip, 2 bytes port
+//   client.timeout_ms      (CF_TIMEOUT)          zigzag
+//   client.thread_hash     (CF_THREAD_HASH)      zigzag
+//   client.partition_hash  (CF_PARTITION_HASH)   varint
+//   server.error_code      (CF_ERROR)            code reference
+//
+// the optional fields are sent only if they are not zero (or CRC_INVALID).
+//
+// a code reference is varint(id << 1 | has_name), followed by varint(length) and the name
+// if has_name is set. id is the local code of the sender plus one, and the name is sent
+// only with the first reference to an id. id 0 is never interned, so its name is always
+// sent, which is used for the codes unknown to the sender.
+//
+enum compact_header_field
+{
+    CF_BODY_CRC32 = 1 << 0,
+    CF_TRACE_ID = 1 << 1,
+    CF_GPID = 1 << 2,
+    CF_FROM_ADDRESS = 1 << 3,
+    CF_TIMEOUT = 1 << 4,
+    CF_THREAD_HASH = 1 << 5,
+    CF_PARTITION_HASH = 1 << 6,
+    CF_ERROR = 1 << 7
+};
+
+static const size_t max_compact_header_length = 256;
+
+// bounds the memory a peer may make us spend on the interned codes
+static const uint64_t max_interned_code_id = 16384;
+
+static inline void write_varint(char *&ptr, uint64_t v)
+{
+    while (v >= 0x80) {
+        *ptr++ = static_cast<char>(v | 0x80);
+        v >>= 7;
+    }
+    *ptr++ = static_cast<char>(v);
+}
+
+static inline void write_zigzag(char *&ptr, int32_t v)
+{
+    write_varint(ptr, (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31));
+}
+
+static inline void write_fixed(char *&ptr, const void *v, size_t sz)
+{
+    memcpy(ptr, v, sz);
+    ptr += sz;
+}
+
+static inline bool read_varint(const char *&ptr, const char *end, /*out*/ uint64_t &v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (ptr >= end) {
+            return false;
+        }
+        uint8_t b = static_cast<uint8_t>(*ptr++);
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool read_zigzag(const char *&ptr, const char *end, /*out*/ int32_t &v)
+{
+    uint64_t u;
+    if (!read_varint(ptr, end, u) || u > UINT32_MAX) {
+        return false;
+    }
+    uint32_t u32 = static_cast<uint32_t>(u);
+    v = static_cast<int32_t>((u32 >> 1) ^ (0u - (u32 & 1)));
+    return true;
+}
+
+static inline bool read_fixed(const char *&ptr, const char *end, /*out*/ void *v, size_t sz)
+{
+    if (static_cast<size_t>(end - ptr) < sz) {
+        return false;
+    }
+    memcpy(v, ptr, sz);
+    ptr += sz;
+    return true;
+}
+
+static bool is_right_compact_header(char *hdr)
+{
+    compact_message_header *chdr = reinterpret_cast<compact_message_header *>(hdr);
+    uint32_t crc32 = chdr->hdr_crc32;
+    if (crc32 != CRC_INVALID) {
+        chdr->hdr_crc32 = CRC_INVALID;
+        bool r = (crc32 == dsn::utils::crc32_calc(hdr, chdr->hdr_length, 0));
+        chdr->hdr_crc32 = crc32;
+        if (!r) {
+            derror("dsn compact message header crc check failed");
+        }
+        return r;
+    }
+
+    // crc is not enabled
+    else {
+        return true;
+    }
+}
+
+/*static*/ void dsn_message_parser::write_code(char *&ptr,
+                                               std::vector<bool> &sent_codes,
+                                               int code,
+                                               const char *name)
+{
+    uint64_t id = 0;
+    bool has_name = true;
+    if (code >= 0 && static_cast<uint64_t>(code) + 1 < max_interned_code_id) {
+        id = static_cast<uint64_t>(code) + 1;
+        if (sent_codes.size() <= static_cast<size_t>(code)) {
+            sent_codes.resize(code + 1, false);
+        }
+        has_name = !sent_codes[code];
+        sent_codes[code] = true;
+    }
+
+    write_varint(ptr, (id << 1) | (has_name ? 1 : 0));
+    if (has_name) {
+        // names are null-terminated in the message_header
+        size_t len = strnlen(name, DSN_MAX_TASK_CODE_NAME_LENGTH - 1);
+        write_varint(ptr, len);
+        write_fixed(ptr, name, len);
+    }
+}
+
+/*static*/ const dsn_message_parser::interned_code *
+dsn_message_parser::read_code(const char *&ptr,
+                              const char *end,
+                              bool is_rpc_code,
+                              std::vector<interned_code> &codes,
+                              interned_code &uninterned)
+{
+    uint64_t v;
+    if (!read_varint(ptr, end, v)) {
+        return nullptr;
+    }
+
+    uint64_t id = v >> 1;
+    bool has_name = (v & 1) != 0;
+    if (id >= max_interned_code_id) {
+        return nullptr;
+    }
+
+    interned_code *code = &uninterned;
+    if (id != 0) {
+        if (codes.size() <= id) {
+            codes.resize(id + 1);
+        }
+        code = &codes[id];
+    }
+
+    if (has_name) {
+        uint64_t len;
+        if (!read_varint(ptr, end, len) || len == 0 || len >= DSN_MAX_TASK_CODE_NAME_LENGTH ||
+            static_cast<uint64_t>(end - ptr) < len) {
+            return nullptr;
+        }
+        code->name.assign(ptr, len);
+        ptr += len;
+        code->local_code = is_rpc_code
+                               ? task_code::try_get(code->name, TASK_CODE_INVALID).code()
+                               : static_cast<int>(error_code::try_get(code->name, ERR_UNKNOWN));
+    } else if (id == 0 || code->name.empty()) {
+        // referring to an id never interned
+        return nullptr;
+    }
+    return code;
+}
+
+int dsn_message_parser::get_compact_buffers_on_send(message_ex *msg,
+                                                    const message_header *header,
+                                                    const blob *body,
+                                                    /*out*/ send_buf *buffers)
+{
+    dassert(!msg->buffers.empty() && msg->buffers[0].data() == (const char *)msg->header,
+            "the message header must be ahead of the first buffer");
+
+    void *ptr;
+    size_t size;
+    tls_trans_mem_next(&ptr, &size, max_compact_header_length);
+
+    char *begin = static_cast<char *>(ptr);
+    char *p = begin + sizeof(compact_message_header);
+    uint16_t fields = 0;
+
+    write_varint(p, header->id);
+    write_code(p,
+               _sent_rpc_codes,
+               msg->local_rpc_code != TASK_CODE_INVALID ? msg->local_rpc_code.code() : -1,
+               header->rpc_name);
+    write_varint(p, header->context.context);
+
+    if (header->body_crc32 != CRC_INVALID) {
+        fields |= CF_BODY_CRC32;
+        write_fixed(p, &header->body_crc32, sizeof(uint32_t));
+    }
+    if (header->trace_id != 0) {
+        fields |= CF_TRACE_ID;
+        write_varint(p, header->trace_id);
+    }
+    if (header->gpid.value() != 0) {
+        fields |= CF_GPID;
+        write_zigzag(p, header->gpid.get_app_id());
+        write_zigzag(p, header->gpid.get_partition_index());
+    }
+    if (header->from_address.type() == HOST_TYPE_IPV4) {
+        fields |= CF_FROM_ADDRESS;
+        uint32_t ip = header->from_address.ip();
+        uint16_t port = header->from_address.port();
+        write_fixed(p, &ip, sizeof(ip));
+        write_fixed(p, &port, sizeof(port));
+    }
+    if (header->client.timeout_ms != 0) {
+        fields |= CF_TIMEOUT;
+        write_zigzag(p, header->client.timeout_ms);
+    }
+    if (header->client.thread_hash != 0) {
+        fields |= CF_THREAD_HASH;
+        write_zigzag(p, header->client.thread_hash);
+    }
+    if (header->client.partition_hash != 0) {
+        fields |= CF_PARTITION_HASH;
+        write_varint(p, header->client.partition_hash);
+    }
+    if (header->server.error_name[0] != '\0') {
+        fields |= CF_ERROR;
+        int err = header->server.error_code.local_hash == message_ex::s_local_hash
+                      ? static_cast<int>(header->server.error_code.local_code)
+                      : -1;
+        write_code(p, _sent_error_codes, err, header->server.error_name);
+    }
+
+    size_t length = p - begin;
+    dassert(length <= max_compact_header_length, "compact header overflows: %d", (int)length);
+
+    compact_message_header *chdr = reinterpret_cast<compact_message_header *>(begin);
+    chdr->hdr_type = header->hdr_type;
+    chdr->hdr_version = DSN_HDR_VERSION_COMPACT;
+    chdr->hdr_length = static_cast<uint16_t>(length);
+    chdr->fields = fields;
+    chdr->hdr_crc32 = CRC_INVALID;
+    chdr->body_length = header->body_length;
+
+    // the same as the full header, crc is computed only if the task requires it
+    if (header->hdr_crc32 != CRC_INVALID) {
+        chdr->hdr_crc32 = dsn::utils::crc32_calc(begin, length, 0);
+    }
+
+    msg->send_header = blob(*tls_trans_memory.block,
+                            static_cast<int>(begin - tls_trans_memory.block->get()),
+                            static_cast<int>(length));
+    tls_trans_mem_commit(length);
+
+    int i = 0;
+    buffers[i].buf = (void *)msg->send_header.data();
+    buffers[i].sz = length;
+    ++i;
+    if (body != nullptr) {
+        buffers[i].buf = (void *)body->data();
+        buffers[i].sz = body->length();
+        return ++i;
+    }
+    for (size_t j = 0; j < msg->buffers.size(); ++j) {
+        const blob &buf = msg->buffers[j];
+        const char *data = buf.data();
+        size_t sz = buf.length();
+        if (j == 0) {
+            // skip the full header
+            data += sizeof(message_header);
+            sz -= sizeof(message_header);
+        }
+        if (sz == 0) {
+            continue;
+        }
+        buffers[i].buf = (void *)data;
+        buffers[i].sz = sz;
+        ++i;
+    }
+    return i;
+}
+
+message_ex *dsn_message_parser::get_compact_message_on_receive(message_reader *reader,
+                                                               /*out*/ int &read_next)
+{
+    dsn::blob &buf = reader->_buffer;
+    char *buf_ptr = (char *)buf.data();
+    unsigned int buf_len = reader->_buffer_occupied;
+
+    if (buf_len < sizeof(compact_message_header)) {
+        read_next = sizeof(compact_message_header) - buf_len;
+        return nullptr;
+    }
+
+    compact_message_header *chdr = reinterpret_cast<compact_message_header *>(buf_ptr);
+    if (chdr->hdr_length < sizeof(compact_message_header) ||
+        chdr->hdr_length > max_compact_header_length) {
+        derror("dsn compact message header length is invalid: %u", (unsigned int)chdr->hdr_length);
+        read_next = -1;
+        return nullptr;
+    }
+
+    if (buf_len < chdr->hdr_length) {
+        read_next = chdr->hdr_length - buf_len;
+        return nullptr;
+    }
+
+    if (!_header_checked) {
+        if (!is_right_compact_header(buf_ptr)) {
+            read_next = -1;
+            return nullptr;
+        }
+        _header_checked = true;
+    }
+
+    unsigned int msg_sz = chdr->hdr_length + chdr->body_length;
+    if (buf_len < msg_sz) {
+        read_next = msg_sz - buf_len;
+        return nullptr;
+    }
+
+    message_ex *msg = message_ex::create_receive_message_with_standalone_header(
+        buf.range(chdr->hdr_length, chdr->body_length));
+    message_header *header = msg->header;
+    header->hdr_type = chdr->hdr_type;
+    header->hdr_version = DSN_HDR_VERSION_COMPACT;
+    header->hdr_length = sizeof(message_header);
+    header->hdr_crc32 = CRC_INVALID;
+    header->body_crc32 = CRC_INVALID;
+
+    const char *p = buf_ptr + sizeof(compact_message_header);
+    const char *end = buf_ptr + chdr->hdr_length;
+    uint16_t fields = chdr->fields;
+    bool ok = read_varint(p, end, header->id);
+
+    interned_code uninterned;
+    const interned_code *code = nullptr;
+    if (ok && (code = read_code(p, end, true, _recv_rpc_codes, uninterned)) != nullptr) {
+        memcpy(header->rpc_name, code->name.c_str(), code->name.length());
+        header->rpc_code.local_code = static_cast<uint32_t>(code->local_code);
+        header->rpc_code.local_hash = message_ex::s_local_hash;
+    } else {
+        ok = false;
+    }
+
+    ok = ok && read_varint(p, end, header->context.context);
+    if (ok && (fields & CF_BODY_CRC32)) {
+        ok = read_fixed(p, end, &header->body_crc32, sizeof(uint32_t));
+    }
+    if (ok && (fields & CF_TRACE_ID)) {
+        ok = read_varint(p, end, header->trace_id);
+    }
+    if (ok && (fields & CF_GPID)) {
+        int32_t app_id, partition_index;
+        ok = read_zigzag(p, end, app_id) && read_zigzag(p, end, partition_index);
+        header->gpid.set_app_id(app_id);
+        header->gpid.set_partition_index(partition_index);
+    }
+    if (ok && (fields & CF_FROM_ADDRESS)) {
+        uint32_t ip;
+        uint16_t port;
+        ok = read_fixed(p, end, &ip, sizeof(ip)) && read_fixed(p, end, &port, sizeof(port));
+        header->from_address.assign_ipv4(ip, port);
+    }
+    if (ok && (fields & CF_TIMEOUT)) {
+        ok = read_zigzag(p, end, header->client.timeout_ms);
+    }
+    if (ok && (fields & CF_THREAD_HASH)) {
+        ok = read_zigzag(p, end, header->client.thread_hash);
+    }
+    if (ok && (fields & CF_PARTITION_HASH)) {
+        ok = read_varint(p, end, header->client.partition_hash);
+    }
+    if (ok && (fields & CF_ERROR)) {
+        code = read_code(p, end, false, _recv_error_codes, uninterned);
+        if (code != nullptr) {
+            memcpy(header->server.error_name, code->name.c_str(), code->name.length());
+            header->server.error_code.local_code = static_cast<uint32_t>(code->local_code);
+            header->server.error_code.local_hash = message_ex::s_local_hash;
+        } else {
+            ok = false;
+        }
+    }
+
+    if (!ok || p != end) {
+        derror("dsn compact message header is corrupted, fields = %x, hdr_length = %u",
+               (unsigned int)fields,
+               (unsigned int)chdr->hdr_length);
+        delete msg;
+        read_next = -1;
+        return nullptr;
+    }
+
+    if (!is_right_body(msg)) {
+        derror("dsn compact message body check failed, id = %" PRIu64 ", trace_id = %016" PRIx64
+               ", rpc_name = %s, from_addr = %s",
+               header->id,
+               header->trace_id,
+               header->rpc_name,
+               header->from_address.to_string());
+        delete msg;
+        read_next = -1;
+        return nullptr;
+    }
+
+    reader->_buffer = buf.range(msg_sz);
+    reader->_buffer_occupied -= msg_sz;
+    _header_checked = false;
+    read_next = (reader->_buffer_occupied >= header_prefix_length
+                     ? 0
+                     : header_prefix_length - reader->_buffer_occupied);
+    msg->hdr_format = NET_HDR_DSN;
+
+    // the peer would not send the compact header unless we had asked for it
+    _peer_accepts_compact_header.store(true, std::memory_order_relaxed);
+
+    msg = decompress_on_receive(msg);
+    if (msg == nullptr) {
+        read_next = -1;
+    }
+    return msg;
+}
 }
@@ -38,29 +38,126 @@
 #include <dsn/tool-api/message_parser.h>
 #include <dsn/tool-api/rpc_message.h>
 #include <dsn/utility/ports.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// hdr_version of the dsn messages on the wire:
+// - DEFAULT: the message_header as is
+// - COMPACT_ACCEPTED: the message_header as is, and the sender is able to receive
+//   the compact header
+// - COMPACT: the compact header, followed by the body directly
+#define DSN_HDR_VERSION_DEFAULT 0
+#define DSN_HDR_VERSION_COMPACT_ACCEPTED 1
+#define DSN_HDR_VERSION_COMPACT 2
 
 namespace dsn {
+
+// the fixed part of the compact header, which is followed by the varint-encoded fields
+// (see dsn_message_parser.cpp for the layout) and then the body.
+//
+// the rpc and error codes are sent as integer ids interned per rpc_session: the first
+// message using a code carries its name along with the id, and the later ones carry
+// only the id.
+struct compact_message_header
+{
+    uint32_t hdr_type;    ///< must be "RDSN"
+    uint32_t hdr_version; ///< must be DSN_HDR_VERSION_COMPACT
+    uint16_t hdr_length;  ///< length of the whole compact header
+    uint16_t fields;      ///< which optional fields are present
+    uint32_t hdr_crc32;   ///< crc of the whole compact header with hdr_crc32 = 0
+    uint32_t body_length;
+    //------------- sizeof(compact_message_header) = 20 ----------//
+};
+
 class dsn_message_parser : public message_parser
 {
 public:
-    dsn_message_parser() : _header_checked(false) {}
+    dsn_message_parser()
+        : _header_checked(false),
+          _compact_header_enabled(false),
+          _peer_accepts_compact_header(false),
+          _peer_compress_mask(0)
+    {
+    }
     virtual ~dsn_message_parser() {}
 
     virtual void reset() override;
 
+    virtual void on_bound_to_session(rpc_session *session) override;
+
     virtual message_ex *get_message_on_receive(message_reader *reader,
                                                /*out*/ int &read_next) override;
 
     virtual void prepare_on_send(message_ex *msg) override;
 
+    virtual int get_buffer_count_on_send(message_ex *msg) const override;
+
     virtual int get_buffers_on_send(message_ex *msg, /*out*/ send_buf *buffers) override;
 
+    // advertise the compact header to the peer, and send it once the peer does the same
+    void enable_compact_header() { _compact_header_enabled = true; }
+
+    bool is_sending_compact_header() const
+    {
+        return _compact_header_enabled &&
+               _peer_accepts_compact_header.load(std::memory_order_relaxed);
+    }
+
+    // whether the compressed body of the message is sent to the peer
+    bool is_sending_compressed_body(message_ex *msg) const;
+
 private:
     static bool is_right_header(char *hdr);
 
     static bool is_right_body(message_ex *msg);
 
+    message_ex *get_compact_message_on_receive(message_reader *reader, /*out*/ int &read_next);
+
+    // send the header instead of msg->header, and the body instead of msg->buffers if given
+    int get_compact_buffers_on_send(message_ex *msg,
+                                    const message_header *header,
+                                    const blob *body,
+                                    /*out*/ send_buf *buffers);
+
+    // compress the body of the message if the task requires and the peer supports it
+    void compress_on_send(message_ex *msg);
+
+    // learn the codecs supported by the peer, and decompress the body if it is compressed,
+    // returns the message with the raw body, or nullptr if failed
+    message_ex *decompress_on_receive(message_ex *msg);
+
+    struct interned_code
+    {
+        std::string name;
+        int local_code;
+    };
+
+    // returns nullptr if the code is corrupted
+    static const interned_code *read_code(const char *&ptr,
+                                          const char *end,
+                                          bool is_rpc_code,
+                                          std::vector<interned_code> &codes,
+                                          interned_code &uninterned);
+
+    static void write_code(char *&ptr, std::vector<bool> &sent_codes, int code, const char *name);
+
 private:
     bool _header_checked;
+
+    bool _compact_header_enabled;
+    std::atomic<bool> _peer_accepts_compact_header;
+
+    // codecs the peer is able to decompress, see message_compressor::type_mask
+    std::atomic<uint32_t> _peer_compress_mask;
+
+    // codes whose names are already sent, only accessed in get_buffers_on_send,
+    // which is called in order by the session
+    std::vector<bool> _sent_rpc_codes;
+    std::vector<bool> _sent_error_codes;
+
+    // codes interned by the peer, indexed by the ids on the wire
+    std::vector<interned_code> _recv_rpc_codes;
+    std::vector<interned_code> _recv_error_codes;
 };
 }
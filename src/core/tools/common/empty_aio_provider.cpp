@@ -56,7 +56,7 @@ error_code empty_aio_provider::flush(dsn_handle_t fh) { return ERR_OK; }
 
 void empty_aio_provider::aio(aio_task *aio)
 {
-    complete_io(aio, ERR_OK, aio->aio()->buffer_size, 0);
+    complete_io(aio, ERR_OK, aio->aio()->type == AIO_Flush ? 0 : aio->aio()->buffer_size, 0);
 }
 
 disk_aio *empty_aio_provider::prepare_aio_context(aio_task *tsk) { return new disk_aio(); }
@@ -51,6 +51,7 @@ public:
     virtual error_code flush(dsn_handle_t fh) override;
     virtual void aio(aio_task *aio) override;
     virtual disk_aio *prepare_aio_context(aio_task *tsk) override;
+    virtual int max_write_buffer_count() const override { return 1024; }
 
     virtual void start() override {}
 };
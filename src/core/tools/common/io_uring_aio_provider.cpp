@@ -0,0 +1,545 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "io_uring_aio_provider.h"
+
+#ifdef DSN_HAS_IO_URING
+
+#include <dsn/utility/config_api.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace dsn {
+namespace tools {
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int
+sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void *arg, unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+template <typename T>
+static T *ring_ptr(void *ring, unsigned offset)
+{
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(ring) + offset);
+}
+
+static unsigned load_acquire(const unsigned *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+
+static void store_release(unsigned *p, unsigned v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+io_uring_aio_provider::io_uring_aio_provider(disk_engine *disk, aio_provider *inner_provider)
+    : aio_provider(disk, inner_provider),
+      _in_flight_count(0),
+      _to_submit(0),
+      _is_submitting(false),
+      _fixed_buffers(nullptr),
+      _fixed_size(0)
+{
+    unsigned queue_depth = (unsigned)dsn_config_get_value_uint64(
+        "core", "io_uring_queue_depth", 256, "entries of the io_uring submission queue");
+    _sqpoll = dsn_config_get_value_bool(
+        "core", "io_uring_sqpoll", false, "let a kernel thread poll the io_uring submission queue");
+    unsigned sqpoll_idle_ms = (unsigned)dsn_config_get_value_uint64(
+        "core",
+        "io_uring_sqpoll_idle_ms",
+        1000,
+        "idle milliseconds before the io_uring submission polling thread sleeps");
+    _datasync = dsn_config_get_value_bool(
+        "core", "io_uring_flush_with_fdatasync", false, "flush with fdatasync instead of fsync");
+    int fixed_count = (int)dsn_config_get_value_uint64(
+        "core",
+        "io_uring_fixed_buffer_count",
+        16,
+        "buffers registered to the io_uring for the small reads and writes, 0 to register none");
+    int fixed_size = (int)dsn_config_get_value_uint64(
+        "core", "io_uring_fixed_buffer_size", 4096, "size of each registered io_uring buffer");
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    if (_sqpoll) {
+        p.flags |= IORING_SETUP_SQPOLL;
+        p.sq_thread_idle = sqpoll_idle_ms;
+    }
+    _ring_fd = sys_io_uring_setup(queue_depth, &p);
+    dassert(_ring_fd >= 0, "io_uring_setup error, err = %s", strerror(errno));
+
+    _sq_entries = p.sq_entries;
+    _sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    _cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+    }
+
+    _sq_ring = mmap(nullptr,
+                    _sq_ring_size,
+                    PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE,
+                    _ring_fd,
+                    IORING_OFF_SQ_RING);
+    dassert(_sq_ring != MAP_FAILED, "mmap sq ring failed, err = %s", strerror(errno));
+    if (single_mmap) {
+        _cq_ring = _sq_ring;
+    } else {
+        _cq_ring = mmap(nullptr,
+                        _cq_ring_size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE,
+                        _ring_fd,
+                        IORING_OFF_CQ_RING);
+        dassert(_cq_ring != MAP_FAILED, "mmap cq ring failed, err = %s", strerror(errno));
+    }
+
+    _sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    _sqes = (struct io_uring_sqe *)mmap(nullptr,
+                                        _sqes_size,
+                                        PROT_READ | PROT_WRITE,
+                                        MAP_SHARED | MAP_POPULATE,
+                                        _ring_fd,
+                                        IORING_OFF_SQES);
+    dassert(_sqes != MAP_FAILED, "mmap sqes failed, err = %s", strerror(errno));
+
+    _sq_head = ring_ptr<unsigned>(_sq_ring, p.sq_off.head);
+    _sq_tail = ring_ptr<unsigned>(_sq_ring, p.sq_off.tail);
+    _sq_mask = ring_ptr<unsigned>(_sq_ring, p.sq_off.ring_mask);
+    _sq_flags = ring_ptr<unsigned>(_sq_ring, p.sq_off.flags);
+    _sq_array = ring_ptr<unsigned>(_sq_ring, p.sq_off.array);
+
+    _cq_head = ring_ptr<unsigned>(_cq_ring, p.cq_off.head);
+    _cq_tail = ring_ptr<unsigned>(_cq_ring, p.cq_off.tail);
+    _cq_mask = ring_ptr<unsigned>(_cq_ring, p.cq_off.ring_mask);
+    _cqes = ring_ptr<struct io_uring_cqe>(_cq_ring, p.cq_off.cqes);
+    _cq_entries = p.cq_entries;
+
+    register_fixed_buffers(fixed_count, fixed_size);
+}
+
+io_uring_aio_provider::~io_uring_aio_provider()
+{
+    if (_is_running) {
+        _is_running = false;
+
+        // wake up the completion thread with a nop
+        submit(nullptr);
+        _worker.join();
+    }
+
+    munmap(_sqes, _sqes_size);
+    if (_cq_ring != _sq_ring) {
+        munmap(_cq_ring, _cq_ring_size);
+    }
+    munmap(_sq_ring, _sq_ring_size);
+    ::close(_ring_fd);
+    free(_fixed_buffers);
+}
+
+void io_uring_aio_provider::register_fixed_buffers(int count, int size)
+{
+    if (count <= 0 || size <= 0) {
+        return;
+    }
+
+    void *buffers = nullptr;
+    if (posix_memalign(&buffers, 4096, (size_t)count * size) != 0) {
+        dwarn("allocate %d io_uring buffers of %d bytes failed, go without them", count, size);
+        return;
+    }
+    std::vector<struct iovec> iovs(count);
+    for (int i = 0; i < count; i++) {
+        iovs[i].iov_base = reinterpret_cast<char *>(buffers) + (size_t)i * size;
+        iovs[i].iov_len = size;
+    }
+    int ret = sys_io_uring_register(_ring_fd, IORING_REGISTER_BUFFERS, iovs.data(), count);
+    if (ret != 0) {
+        // e.g., RLIMIT_MEMLOCK is too low to pin them
+        dwarn("register %d io_uring buffers of %d bytes failed, go without them, err = %s",
+              count,
+              size,
+              strerror(errno));
+        free(buffers);
+        return;
+    }
+
+    _fixed_buffers = reinterpret_cast<char *>(buffers);
+    _fixed_size = size;
+    for (int i = count - 1; i >= 0; i--) {
+        _free_fixed_indexes.push_back(i);
+    }
+}
+
+void io_uring_aio_provider::start()
+{
+    _is_running = true;
+    _worker = std::thread([this]() {
+        task::set_tls_dsn_context(node(), nullptr);
+        get_event();
+    });
+}
+
+dsn_handle_t io_uring_aio_provider::open(const char *file_name, int flag, int pmode)
+{
+    dsn_handle_t fh = (dsn_handle_t)(uintptr_t)::open(file_name, flag, pmode);
+    if (fh == DSN_INVALID_FILE_HANDLE) {
+        derror("create file failed, err = %s", strerror(errno));
+    }
+    return fh;
+}
+
+error_code io_uring_aio_provider::close(dsn_handle_t fh)
+{
+    if (fh == DSN_INVALID_FILE_HANDLE || ::close((int)(uintptr_t)(fh)) == 0) {
+        return ERR_OK;
+    } else {
+        derror("close file failed, err = %s", strerror(errno));
+        return ERR_FILE_OPERATION_FAILED;
+    }
+}
+
+error_code io_uring_aio_provider::flush(dsn_handle_t fh)
+{
+    int fd = (int)(uintptr_t)(fh);
+    if (fh == DSN_INVALID_FILE_HANDLE || (_datasync ? ::fdatasync(fd) : ::fsync(fd)) == 0) {
+        return ERR_OK;
+    } else {
+        derror("flush file failed, err = %s", strerror(errno));
+        return ERR_FILE_OPERATION_FAILED;
+    }
+}
+
+disk_aio *io_uring_aio_provider::prepare_aio_context(aio_task *tsk)
+{
+    auto r = new io_uring_disk_aio_context;
+    r->tsk = tsk;
+    r->this_ = this;
+    r->evt = nullptr;
+    r->fixed_index = -1;
+    return r;
+}
+
+void io_uring_aio_provider::aio(aio_task *aio_tsk) { aio_internal(aio_tsk, true); }
+
+void io_uring_aio_provider::prepare_sqe(struct io_uring_sqe *sqe, io_uring_disk_aio_context *aio)
+{
+    memset(sqe, 0, sizeof(*sqe));
+    if (aio == nullptr) {
+        sqe->opcode = IORING_OP_NOP;
+        sqe->user_data = 0;
+        return;
+    }
+
+    sqe->fd = static_cast<int>((ssize_t)aio->file);
+    sqe->user_data = (uint64_t)(uintptr_t)aio;
+
+    if (aio->type != AIO_Flush && prepare_fixed_sqe(sqe, aio)) {
+        return;
+    }
+
+    switch (aio->type) {
+    case AIO_Write:
+        if (!aio->write_buffers.empty()) {
+            aio->iovs.resize(aio->write_buffers.size());
+            for (size_t i = 0; i < aio->write_buffers.size(); i++) {
+                aio->iovs[i].iov_base = aio->write_buffers[i].buffer;
+                aio->iovs[i].iov_len = aio->write_buffers[i].size;
+            }
+            sqe->off = aio->file_offset;
+            sqe->opcode = IORING_OP_WRITEV;
+            sqe->addr = (uint64_t)(uintptr_t)aio->iovs.data();
+            sqe->len = (uint32_t)aio->iovs.size();
+            break;
+        }
+    // fall through
+    case AIO_Read:
+        sqe->off = aio->file_offset;
+        aio->iov.iov_base = aio->buffer;
+        aio->iov.iov_len = aio->buffer_size;
+        sqe->opcode = (aio->type == AIO_Read ? IORING_OP_READV : IORING_OP_WRITEV);
+        sqe->addr = (uint64_t)(uintptr_t)&aio->iov;
+        sqe->len = 1;
+        break;
+    case AIO_Flush:
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fsync_flags = (_datasync ? IORING_FSYNC_DATASYNC : 0);
+        break;
+    default:
+        dassert(false, "unknown aio type %u", static_cast<int>(aio->type));
+        break;
+    }
+}
+
+bool io_uring_aio_provider::prepare_fixed_sqe(struct io_uring_sqe *sqe,
+                                              io_uring_disk_aio_context *aio)
+{
+    if (_free_fixed_indexes.empty()) {
+        return false;
+    }
+
+    uint64_t size = 0;
+    if (aio->type == AIO_Write && !aio->write_buffers.empty()) {
+        for (const auto &b : aio->write_buffers) {
+            size += b.size;
+        }
+    } else {
+        size = aio->buffer_size;
+    }
+    if (size > (uint64_t)_fixed_size) {
+        return false;
+    }
+
+    int index = _free_fixed_indexes.back();
+    _free_fixed_indexes.pop_back();
+    char *buffer = fixed_buffer(index);
+    if (aio->type == AIO_Write) {
+        if (!aio->write_buffers.empty()) {
+            char *p = buffer;
+            for (const auto &b : aio->write_buffers) {
+                memcpy(p, b.buffer, b.size);
+                p += b.size;
+            }
+        } else {
+            memcpy(buffer, aio->buffer, size);
+        }
+    }
+
+    aio->fixed_index = index;
+    sqe->opcode = (aio->type == AIO_Read ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED);
+    sqe->off = aio->file_offset;
+    sqe->addr = (uint64_t)(uintptr_t)buffer;
+    sqe->len = (uint32_t)size;
+    sqe->buf_index = (uint16_t)index;
+    return true;
+}
+
+void io_uring_aio_provider::submit(io_uring_disk_aio_context *aio)
+{
+    {
+        utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_sq_lock);
+        _pending.push_back(aio);
+    }
+    submit_pending();
+}
+
+void io_uring_aio_provider::submit_pending()
+{
+    {
+        utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_sq_lock);
+        if (_is_submitting) {
+            return;
+        }
+        _is_submitting = true;
+    }
+
+    while (true) {
+        unsigned to_submit;
+        {
+            utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_sq_lock);
+            unsigned tail = *_sq_tail;
+            while (!_pending.empty() && _in_flight_count < _cq_entries &&
+                   tail - load_acquire(_sq_head) < _sq_entries) {
+                unsigned index = tail & *_sq_mask;
+                prepare_sqe(&_sqes[index], _pending.front());
+                _sq_array[index] = index;
+                _pending.pop_front();
+                tail++;
+                _in_flight_count++;
+                _to_submit++;
+            }
+            store_release(_sq_tail, tail);
+
+            to_submit = _to_submit;
+            if (to_submit == 0) {
+                // the completion thread goes on when the in-flight ones complete
+                _is_submitting = false;
+                return;
+            }
+        }
+
+        unsigned submitted = enter(to_submit);
+        {
+            utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_sq_lock);
+            _to_submit -= submitted;
+            if (submitted == 0 && _in_flight_count > _to_submit) {
+                // let the completion thread submit them after reaping
+                _is_submitting = false;
+                return;
+            }
+        }
+        if (submitted == 0) {
+            // nothing in flight to reap, so the kernel is only short for a moment
+            std::this_thread::yield();
+        }
+    }
+}
+
+unsigned io_uring_aio_provider::enter(unsigned to_submit)
+{
+    if (_sqpoll) {
+        // the kernel thread picks up the sqes by itself, unless it is sleeping
+        if (load_acquire(_sq_flags) & IORING_SQ_NEED_WAKEUP) {
+            sys_io_uring_enter(_ring_fd, 0, 0, IORING_ENTER_SQ_WAKEUP);
+        }
+        return to_submit;
+    }
+
+    while (true) {
+        int ret = sys_io_uring_enter(_ring_fd, to_submit, 0, 0);
+        if (ret >= 0) {
+            return std::min((unsigned)ret, to_submit);
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EBUSY) {
+            return 0;
+        } else {
+            dassert(false, "io_uring_enter error, ret = %d, err = %s", ret, strerror(errno));
+            return 0;
+        }
+    }
+}
+
+void io_uring_aio_provider::get_event()
+{
+    task::set_tls_dsn_context(node(), nullptr);
+
+    const char *name = ::dsn::tools::get_service_node_name(node());
+    char buffer[128];
+    sprintf(buffer, "%s.aio", name);
+    task_worker::set_name(buffer);
+
+    while (true) {
+        if (dsn_unlikely(!_is_running.load(std::memory_order_relaxed))) {
+            break;
+        }
+
+        unsigned head = *_cq_head;
+        if (head == load_acquire(_cq_tail)) {
+            int ret = sys_io_uring_enter(_ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+            if (ret < 0 && errno != EINTR) {
+                dwarn("io_uring_enter for events failed, err = %s", strerror(errno));
+            }
+            continue;
+        }
+
+        unsigned tail = load_acquire(_cq_tail);
+        unsigned reaped = tail - head;
+        while (head != tail) {
+            struct io_uring_cqe *cqe = &_cqes[head & *_cq_mask];
+            auto aio = (io_uring_disk_aio_context *)(uintptr_t)cqe->user_data;
+            int res = cqe->res;
+            head++;
+            store_release(_cq_head, head);
+
+            if (aio != nullptr) {
+                complete_aio(aio, res);
+            }
+        }
+
+        // only now are the cqes free for the ios held back for the completion queue being full
+        {
+            utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_sq_lock);
+            _in_flight_count -= reaped;
+        }
+        submit_pending();
+    }
+}
+
+void io_uring_aio_provider::complete_aio(io_uring_disk_aio_context *aio, int res)
+{
+    error_code ec;
+    uint32_t bytes = 0;
+    if (res < 0) {
+        derror("aio error, err = %s", strerror(-res));
+        ec = ERR_FILE_OPERATION_FAILED;
+    } else {
+        bytes = static_cast<uint32_t>(res);
+        ec = (bytes > 0 || aio->type == AIO_Flush) ? ERR_OK : ERR_HANDLE_EOF;
+    }
+
+    if (aio->fixed_index >= 0) {
+        if (aio->type == AIO_Read && bytes > 0) {
+            memcpy(aio->buffer, fixed_buffer(aio->fixed_index), bytes);
+        }
+        utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_sq_lock);
+        _free_fixed_indexes.push_back(aio->fixed_index);
+        aio->fixed_index = -1;
+    }
+
+    if (!aio->evt) {
+        aio_task *aio_ptr(aio->tsk);
+        aio->this_->complete_io(aio_ptr, ec, bytes);
+    } else {
+        aio->err = ec;
+        aio->bytes = bytes;
+        aio->evt->notify();
+    }
+}
+
+error_code io_uring_aio_provider::aio_internal(aio_task *aio_tsk,
+                                               bool async,
+                                               /*out*/ uint32_t *pbytes /*= nullptr*/)
+{
+    auto aio = (io_uring_disk_aio_context *)aio_tsk->aio();
+    aio->this_ = this;
+
+    if (!async) {
+        aio->evt = new utils::notify_event();
+        aio->err = ERR_OK;
+        aio->bytes = 0;
+    }
+
+    submit(aio);
+
+    if (async) {
+        return ERR_IO_PENDING;
+    } else {
+        aio->evt->wait();
+        delete aio->evt;
+        aio->evt = nullptr;
+        if (pbytes != nullptr) {
+            *pbytes = aio->bytes;
+        }
+        return aio->err;
+    }
+}
+
+} // namespace tools
+} // namespace dsn
+
+#endif // DSN_HAS_IO_URING
@@ -0,0 +1,165 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     aio provider based on linux io_uring, talking to the kernel with raw
+ *     syscalls so that no extra library is required
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#pragma once
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define DSN_HAS_IO_URING 1
+#endif
+#endif
+
+#ifdef DSN_HAS_IO_URING
+
+#include <dsn/tool_api.h>
+#include <dsn/utility/synchronize.h>
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+#include <atomic>
+#include <climits>
+#include <deque>
+#include <thread>
+#include <vector>
+
+namespace dsn {
+namespace tools {
+
+//
+// configs in [core]:
+//   io_uring_queue_depth          entries of the submission queue
+//   io_uring_sqpoll               let a kernel thread poll the submission queue
+//   io_uring_sqpoll_idle_ms       idle time before the polling kernel thread sleeps
+//   io_uring_flush_with_fdatasync flush with fdatasync instead of fsync
+//   io_uring_fixed_buffer_count   buffers registered to the ring, 0 to register none
+//   io_uring_fixed_buffer_size    size of each registered buffer
+//
+// the reads and writes no larger than a registered buffer are bounced through a free one with
+// READ_FIXED/WRITE_FIXED, so that the kernel need not pin the user pages on every small io;
+// the larger ones, or those finding no free registered buffer, go through READV/WRITEV
+//
+class io_uring_aio_provider : public aio_provider
+{
+public:
+    io_uring_aio_provider(disk_engine *disk, aio_provider *inner_provider);
+    ~io_uring_aio_provider();
+
+    virtual dsn_handle_t open(const char *file_name, int flag, int pmode) override;
+    virtual error_code close(dsn_handle_t fh) override;
+    virtual error_code flush(dsn_handle_t fh) override;
+    virtual void aio(aio_task *aio) override;
+    virtual disk_aio *prepare_aio_context(aio_task *tsk) override;
+    virtual int max_write_buffer_count() const override { return IOV_MAX; }
+
+    virtual void start() override;
+
+    struct io_uring_disk_aio_context : public disk_aio
+    {
+        struct iovec iov;
+        std::vector<struct iovec> iovs; // for vectored writes
+        int fixed_index;                // the registered buffer bounced through, or -1
+        aio_task *tsk;
+        io_uring_aio_provider *this_;
+        utils::notify_event *evt;
+        error_code err;
+        uint32_t bytes;
+    };
+
+protected:
+    error_code aio_internal(aio_task *aio, bool async, /*out*/ uint32_t *pbytes = nullptr);
+    void complete_aio(io_uring_disk_aio_context *aio, int res);
+    void get_event();
+
+    // queue aio (a nop if aio is null), and whoever finds no submitter working becomes one and
+    // submits the queued ones with as few io_uring_enter calls as possible, but never more in
+    // flight than the completion queue holds; the rest are left queued for the completion
+    // thread to submit, so that neither a submitter nor the completion thread completing an io
+    // inline ever waits for the ring to drain
+    void submit(io_uring_disk_aio_context *aio);
+    void submit_pending();
+    // under _sq_lock
+    void prepare_sqe(struct io_uring_sqe *sqe, io_uring_disk_aio_context *aio);
+    bool prepare_fixed_sqe(struct io_uring_sqe *sqe, io_uring_disk_aio_context *aio);
+    // return how many sqes are consumed, 0 if the kernel is short of resources for now
+    unsigned enter(unsigned to_submit);
+
+    void register_fixed_buffers(int count, int size);
+    char *fixed_buffer(int index) const { return _fixed_buffers + (size_t)index * _fixed_size; }
+
+private:
+    int _ring_fd;
+    bool _sqpoll;
+    bool _datasync;
+
+    // submission queue
+    void *_sq_ring;
+    size_t _sq_ring_size;
+    unsigned *_sq_head;
+    unsigned *_sq_tail;
+    unsigned *_sq_mask;
+    unsigned *_sq_flags;
+    unsigned *_sq_array;
+    unsigned _sq_entries;
+    struct io_uring_sqe *_sqes;
+    size_t _sqes_size;
+
+    // completion queue
+    void *_cq_ring;
+    size_t _cq_ring_size;
+    unsigned *_cq_head;
+    unsigned *_cq_tail;
+    unsigned *_cq_mask;
+    struct io_uring_cqe *_cqes;
+    unsigned _cq_entries;
+
+    ::dsn::utils::ex_lock_nr_spin _sq_lock;
+    std::deque<io_uring_disk_aio_context *> _pending;
+    unsigned _in_flight_count; // the sqes filled and not reaped yet
+    unsigned _to_submit;       // the sqes filled and not consumed by the kernel yet
+    bool _is_submitting;
+
+    // registered buffers
+    char *_fixed_buffers;
+    int _fixed_size;
+    std::vector<int> _free_fixed_indexes; // under _sq_lock
+
+    std::atomic<bool> _is_running{false};
+    std::thread _worker;
+};
+
+} // namespace tools
+} // namespace dsn
+
+#endif // DSN_HAS_IO_URING
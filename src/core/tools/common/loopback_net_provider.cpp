@@ -0,0 +1,264 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     network provider passing messages in memory to the services in the same process
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "loopback_net_provider.h"
+#include <dsn/utility/singleton_store.h>
+#include <dsn/tool/node_scoper.h>
+#include <deque>
+
+namespace dsn {
+namespace tools {
+
+// listening address => server network in this process
+static utils::safe_singleton_store<::dsn::rpc_address, loopback_network_provider *> s_servers;
+
+loopback_network_provider::loopback_network_provider(rpc_engine *srv, network *inner_provider)
+    : asio_network_provider(srv, inner_provider)
+{
+}
+
+loopback_network_provider::~loopback_network_provider()
+{
+    for (auto &addr : _registered_addresses) {
+        s_servers.remove(addr);
+    }
+}
+
+error_code loopback_network_provider::start(rpc_channel channel, int port, bool client_only)
+{
+    error_code err = asio_network_provider::start(channel, port, client_only);
+    if (err != ERR_OK || client_only || channel != RPC_CHANNEL_TCP) {
+        return err;
+    }
+
+    // the peers may address this server by either the local ip or the loopback ip
+    ::dsn::rpc_address addrs[] = {address(), ::dsn::rpc_address("localhost", port)};
+    for (auto &addr : addrs) {
+        if (s_servers.put(addr, this)) {
+            _registered_addresses.push_back(addr);
+        } else {
+            dwarn("loopback server %s is already registered, messages to it go through tcp",
+                  addr.to_string());
+        }
+    }
+    return ERR_OK;
+}
+
+rpc_session_ptr loopback_network_provider::create_client_session(::dsn::rpc_address server_addr)
+{
+    // only the dsn messages can be delivered without the parsers
+    if (_client_hdr_format != NET_HDR_DSN || find(server_addr) == nullptr) {
+        return asio_network_provider::create_client_session(server_addr);
+    }
+
+    message_parser_ptr parser(new_message_parser(_client_hdr_format));
+    return rpc_session_ptr(new loopback_rpc_session(*this, server_addr, parser, true));
+}
+
+/*static*/ loopback_network_provider *loopback_network_provider::find(::dsn::rpc_address addr)
+{
+    loopback_network_provider *net = nullptr;
+    return s_servers.get(addr, net) ? net : nullptr;
+}
+
+// the receiving message shares the body of the sending message, with a copied header
+static message_ex *loopback_message(message_ex *msg)
+{
+    std::vector<blob> pieces;
+    for (size_t i = 0; i < msg->buffers.size(); i++) {
+        blob bb = msg->buffers[i];
+        if (i == 0 && bb.data() == (const char *)msg->header) {
+            bb = bb.range((int)sizeof(message_header));
+        }
+        if (bb.length() > 0) {
+            pieces.push_back(std::move(bb));
+        }
+    }
+
+    blob body;
+    if (pieces.size() == 1) {
+        body = pieces[0];
+    } else if (pieces.size() > 1) {
+        std::shared_ptr<char> buffer(
+            dsn::utils::make_shared_array<char>(msg->header->body_length));
+        int length = 0;
+        for (auto &bb : pieces) {
+            memcpy(buffer.get() + length, bb.data(), bb.length());
+            length += bb.length();
+        }
+        body = blob(std::move(buffer), length);
+    }
+    dassert(body.length() == msg->header->body_length,
+            "%d VS %u, rpc_name = %s",
+            body.length(),
+            msg->header->body_length,
+            msg->header->rpc_name);
+
+    message_ex *recv_msg = message_ex::create_receive_message_with_standalone_header(body);
+    memcpy(recv_msg->header, msg->header, sizeof(message_header));
+    recv_msg->hdr_format = msg->hdr_format;
+    recv_msg->to_address = msg->to_address;
+
+    msg->copy_to(*recv_msg); // extensible object state move
+    return recv_msg;
+}
+
+loopback_rpc_session::loopback_rpc_session(connection_oriented_network &net,
+                                           ::dsn::rpc_address remote_addr,
+                                           message_parser_ptr &parser,
+                                           bool is_client)
+    : rpc_session(net, remote_addr, parser, is_client)
+{
+}
+
+void loopback_rpc_session::connect()
+{
+    if (!set_connecting()) {
+        return;
+    }
+
+    loopback_network_provider *server_net = loopback_network_provider::find(_remote_addr);
+    if (server_net == nullptr) {
+        derror("client session connect to %s failed, the loopback server is gone",
+               _remote_addr.to_string());
+        on_disconnected(true);
+        return;
+    }
+
+    rpc_session_ptr self = this;
+    message_parser_ptr parser(server_net->new_message_parser(NET_HDR_DSN));
+    rpc_session_ptr server(new loopback_rpc_session(*server_net, _net.address(), parser, false));
+    static_cast<loopback_rpc_session *>(server.get())->set_peer(self);
+    set_peer(server);
+    server_net->on_server_session_accepted(server);
+
+    dinfo("client session %s connected in memory", _remote_addr.to_string());
+    set_connected();
+    on_send_completed();
+}
+
+void loopback_rpc_session::set_peer(rpc_session_ptr &peer)
+{
+    utils::auto_lock<utils::ex_lock_nr> l(_lock);
+    _peer = peer;
+}
+
+// the batches to be delivered by the outermost send() in this thread, or nullptr
+static __thread std::deque<std::pair<rpc_session_ptr, uint64_t>> *s_pending_sends = nullptr;
+
+void loopback_rpc_session::send(uint64_t signature)
+{
+    // on_send_completed() calls send() again for the next batch, and so may delivering the
+    // messages through the other loopback sessions, so that the nested calls are left to
+    // the outermost one to deliver in a loop rather than recursively
+    if (s_pending_sends != nullptr) {
+        s_pending_sends->emplace_back(this, signature);
+        return;
+    }
+
+    std::deque<std::pair<rpc_session_ptr, uint64_t>> pending_sends;
+    pending_sends.emplace_back(this, signature);
+    s_pending_sends = &pending_sends;
+    while (!pending_sends.empty()) {
+        auto next = std::move(pending_sends.front());
+        pending_sends.pop_front();
+        static_cast<loopback_rpc_session *>(next.first.get())->deliver(next.second);
+    }
+    s_pending_sends = nullptr;
+}
+
+void loopback_rpc_session::deliver(uint64_t signature)
+{
+    rpc_session_ptr peer;
+    {
+        utils::auto_lock<utils::ex_lock_nr> l(_lock);
+        peer = _peer;
+    }
+
+    if (peer == nullptr) {
+        // closed meanwhile, the sending messages are cleared as tcp sessions do on failure
+        on_disconnected(true);
+        on_send_completed(signature);
+        return;
+    }
+
+    size_t delivered = 0;
+    {
+        node_scoper ns(peer->net().node());
+        for (; delivered < _sending_msgs.size(); delivered++) {
+            message_ex *recv_msg = loopback_message(_sending_msgs[delivered]);
+            if (!peer->on_recv_message(recv_msg, 0)) {
+                break;
+            }
+        }
+    }
+
+    if (delivered < _sending_msgs.size()) {
+        derror("deliver message to %s failed, close the session", _remote_addr.to_string());
+        {
+            utils::auto_lock<utils::ex_lock_nr> l(_lock);
+            for (size_t i = 0; i < delivered; i++) {
+                // added in rpc_engine::reply (for server) or rpc_session::send_message (for client)
+                _sending_msgs[i]->release_ref();
+            }
+            _sending_msgs.erase(_sending_msgs.begin(), _sending_msgs.begin() + delivered);
+        }
+
+        // the messages not delivered are failed as tcp sessions do on failure
+        close();
+        on_disconnected(true);
+    }
+
+    on_send_completed(signature);
+}
+
+void loopback_rpc_session::close()
+{
+    rpc_session_ptr peer;
+    {
+        utils::auto_lock<utils::ex_lock_nr> l(_lock);
+        peer = _peer;
+        _peer = nullptr;
+    }
+
+    // the sending messages are left to the in-flight send() which sees no peer
+    on_disconnected(false);
+    if (peer != nullptr) {
+        peer->close();
+    }
+}
+
+} // namespace tools
+} // namespace dsn
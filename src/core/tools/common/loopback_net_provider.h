@@ -0,0 +1,98 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     network provider passing messages in memory to the services in the same process
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#pragma once
+
+#include "asio_net_provider.h"
+
+namespace dsn {
+namespace tools {
+
+//
+// a tcp network which delivers the messages to the services in the same process directly,
+// without serializing them into the sockets. the server networks of this type are recognized
+// by their listening addresses, and the sessions to the other servers go through tcp as
+// asio_network_provider does.
+//
+// the message bodies are shared with the receivers rather than copied, only the headers are
+// copied as the receivers may modify them.
+//
+class loopback_network_provider : public asio_network_provider
+{
+public:
+    loopback_network_provider(rpc_engine *srv, network *inner_provider);
+
+    ~loopback_network_provider() override;
+
+    virtual error_code start(rpc_channel channel, int port, bool client_only) override;
+    virtual rpc_session_ptr create_client_session(::dsn::rpc_address server_addr) override;
+
+    // the server network listening on addr in this process, or nullptr
+    static loopback_network_provider *find(::dsn::rpc_address addr);
+
+private:
+    std::vector<::dsn::rpc_address> _registered_addresses;
+};
+
+class loopback_rpc_session : public rpc_session
+{
+public:
+    loopback_rpc_session(connection_oriented_network &net,
+                         ::dsn::rpc_address remote_addr,
+                         message_parser_ptr &parser,
+                         bool is_client);
+
+    // for the client session, connect to the server network in this process
+    virtual void connect() override;
+
+    virtual void send(uint64_t signature) override;
+
+    virtual void do_read(int read_next) override {}
+
+    // both this and the peer session are disconnected
+    virtual void close() override;
+
+private:
+    void set_peer(rpc_session_ptr &peer);
+
+    // deliver the sending messages to the peer, and then complete the send
+    void deliver(uint64_t signature);
+
+    // the session on the other side, protected by _lock
+    rpc_session_ptr _peer;
+};
+
+} // namespace tools
+} // namespace dsn
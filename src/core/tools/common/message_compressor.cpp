@@ -0,0 +1,210 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     codecs compressing the rpc message bodies, see rpc_message_compress_type
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "message_compressor.h"
+#include <dsn/utility/config_api.h>
+#include <dsn/utility/utils.h>
+#include <dsn/c/api_utilities.h>
+
+#ifdef DSN_HAS_LZ4
+#include <lz4.h>
+#endif
+#ifdef DSN_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace dsn {
+
+static const size_t raw_length_size = sizeof(uint32_t);
+
+/*static*/ message_compressor &message_compressor::instance()
+{
+    static message_compressor *compressor = new message_compressor();
+    return *compressor;
+}
+
+/*static*/ uint32_t message_compressor::supported_mask()
+{
+    uint32_t mask = 0;
+#ifdef DSN_HAS_LZ4
+    mask |= type_mask(RPC_COMPRESS_LZ4);
+#endif
+#ifdef DSN_HAS_ZSTD
+    mask |= type_mask(RPC_COMPRESS_ZSTD);
+#endif
+    return mask;
+}
+
+message_compressor::message_compressor()
+{
+    _zstd_level = (int)dsn_config_get_value_int64(
+        "network", "rpc_compress_zstd_level", 1, "compression level of RPC_COMPRESS_ZSTD");
+    _max_body_size = (uint32_t)dsn_config_get_value_uint64(
+        "network",
+        "rpc_compress_max_body_size",
+        64 * 1024 * 1024,
+        "larger bodies are sent uncompressed, and the compressed bodies claiming to be larger "
+        "are rejected, which bounds the memory a peer may make us allocate for one message");
+    dassert(_max_body_size > 0, "rpc_compress_max_body_size must be > 0");
+
+    _compress_ratio.init_global_counter("replica",
+                                        "network",
+                                        "rpc.compress.ratio",
+                                        COUNTER_TYPE_NUMBER_PERCENTILES,
+                                        "raw size / compressed size of the rpc bodies, x100");
+    _compress_saved_bytes.init_global_counter("replica",
+                                              "network",
+                                              "rpc.compress.saved.bytes",
+                                              COUNTER_TYPE_RATE,
+                                              "bytes saved by rpc body compression per second");
+    _compress_time_ns.init_global_counter("replica",
+                                          "network",
+                                          "rpc.compress.time.ns",
+                                          COUNTER_TYPE_NUMBER_PERCENTILES,
+                                          "cpu time of compressing one rpc body");
+    _decompress_time_ns.init_global_counter("replica",
+                                            "network",
+                                            "rpc.decompress.time.ns",
+                                            COUNTER_TYPE_NUMBER_PERCENTILES,
+                                            "cpu time of decompressing one rpc body");
+}
+
+bool message_compressor::compress(rpc_compress_type_t type,
+                                  const char *data,
+                                  size_t size,
+                                  /*out*/ blob &out)
+{
+    if ((supported_mask() & type_mask(type)) == 0 || size > _max_body_size) {
+        return false;
+    }
+
+    uint64_t start_ns = utils::get_current_physical_time_ns();
+    size_t bound = 0;
+    switch (type) {
+#ifdef DSN_HAS_LZ4
+    case RPC_COMPRESS_LZ4:
+        bound = LZ4_compressBound(static_cast<int>(size));
+        break;
+#endif
+#ifdef DSN_HAS_ZSTD
+    case RPC_COMPRESS_ZSTD:
+        bound = ZSTD_compressBound(size);
+        break;
+#endif
+    default:
+        return false;
+    }
+
+    std::shared_ptr<char> buffer = utils::make_shared_array<char>(raw_length_size + bound);
+    char *dst = buffer.get() + raw_length_size;
+    size_t length = 0;
+    switch (type) {
+#ifdef DSN_HAS_LZ4
+    case RPC_COMPRESS_LZ4: {
+        int r = LZ4_compress_default(data, dst, static_cast<int>(size), static_cast<int>(bound));
+        length = r > 0 ? static_cast<size_t>(r) : 0;
+        break;
+    }
+#endif
+#ifdef DSN_HAS_ZSTD
+    case RPC_COMPRESS_ZSTD: {
+        size_t r = ZSTD_compress(dst, bound, data, size, _zstd_level);
+        length = ZSTD_isError(r) ? 0 : r;
+        break;
+    }
+#endif
+    default:
+        break;
+    }
+
+    // not worth it if it saves nothing
+    if (length == 0 || raw_length_size + length >= size) {
+        return false;
+    }
+
+    uint32_t raw_length = static_cast<uint32_t>(size);
+    memcpy(buffer.get(), &raw_length, raw_length_size);
+    out = blob(std::move(buffer), static_cast<int>(raw_length_size + length));
+
+    _compress_time_ns->set(utils::get_current_physical_time_ns() - start_ns);
+    _compress_ratio->set(size * 100 / out.length());
+    _compress_saved_bytes->add(size - out.length());
+    return true;
+}
+
+bool message_compressor::decompress(rpc_compress_type_t type, const blob &in, /*out*/ blob &out)
+{
+    if ((supported_mask() & type_mask(type)) == 0 || in.length() < raw_length_size) {
+        return false;
+    }
+
+    uint32_t raw_length;
+    memcpy(&raw_length, in.data(), raw_length_size);
+    if (raw_length > _max_body_size) {
+        return false;
+    }
+
+    uint64_t start_ns = utils::get_current_physical_time_ns();
+    std::shared_ptr<char> buffer = utils::make_shared_array<char>(raw_length);
+    const char *src = in.data() + raw_length_size;
+    size_t src_length = in.length() - raw_length_size;
+    bool ok = false;
+    switch (type) {
+#ifdef DSN_HAS_LZ4
+    case RPC_COMPRESS_LZ4:
+        ok = LZ4_decompress_safe(src,
+                                 buffer.get(),
+                                 static_cast<int>(src_length),
+                                 static_cast<int>(raw_length)) == static_cast<int>(raw_length);
+        break;
+#endif
+#ifdef DSN_HAS_ZSTD
+    case RPC_COMPRESS_ZSTD:
+        ok = ZSTD_decompress(buffer.get(), raw_length, src, src_length) == raw_length;
+        break;
+#endif
+    default:
+        break;
+    }
+
+    if (!ok) {
+        return false;
+    }
+
+    out = blob(std::move(buffer), static_cast<int>(raw_length));
+    _decompress_time_ns->set(utils::get_current_physical_time_ns() - start_ns);
+    return true;
+}
+}
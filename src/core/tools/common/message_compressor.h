@@ -0,0 +1,77 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     codecs compressing the rpc message bodies, see rpc_message_compress_type
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#pragma once
+
+#include <dsn/tool-api/task_spec.h>
+#include <dsn/perf_counter/perf_counter_wrapper.h>
+#include <dsn/utility/blob.h>
+
+namespace dsn {
+
+//
+// a compressed body is the length of the raw body (4 bytes, little endian) followed by the
+// output of the codec. the codecs are built in only if the libraries are found when building,
+// see DSN_HAS_LZ4 and DSN_HAS_ZSTD.
+//
+class message_compressor
+{
+public:
+    static message_compressor &instance();
+
+    // the bit of a compress type in the masks of msg_context_t
+    static uint32_t type_mask(int type) { return 1u << (type - 1); }
+
+    // mask of the codecs built in
+    static uint32_t supported_mask();
+
+    // return false if the codec is not built in, or the body is not worth compressing
+    bool compress(rpc_compress_type_t type, const char *data, size_t size, /*out*/ blob &out);
+
+    // return false if the codec is not built in, or the input is corrupted
+    bool decompress(rpc_compress_type_t type, const blob &in, /*out*/ blob &out);
+
+private:
+    message_compressor();
+
+    int _zstd_level;
+    uint32_t _max_body_size;
+
+    perf_counter_wrapper _compress_ratio;
+    perf_counter_wrapper _compress_saved_bytes;
+    perf_counter_wrapper _compress_time_ns;
+    perf_counter_wrapper _decompress_time_ns;
+};
+}
@@ -44,11 +44,32 @@ namespace tools {
 
 native_linux_aio_provider::native_linux_aio_provider(disk_engine *disk,
                                                      aio_provider *inner_provider)
-    : aio_provider(disk, inner_provider)
+    : aio_provider(disk, inner_provider), _in_flight_count(0), _is_submitting(false)
 {
+    _queue_depth = (int)dsn_config_get_value_uint64(
+        "core", "native_aio_queue_depth", 128, "max concurrent events of the native aio context");
+    _max_submit_batch = (int)dsn_config_get_value_uint64(
+        "core", "native_aio_max_submit_batch", 64, "max iocbs submitted by one io_submit call");
+    _max_events_per_reap = (int)dsn_config_get_value_uint64(
+        "core", "native_aio_max_events_per_reap", 64, "max events reaped by one io_getevents call");
+    _completion_thread_count =
+        (int)dsn_config_get_value_uint64("core",
+                                         "native_aio_completion_thread_count",
+                                         1,
+                                         "thread number for reaping native aio events");
+    _datasync = dsn_config_get_value_bool(
+        "core", "native_aio_flush_with_fdatasync", false, "flush with fdatasync instead of fsync");
+    dassert(_queue_depth > 0 && _max_submit_batch > 0 && _max_events_per_reap > 0 &&
+                _completion_thread_count > 0,
+            "invalid native aio config: queue_depth = %d, max_submit_batch = %d, "
+            "max_events_per_reap = %d, completion_thread_count = %d",
+            _queue_depth,
+            _max_submit_batch,
+            _max_events_per_reap,
+            _completion_thread_count);
 
     memset(&_ctx, 0, sizeof(_ctx));
-    auto ret = io_setup(128, &_ctx); // 128 concurrent events
+    auto ret = io_setup(_queue_depth, &_ctx);
     dassert(ret == 0, "io_setup error, ret = %d", ret);
 }
 
@@ -62,16 +83,20 @@ native_linux_aio_provider::~native_linux_aio_provider()
     auto ret = io_destroy(_ctx);
     dassert(ret == 0, "io_destroy error, ret = %d", ret);
 
-    _worker.join();
+    for (auto &worker : _workers) {
+        worker.join();
+    }
 }
 
 void native_linux_aio_provider::start()
 {
     _is_running = true;
-    _worker = std::thread([this]() {
-        task::set_tls_dsn_context(node(), nullptr);
-        get_event();
-    });
+    for (int i = 0; i < _completion_thread_count; i++) {
+        _workers.emplace_back([this]() {
+            task::set_tls_dsn_context(node(), nullptr);
+            get_event();
+        });
+    }
 }
 
 dsn_handle_t native_linux_aio_provider::open(const char *file_name, int flag, int pmode)
@@ -95,7 +120,8 @@ error_code native_linux_aio_provider::close(dsn_handle_t fh)
 
 error_code native_linux_aio_provider::flush(dsn_handle_t fh)
 {
-    if (fh == DSN_INVALID_FILE_HANDLE || ::fsync((int)(uintptr_t)(fh)) == 0) {
+    int fd = (int)(uintptr_t)(fh);
+    if (fh == DSN_INVALID_FILE_HANDLE || (_datasync ? ::fdatasync(fd) : ::fsync(fd)) == 0) {
         return ERR_OK;
     } else {
         derror("flush file failed, err = %s", strerror(errno));
@@ -116,7 +142,7 @@ void native_linux_aio_provider::aio(aio_task *aio_tsk) { aio_internal(aio_tsk, t
 
 void native_linux_aio_provider::get_event()
 {
-    struct io_event events[1];
+    std::vector<struct io_event> events(_max_events_per_reap);
     int ret;
 
     task::set_tls_dsn_context(node(), nullptr);
@@ -130,12 +156,20 @@ void native_linux_aio_provider::get_event()
         if (dsn_unlikely(!_is_running.load(std::memory_order_relaxed))) {
             break;
         }
-        ret = io_getevents(_ctx, 1, 1, events, NULL);
-        if (ret > 0) // should be 1
-        {
-            dassert(ret == 1, "io_getevents returns %d", ret);
-            struct iocb *io = events[0].obj;
-            complete_aio(io, static_cast<int>(events[0].res), static_cast<int>(events[0].res2));
+        ret = io_getevents(_ctx, 1, _max_events_per_reap, events.data(), NULL);
+        if (ret > 0) {
+            {
+                utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_pending_lock);
+                _in_flight_count -= ret;
+            }
+            for (int i = 0; i < ret; i++) {
+                complete_aio(events[i].obj,
+                             static_cast<int>(events[i].res),
+                             static_cast<int>(events[i].res2));
+            }
+
+            // the iocbs held back for the context being full
+            submit_pending();
         } else {
             dwarn("io_getevents returns %d, you probably want to try on another machine:-(", ret);
         }
@@ -146,7 +180,19 @@ void native_linux_aio_provider::complete_aio(struct iocb *io, int bytes, int err
 {
     linux_disk_aio_context *aio = CONTAINING_RECORD(io, linux_disk_aio_context, cb);
     error_code ec;
-    if (err != 0) {
+    if (aio->type == AIO_Flush) {
+        // file systems without IOCB_CMD_FSYNC/FDSYNC support fail the iocb with EINVAL,
+        // flush them here on the reaper thread instead
+        if (err == 0 && bytes == -EINVAL) {
+            ec = flush(aio->file);
+        } else if (err != 0 || bytes < 0) {
+            derror("aio flush error, err = %s", strerror(err != 0 ? err : -bytes));
+            ec = ERR_FILE_OPERATION_FAILED;
+        } else {
+            ec = ERR_OK;
+        }
+        bytes = 0;
+    } else if (err != 0) {
         derror("aio error, err = %s", strerror(err));
         ec = ERR_FILE_OPERATION_FAILED;
     } else {
@@ -167,9 +213,7 @@ error_code native_linux_aio_provider::aio_internal(aio_task *aio_tsk,
                                                    bool async,
                                                    /*out*/ uint32_t *pbytes /*= nullptr*/)
 {
-    struct iocb *cbs[1];
     linux_disk_aio_context *aio;
-    int ret;
 
     aio = (linux_disk_aio_context *)aio_tsk->aio();
 
@@ -186,11 +230,31 @@ error_code native_linux_aio_provider::aio_internal(aio_task *aio_tsk,
                       aio->file_offset);
         break;
     case AIO_Write:
-        io_prep_pwrite(&aio->cb,
-                       static_cast<int>((ssize_t)aio->file),
-                       aio->buffer,
-                       aio->buffer_size,
-                       aio->file_offset);
+        if (!aio->write_buffers.empty()) {
+            aio->iovs.resize(aio->write_buffers.size());
+            for (size_t i = 0; i < aio->write_buffers.size(); i++) {
+                aio->iovs[i].iov_base = aio->write_buffers[i].buffer;
+                aio->iovs[i].iov_len = aio->write_buffers[i].size;
+            }
+            io_prep_pwritev(&aio->cb,
+                            static_cast<int>((ssize_t)aio->file),
+                            aio->iovs.data(),
+                            static_cast<int>(aio->iovs.size()),
+                            aio->file_offset);
+        } else {
+            io_prep_pwrite(&aio->cb,
+                           static_cast<int>((ssize_t)aio->file),
+                           aio->buffer,
+                           aio->buffer_size,
+                           aio->file_offset);
+        }
+        break;
+    case AIO_Flush:
+        if (_datasync) {
+            io_prep_fdsync(&aio->cb, static_cast<int>((ssize_t)aio->file));
+        } else {
+            io_prep_fsync(&aio->cb, static_cast<int>((ssize_t)aio->file));
+        }
         break;
     default:
         derror("unknown aio type %u", static_cast<int>(aio->type));
@@ -202,35 +266,103 @@ error_code native_linux_aio_provider::aio_internal(aio_task *aio_tsk,
         aio->bytes = 0;
     }
 
-    cbs[0] = &aio->cb;
-    ret = io_submit(_ctx, 1, cbs);
+    submit(&aio->cb);
 
-    if (ret != 1) {
-        if (ret < 0)
-            derror("io_submit error, ret = %d", ret);
-        else
-            derror("could not sumbit IOs, ret = %d", ret);
+    if (async) {
+        return ERR_IO_PENDING;
+    } else {
+        aio->evt->wait();
+        delete aio->evt;
+        aio->evt = nullptr;
+        if (pbytes != nullptr) {
+            *pbytes = aio->bytes;
+        }
+        return aio->err;
+    }
+}
 
-        if (async) {
-            complete_io(aio_tsk, ERR_FILE_OPERATION_FAILED, 0);
-        } else {
-            delete aio->evt;
-            aio->evt = nullptr;
+void native_linux_aio_provider::submit(struct iocb *io)
+{
+    {
+        utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_pending_lock);
+        _pending_iocbs.push_back(io);
+    }
+    submit_pending();
+}
+
+void native_linux_aio_provider::submit_pending()
+{
+    {
+        utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_pending_lock);
+        if (_is_submitting) {
+            return;
         }
-        return ERR_FILE_OPERATION_FAILED;
-    } else {
-        if (async) {
-            return ERR_IO_PENDING;
+        _is_submitting = true;
+    }
+
+    std::vector<struct iocb *> batch;
+    while (true) {
+        {
+            utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_pending_lock);
+            size_t room = static_cast<size_t>(std::max(_queue_depth - _in_flight_count, 0));
+            size_t count = std::min(room, _pending_iocbs.size());
+            if (count == 0) {
+                // the reapers go on when the in-flight ones complete
+                _is_submitting = false;
+                return;
+            }
+            batch.assign(_pending_iocbs.begin(), _pending_iocbs.begin() + count);
+            _pending_iocbs.erase(_pending_iocbs.begin(), _pending_iocbs.begin() + count);
+            _in_flight_count += static_cast<int>(count);
+        }
+
+        size_t done = submit_batch(batch);
+        if (done < batch.size()) {
+            {
+                utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_pending_lock);
+                _pending_iocbs.insert(_pending_iocbs.begin(), batch.begin() + done, batch.end());
+                _in_flight_count -= static_cast<int>(batch.size() - done);
+                if (_in_flight_count > 0) {
+                    _is_submitting = false;
+                    return;
+                }
+            }
+            // nothing in flight to reap, so the context is only short for a moment
+            std::this_thread::yield();
+        }
+        batch.clear();
+    }
+}
+
+size_t native_linux_aio_provider::submit_batch(std::vector<struct iocb *> &batch)
+{
+    size_t pos = 0;
+    while (pos < batch.size()) {
+        long count = static_cast<long>(std::min(batch.size() - pos, (size_t)_max_submit_batch));
+        int ret = io_submit(_ctx, count, &batch[pos]);
+        if (ret > 0) {
+            pos += ret;
+        } else if (ret == -EINTR) {
+            continue;
+        } else if (ret == -EAGAIN) {
+            // the context is full, leave the rest to be submitted after reaping
+            break;
         } else {
-            aio->evt->wait();
-            delete aio->evt;
-            aio->evt = nullptr;
-            if (pbytes != nullptr) {
-                *pbytes = aio->bytes;
+            if (ret < 0)
+                derror("io_submit error, ret = %d", ret);
+            else
+                derror("could not sumbit IOs, ret = %d", ret);
+
+            // fail the first one which blocks the submission, and go on with the others
+            {
+                utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_pending_lock);
+                _in_flight_count--;
             }
-            return aio->err;
+            complete_aio(batch[pos], 0, ret < 0 ? -ret : EIO);
+            pos++;
         }
     }
+    return pos;
 }
 
 } // namespace tools
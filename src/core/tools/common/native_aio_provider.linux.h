@@ -28,10 +28,14 @@
 
 #include <dsn/tool_api.h>
 #include <dsn/utility/synchronize.h>
+#include <deque>
 #include <queue>
+#include <vector>
 #include <stdio.h>       /* for perror() */
 #include <sys/syscall.h> /* for __NR_* definitions */
 #include <libaio.h>
+#include <sys/uio.h>
+#include <climits>
 #include <fcntl.h>    /* O_RDWR */
 #include <string.h>   /* memset() */
 #include <inttypes.h> /* uint64_t */
@@ -50,12 +54,14 @@ public:
     virtual error_code flush(dsn_handle_t fh) override;
     virtual void aio(aio_task *aio) override;
     virtual disk_aio *prepare_aio_context(aio_task *tsk) override;
+    virtual int max_write_buffer_count() const override { return IOV_MAX; }
 
     virtual void start() override;
 
     struct linux_disk_aio_context : public disk_aio
     {
         struct iocb cb;
+        std::vector<struct iovec> iovs;
         aio_task *tsk;
         native_linux_aio_provider *this_;
         utils::notify_event *evt;
@@ -68,10 +74,30 @@ protected:
     void complete_aio(struct iocb *io, int bytes, int err);
     void get_event();
 
+    // the iocbs are queued, and whoever finds no submitter working becomes one and
+    // submits the queued iocbs with as few io_submit calls as possible, but never more than
+    // the context holds; the rest are left queued for the reapers to submit, so that neither
+    // a submitter nor a reaper completing an io inline ever waits for the context to drain
+    void submit(struct iocb *io);
+    void submit_pending();
+    // returns how many of the batch are submitted or failed
+    size_t submit_batch(std::vector<struct iocb *> &batch);
+
 private:
     io_context_t _ctx;
     std::atomic<bool> _is_running{false};
-    std::thread _worker;
+    std::vector<std::thread> _workers;
+
+    int _queue_depth;
+    int _max_submit_batch;
+    int _max_events_per_reap;
+    int _completion_thread_count;
+    bool _datasync;
+
+    ::dsn::utils::ex_lock_nr_spin _pending_lock;
+    std::deque<struct iocb *> _pending_iocbs;
+    int _in_flight_count;
+    bool _is_submitting;
 };
 
 } // namespace tools
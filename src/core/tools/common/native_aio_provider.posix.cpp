@@ -117,7 +117,7 @@ void aio_completed(sigval sigval)
             derror("aio error, err = %s", strerror(err));
             ec = ERR_FILE_OPERATION_FAILED;
         } else {
-            ec = bytes > 0 ? ERR_OK : ERR_HANDLE_EOF;
+            ec = (bytes > 0 || ctx->type == AIO_Flush) ? ERR_OK : ERR_HANDLE_EOF;
         }
 
         if (!ctx->evt) {
@@ -166,6 +166,9 @@ error_code native_posix_aio_provider::aio_internal(aio_task *aio_tsk,
     case AIO_Write:
         r = aio_write(&aio->cb);
         break;
+    case AIO_Flush:
+        r = aio_fsync(O_SYNC, &aio->cb);
+        break;
     default:
         dassert(false, "unknown aio type %u", static_cast<int>(aio->type));
         break;
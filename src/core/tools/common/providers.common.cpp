@@ -34,11 +34,14 @@
  */
 
 #include "asio_net_provider.h"
+#include "loopback_net_provider.h"
 #include <dsn/tool/providers.common.h>
 #include "lockp.std.h"
 #include "native_aio_provider.posix.h"
 #include "native_aio_provider.linux.h"
+#include "io_uring_aio_provider.h"
 #include "simple_task_queue.h"
+#include "timing_wheel_timer_service.h"
 #include "network.sim.h"
 #include "simple_logger.h"
 #include "empty_aio_provider.h"
@@ -59,9 +62,13 @@ void register_common_providers()
 
     register_component_provider<asio_network_provider>("dsn::tools::asio_network_provider");
     register_component_provider<asio_udp_provider>("dsn::tools::asio_udp_provider");
+    register_component_provider<loopback_network_provider>(
+        "dsn::tools::loopback_network_provider");
     register_component_provider<sim_network_provider>("dsn::tools::sim_network_provider");
     register_component_provider<simple_task_queue>("dsn::tools::simple_task_queue");
     register_component_provider<simple_timer_service>("dsn::tools::simple_timer_service");
+    register_component_provider<timing_wheel_timer_service>(
+        "dsn::tools::timing_wheel_timer_service");
 
     register_message_header_parser<dsn_message_parser>(NET_HDR_DSN, {"RDSN"});
     register_message_header_parser<thrift_message_parser>(NET_HDR_THRIFT, {"THFT"});
@@ -70,6 +77,9 @@ void register_common_providers()
     register_component_provider<native_linux_aio_provider>("dsn::tools::native_aio_provider");
     register_component_provider<native_posix_aio_provider>("dsn::tools::posix_aio_provider");
     register_component_provider<empty_aio_provider>("dsn::tools::empty_aio_provider");
+#ifdef DSN_HAS_IO_URING
+    register_component_provider<io_uring_aio_provider>("dsn::tools::io_uring_aio_provider");
+#endif
 }
 }
 }
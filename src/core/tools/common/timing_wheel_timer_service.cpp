@@ -0,0 +1,279 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     hierarchical timing wheel based timer service
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "timing_wheel_timer_service.h"
+
+namespace dsn {
+namespace tools {
+
+static const uint64_t level0_mask = (1ULL << 8) - 1;
+static const uint64_t level_mask = (1ULL << 6) - 1;
+
+timing_wheel_timer_service::timing_wheel_timer_service(service_node *node,
+                                                       timer_service *inner_provider)
+    : timer_service(node, inner_provider),
+      _current_tick(0),
+      _next_wakeup_tick(UINT64_MAX),
+      _timer_count(0),
+      _is_running(false)
+{
+    _tick_ms = (int)dsn_config_get_value_uint64(
+        "core", "timing_wheel_tick_ms", 1, "tick length in milliseconds of the timing wheel");
+    dassert(_tick_ms > 0, "invalid timing_wheel_tick_ms %d", _tick_ms);
+
+    static_assert(level0_bits == 8 && level_bits == 6, "please update the masks");
+    _slots[0].resize(1 << level0_bits);
+    for (int i = 1; i < level_count; i++) {
+        _slots[i].resize(1 << level_bits);
+    }
+    _start_time = std::chrono::steady_clock::now();
+}
+
+timing_wheel_timer_service::~timing_wheel_timer_service()
+{
+    {
+        std::lock_guard<std::mutex> l(_lock);
+        _is_running = false;
+    }
+    _cond.notify_one();
+    if (_worker.joinable()) {
+        _worker.join();
+    }
+}
+
+void timing_wheel_timer_service::start()
+{
+    _is_running = true;
+    _worker = std::thread([this]() {
+        task::set_tls_dsn_context(node(), nullptr);
+
+        char buffer[128];
+        sprintf(buffer, "%s.timer", get_service_node_name(node()));
+
+        task_worker::set_name(buffer);
+        task_worker::set_priority(worker_priority_t::THREAD_xPRIORITY_ABOVE_NORMAL);
+
+        run();
+    });
+}
+
+void timing_wheel_timer_service::add_timer(task *task)
+{
+    uint64_t delay_ms = (uint64_t)std::max(task->delay_milliseconds(), 0);
+    task->set_delay(0);
+
+    std::unique_lock<std::mutex> l(_lock);
+    uint64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                              std::chrono::steady_clock::now() - _start_time)
+                              .count();
+    uint64_t tick_us = (uint64_t)_tick_ms * 1000;
+    uint64_t now = elapsed_us / tick_us;
+    if (_timer_count == 0 && _current_tick < now) {
+        // nothing is on the wheel, skip the idle ticks directly
+        _current_tick = now;
+    }
+
+    // round up so that the task never fires earlier than expected
+    uint64_t expire = (elapsed_us + delay_ms * 1000 + tick_us - 1) / tick_us;
+    task->timer_expire_tick = std::max(expire, _current_tick);
+    task->timer_svc.store(this, std::memory_order_release);
+    place(task);
+    ++_timer_count;
+
+    bool wakeup = task->timer_expire_tick < _next_wakeup_tick;
+    if (wakeup) {
+        _next_wakeup_tick = task->timer_expire_tick;
+    }
+    l.unlock();
+
+    if (wakeup) {
+        _cond.notify_one();
+    }
+}
+
+void timing_wheel_timer_service::remove_timer(task *task)
+{
+    {
+        std::lock_guard<std::mutex> l(_lock);
+        if (task->timer_dl.is_alone()) {
+            // already taken by the timer thread, which will enqueue it as usual
+            return;
+        }
+        task->timer_dl.remove();
+        --_timer_count;
+    }
+
+    // to consume the added ref count by task::enqueue for add_timer
+    task->release_ref();
+}
+
+uint64_t timing_wheel_timer_service::timer_count()
+{
+    std::lock_guard<std::mutex> l(_lock);
+    return _timer_count;
+}
+
+uint64_t timing_wheel_timer_service::now_tick() const
+{
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - _start_time);
+    return (uint64_t)elapsed.count() / _tick_ms;
+}
+
+void timing_wheel_timer_service::place(task *task)
+{
+    uint64_t expire = task->timer_expire_tick;
+    uint64_t span = expire - _current_tick;
+    dlink *slot;
+    if (span <= level0_mask) {
+        slot = &_slots[0][expire & level0_mask];
+    } else {
+        if (span >= max_span) {
+            // too far away, park it at the farthest slot until it is cascaded
+            expire = _current_tick + max_span - 1;
+            span = max_span - 1;
+        }
+
+        int level = 1;
+        while (span >= (1ULL << (level0_bits + level * level_bits))) {
+            level++;
+        }
+        int shift = level0_bits + (level - 1) * level_bits;
+        slot = &_slots[level][(expire >> shift) & level_mask];
+    }
+    task->timer_dl.insert_before(slot);
+}
+
+void timing_wheel_timer_service::cascade(int level, int index)
+{
+    dlink &slot = _slots[level][index];
+    dlink tasks;
+    while (!slot.is_alone()) {
+        dlink *dl = slot.next();
+        dl->remove();
+        dl->insert_before(&tasks);
+    }
+
+    while (!tasks.is_alone()) {
+        dlink *dl = tasks.next();
+        dl->remove();
+        place(CONTAINING_RECORD(dl, task, timer_dl));
+    }
+}
+
+void timing_wheel_timer_service::advance()
+{
+    int index = (int)(_current_tick & level0_mask);
+    if (index == 0) {
+        // level 0 wraps, pull down the timers of the upper levels one by one
+        for (int level = 1; level < level_count; level++) {
+            int shift = level0_bits + (level - 1) * level_bits;
+            int i = (int)((_current_tick >> shift) & level_mask);
+            cascade(level, i);
+            if (i != 0) {
+                break;
+            }
+        }
+    }
+
+    dlink &slot = _slots[0][index];
+    while (!slot.is_alone()) {
+        dlink *dl = slot.next();
+        dl->remove();
+        _expired.push_back(CONTAINING_RECORD(dl, task, timer_dl));
+        --_timer_count;
+    }
+    ++_current_tick;
+}
+
+uint64_t timing_wheel_timer_service::next_wakeup_tick() const
+{
+    int index = (int)(_current_tick & level0_mask);
+    if (index == 0) {
+        return _current_tick;
+    }
+
+    // no need to look into the upper levels, as they are only cascaded when level 0 wraps
+    for (int i = index; i <= (int)level0_mask; i++) {
+        if (!_slots[0][i].is_alone()) {
+            return _current_tick + (i - index);
+        }
+    }
+    return _current_tick + (level0_mask + 1 - index);
+}
+
+void timing_wheel_timer_service::run()
+{
+    std::unique_lock<std::mutex> l(_lock);
+    while (_is_running) {
+        if (_timer_count == 0) {
+            _next_wakeup_tick = UINT64_MAX;
+            _cond.wait(l);
+            continue;
+        }
+
+        _next_wakeup_tick = next_wakeup_tick();
+        uint64_t now = now_tick();
+        if (now < _next_wakeup_tick) {
+            _cond.wait_until(l,
+                             _start_time + std::chrono::milliseconds(_next_wakeup_tick * _tick_ms));
+            continue;
+        }
+
+        // fire all the timers expired till now in one batch
+        while (_current_tick <= now) {
+            advance();
+        }
+        if (_expired.empty()) {
+            continue;
+        }
+
+        // we are awake, no need to be notified by add_timer
+        _next_wakeup_tick = 0;
+        l.unlock();
+
+        for (task *t : _expired) {
+            t->enqueue();
+
+            // to consume the added ref count by task::enqueue for add_timer
+            t->release_ref();
+        }
+        _expired.clear();
+
+        l.lock();
+    }
+}
+} // namespace tools
+} // namespace dsn
@@ -0,0 +1,105 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     hierarchical timing wheel based timer service
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#pragma once
+
+#include <dsn/tool_api.h>
+#include <condition_variable>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dsn {
+namespace tools {
+
+//
+// timers are linked into the slots of a 4-level hierarchical timing wheel through the
+// intrusive task::timer_dl, so that both add_timer and remove_timer (on task cancel) are
+// O(1). time advances in coarse ticks ([core] timing_wheel_tick_ms), and all the timers
+// expiring in the same tick are fired in one batch by the timer thread.
+//
+// level 0 has 256 slots of one tick each, and each upper level has 64 slots covering a
+// whole round of the level below it. timers beyond the last level (about 18.6 hours for
+// 1 ms tick) are parked in its farthest slot and re-placed when cascaded.
+//
+class timing_wheel_timer_service : public timer_service
+{
+public:
+    timing_wheel_timer_service(service_node *node, timer_service *inner_provider);
+
+    ~timing_wheel_timer_service() override;
+
+    // after milliseconds, the provider should call task->enqueue()
+    virtual void add_timer(task *task) override;
+
+    virtual void remove_timer(task *task) override;
+
+    virtual void start() override;
+
+    // for test and benchmark
+    uint64_t timer_count();
+
+private:
+    void run();
+
+    // all the followings are called under _lock
+    uint64_t now_tick() const;
+    void place(task *task);
+    void cascade(int level, int index);
+    void advance();
+    uint64_t next_wakeup_tick() const;
+
+private:
+    static const int level_count = 4;
+    static const int level0_bits = 8;
+    static const int level_bits = 6;
+    static const uint64_t max_span = 1ULL << (level0_bits + (level_count - 1) * level_bits);
+
+    int _tick_ms;
+    std::chrono::steady_clock::time_point _start_time;
+
+    std::mutex _lock;
+    std::condition_variable _cond;
+    std::vector<dlink> _slots[level_count];
+    uint64_t _current_tick;     // the next tick to be processed
+    uint64_t _next_wakeup_tick; // when the timer thread will wake up next time
+    uint64_t _timer_count;
+    std::vector<task *> _expired;
+    bool _is_running;
+    std::thread _worker;
+};
+} // namespace tools
+} // namespace dsn
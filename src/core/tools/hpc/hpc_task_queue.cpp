@@ -34,6 +34,8 @@
  */
 
 #include "hpc_task_queue.h"
+#include <dsn/tool-api/task_worker.h>
+#include "core/core/task_engine.h"
 #include <boost/function_output_iterator.hpp>
 
 namespace dsn {
@@ -80,5 +82,209 @@ task *hpc_concurrent_task_queue::dequeue(int &batch_size)
     } while (count != 0);
     return head;
 }
+
+hpc_work_stealing_task_queue::hpc_work_stealing_task_queue(task_worker_pool *pool,
+                                                           int index,
+                                                           task_queue *inner_provider)
+    : task_queue(pool, index, inner_provider), _is_idle(false)
+{
+    _pin_hashed_tasks = pool_spec().partitioned;
+}
+
+bool hpc_work_stealing_task_queue::is_owner_thread() const
+{
+    task_worker *current = task_worker::current();
+    return current != nullptr && current->pool() == pool() && current->index() == index();
+}
+
+hpc_work_stealing_task_queue *hpc_work_stealing_task_queue::sibling(int index) const
+{
+    // all the queues of a pool are created by the same factory
+    return static_cast<hpc_work_stealing_task_queue *>(pool()->queues()[index]);
+}
+
+void hpc_work_stealing_task_queue::wake_idle_sibling()
+{
+    int count = static_cast<int>(pool()->queues().size());
+    for (int i = 1; i < count; i++) {
+        hpc_work_stealing_task_queue *q = sibling((index() + i) % count);
+        if (q->_is_idle.load(std::memory_order_acquire) && q->_is_idle.exchange(false)) {
+            q->_sema.signal(1);
+            return;
+        }
+    }
+}
+
+void hpc_work_stealing_task_queue::enqueue(task *task)
+{
+    auto pri = task->spec().priority;
+    bool stealable = true;
+    task->is_strand_serialized = (_pin_hashed_tasks && task->hash() != 0);
+    if (task->is_strand_serialized) {
+        utils::auto_lock<utils::ex_lock_nr_spin> l(_strands_lock);
+        strand &s = _strands[task->hash()];
+        s.hash = task->hash();
+        s.tasks[pri].push_back(task);
+        s.task_count++;
+        if (!s.is_ready) {
+            s.is_ready = true;
+            _ready_strands.push_back(&s);
+        }
+        stealable = (s.runner == -1);
+    } else if (pri != TASK_PRIORITY_HIGH && is_owner_thread()) {
+        _local.push(task);
+    } else {
+        _injected[pri].enqueue(task);
+    }
+    _sema.signal(1);
+
+    // let an idle sibling help if our worker is busy
+    if (stealable && !_is_idle.load(std::memory_order_acquire)) {
+        wake_idle_sibling();
+    }
+}
+
+void hpc_work_stealing_task_queue::release_strands()
+{
+    for (auto &taken : _taken_strands) {
+        hpc_work_stealing_task_queue *home = taken.first;
+        bool has_tasks;
+        {
+            utils::auto_lock<utils::ex_lock_nr_spin> l(home->_strands_lock);
+            taken.second->runner = -1;
+            has_tasks = (taken.second->task_count > 0);
+            if (!has_tasks) {
+                // not in _ready_strands either, see take()
+                home->_strands.erase(taken.second->hash);
+            }
+        }
+        // the home worker may have skipped the strand and gone idle
+        if (has_tasks && home != this) {
+            home->_sema.signal(1);
+        }
+    }
+    _taken_strands.clear();
+}
+
+task *hpc_work_stealing_task_queue::take(int max_count,
+                                         hpc_work_stealing_task_queue *taker,
+                                         /*out*/ int &count)
+{
+    task *head = nullptr, *last = nullptr;
+    auto append = [&head, &last](task *in) {
+        if (last) {
+            last->next = in;
+        } else {
+            head = in;
+        }
+
+        last = in;
+        last->next = nullptr;
+    };
+    auto out = boost::make_function_output_iterator(append);
+
+    bool is_owner = (taker == this);
+    count = 0;
+
+    // the strands are stolen only from a busy worker, an idle one is about to run them
+    if (_pin_hashed_tasks && (is_owner || !_is_idle.load(std::memory_order_acquire))) {
+        utils::auto_lock<utils::ex_lock_nr_spin> l(_strands_lock);
+
+        // steal at most half of the strands so that the owner is not starved in turn
+        size_t max_strands = is_owner ? _ready_strands.size() : (_ready_strands.size() + 1) / 2;
+        std::vector<strand *> unfinished;
+        for (auto it = _ready_strands.begin();
+             it != _ready_strands.end() && count < max_count && max_strands > 0;) {
+            strand *s = *it;
+            if (s->runner != -1) {
+                ++it;
+                continue;
+            }
+
+            s->runner = taker->index();
+            for (int pri = TASK_PRIORITY_HIGH; pri >= TASK_PRIORITY_LOW && count < max_count;
+                 --pri) {
+                while (count < max_count && !s->tasks[pri].empty()) {
+                    task *t = s->tasks[pri].front();
+                    s->tasks[pri].pop_front();
+                    append(t);
+                    count++;
+                    s->task_count--;
+                }
+            }
+            taker->_taken_strands.emplace_back(this, s);
+            max_strands--;
+
+            it = _ready_strands.erase(it);
+            if (s->task_count > 0) {
+                unfinished.push_back(s);
+            } else {
+                s->is_ready = false;
+            }
+        }
+        // take turns with the other strands
+        _ready_strands.insert(_ready_strands.end(), unfinished.begin(), unfinished.end());
+    }
+
+    task *t;
+    if (is_owner) {
+        for (int pri = TASK_PRIORITY_HIGH; pri >= TASK_PRIORITY_LOW && count < max_count; --pri) {
+            count += static_cast<int>(_injected[pri].try_dequeue_bulk(out, max_count - count));
+            if (pri == TASK_PRIORITY_HIGH) {
+                while (count < max_count && _local.pop(t)) {
+                    append(t);
+                    count++;
+                }
+            }
+        }
+    } else {
+        // steal at most half of the local tasks so that the owner is not starved in turn
+        int64_t local_count = (_local.size() + 1) / 2;
+        while (count < max_count && local_count-- > 0 && _local.steal(t)) {
+            append(t);
+            count++;
+        }
+        for (int pri = TASK_PRIORITY_HIGH; pri >= TASK_PRIORITY_LOW && count < max_count; --pri) {
+            count += static_cast<int>(_injected[pri].try_dequeue_bulk(out, max_count - count));
+        }
+    }
+    return head;
+}
+
+task *hpc_work_stealing_task_queue::dequeue(/*inout*/ int &batch_size)
+{
+    // the last batch is done
+    release_strands();
+
+    int max_count = batch_size;
+    task *head = take(max_count, this, batch_size);
+    if (batch_size > 0) {
+        _sema.tryWaitMany(batch_size);
+        return head;
+    }
+
+    _is_idle.store(true, std::memory_order_release);
+    _sema.wait();
+    _is_idle.store(false, std::memory_order_release);
+
+    head = take(max_count, this, batch_size);
+    // one signal is already consumed by the wait above
+    if (batch_size > 1) {
+        _sema.tryWaitMany(batch_size - 1);
+    }
+    return head;
+}
+
+task *hpc_work_stealing_task_queue::steal(/*inout*/ int &batch_size)
+{
+    hpc_work_stealing_task_queue *thief = sibling(task_worker::current()->index());
+    task *head = take(batch_size, thief, batch_size);
+    if (batch_size > 0) {
+        _sema.tryWaitMany(batch_size);
+        // come back for more before blocking, as this worker is likely still busy
+        thief->_sema.signal(1);
+    }
+    return head;
+}
 }
 }
@@ -39,6 +39,11 @@
 #include <concurrentqueue/blockingconcurrentqueue.h>
 
 #include <dsn/tool-api/task_queue.h>
+#include <dsn/utility/synchronize.h>
+#include "work_stealing_deque.h"
+#include <atomic>
+#include <deque>
+#include <unordered_map>
 
 namespace dsn {
 namespace tools {
@@ -57,5 +62,69 @@ public:
 
     task *dequeue(/*inout*/ int &batch_size) override;
 };
+
+//
+// one queue per worker, idle workers steal from their siblings (see task_worker::loop):
+// - tasks pinned by thread_hash in partitioned pools go to the strand of their hash, whose
+//   tasks are run in order and one batch at a time, by the owner worker or by a thief when
+//   the owner is busy; a strand whose batch is running is skipped by all the others
+// - other tasks enqueued by the owner worker go to the _local deque (owner pops the newest
+//   one, thieves steal the oldest one), and the ones enqueued by any other thread go to
+//   _injected, which is drained by the owner and the thieves as well
+// - an idle worker blocks on its semaphore, which is signaled on enqueue, and also by the
+//   siblings having tasks enqueued while busy
+//
+class hpc_work_stealing_task_queue : public task_queue
+{
+public:
+    hpc_work_stealing_task_queue(task_worker_pool *pool, int index, task_queue *inner_provider);
+
+    void enqueue(task *task) override;
+
+    // returns no task if woken up with nothing left in the queue, so the worker goes stealing
+    task *dequeue(/*inout*/ int &batch_size) override;
+
+    bool is_work_stealing() const override { return true; }
+
+    task *steal(/*inout*/ int &batch_size) override;
+
+private:
+    // removed from _strands once it has no task and no batch running
+    struct strand
+    {
+        int hash = 0;
+        std::deque<task *> tasks[TASK_PRIORITY_COUNT];
+        int task_count = 0;
+        bool is_ready = false; // in _ready_strands
+        int runner = -1;       // the worker running a batch of the strand, -1 if none
+    };
+
+    bool is_owner_thread() const;
+    hpc_work_stealing_task_queue *sibling(int index) const;
+    void wake_idle_sibling();
+
+    // release the strands taken in the last batch of this queue's worker, and remove the
+    // drained ones
+    void release_strands();
+
+    // take at most max_count tasks, return the task list and set count
+    task *take(int max_count, hpc_work_stealing_task_queue *taker, /*out*/ int &count);
+
+private:
+    typedef moodycamel::ConcurrentQueue<task *> queue_t;
+
+    moodycamel::details::mpmc_sema::LightweightSemaphore _sema;
+    std::atomic<bool> _is_idle;
+    work_stealing_deque<task *> _local;
+    queue_t _injected[TASK_PRIORITY_COUNT];
+
+    bool _pin_hashed_tasks;
+    ::dsn::utils::ex_lock_nr_spin _strands_lock;
+    std::unordered_map<int, strand> _strands;
+    std::deque<strand *> _ready_strands;
+
+    // accessed only by the worker of this queue
+    std::vector<std::pair<hpc_work_stealing_task_queue *, strand *>> _taken_strands;
+};
 }
 }
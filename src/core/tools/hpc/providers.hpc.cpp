@@ -41,6 +41,8 @@ namespace tools {
 void register_hpc_providers()
 {
     register_component_provider<hpc_concurrent_task_queue>("dsn::tools::hpc_concurrent_task_queue");
+    register_component_provider<hpc_work_stealing_task_queue>(
+        "dsn::tools::hpc_work_stealing_task_queue");
 }
 }
 }
@@ -0,0 +1,188 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Chase-Lev work stealing deque, following "Correct and Efficient
+ *     Work-Stealing for Weak Memory Models" (Le et al., PPoPP'13)
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <type_traits>
+
+namespace dsn {
+namespace tools {
+
+//
+// only the owner thread may call push() and pop(), which work on the bottom end;
+// any thread may call steal(), which takes the oldest element from the top end.
+//
+// T must be trivially copyable (usually a pointer), as elements may be read by
+// a thief that later loses the race and discards its copy.
+//
+template <typename T>
+class work_stealing_deque
+{
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+public:
+    explicit work_stealing_deque(int capacity_log2 = 10) : _top(0), _bottom(0)
+    {
+        _array.store(new ring(capacity_log2), std::memory_order_relaxed);
+    }
+
+    ~work_stealing_deque()
+    {
+        for (ring *r : _retired) {
+            delete r;
+        }
+        delete _array.load(std::memory_order_relaxed);
+    }
+
+    work_stealing_deque(const work_stealing_deque &) = delete;
+    work_stealing_deque &operator=(const work_stealing_deque &) = delete;
+
+    // owner only
+    void push(T x)
+    {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t t = _top.load(std::memory_order_acquire);
+        ring *a = _array.load(std::memory_order_relaxed);
+        if (b - t > a->capacity() - 1) {
+            a = grow(a, t, b);
+        }
+        a->put(b, x);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // owner only, takes the newest element
+    bool pop(/*out*/ T &x)
+    {
+        int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+        ring *a = _array.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = _top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // empty
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        x = a->get(b);
+        if (t == b) {
+            // the last element, race against thieves
+            bool won = _top.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // any thread, takes the oldest element
+    bool steal(/*out*/ T &x)
+    {
+        int64_t t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = _bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+
+        ring *a = _array.load(std::memory_order_acquire);
+        T v = a->get(t);
+        if (!_top.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return false;
+        }
+        x = v;
+        return true;
+    }
+
+    // approximate when called concurrently
+    int64_t size() const
+    {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t t = _top.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    class ring
+    {
+    public:
+        explicit ring(int capacity_log2)
+            : _mask((int64_t(1) << capacity_log2) - 1),
+              _capacity_log2(capacity_log2),
+              _slots(new std::atomic<T>[int64_t(1) << capacity_log2])
+        {
+        }
+        ~ring() { delete[] _slots; }
+
+        int64_t capacity() const { return _mask + 1; }
+        int capacity_log2() const { return _capacity_log2; }
+        void put(int64_t i, T x) { _slots[i & _mask].store(x, std::memory_order_relaxed); }
+        T get(int64_t i) const { return _slots[i & _mask].load(std::memory_order_relaxed); }
+
+    private:
+        int64_t _mask;
+        int _capacity_log2;
+        std::atomic<T> *_slots;
+    };
+
+    ring *grow(ring *old, int64_t t, int64_t b)
+    {
+        ring *a = new ring(old->capacity_log2() + 1);
+        for (int64_t i = t; i < b; ++i) {
+            a->put(i, old->get(i));
+        }
+        _array.store(a, std::memory_order_release);
+        // thieves may still be reading from the old ring, so keep it until we are destroyed
+        _retired.push_back(old);
+        return a;
+    }
+
+private:
+    std::atomic<int64_t> _top;
+    std::atomic<int64_t> _bottom;
+    std::atomic<ring *> _array;
+    std::vector<ring *> _retired; // owner only
+};
+} // namespace tools
+} // namespace dsn
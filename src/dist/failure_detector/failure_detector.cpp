@@ -34,6 +34,7 @@
  */
 
 #include <dsn/dist/failure_detector.h>
+#include <dsn/utility/utils.h>
 #include <chrono>
 #include <ctime>
 
@@ -51,6 +52,15 @@ failure_detector::failure_detector()
         "recent_beacon_fail_count",
         COUNTER_TYPE_VOLATILE_NUMBER,
         "failure detector beacon fail count in the recent period");
+    _beacon_process_latency_ns.init_app_counter(
+        "eon.failure_detector",
+        "beacon_process_latency_ns",
+        COUNTER_TYPE_NUMBER_PERCENTILES,
+        "time used by the master to process one beacon");
+    _beacon_ack_latency_ms.init_app_counter("eon.failure_detector",
+                                            "beacon_ack_latency_ms",
+                                            COUNTER_TYPE_NUMBER_PERCENTILES,
+                                            "round trip time of the beacons acked by the masters");
 
     _is_started = false;
 }
@@ -70,6 +80,27 @@ error_code failure_detector::start(uint32_t check_interval_seconds,
     _grace_milliseconds = grace_seconds * 1000;
 
     _use_allow_list = use_allow_list;
+    dassert(_check_interval_milliseconds > 0, "check interval of failure detector must be > 0");
+
+    {
+        zauto_lock l(_lock);
+        // a worker may be checked at most one tick later than its grace deadline, after
+        // which it is either expired or rescheduled within the next grace period
+        size_t wheel_size = _grace_milliseconds / _check_interval_milliseconds + 3;
+        uint64_t now = dsn_now_ms();
+        for (worker_shard &shard : _worker_shards) {
+            utils::auto_lock<utils::ex_lock_nr_spin> sl(shard.lock);
+            shard.wheel.clear();
+            shard.wheel.resize(wheel_size);
+            shard.next_tick = to_check_tick(now);
+            for (auto &kv : shard.workers) {
+                kv.second.expire_tick = 0;
+                if (kv.second.is_alive) {
+                    schedule_worker_expire(shard, kv.second, shard.next_tick + 1);
+                }
+            }
+        }
+    }
 
     open_service();
 
@@ -81,6 +112,15 @@ error_code failure_detector::start(uint32_t check_interval_seconds,
                                          -1,
                                          std::chrono::milliseconds(_check_interval_milliseconds));
 
+    // the beacons to all the masters are sent together in one round
+    _send_beacon_task =
+        tasking::enqueue_timer(LPC_BEACON_SEND,
+                               &_tracker,
+                               [this] { send_beacons(); },
+                               std::chrono::milliseconds(_beacon_interval_milliseconds),
+                               0,
+                               std::chrono::milliseconds(_beacon_interval_milliseconds));
+
     _is_started = true;
     return ERR_OK;
 }
@@ -97,12 +137,12 @@ error_code failure_detector::stop()
 
     {
         zauto_lock l(_lock);
-        for (auto &m : _masters) {
-            m.second.send_beacon_timer->cancel(true);
-        }
-
         _masters.clear();
-        _workers.clear();
+        for (worker_shard &shard : _worker_shards) {
+            utils::auto_lock<utils::ex_lock_nr_spin> sl(shard.lock);
+            shard.workers.clear();
+            shard.wheel.clear();
+        }
     }
 
     if (_check_task != nullptr) {
@@ -110,12 +150,17 @@ error_code failure_detector::stop()
         _check_task = nullptr;
     }
 
+    if (_send_beacon_task != nullptr) {
+        _send_beacon_task->cancel(true);
+        _send_beacon_task = nullptr;
+    }
+
     return ERR_OK;
 }
 
 void failure_detector::register_master(::dsn::rpc_address target)
 {
-    bool setup_timer = false;
+    bool send_beacon_now = false;
     uint64_t now = dsn_now_ms();
 
     zauto_lock l(_lock);
@@ -125,26 +170,20 @@ void failure_detector::register_master(::dsn::rpc_address target)
     auto ret = _masters.insert(std::make_pair(target, record));
     if (ret.second) {
         dinfo("register master[%s] successfully", target.to_string());
-        setup_timer = true;
+        send_beacon_now = true;
     } else {
         // active the beacon again in case previously local node is not in target's allow list
         if (ret.first->second.rejected) {
             ret.first->second.rejected = false;
-            setup_timer = true;
+            send_beacon_now = true;
         }
         dinfo("master[%s] already registered", target.to_string());
     }
 
-    if (setup_timer) {
+    if (send_beacon_now) {
         // delay the beacon slightly to make first beacon greater than the
-        // last_beacon_send_time_with_ack
-        ret.first->second.send_beacon_timer =
-            tasking::enqueue_timer(LPC_BEACON_SEND,
-                                   &_tracker,
-                                   [this, target]() { this->send_beacon(target, dsn_now_ms()); },
-                                   std::chrono::milliseconds(_beacon_interval_milliseconds),
-                                   0,
-                                   std::chrono::milliseconds(1));
+        // last_beacon_send_time_with_ack, the later ones are sent in the rounds
+        send_beacon_later(target, 1);
     }
 }
 
@@ -165,17 +204,10 @@ bool failure_detector::switch_master(::dsn::rpc_address from,
 
         it->second.node = to;
         it->second.rejected = false;
-        it->second.send_beacon_timer->cancel(true);
-        it->second.send_beacon_timer =
-            tasking::enqueue_timer(LPC_BEACON_SEND,
-                                   &_tracker,
-                                   [this, to]() { this->send_beacon(to, dsn_now_ms()); },
-                                   std::chrono::milliseconds(_beacon_interval_milliseconds),
-                                   0,
-                                   std::chrono::milliseconds(delay_milliseconds));
 
         _masters.insert(std::make_pair(to, it->second));
         _masters.erase(from);
+        send_beacon_later(to, delay_milliseconds);
 
         ddebug("switch master successfully, from[%s], to[%s]", from.to_string(), to.to_string());
     } else {
@@ -258,17 +290,12 @@ void failure_detector::check_all_records()
 
     {
         zauto_lock l(_lock);
-        worker_map::iterator itq = _workers.begin();
-        for (; itq != _workers.end(); itq++) {
-            worker_record &record = itq->second;
-
-            if (record.is_alive != false &&
-                now - record.last_beacon_recv_time > _grace_milliseconds) {
-                expire.push_back(record.node);
-                record.is_alive = false;
-
-                report(record.node, false, false);
-            }
+        for (worker_shard &shard : _worker_shards) {
+            utils::auto_lock<utils::ex_lock_nr_spin> sl(shard.lock);
+            expire_workers(shard, now, expire);
+        }
+        for (auto &node : expire) {
+            report(node, false, false);
         }
         /*
          * The worker disconnected event also need to be under protection of the _lock
@@ -279,6 +306,78 @@ void failure_detector::check_all_records()
     }
 }
 
+void failure_detector::expire_workers(worker_shard &shard,
+                                      uint64_t now,
+                                      /*out*/ std::vector<::dsn::rpc_address> &expire)
+{
+    if (shard.wheel.empty()) {
+        return;
+    }
+
+    uint64_t now_tick = to_check_tick(now);
+    uint64_t wheel_size = shard.wheel.size();
+    uint64_t tick = shard.next_tick;
+    if (now_tick >= wheel_size && tick < now_tick - wheel_size + 1) {
+        // all the slots are visited once even if the check is delayed for long
+        tick = now_tick - wheel_size + 1;
+    }
+
+    std::vector<std::pair<::dsn::rpc_address, uint64_t>> due;
+    for (; tick <= now_tick; ++tick) {
+        auto &slot = shard.wheel[tick % wheel_size];
+        if (slot.empty()) {
+            continue;
+        }
+
+        due.clear();
+        size_t kept = 0;
+        for (auto &entry : slot) {
+            if (entry.second > tick) {
+                // belongs to a later round of this slot
+                slot[kept++] = entry;
+            } else {
+                due.push_back(entry);
+            }
+        }
+        slot.resize(kept);
+
+        for (auto &entry : due) {
+            auto it = shard.workers.find(entry.first);
+            // stale entries of the rescheduled, expired or unregistered workers
+            if (it == shard.workers.end() || it->second.expire_tick != entry.second) {
+                continue;
+            }
+
+            worker_record &record = it->second;
+            if (now - record.last_beacon_recv_time > _grace_milliseconds) {
+                expire.push_back(record.node);
+                record.is_alive = false;
+                record.expire_tick = 0;
+            } else {
+                schedule_worker_expire(shard, record, now_tick + 1);
+            }
+        }
+    }
+    shard.next_tick = now_tick + 1;
+}
+
+void failure_detector::schedule_worker_expire(worker_shard &shard,
+                                              worker_record &record,
+                                              uint64_t min_tick)
+{
+    if (shard.wheel.empty()) {
+        // not started yet, scheduled in start()
+        record.expire_tick = 0;
+        return;
+    }
+
+    // the first tick by which the grace period must have passed if no beacon is received
+    uint64_t tick = to_check_tick(record.last_beacon_recv_time + _grace_milliseconds) + 1;
+    record.expire_tick = std::max(tick, min_tick);
+    shard.wheel[record.expire_tick % shard.wheel.size()].emplace_back(record.node,
+                                                                      record.expire_tick);
+}
+
 void failure_detector::add_allow_list(::dsn::rpc_address node)
 {
     zauto_lock l(_lock);
@@ -299,38 +398,63 @@ void failure_detector::on_ping_internal(const beacon_msg &beacon, /*out*/ beacon
     ack.is_master = true;
     ack.allowed = true;
 
-    zauto_lock l(_lock);
-
-    uint64_t now = dsn_now_ms();
+    uint64_t start_ns = utils::get_current_physical_time_ns();
     auto node = beacon.from_addr;
+    worker_shard &shard = get_worker_shard(node);
 
-    worker_map::iterator itr = _workers.find(node);
-    if (itr == _workers.end()) {
-        // if is a new worker, check allow list first if need
-        if (_use_allow_list && _allow_list.find(node) == _allow_list.end()) {
-            dwarn("new worker[%s] is rejected", node.to_string());
-            ack.allowed = false;
+    // fast path: beacons from the alive workers only refresh the records
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> sl(shard.lock);
+        worker_map::iterator itr = shard.workers.find(node);
+        if (itr != shard.workers.end() && itr->second.is_alive) {
+            uint64_t now = dsn_now_ms();
+            if (is_time_greater_than(now, itr->second.last_beacon_recv_time)) {
+                itr->second.last_beacon_recv_time = now;
+            }
+            _beacon_process_latency_ns->set(utils::get_current_physical_time_ns() - start_ns);
             return;
         }
+    }
 
-        // create new entry for node
-        worker_record record(node, now);
-        record.is_alive = true;
-        _workers.insert(std::make_pair(node, record));
-
-        report(node, false, true);
-        on_worker_connected(node);
-    } else if (is_time_greater_than(now, itr->second.last_beacon_recv_time)) {
-        // update last_beacon_recv_time
-        itr->second.last_beacon_recv_time = now;
+    // slow path: the connected callback must be atomic with the is_alive switch under _lock
+    zauto_lock l(_lock);
 
-        if (itr->second.is_alive == false) {
-            itr->second.is_alive = true;
+    uint64_t now = dsn_now_ms();
+    bool connected = false;
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> sl(shard.lock);
+        worker_map::iterator itr = shard.workers.find(node);
+        if (itr == shard.workers.end()) {
+            // if is a new worker, check allow list first if need
+            if (_use_allow_list && _allow_list.find(node) == _allow_list.end()) {
+                dwarn("new worker[%s] is rejected", node.to_string());
+                ack.allowed = false;
+                return;
+            }
 
-            report(node, false, true);
-            on_worker_connected(node);
+            // create new entry for node
+            worker_record record(node, now);
+            record.is_alive = true;
+            itr = shard.workers.insert(std::make_pair(node, record)).first;
+            schedule_worker_expire(shard, itr->second, to_check_tick(now) + 1);
+            connected = true;
+        } else if (is_time_greater_than(now, itr->second.last_beacon_recv_time)) {
+            // update last_beacon_recv_time
+            itr->second.last_beacon_recv_time = now;
+
+            if (itr->second.is_alive == false) {
+                itr->second.is_alive = true;
+                schedule_worker_expire(shard, itr->second, to_check_tick(now) + 1);
+                connected = true;
+            }
         }
     }
+
+    if (connected) {
+        report(node, false, true);
+        on_worker_connected(node);
+    }
+    _beacon_process_latency_ns->set(utils::get_current_physical_time_ns() - start_ns);
 }
 
 void failure_detector::on_ping(const beacon_msg &beacon, ::dsn::rpc_replier<beacon_ack> &reply)
@@ -378,8 +502,8 @@ bool failure_detector::end_ping_internal(::dsn::error_code err, const beacon_ack
               "remote_master[%s], local_worker[%s]",
               node.to_string(),
               dsn_primary_address().to_string());
+        // no more beacons are sent to the rejected master in the rounds
         record.rejected = true;
-        record.send_beacon_timer->cancel(true);
         return false;
     }
 
@@ -397,6 +521,8 @@ bool failure_detector::end_ping_internal(::dsn::error_code err, const beacon_ack
         return true;
     }
 
+    _beacon_ack_latency_ms->set(now - beacon_send_time);
+
     // update last_send_time_for_beacon_with_ack
     record.last_send_time_for_beacon_with_ack = beacon_send_time;
     record.rejected = false;
@@ -418,7 +544,6 @@ bool failure_detector::unregister_master(::dsn::rpc_address node)
     auto it = _masters.find(node);
 
     if (it != _masters.end()) {
-        it->second.send_beacon_timer->cancel(true);
         _masters.erase(it);
         dinfo("unregister master[%s] successfully", node.to_string());
         return true;
@@ -438,6 +563,16 @@ bool failure_detector::is_master_connected(::dsn::rpc_address node) const
         return false;
 }
 
+uint64_t failure_detector::get_master_lease_expire_ms(::dsn::rpc_address node) const
+{
+    zauto_lock l(_lock);
+    auto it = _masters.find(node);
+    if (it != _masters.end())
+        return it->second.last_send_time_for_beacon_with_ack + _lease_milliseconds;
+    else
+        return 0;
+}
+
 void failure_detector::register_worker(::dsn::rpc_address target, bool is_connected)
 {
     uint64_t now = dsn_now_ms();
@@ -448,8 +583,13 @@ void failure_detector::register_worker(::dsn::rpc_address target, bool is_connec
     worker_record record(target, now);
     record.is_alive = is_connected ? true : false;
 
-    auto ret = _workers.insert(std::make_pair(target, record));
+    worker_shard &shard = get_worker_shard(target);
+    utils::auto_lock<utils::ex_lock_nr_spin> sl(shard.lock);
+    auto ret = shard.workers.insert(std::make_pair(target, record));
     if (ret.second) {
+        if (record.is_alive) {
+            schedule_worker_expire(shard, ret.first->second, to_check_tick(now) + 1);
+        }
         dinfo("register worker[%s] successfully", target.to_string());
     } else {
         dinfo("worker[%s] already registered", target.to_string());
@@ -463,7 +603,13 @@ bool failure_detector::unregister_worker(::dsn::rpc_address node)
      */
     bool ret;
 
-    size_t count = _workers.erase(node);
+    // the entry left in the wheel is dropped when its tick is due
+    worker_shard &shard = get_worker_shard(node);
+    size_t count;
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> sl(shard.lock);
+        count = shard.workers.erase(node);
+    }
 
     if (count == 0) {
         ret = false;
@@ -481,19 +627,73 @@ bool failure_detector::unregister_worker(::dsn::rpc_address node)
 void failure_detector::clear_workers()
 {
     zauto_lock l(_lock);
-    _workers.clear();
+    for (worker_shard &shard : _worker_shards) {
+        utils::auto_lock<utils::ex_lock_nr_spin> sl(shard.lock);
+        shard.workers.clear();
+        for (auto &slot : shard.wheel) {
+            slot.clear();
+        }
+    }
 }
 
 bool failure_detector::is_worker_connected(::dsn::rpc_address node) const
 {
-    zauto_lock l(_lock);
-    auto it = _workers.find(node);
-    if (it != _workers.end())
+    const worker_shard &shard = get_worker_shard(node);
+    utils::auto_lock<utils::ex_lock_nr_spin> sl(shard.lock);
+    auto it = shard.workers.find(node);
+    if (it != shard.workers.end())
         return it->second.is_alive;
     else
         return false;
 }
 
+int failure_detector::worker_count() const
+{
+    size_t count = 0;
+    for (const worker_shard &shard : _worker_shards) {
+        utils::auto_lock<utils::ex_lock_nr_spin> sl(shard.lock);
+        count += shard.workers.size();
+    }
+    return static_cast<int>(count);
+}
+
+void failure_detector::send_beacons()
+{
+    std::vector<::dsn::rpc_address> targets;
+    {
+        zauto_lock l(_lock);
+        targets.reserve(_masters.size());
+        for (auto &kv : _masters) {
+            if (!kv.second.rejected) {
+                targets.push_back(kv.first);
+            }
+        }
+    }
+
+    uint64_t now = dsn_now_ms();
+    for (auto &target : targets) {
+        send_beacon(target, now);
+    }
+}
+
+void failure_detector::send_beacon_later(::dsn::rpc_address target, uint32_t delay_milliseconds)
+{
+    tasking::enqueue(LPC_BEACON_SEND,
+                     &_tracker,
+                     [this, target]() {
+                         {
+                             zauto_lock l(_lock);
+                             auto it = _masters.find(target);
+                             if (it == _masters.end() || it->second.rejected) {
+                                 return;
+                             }
+                         }
+                         send_beacon(target, dsn_now_ms());
+                     },
+                     0,
+                     std::chrono::milliseconds(delay_milliseconds));
+}
+
 void failure_detector::send_beacon(::dsn::rpc_address target, uint64_t time)
 {
     beacon_msg beacon;
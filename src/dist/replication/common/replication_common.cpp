@@ -56,11 +56,23 @@ replication_options::replication_options()
     batch_write_disabled = false;
     staleness_for_commit = 10;
     max_mutation_count_in_prepare_list = 110;
+    mutation_2pc_adaptive_enabled = false;
+    mutation_2pc_max_batch_bytes = 4 * 1024 * 1024;
     mutation_2pc_min_replica_count = 2;
 
     group_check_disabled = false;
     group_check_interval_ms = 10000;
 
+    stale_read_max_decree_gap = -1;
+    stale_read_max_lag_ms = 30000;
+
+    primary_read_lease_enabled = false;
+    primary_read_lease_ms = 3000;
+
+    prepare_batch_enabled = false;
+    prepare_batch_delay_ms = 0;
+    prepare_batch_max_bytes = 1024 * 1024;
+
     checkpoint_disabled = false;
     checkpoint_interval_seconds = 100;
     checkpoint_min_decree_gap = 10000;
@@ -87,14 +99,22 @@ replication_options::replication_options()
     log_private_batch_buffer_flush_interval_ms = 10000;
     log_private_reserve_max_size_mb = 0;
     log_private_reserve_max_time_seconds = 0;
+    log_private_direct_io = false;
 
     log_shared_file_size_mb = 32;
     log_shared_file_count_limit = 100;
     log_shared_batch_buffer_kb = 0;
     log_shared_force_flush = false;
+    log_shared_replay_thread_count = 4;
+    log_shared_group_commit = false;
+    log_shared_group_commit_max_kb = 1024;
+    log_shared_group_commit_max_wait_us = 2000;
+    log_shared_segment_pool_count = 0;
+    log_shared_direct_io = false;
 
     config_sync_disabled = false;
     config_sync_interval_ms = 30000;
+    config_sync_full_interval_ms = 300000;
 
     lb_interval_ms = 10000;
 
@@ -299,6 +319,17 @@ void replication_options::initialize()
         "mutation_2pc_min_replica_count",
         mutation_2pc_min_replica_count,
         "minimum number of alive replicas under which write is allowed");
+    mutation_2pc_adaptive_enabled = dsn_config_get_value_bool(
+        "replication",
+        "mutation_2pc_adaptive_enabled",
+        mutation_2pc_adaptive_enabled,
+        "whether to adapt the concurrent two phase commit rounds (up to staleness_for_commit) "
+        "and the batch size of the write requests to the commit latency");
+    mutation_2pc_max_batch_bytes = (int)dsn_config_get_value_uint64(
+        "replication",
+        "mutation_2pc_max_batch_bytes",
+        mutation_2pc_max_batch_bytes,
+        "max bytes of the write requests batched in one mutation if adaptive 2pc is enabled");
 
     group_check_disabled = dsn_config_get_value_bool("replication",
                                                      "group_check_disabled",
@@ -310,6 +341,50 @@ void replication_options::initialize()
                                          group_check_interval_ms,
                                          "every what period (ms) we check the replica healthness");
 
+    stale_read_max_decree_gap = (int32_t)dsn_config_get_value_int64(
+        "replication",
+        "stale_read_max_decree_gap",
+        stale_read_max_decree_gap,
+        "max decrees a secondary may lag behind the primary to serve the reads allowing stale "
+        "results, negative to forward all of them to the primary, overridden by the app env "
+        "replica.stale_read_max_decree_gap");
+    stale_read_max_lag_ms = (int32_t)dsn_config_get_value_uint64(
+        "replication",
+        "stale_read_max_lag_ms",
+        stale_read_max_lag_ms,
+        "a secondary not hearing from the primary for longer than this (ms) does not serve the "
+        "reads allowing stale results");
+
+    primary_read_lease_enabled =
+        dsn_config_get_value_bool("replication",
+                                  "primary_read_lease_enabled",
+                                  primary_read_lease_enabled,
+                                  "whether the primary serves reads only under the lease granted "
+                                  "by the secondaries, which a new primary waits out");
+    primary_read_lease_ms = (int32_t)dsn_config_get_value_uint64(
+        "replication",
+        "primary_read_lease_ms",
+        primary_read_lease_ms,
+        "the read lease period (ms) granted by the secondaries on acking prepares or group checks");
+
+    prepare_batch_enabled = dsn_config_get_value_bool(
+        "replication",
+        "prepare_batch_enabled",
+        prepare_batch_enabled,
+        "whether the prepares of different partitions to the same node are sent in batches, "
+        "while the batched prepares from the peers are always acked in batches");
+    prepare_batch_delay_ms = (int32_t)dsn_config_get_value_uint64(
+        "replication",
+        "prepare_batch_delay_ms",
+        prepare_batch_delay_ms,
+        "how long (ms) a prepare or an ack waits for others to the same node before being sent, "
+        "0 to only batch those queued while the last batch is being flushed");
+    prepare_batch_max_bytes = (int32_t)dsn_config_get_value_uint64(
+        "replication",
+        "prepare_batch_max_bytes",
+        prepare_batch_max_bytes,
+        "a batch of prepares to the same node is sent at once on reaching this size");
+
     checkpoint_disabled = dsn_config_get_value_bool("replication",
                                                     "checkpoint_disabled",
                                                     checkpoint_disabled,
@@ -420,6 +495,12 @@ void replication_options::initialize()
         "log_private_reserve_max_time_seconds",
         log_private_reserve_max_time_seconds,
         "max time in seconds of useless private log to be reserved");
+    log_private_direct_io =
+        dsn_config_get_value_bool("replication",
+                                  "log_private_direct_io",
+                                  log_private_direct_io,
+                                  "whether to write and replay private log with direct io, "
+                                  "bypassing the page cache");
 
     log_shared_file_size_mb =
         (int)dsn_config_get_value_uint64("replication",
@@ -440,6 +521,44 @@ void replication_options::initialize()
                                   "log_shared_force_flush",
                                   log_shared_force_flush,
                                   "when write shared log, whether to flush file after write done");
+    log_shared_replay_thread_count =
+        (int)dsn_config_get_value_uint64("replication",
+                                         "log_shared_replay_thread_count",
+                                         log_shared_replay_thread_count,
+                                         "thread number to read and decode the shared log "
+                                         "files in parallel when replaying on startup");
+    log_shared_group_commit = dsn_config_get_value_bool(
+        "replication",
+        "log_shared_group_commit",
+        log_shared_group_commit,
+        "whether to delay shared log writes a little to share one fsync among more "
+        "mutations, only takes effect when log_shared_force_flush is true");
+    log_shared_group_commit_max_kb =
+        (int)dsn_config_get_value_uint64("replication",
+                                         "log_shared_group_commit_max_kb",
+                                         log_shared_group_commit_max_kb,
+                                         "shared log group commit is written without waiting "
+                                         "once its size reaches this limit (KB)");
+    log_shared_group_commit_max_wait_us =
+        (int)dsn_config_get_value_uint64("replication",
+                                         "log_shared_group_commit_max_wait_us",
+                                         log_shared_group_commit_max_wait_us,
+                                         "max time (us) a shared log group commit waits for "
+                                         "more mutations, the actual wait adapts to the "
+                                         "observed fsync latency");
+    log_shared_segment_pool_count =
+        (int)dsn_config_get_value_uint64("replication",
+                                         "log_shared_segment_pool_count",
+                                         log_shared_segment_pool_count,
+                                         "max count of pre-allocated and recycled shared log "
+                                         "segment files, 0 means to create a new file for "
+                                         "each segment");
+    log_shared_direct_io =
+        dsn_config_get_value_bool("replication",
+                                  "log_shared_direct_io",
+                                  log_shared_direct_io,
+                                  "whether to write and replay shared log with direct io, "
+                                  "bypassing the page cache");
 
     config_sync_disabled = dsn_config_get_value_bool(
         "replication",
@@ -451,6 +570,12 @@ void replication_options::initialize()
         "config_sync_interval_ms",
         config_sync_interval_ms,
         "every this period(ms) the replica syncs replica configuration with the meta server");
+    config_sync_full_interval_ms = (int)dsn_config_get_value_uint64(
+        "replication",
+        "config_sync_full_interval_ms",
+        config_sync_full_interval_ms,
+        "every this period(ms) the replica syncs all the replica configurations with the meta "
+        "server, while only the changed ones are synced in between, 0 to always sync all");
 
     lb_interval_ms = (int)dsn_config_get_value_uint64(
         "replication",
@@ -484,6 +609,9 @@ void replication_options::sanity_check()
             "%d VS %d",
             max_mutation_count_in_prepare_list,
             staleness_for_commit);
+    dassert(!primary_read_lease_enabled || (primary_read_lease_ms > 0 && !group_check_disabled),
+            "primary read lease needs the group check to be renewed, primary_read_lease_ms = %d",
+            primary_read_lease_ms);
 }
 
 /*static*/ bool replica_helper::remove_node(::dsn::rpc_address node,
@@ -547,6 +675,8 @@ const std::string cold_backup_constant::BACKUP_METADATA("backup_metadata");
 const std::string cold_backup_constant::BACKUP_INFO("backup_info");
 const int32_t cold_backup_constant::PROGRESS_FINISHED = 1000;
 
+const std::string replica_envs::STALE_READ_MAX_DECREE_GAP("replica.stale_read_max_decree_gap");
+
 const std::string backup_restore_constant::FORCE_RESTORE("restore.force_restore");
 const std::string backup_restore_constant::BLOCK_SERVICE_PROVIDER("restore.block_service_provider");
 const std::string backup_restore_constant::CLUSTER_NAME("restore.cluster_name");
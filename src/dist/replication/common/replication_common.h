@@ -70,10 +70,22 @@ public:
     int32_t staleness_for_commit;
     int32_t max_mutation_count_in_prepare_list;
     int32_t mutation_2pc_min_replica_count;
+    bool mutation_2pc_adaptive_enabled;
+    int32_t mutation_2pc_max_batch_bytes;
 
     bool group_check_disabled;
     int32_t group_check_interval_ms;
 
+    int32_t stale_read_max_decree_gap;
+    int32_t stale_read_max_lag_ms;
+
+    bool primary_read_lease_enabled;
+    int32_t primary_read_lease_ms;
+
+    bool prepare_batch_enabled;
+    int32_t prepare_batch_delay_ms;
+    int32_t prepare_batch_max_bytes;
+
     bool checkpoint_disabled;
     int32_t checkpoint_interval_seconds;
     int64_t checkpoint_min_decree_gap;
@@ -100,14 +112,22 @@ public:
     int32_t log_private_batch_buffer_flush_interval_ms;
     int32_t log_private_reserve_max_size_mb;
     int32_t log_private_reserve_max_time_seconds;
+    bool log_private_direct_io;
 
     int32_t log_shared_file_size_mb;
     int32_t log_shared_file_count_limit;
     int32_t log_shared_batch_buffer_kb;
     bool log_shared_force_flush;
+    int32_t log_shared_replay_thread_count;
+    bool log_shared_group_commit;
+    int32_t log_shared_group_commit_max_kb;
+    int32_t log_shared_group_commit_max_wait_us;
+    int32_t log_shared_segment_pool_count;
+    bool log_shared_direct_io;
 
     bool config_sync_disabled;
     int32_t config_sync_interval_ms;
+    int32_t config_sync_full_interval_ms;
 
     int32_t lb_interval_ms;
 
@@ -136,6 +156,12 @@ public:
     static const int32_t PROGRESS_FINISHED;
 };
 
+class replica_envs
+{
+public:
+    static const std::string STALE_READ_MAX_DECREE_GAP;
+};
+
 class backup_restore_constant
 {
 public:
@@ -3267,6 +3267,18 @@ void configuration_query_by_node_request::__set_info(const replica_server_info &
     __isset.info = true;
 }
 
+void configuration_query_by_node_request::__set_last_sync_epoch(const int64_t val)
+{
+    this->last_sync_epoch = val;
+    __isset.last_sync_epoch = true;
+}
+
+void configuration_query_by_node_request::__set_last_sync_version(const int64_t val)
+{
+    this->last_sync_version = val;
+    __isset.last_sync_version = true;
+}
+
 uint32_t configuration_query_by_node_request::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -3321,6 +3333,22 @@ uint32_t configuration_query_by_node_request::read(::apache::thrift::protocol::T
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 4:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->last_sync_epoch);
+                this->__isset.last_sync_epoch = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 5:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->last_sync_version);
+                this->__isset.last_sync_version = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -3363,6 +3391,16 @@ configuration_query_by_node_request::write(::apache::thrift::protocol::TProtocol
         xfer += this->info.write(oprot);
         xfer += oprot->writeFieldEnd();
     }
+    if (this->__isset.last_sync_epoch) {
+        xfer += oprot->writeFieldBegin("last_sync_epoch", ::apache::thrift::protocol::T_I64, 4);
+        xfer += oprot->writeI64(this->last_sync_epoch);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.last_sync_version) {
+        xfer += oprot->writeFieldBegin("last_sync_version", ::apache::thrift::protocol::T_I64, 5);
+        xfer += oprot->writeI64(this->last_sync_version);
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -3374,6 +3412,8 @@ void swap(configuration_query_by_node_request &a, configuration_query_by_node_re
     swap(a.node, b.node);
     swap(a.stored_replicas, b.stored_replicas);
     swap(a.info, b.info);
+    swap(a.last_sync_epoch, b.last_sync_epoch);
+    swap(a.last_sync_version, b.last_sync_version);
     swap(a.__isset, b.__isset);
 }
 
@@ -3383,6 +3423,8 @@ configuration_query_by_node_request::configuration_query_by_node_request(
     node = other108.node;
     stored_replicas = other108.stored_replicas;
     info = other108.info;
+    last_sync_epoch = other108.last_sync_epoch;
+    last_sync_version = other108.last_sync_version;
     __isset = other108.__isset;
 }
 configuration_query_by_node_request::configuration_query_by_node_request(
@@ -3391,6 +3433,8 @@ configuration_query_by_node_request::configuration_query_by_node_request(
     node = std::move(other109.node);
     stored_replicas = std::move(other109.stored_replicas);
     info = std::move(other109.info);
+    last_sync_epoch = std::move(other109.last_sync_epoch);
+    last_sync_version = std::move(other109.last_sync_version);
     __isset = std::move(other109.__isset);
 }
 configuration_query_by_node_request &configuration_query_by_node_request::
@@ -3399,6 +3443,8 @@ operator=(const configuration_query_by_node_request &other110)
     node = other110.node;
     stored_replicas = other110.stored_replicas;
     info = other110.info;
+    last_sync_epoch = other110.last_sync_epoch;
+    last_sync_version = other110.last_sync_version;
     __isset = other110.__isset;
     return *this;
 }
@@ -3408,6 +3454,8 @@ operator=(configuration_query_by_node_request &&other111)
     node = std::move(other111.node);
     stored_replicas = std::move(other111.stored_replicas);
     info = std::move(other111.info);
+    last_sync_epoch = std::move(other111.last_sync_epoch);
+    last_sync_version = std::move(other111.last_sync_version);
     __isset = std::move(other111.__isset);
     return *this;
 }
@@ -3422,6 +3470,12 @@ void configuration_query_by_node_request::printTo(std::ostream &out) const
     out << ", "
         << "info=";
     (__isset.info ? (out << to_string(info)) : (out << "<null>"));
+    out << ", "
+        << "last_sync_epoch=";
+    (__isset.last_sync_epoch ? (out << to_string(last_sync_epoch)) : (out << "<null>"));
+    out << ", "
+        << "last_sync_version=";
+    (__isset.last_sync_version ? (out << to_string(last_sync_version)) : (out << "<null>"));
     out << ")";
 }
 
@@ -3444,6 +3498,24 @@ void configuration_query_by_node_response::__set_gc_replicas(const std::vector<r
     __isset.gc_replicas = true;
 }
 
+void configuration_query_by_node_response::__set_sync_epoch(const int64_t val)
+{
+    this->sync_epoch = val;
+    __isset.sync_epoch = true;
+}
+
+void configuration_query_by_node_response::__set_sync_version(const int64_t val)
+{
+    this->sync_version = val;
+    __isset.sync_version = true;
+}
+
+void configuration_query_by_node_response::__set_is_delta(const bool val)
+{
+    this->is_delta = val;
+    __isset.is_delta = true;
+}
+
 uint32_t configuration_query_by_node_response::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -3509,6 +3581,30 @@ uint32_t configuration_query_by_node_response::read(::apache::thrift::protocol::
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 4:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->sync_epoch);
+                this->__isset.sync_epoch = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 5:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->sync_version);
+                this->__isset.sync_version = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 6:
+            if (ftype == ::apache::thrift::protocol::T_BOOL) {
+                xfer += iprot->readBool(this->is_delta);
+                this->__isset.is_delta = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -3558,6 +3654,21 @@ configuration_query_by_node_response::write(::apache::thrift::protocol::TProtoco
         }
         xfer += oprot->writeFieldEnd();
     }
+    if (this->__isset.sync_epoch) {
+        xfer += oprot->writeFieldBegin("sync_epoch", ::apache::thrift::protocol::T_I64, 4);
+        xfer += oprot->writeI64(this->sync_epoch);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.sync_version) {
+        xfer += oprot->writeFieldBegin("sync_version", ::apache::thrift::protocol::T_I64, 5);
+        xfer += oprot->writeI64(this->sync_version);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.is_delta) {
+        xfer += oprot->writeFieldBegin("is_delta", ::apache::thrift::protocol::T_BOOL, 6);
+        xfer += oprot->writeBool(this->is_delta);
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -3569,6 +3680,9 @@ void swap(configuration_query_by_node_response &a, configuration_query_by_node_r
     swap(a.err, b.err);
     swap(a.partitions, b.partitions);
     swap(a.gc_replicas, b.gc_replicas);
+    swap(a.sync_epoch, b.sync_epoch);
+    swap(a.sync_version, b.sync_version);
+    swap(a.is_delta, b.is_delta);
     swap(a.__isset, b.__isset);
 }
 
@@ -3578,6 +3692,9 @@ configuration_query_by_node_response::configuration_query_by_node_response(
     err = other124.err;
     partitions = other124.partitions;
     gc_replicas = other124.gc_replicas;
+    sync_epoch = other124.sync_epoch;
+    sync_version = other124.sync_version;
+    is_delta = other124.is_delta;
     __isset = other124.__isset;
 }
 configuration_query_by_node_response::configuration_query_by_node_response(
@@ -3586,6 +3703,9 @@ configuration_query_by_node_response::configuration_query_by_node_response(
     err = std::move(other125.err);
     partitions = std::move(other125.partitions);
     gc_replicas = std::move(other125.gc_replicas);
+    sync_epoch = std::move(other125.sync_epoch);
+    sync_version = std::move(other125.sync_version);
+    is_delta = std::move(other125.is_delta);
     __isset = std::move(other125.__isset);
 }
 configuration_query_by_node_response &configuration_query_by_node_response::
@@ -3594,6 +3714,9 @@ operator=(const configuration_query_by_node_response &other126)
     err = other126.err;
     partitions = other126.partitions;
     gc_replicas = other126.gc_replicas;
+    sync_epoch = other126.sync_epoch;
+    sync_version = other126.sync_version;
+    is_delta = other126.is_delta;
     __isset = other126.__isset;
     return *this;
 }
@@ -3603,6 +3726,9 @@ operator=(configuration_query_by_node_response &&other127)
     err = std::move(other127.err);
     partitions = std::move(other127.partitions);
     gc_replicas = std::move(other127.gc_replicas);
+    sync_epoch = std::move(other127.sync_epoch);
+    sync_version = std::move(other127.sync_version);
+    is_delta = std::move(other127.is_delta);
     __isset = std::move(other127.__isset);
     return *this;
 }
@@ -3616,6 +3742,15 @@ void configuration_query_by_node_response::printTo(std::ostream &out) const
     out << ", "
         << "gc_replicas=";
     (__isset.gc_replicas ? (out << to_string(gc_replicas)) : (out << "<null>"));
+    out << ", "
+        << "sync_epoch=";
+    (__isset.sync_epoch ? (out << to_string(sync_epoch)) : (out << "<null>"));
+    out << ", "
+        << "sync_version=";
+    (__isset.sync_version ? (out << to_string(sync_version)) : (out << "<null>"));
+    out << ", "
+        << "is_delta=";
+    (__isset.is_delta ? (out << to_string(is_delta)) : (out << "<null>"));
     out << ")";
 }
 
@@ -36,6 +36,7 @@
 #include "mutation.h"
 #include "mutation_log.h"
 #include "replica.h"
+#include <algorithm>
 
 namespace dsn {
 namespace replication {
@@ -47,7 +48,7 @@ mutation::mutation()
     next = nullptr;
     _private0 = 0;
     _not_logged = 1;
-    _prepare_ts_ms = 0;
+    _prepare_ts_us = 0;
     strcpy(_name, "0.0.0.0");
     _appro_data_bytes = sizeof(mutation_header);
     _create_ts_ns = dsn_now_ns();
@@ -125,14 +126,12 @@ void mutation::add_client_request(task_code code, dsn::message_ex *request)
             (dsn_msg_serialize_format)request->header->context.u.serialize_format;
         request->add_ref(); // released on dctor
 
-        void *ptr;
-        size_t size;
-        bool r = request->read_next(&ptr, &size);
+        // the data shares the request buffer, so that it can be sent without copy
+        bool r = request->read_next(update.data);
         dassert(r, "payload is not present");
         request->read_commit(0); // so we can re-read the request buffer in replicated app
-        update.data.assign((char *)ptr, 0, (int)size);
 
-        _appro_data_bytes += sizeof(int) + (int)size; // data size
+        _appro_data_bytes += sizeof(int) + update.data.length(); // data size
     } else {
         update.code = RPC_REPLICATION_WRITE_EMPTY;
         _appro_data_bytes += sizeof(int); // empty data size
@@ -184,12 +183,40 @@ void mutation::write_to(binary_writer &writer, dsn::message_ex * /*to*/) const
 
         writer.write_pod(static_cast<int>(update.data.length()));
     }
-    // TODO(qinzuoyan): directly append buffer to message to avoid memory copy
+    // the data are copied as the writer is a flat buffer, e.g., of the learn state; the
+    // messages share the data without copy, see serialize() and append_to()
     for (const mutation_update &update : data.updates) {
         writer.write(update.data.data(), update.data.length());
     }
 }
 
+std::vector<blob> mutation::serialize() const
+{
+    std::vector<blob> blobs;
+    blobs.reserve(data.updates.size() + 1);
+    write_to([&blobs](const blob &bb) { blobs.push_back(bb); });
+    return blobs;
+}
+
+/*static*/ void mutation::append_to(dsn::message_ex *to, const std::vector<blob> &blobs)
+{
+    // the small blobs are cheaper to copy than to be sent as separate buffers
+    static const int min_append_size = 4096;
+
+    for (const blob &bb : blobs) {
+        // the blobs not owning the buffer may not outlive the message
+        if (bb.length() >= min_append_size && bb.buffer_ptr() != nullptr) {
+            to->write_append(bb);
+        } else if (bb.length() > 0) {
+            void *ptr;
+            size_t size;
+            to->write_next(&ptr, &size, bb.length());
+            memcpy(ptr, bb.data(), bb.length());
+            to->write_commit(bb.length());
+        }
+    }
+}
+
 /*static*/ mutation_ptr mutation::read_from(binary_reader &reader, dsn::message_ex *from)
 {
     mutation_ptr mu(new mutation());
@@ -212,6 +239,7 @@ void mutation::write_to(binary_writer &writer, dsn::message_ex * /*to*/) const
 
         reader.read_pod(lengths[i]);
     }
+    // the data are ranges of the message buffer, without copy
     for (int i = 0; i < size; ++i) {
         reader.read(mu->data.updates[i].data, lengths[i]);
     }
@@ -311,6 +339,16 @@ mutation_queue::mutation_queue(gpid gpid,
 {
     _current_op_count = 0;
     _pending_mutation = nullptr;
+    _batch_bytes = 1024 * 1024;
+
+    _adaptive = false;
+    _max_concurrent_op_limit = max_concurrent_op;
+    _min_batch_bytes = _batch_bytes;
+    _max_batch_bytes = _batch_bytes;
+    _base_latency_us = 0;
+    _window_min_latency_us = 0;
+    _window_samples = 0;
+    _round_samples = 0;
     dassert(gpid.get_app_id() != 0, "invalid gpid");
     _pcount = dsn_task_queue_virtual_length_ptr(RPC_PREPARE, gpid.thread_hash());
 }
@@ -348,7 +386,7 @@ mutation_ptr mutation_queue::add_work(task_code code, dsn::message_ex *request,
 
     // check if need to switch work queue
     if (_batch_write_disabled || !spec->rpc_request_is_write_allow_batch ||
-        _pending_mutation->is_full()) {
+        _pending_mutation->is_full(_batch_bytes)) {
         _pending_mutation->add_ref(); // released when unlink
         _hdr.add(_pending_mutation);
         _pending_mutation = nullptr;
@@ -397,6 +435,52 @@ mutation_ptr mutation_queue::check_possible_work(int current_running_count)
     }
 }
 
+void mutation_queue::enable_adaptive(int max_batch_bytes)
+{
+    _adaptive = true;
+    _max_batch_bytes = std::max(max_batch_bytes, _min_batch_bytes);
+}
+
+void mutation_queue::on_mutation_committed(uint64_t commit_latency_us)
+{
+    // the base latency is refreshed every window, to follow the changes of the environment
+    static const int window_size = 256;
+    // the latency above which the mutations are considered queued rather than pipelined
+    static const int latency_tolerance = 2;
+
+    if (!_adaptive) {
+        return;
+    }
+
+    if (_window_samples == 0 || commit_latency_us < _window_min_latency_us) {
+        _window_min_latency_us = commit_latency_us;
+    }
+    if (++_window_samples >= window_size || _base_latency_us == 0) {
+        _base_latency_us = std::max(_window_min_latency_us, (uint64_t)1);
+        _window_samples = 0;
+    }
+
+    // adjust once a round, i.e., when the mutations in flight since the last adjustment are
+    // committed, which is the AIMD of tcp congestion control
+    if (++_round_samples < _max_concurrent_op) {
+        return;
+    }
+    _round_samples = 0;
+
+    if (commit_latency_us > _base_latency_us * latency_tolerance) {
+        // more mutations in flight only queue up in the network or the disks
+        _max_concurrent_op = std::max(1, _max_concurrent_op - (_max_concurrent_op + 3) / 4);
+        _batch_bytes = std::max(_min_batch_bytes, _batch_bytes / 2);
+    } else if (has_backlog()) {
+        // pipeline deeper first, and batch larger when it cannot be deeper
+        if (_max_concurrent_op < _max_concurrent_op_limit) {
+            _max_concurrent_op++;
+        } else {
+            _batch_bytes = std::min(_max_batch_bytes, _batch_bytes * 2);
+        }
+    }
+}
+
 void mutation_queue::clear()
 {
     if (_pending_mutation != nullptr) {
@@ -81,7 +81,7 @@ public:
     node_tasks &remote_tasks() { return _prepare_or_commit_tasks; }
     bool is_prepare_close_to_timeout(int gap_ms, int timeout_ms)
     {
-        return dsn_now_ms() + gap_ms >= _prepare_ts_ms + timeout_ms;
+        return dsn_now_ms() + gap_ms >= prepare_ts_ms() + timeout_ms;
     }
     uint64_t create_ts_ns() const { return _create_ts_ns; }
     ballot get_ballot() const { return data.header.ballot; }
@@ -109,11 +109,11 @@ public:
     }
     int clear_prepare_or_commit_tasks();
     void wait_log_task() const;
-    uint64_t prepare_ts_ms() const { return _prepare_ts_ms; }
-    void set_prepare_ts() { _prepare_ts_ms = dsn_now_ms(); }
+    uint64_t prepare_ts_ms() const { return _prepare_ts_us / 1000; }
+    uint64_t prepare_ts_us() const { return _prepare_ts_us; }
+    void set_prepare_ts() { _prepare_ts_us = dsn_now_us(); }
 
-    // >= 1 MB
-    bool is_full() const { return _appro_data_bytes >= 1024 * 1024; }
+    bool is_full(int max_bytes) const { return _appro_data_bytes >= max_bytes; }
     int appro_data_bytes() const { return _appro_data_bytes; }
 
     // read & write mutation data
@@ -126,6 +126,12 @@ public:
     void write_to(binary_writer &writer, dsn::message_ex *to) const;
     static mutation_ptr read_from(binary_reader &reader, dsn::message_ex *from);
 
+    // serialize the mutation once into the blobs sharing the update data, which may be
+    // appended to several messages by append_to(), e.g., the prepare messages to the peers
+    std::vector<blob> serialize() const;
+    // the large blobs are appended without copy, the others are copied into the message
+    static void append_to(dsn::message_ex *to, const std::vector<blob> &blobs);
+
     static void write_mutation_header(binary_writer &writer, const mutation_header &header);
     static void read_mutation_header(binary_reader &reader, mutation_header &header);
 
@@ -150,7 +156,7 @@ private:
         uint32_t _private0;
     };
 
-    uint64_t _prepare_ts_ms;
+    uint64_t _prepare_ts_us;
     ::dsn::task_ptr _log_task;
     node_tasks _prepare_or_commit_tasks;
     std::vector<dsn::message_ex *> _prepare_requests; // may combine duplicate requests
@@ -196,6 +202,15 @@ public:
     // which triggers further round of operations as returned
     mutation_ptr check_possible_work(int current_running_count);
 
+    // adapt the count of the concurrent mutations and the batch size to the commit latency,
+    // the count is within [1, max_concurrent_op] and the size is within [1MB, max_batch_bytes]
+    void enable_adaptive(int max_batch_bytes);
+    // called on the primary when a mutation is committed
+    void on_mutation_committed(uint64_t commit_latency_us);
+
+    int max_concurrent_op() const { return _max_concurrent_op; }
+    int batch_bytes() const { return _batch_bytes; }
+
 private:
     mutation_ptr unlink_next_workload()
     {
@@ -209,10 +224,26 @@ private:
 
     void reset_max_concurrent_ops(int max_c) { _max_concurrent_op = max_c; }
 
+    bool has_backlog() const { return !_hdr.is_empty() || _pending_mutation != nullptr; }
+
 private:
     int _current_op_count;
     int _max_concurrent_op;
     bool _batch_write_disabled;
+    int _batch_bytes;
+
+    // for the adaptive 2pc
+    bool _adaptive;
+    int _max_concurrent_op_limit;
+    int _min_batch_bytes;
+    int _max_batch_bytes;
+    // the least commit latency of the last window, which is taken as the latency without
+    // queuing, and the window being sampled
+    uint64_t _base_latency_us;
+    uint64_t _window_min_latency_us;
+    int _window_samples;
+    // commits since the last adjustment
+    int _round_samples;
 
     volatile int *_pcount;
     mutation_ptr _pending_mutation;
@@ -37,14 +37,66 @@
 #ifdef _WIN32
 #include <io.h>
 #endif
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifndef O_DIRECT
+#define O_DIRECT 0
+#endif
 #include "replica.h"
 #include <dsn/utility/filesystem.h>
 #include <dsn/utility/crc.h>
+#include <dsn/utility/defer.h>
 #include <dsn/tool-api/async_calls.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 namespace dsn {
 namespace replication {
 
+mutation_log_shared::mutation_log_shared(const std::string &dir,
+                                         int32_t max_log_file_mb,
+                                         bool force_flush,
+                                         int replay_thread_count,
+                                         uint32_t group_commit_max_bytes,
+                                         uint64_t group_commit_max_wait_us)
+    : mutation_log(dir, max_log_file_mb, dsn::gpid(), nullptr),
+      _is_writing(false),
+      _pending_write_start_offset(0),
+      _pending_write_start_time_us(0),
+      _force_flush(force_flush),
+      _group_commit(force_flush && group_commit_max_wait_us > 0),
+      _group_commit_max_bytes(group_commit_max_bytes),
+      _group_commit_max_wait_us(group_commit_max_wait_us),
+      _group_commit_timer_armed(false),
+      _fsync_latency_avg_us(0)
+{
+    _replay_thread_count = replay_thread_count;
+
+    if (_group_commit) {
+        _counter_group_commit_size.init_app_counter("eon.replica_stub",
+                                                    "shared.log.group.commit.size(bytes)",
+                                                    COUNTER_TYPE_NUMBER_PERCENTILES,
+                                                    "bytes of each shared log group commit");
+        _counter_group_commit_latency.init_app_counter(
+            "eon.replica_stub",
+            "shared.log.group.commit.latency(us)",
+            COUNTER_TYPE_NUMBER_PERCENTILES,
+            "latency of each shared log group commit, from the first mutation "
+            "appended to the group flushed");
+        _counter_group_commit_mutations.init_app_counter(
+            "eon.replica_stub",
+            "shared.log.group.commit.mutations(Count)",
+            COUNTER_TYPE_NUMBER_PERCENTILES,
+            "mutation count of each shared log group commit, i.e., mutations per fsync");
+    }
+}
+
 ::dsn::task_ptr mutation_log_shared::append(mutation_ptr &mu,
                                             dsn::task_code callback_code,
                                             dsn::task_tracker *tracker,
@@ -65,6 +117,7 @@ namespace replication {
         _pending_write_callbacks.reset(new callbacks());
         _pending_write_mutations.reset(new mutations());
         _pending_write_start_offset = mark_new_offset(0, true).second;
+        _pending_write_start_time_us = dsn_now_us();
     }
 
     // save mutations
@@ -84,13 +137,61 @@ namespace replication {
 
     // start to write if possible
     if (!_is_writing.load(std::memory_order_acquire)) {
-        write_pending_mutations(true);
+        write_or_wait_pending_mutations();
     } else {
         _slock.unlock();
     }
     return cb;
 }
 
+void mutation_log_shared::write_or_wait_pending_mutations()
+{
+    if (group_commit_ready()) {
+        write_pending_mutations(true);
+        return;
+    }
+
+    if (!_group_commit_timer_armed) {
+        _group_commit_timer_armed = true;
+        uint64_t waited_us = dsn_now_us() - _pending_write_start_time_us;
+        uint64_t window_us = group_commit_window_us();
+        uint64_t delay_ms = window_us > waited_us ? (window_us - waited_us + 999) / 1000 : 0;
+        tasking::enqueue(LPC_MUTATION_LOG_PENDING_TIMER,
+                         &_tracker,
+                         [this]() { on_group_commit_timer(); },
+                         0,
+                         std::chrono::milliseconds(delay_ms));
+    }
+    _slock.unlock();
+}
+
+bool mutation_log_shared::group_commit_ready() const
+{
+    return !_group_commit || _pending_write->size() >= _group_commit_max_bytes ||
+           dsn_now_us() - _pending_write_start_time_us >= group_commit_window_us();
+}
+
+uint64_t mutation_log_shared::group_commit_window_us() const
+{
+    // waiting longer than the device takes to sync gains nothing: writes arriving
+    // during an in-flight fsync are batched anyway
+    return std::min(_group_commit_max_wait_us,
+                    _fsync_latency_avg_us.load(std::memory_order_relaxed) / 2);
+}
+
+void mutation_log_shared::on_group_commit_timer()
+{
+    _slock.lock();
+    _group_commit_timer_armed = false;
+    if (!_is_writing.load(std::memory_order_acquire) && _pending_write) {
+        // the window may have shrunk or grown since the timer is armed, but a group
+        // never waits twice, so write it out now
+        write_pending_mutations(true);
+    } else {
+        _slock.unlock();
+    }
+}
+
 void mutation_log_shared::flush() { flush_internal(-1); }
 
 void mutation_log_shared::flush_once() { flush_internal(1); }
@@ -125,7 +226,7 @@ void mutation_log_shared::write_pending_mutations(bool release_lock_required)
     dassert(!_is_writing.load(std::memory_order_relaxed), "");
     dassert(_pending_write != nullptr, "");
     dassert(_pending_write->size() > 0, "pending write size = %d", (int)_pending_write->size());
-    auto pr = mark_new_offset(_pending_write->size(), false);
+    auto pr = mark_new_offset(block_size_on_disk(_pending_write->size()), false);
     dassert(pr.second == _pending_write_start_offset,
             "%" PRId64 " VS %" PRId64 "",
             pr.second,
@@ -138,7 +239,9 @@ void mutation_log_shared::write_pending_mutations(bool release_lock_required)
     std::shared_ptr<callbacks> pwu = std::move(_pending_write_callbacks);
     std::shared_ptr<mutations> pmu = std::move(_pending_write_mutations);
     int64_t start_offset = _pending_write_start_offset;
+    uint64_t start_time_us = _pending_write_start_time_us;
     _pending_write_start_offset = 0;
+    _pending_write_start_time_us = 0;
 
     // seperate commit_log_block from within the lock
     _slock.unlock();
@@ -153,7 +256,8 @@ void mutation_log_shared::write_pending_mutations(bool release_lock_required)
           lf = pr.first,
           block = blk,
           callbacks = std::move(pwu),
-          mutations = std::move(pmu)
+          mutations = std::move(pmu),
+          start_time_us
         ](error_code err, size_t sz) mutable {
             dassert(_is_writing.load(std::memory_order_relaxed), "");
 
@@ -173,38 +277,77 @@ void mutation_log_shared::write_pending_mutations(bool release_lock_required)
                         hdr->length);
 
                 if (_force_flush) {
-                    // flush to ensure that shared log data synced to disk
+                    // flush to ensure that shared log data synced to disk, the callbacks
+                    // are notified after the flush is done
                     //
                     // FIXME : the file could have been closed
-                    lf->flush();
+                    uint64_t flush_start_us = dsn_now_us();
+                    size_t mutation_count = mutations->size();
+                    lf->flush_async(
+                        LPC_WRITE_REPLICATION_LOG_SHARED,
+                        &_tracker,
+                        [
+                          this,
+                          callbacks = std::move(callbacks),
+                          sz,
+                          mutation_count,
+                          start_time_us,
+                          flush_start_us
+                        ](error_code err, size_t) mutable {
+                            if (err != ERR_OK) {
+                                derror("flush shared log failed, err = %s", err.to_string());
+                            } else if (_group_commit) {
+                                uint64_t now_us = dsn_now_us();
+                                uint64_t fsync_us = now_us - flush_start_us;
+                                uint64_t avg_us =
+                                    _fsync_latency_avg_us.load(std::memory_order_relaxed);
+                                _fsync_latency_avg_us.store(
+                                    avg_us == 0 ? fsync_us : (avg_us * 7 + fsync_us) / 8,
+                                    std::memory_order_relaxed);
+
+                                _counter_group_commit_size->set(sz);
+                                _counter_group_commit_latency->set(now_us - start_time_us);
+                                _counter_group_commit_mutations->set(mutation_count);
+                            }
+                            on_write_done(callbacks, err, sz);
+                        },
+                        0);
+                    return;
                 }
             } else {
                 derror("write shared log failed, err = %s", err.to_string());
             }
 
-            // here we use _is_writing instead of _issued_write.expired() to check writing done,
-            // because the following callbacks may run before "block" released, which may cause
-            // the next init_prepare() not starting the write.
-            _is_writing.store(false, std::memory_order_relaxed);
+            on_write_done(callbacks, err, sz);
+        },
+        0);
+}
 
-            // notify the callbacks
-            // ATTENTION: callback may be called before this code block executed done.
-            for (auto &c : *callbacks) {
-                c->enqueue(err, sz);
-            }
+void mutation_log_shared::on_write_done(std::shared_ptr<callbacks> &cbs,
+                                        error_code err,
+                                        size_t sz)
+{
+    // here we use _is_writing instead of _issued_write.expired() to check writing done,
+    // because the following callbacks may run before "block" released, which may cause
+    // the next init_prepare() not starting the write.
+    _is_writing.store(false, std::memory_order_relaxed);
 
-            // start to write next if possible
-            if (err == ERR_OK) {
-                _slock.lock();
+    // notify the callbacks
+    // ATTENTION: callback may be called before this code block executed done.
+    for (auto &c : *cbs) {
+        c->enqueue(err, sz);
+    }
 
-                if (!_is_writing.load(std::memory_order_acquire) && _pending_write) {
-                    write_pending_mutations(true);
-                } else {
-                    _slock.unlock();
-                }
-            }
-        },
-        0);
+    // start to write next if possible
+    if (err == ERR_OK) {
+        _slock.lock();
+
+        if (!_is_writing.load(std::memory_order_acquire) && _pending_write) {
+            write_or_wait_pending_mutations();
+        } else {
+            _slock.unlock();
+        }
+    }
 }
 
 ////////////////////////////////////////////////////
@@ -336,7 +479,7 @@ void mutation_log_private::write_pending_mutations(bool release_lock_required)
     dassert(!_is_writing.load(std::memory_order_relaxed), "");
     dassert(_pending_write != nullptr, "");
     dassert(_pending_write->size() > 0, "pending write size = %d", (int)_pending_write->size());
-    auto pr = mark_new_offset(_pending_write->size(), false);
+    auto pr = mark_new_offset(block_size_on_disk(_pending_write->size()), false);
     dassert(pr.second == _pending_write_start_offset,
             "%" PRId64 " VS %" PRId64 "",
             pr.second,
@@ -385,55 +528,78 @@ void mutation_log_private::write_pending_mutations(bool release_lock_required)
                         hdr->length);
 
                 // flush to ensure that there is no gap between private log and in-memory buffer
-                // so that we can get all mutations in learning process.
+                // so that we can get all mutations in learning process, the mutations are
+                // pinned until the flush is done.
                 //
                 // FIXME : the file could have been closed
-                lf->flush();
-
-                // update _private_max_commit_on_disk after writen into log file done
-                update_max_commit_on_disk(max_commit);
+                lf->flush_async(
+                    LPC_WRITE_REPLICATION_LOG_PRIVATE,
+                    &_tracker,
+                    [ this, mutations = std::move(mutations), max_commit ](error_code err,
+                                                                            size_t) mutable {
+                        if (err != ERR_OK) {
+                            derror("flush private log failed, err = %s", err.to_string());
+                        }
+                        on_write_done(max_commit, err);
+                    },
+                    0);
+                return;
             } else {
                 derror("write private log failed, err = %s", err.to_string());
             }
 
-            // here we use _is_writing instead of _issued_write.expired() to check writing done,
-            // because the following callbacks may run before "block" released, which may cause
-            // the next init_prepare() not starting the write.
-            _is_writing.store(false, std::memory_order_relaxed);
-
-            // notify error when necessary
-            if (err != ERR_OK) {
-                if (_io_error_callback) {
-                    _io_error_callback(err);
-                }
-            } else {
-                // start to write if possible
-                _plock.lock();
-
-                if (!_is_writing.load(std::memory_order_acquire) && _pending_write &&
-                    (static_cast<uint32_t>(_pending_write->size()) >= _batch_buffer_bytes ||
-                     static_cast<uint32_t>(_pending_write->data().size()) >=
-                         _batch_buffer_max_count ||
-                     flush_interval_expired())) {
-                    write_pending_mutations(true);
-                } else {
-                    _plock.unlock();
-                }
-            }
+            on_write_done(max_commit, err);
         },
         0);
 }
 
+void mutation_log_private::on_write_done(decree max_commit, error_code err)
+{
+    if (err == ERR_OK) {
+        // update _private_max_commit_on_disk after writen into log file done
+        update_max_commit_on_disk(max_commit);
+    }
+
+    // here we use _is_writing instead of _issued_write.expired() to check writing done,
+    // because the following callbacks may run before "block" released, which may cause
+    // the next init_prepare() not starting the write.
+    _is_writing.store(false, std::memory_order_relaxed);
+
+    // notify error when necessary
+    if (err != ERR_OK) {
+        if (_io_error_callback) {
+            _io_error_callback(err);
+        }
+    } else {
+        // start to write if possible
+        _plock.lock();
+
+        if (!_is_writing.load(std::memory_order_acquire) && _pending_write &&
+            (static_cast<uint32_t>(_pending_write->size()) >= _batch_buffer_bytes ||
+             static_cast<uint32_t>(_pending_write->data().size()) >= _batch_buffer_max_count ||
+             flush_interval_expired())) {
+            write_pending_mutations(true);
+        } else {
+            _plock.unlock();
+        }
+    }
+}
+
 ///////////////////////////////////////////////////////////////
 
 mutation_log::mutation_log(const std::string &dir, int32_t max_log_file_mb, gpid gpid, replica *r)
 {
     _dir = dir;
     _is_private = (gpid.value() != 0);
+    _replay_thread_count = 1;
     _max_log_file_size_in_bytes = static_cast<int64_t>(max_log_file_mb) * 1024L * 1024L;
     _min_log_file_size_in_bytes = _max_log_file_size_in_bytes / 10;
     _owner_replica = r;
     _private_gpid = gpid;
+    _segment_pool_size = 0;
+    _segment_pool_next_id = 0;
+    _is_filling_segment_pool = false;
+    _direct_io = false;
 
     if (r) {
         dassert(_private_gpid == r->get_gpid(),
@@ -489,6 +655,13 @@ error_code mutation_log::open(replay_callback read_callback,
         }
     }
 
+    if (_segment_pool_size > 0) {
+        error_code pool_err = load_segment_pool();
+        if (pool_err != ERR_OK) {
+            return pool_err;
+        }
+    }
+
     // load the existing logs
     _log_files.clear();
     _io_error_callback = write_error_callback;
@@ -507,7 +680,7 @@ error_code mutation_log::open(replay_callback read_callback,
 
     error_code err = ERR_OK;
     for (auto &fpath : file_list) {
-        log_file_ptr log = log_file::open_read(fpath.c_str(), err);
+        log_file_ptr log = log_file::open_read(fpath.c_str(), err, _direct_io);
         if (log == nullptr) {
             if (err == ERR_HANDLE_EOF || err == ERR_INCOMPLETE_DATA ||
                 err == ERR_INVALID_PARAMETERS) {
@@ -543,6 +716,15 @@ error_code mutation_log::open(replay_callback read_callback,
 
     file_list.clear();
 
+    // the file size of a pre-allocated file tells nothing about how much is written, so
+    // it ends where the next file starts, while the last one ends where replay stops
+    for (auto it = _log_files.begin(); it != _log_files.end(); ++it) {
+        auto next = std::next(it);
+        if (next != _log_files.end()) {
+            it->second->on_next_file_opened(next->second->start_offset());
+        }
+    }
+
     // filter useless log
     std::map<int, log_file_ptr>::iterator replay_begin = _log_files.begin();
     std::map<int, log_file_ptr>::iterator replay_end = _log_files.end();
@@ -642,7 +824,8 @@ error_code mutation_log::open(replay_callback read_callback,
 
             return ret;
         },
-        end_offset);
+        end_offset,
+        _replay_thread_count);
 
     if (ERR_OK == err) {
         _global_start_offset =
@@ -693,10 +876,19 @@ void mutation_log::close()
 
 error_code mutation_log::create_new_log_file()
 {
-    // create file
+    // create file, reuse a pooled segment if any
     uint64_t start = dsn_now_ns();
-    log_file_ptr logf =
-        log_file::create_write(_dir.c_str(), _last_file_index + 1, _global_end_offset);
+    std::string segment_path;
+    if (!_segment_pool.empty()) {
+        segment_path = _segment_pool.front();
+        _segment_pool.pop_front();
+    }
+    log_file_ptr logf = log_file::create_write(_dir.c_str(),
+                                               _last_file_index + 1,
+                                               _global_end_offset,
+                                               segment_path.empty() ? nullptr
+                                                                    : segment_path.c_str(),
+                                               _direct_io);
     if (logf == nullptr) {
         derror("cannot create log file with index %d", _last_file_index + 1);
         return ERR_FILE_OPERATION_FAILED;
@@ -739,7 +931,7 @@ error_code mutation_log::create_new_log_file()
 
     log_block *blk = logf->prepare_log_block();
     blk->add(temp_writer.get_buffer());
-    _global_end_offset += blk->size();
+    _global_end_offset += block_size_on_disk(blk->size());
 
     logf->commit_log_block(*blk,
                            _current_log_file->start_offset(),
@@ -762,7 +954,8 @@ error_code mutation_log::create_new_log_file()
                            0);
 
     dassert(_global_end_offset ==
-                _current_log_file->start_offset() + sizeof(log_block_header) + header_len,
+                _current_log_file->start_offset() +
+                    block_size_on_disk(sizeof(log_block_header) + header_len),
             "%" PRId64 " VS %" PRId64 "(%" PRId64 " + %d + %d)",
             _global_end_offset,
             _current_log_file->start_offset() + sizeof(log_block_header) + header_len,
@@ -839,7 +1032,7 @@ std::pair<log_file_ptr, int64_t> mutation_log::mark_new_offset(size_t size,
     }
 
     std::shared_ptr<binary_reader> reader(new binary_reader(std::move(bb)));
-    end_offset += sizeof(log_block_header);
+    end_offset = log->start_offset() + log->read_offset() - reader->get_remaining_size();
 
     // read file header
     end_offset += log->read_file_header(*reader);
@@ -872,11 +1065,17 @@ std::pair<log_file_ptr, int64_t> mutation_log::mark_new_offset(size_t size,
         err = log->read_next_log_block(bb);
         if (err != ERR_OK) {
             // if an error occurs in an log mutation block, then the replay log is stopped
+            if (err == ERR_HANDLE_EOF) {
+                // including the padding of the last block
+                end_offset = log->start_offset() + log->read_offset();
+            }
             break;
         }
 
+        // the data of the block starts after the block header, and the padding of the
+        // previous block if it is aligned
         reader.reset(new binary_reader(std::move(bb)));
-        end_offset += sizeof(log_block_header);
+        end_offset = log->start_offset() + log->read_offset() - reader->get_remaining_size();
     }
 
     ddebug("finish to replay mutation log %s, err = %s", log->path().c_str(), err.to_string());
@@ -909,19 +1108,128 @@ std::pair<log_file_ptr, int64_t> mutation_log::mark_new_offset(size_t size,
     return replay(logs, callback, end_offset);
 }
 
+//------------------- mutation_log::parallel_log_decoder --------------------------
+// reads and decodes the log files with several threads, at most 'window' files ahead of the
+// one being consumed, so that the memory usage is bounded
+class mutation_log::parallel_log_decoder
+{
+public:
+    // the mutations of a log file decoded ahead of time by the replay threads
+    struct decoded_log_file
+    {
+        typedef std::vector<std::pair<int, mutation_ptr>> mutations;
+
+        log_file_ptr log;
+        bool done;
+        error_code err;
+        int64_t end_offset;
+        mutations mus;
+
+        decoded_log_file() : done(false), end_offset(0) {}
+    };
+
+    parallel_log_decoder(std::map<int, log_file_ptr> &logs, int thread_count)
+        : _files(logs.size()), _next_decode(0), _next_consume(0), _stopped(false)
+    {
+        size_t index = 0;
+        for (auto &kv : logs) {
+            _files[index++].log = kv.second;
+        }
+
+        _window = thread_count * 2;
+        service_node *node = task::get_current_node2();
+        for (int i = 0; i < thread_count; i++) {
+            _threads.emplace_back([this, node]() {
+                task::set_tls_dsn_context(node, nullptr);
+                decode_files();
+            });
+        }
+    }
+
+    ~parallel_log_decoder()
+    {
+        {
+            std::lock_guard<std::mutex> l(_lock);
+            _stopped = true;
+        }
+        _cond.notify_all();
+        for (auto &t : _threads) {
+            t.join();
+        }
+    }
+
+    // wait until the i-th file is decoded, and the ones before it must have been consumed
+    decoded_log_file &wait(size_t i)
+    {
+        std::unique_lock<std::mutex> l(_lock);
+        _next_consume = i;
+        _cond.notify_all();
+        _cond.wait(l, [this, i]() { return _files[i].done; });
+        return _files[i];
+    }
+
+private:
+    void decode_files()
+    {
+        while (true) {
+            size_t i;
+            {
+                std::unique_lock<std::mutex> l(_lock);
+                _cond.wait(l, [this]() {
+                    return _stopped || _next_decode >= _files.size() ||
+                           _next_decode < _next_consume + _window;
+                });
+                if (_stopped || _next_decode >= _files.size()) {
+                    return;
+                }
+                i = _next_decode++;
+            }
+
+            decoded_log_file &f = _files[i];
+            decoded_log_file::mutations mus;
+            int64_t end_offset = 0;
+            error_code err = mutation_log::replay(f.log,
+                                                  [&mus](int log_length, mutation_ptr &mu) {
+                                                      mus.emplace_back(log_length, mu);
+                                                      return true;
+                                                  },
+                                                  end_offset);
+            f.log->close();
+
+            {
+                std::lock_guard<std::mutex> l(_lock);
+                f.err = err;
+                f.end_offset = end_offset;
+                f.mus = std::move(mus);
+                f.done = true;
+            }
+            _cond.notify_all();
+        }
+    }
+
+    std::vector<decoded_log_file> _files;
+    std::vector<std::thread> _threads;
+    size_t _window;
+
+    std::mutex _lock;
+    std::condition_variable _cond;
+    size_t _next_decode;
+    size_t _next_consume;
+    bool _stopped;
+};
+
 /*static*/ error_code mutation_log::replay(std::map<int, log_file_ptr> &logs,
                                            replay_callback callback,
-                                           /*out*/ int64_t &end_offset)
+                                           /*out*/ int64_t &end_offset,
+                                           int thread_count /*= 1*/)
 {
     int64_t g_start_offset = 0;
-    int64_t g_end_offset = 0;
     error_code err = ERR_OK;
     log_file_ptr last;
     int last_file_index = 0;
 
     if (logs.size() > 0) {
         g_start_offset = logs.begin()->second->start_offset();
-        g_end_offset = logs.rbegin()->second->end_offset();
         last_file_index = logs.begin()->first - 1;
     }
 
@@ -935,8 +1243,17 @@ std::pair<log_file_ptr, int64_t> mutation_log::mark_new_offset(size_t size,
 
     end_offset = g_start_offset;
 
-    for (auto &kv : logs) {
-        log_file_ptr &log = kv.second;
+    thread_count = std::min(thread_count, static_cast<int>(logs.size()));
+    std::unique_ptr<parallel_log_decoder> decoder;
+    if (thread_count > 1) {
+        decoder.reset(new parallel_log_decoder(logs, thread_count));
+    }
+
+    uint64_t start_time_ns = dsn_now_ns();
+    uint64_t wait_time_ns = 0;
+    size_t i = 0;
+    for (auto it = logs.begin(); it != logs.end(); ++it, ++i) {
+        log_file_ptr &log = it->second;
 
         if (log->start_offset() != end_offset) {
             derror("offset mismatch in log file offset and global offset %" PRId64 " vs %" PRId64,
@@ -946,9 +1263,23 @@ std::pair<log_file_ptr, int64_t> mutation_log::mark_new_offset(size_t size,
         }
 
         last = log;
-        err = mutation_log::replay(log, callback, end_offset);
+        if (decoder != nullptr) {
+            uint64_t wait_start_ns = dsn_now_ns();
+            parallel_log_decoder::decoded_log_file &f = decoder->wait(i);
+            wait_time_ns += dsn_now_ns() - wait_start_ns;
 
-        log->close();
+            for (auto &mu : f.mus) {
+                callback(mu.first, mu.second);
+            }
+            f.mus.clear();
+            f.mus.shrink_to_fit();
+
+            err = f.err;
+            end_offset = f.end_offset;
+        } else {
+            err = mutation_log::replay(log, callback, end_offset);
+            log->close();
+        }
 
         if (err == ERR_OK || err == ERR_HANDLE_EOF) {
             // do nothing
@@ -962,8 +1293,21 @@ std::pair<log_file_ptr, int64_t> mutation_log::mark_new_offset(size_t size,
         }
     }
 
+    if (decoder != nullptr) {
+        uint64_t time_used_ns = std::max(dsn_now_ns() - start_time_ns, (uint64_t)1);
+        ddebug("replay %d log files with %d threads, size = %" PRId64 ", time_used = %" PRIu64
+               " ms (%" PRIu64 " ms waiting for decoding), throughput = %.2f MB/s",
+               static_cast<int>(logs.size()),
+               thread_count,
+               end_offset - g_start_offset,
+               time_used_ns / 1000000,
+               wait_time_ns / 1000000,
+               (end_offset - g_start_offset) * 1000.0 / time_used_ns);
+    }
+
     if (err == ERR_OK || err == ERR_HANDLE_EOF) {
         // the log may still be written when used for learning
+        int64_t g_end_offset = logs.size() > 0 ? logs.rbegin()->second->end_offset() : 0;
         dassert(g_end_offset <= end_offset,
                 "make sure the global end offset is correct: %" PRId64 " vs %" PRId64,
                 g_end_offset,
@@ -1427,6 +1771,15 @@ int mutation_log::garbage_collection(const replica_log_info_map &gc_condition,
 {
     dassert(!_is_private, "this method is only valid for shared log");
 
+    // clearing the recycled files and pre-allocating segments take sync writes, which are
+    // left to the log's own task not to delay the gc
+    auto fill_pool = dsn::defer([this]() {
+        if (_segment_pool_size > 0) {
+            tasking::enqueue(
+                LPC_FILL_LOG_SEGMENT_POOL, &_tracker, [this]() { fill_segment_pool(); });
+        }
+    });
+
     std::map<int, log_file_ptr> files;
     replica_log_info_map max_decrees;
     int current_log_index = -1;
@@ -1657,7 +2010,7 @@ int mutation_log::garbage_collection(const replica_log_info_map &gc_condition,
 
         // delete file
         auto &fpath = log->path();
-        if (!dsn::utils::filesystem::remove_path(fpath)) {
+        if (!recycle_or_remove_log_file(fpath)) {
             derror("gc_shared: fail to remove %s, stop current gc cycle ...", fpath.c_str());
             break;
         }
@@ -1739,6 +2092,248 @@ int mutation_log::garbage_collection(const replica_log_info_map &gc_condition,
     return reserved_log_count;
 }
 
+void mutation_log::set_direct_io(bool direct_io)
+{
+    dassert(!_is_opened, "direct io must be set before open");
+    _direct_io = direct_io;
+}
+
+size_t mutation_log::block_size_on_disk(size_t size) const
+{
+    return _direct_io ? (size + LOG_FILE_ALIGNMENT - 1) / LOG_FILE_ALIGNMENT * LOG_FILE_ALIGNMENT
+                      : size;
+}
+
+void mutation_log::set_segment_pool_size(int count)
+{
+    dassert(!_is_private, "segment pool is only valid for shared log");
+    dassert(!_is_opened, "segment pool size must be set before open");
+#ifdef __linux__
+    _segment_pool_size = count;
+#else
+    if (count > 0) {
+        dwarn("segment pool is not supported on this platform");
+    }
+#endif
+}
+
+std::string mutation_log::segment_pool_dir() const
+{
+    return utils::filesystem::path_combine(_dir, "segment_pool");
+}
+
+error_code mutation_log::load_segment_pool()
+{
+    std::string pool_dir = segment_pool_dir();
+    if (!utils::filesystem::directory_exists(pool_dir) &&
+        !utils::filesystem::create_directory(pool_dir)) {
+        derror("create segment pool dir %s failed", pool_dir.c_str());
+        return ERR_FILE_OPERATION_FAILED;
+    }
+
+    std::vector<std::string> file_list;
+    if (!utils::filesystem::get_subfiles(pool_dir, file_list, false)) {
+        derror("get subfiles of segment pool dir %s failed", pool_dir.c_str());
+        return ERR_FILE_OPERATION_FAILED;
+    }
+
+    zauto_lock l(_lock);
+    _segment_pool.clear();
+    _recycled_segments.clear();
+    _segment_pool_next_id = 0;
+    for (auto &fpath : file_list) {
+        // segment.{id}, or segment.{id}.tmp if the pre-allocation is not done
+        std::string name = utils::filesystem::get_file_name(fpath);
+        char *p = nullptr;
+        int id = -1;
+        if (name.compare(0, strlen("segment."), "segment.") == 0) {
+            id = static_cast<int>(strtol(name.c_str() + strlen("segment."), &p, 10));
+        }
+        if (id < 0 || *p != 0) {
+            dwarn("remove uncompleted or unknown segment file %s", fpath.c_str());
+            utils::filesystem::remove_path(fpath);
+            continue;
+        }
+
+        _segment_pool_next_id = std::max(_segment_pool_next_id, id + 1);
+        if (static_cast<int>(_segment_pool.size()) < _segment_pool_size) {
+            _segment_pool.push_back(fpath);
+        } else {
+            utils::filesystem::remove_path(fpath);
+        }
+    }
+
+    ddebug("load %d segment files from %s", (int)_segment_pool.size(), pool_dir.c_str());
+    return ERR_OK;
+}
+
+void mutation_log::fill_segment_pool()
+{
+    {
+        zauto_lock l(_lock);
+        if (_is_filling_segment_pool) {
+            return;
+        }
+        _is_filling_segment_pool = true;
+    }
+
+    while (true) {
+        std::string tmp_path;
+        bool is_recycled = false;
+        {
+            zauto_lock l(_lock);
+            if (_is_opened && !_recycled_segments.empty()) {
+                tmp_path = _recycled_segments.front();
+                is_recycled = true;
+            } else if (_is_opened &&
+                       static_cast<int>(_segment_pool.size()) < _segment_pool_size) {
+                tmp_path = utils::filesystem::path_combine(
+                    segment_pool_dir(),
+                    "segment." + std::to_string(_segment_pool_next_id++) + ".tmp");
+            } else {
+                _is_filling_segment_pool = false;
+                return;
+            }
+        }
+
+        // rename after it is filled, so that a crash in the middle leaves only a tmp file;
+        // only the first block header of a recycled file is cleared, see prepare_segment()
+        uint64_t start = dsn_now_ns();
+        std::string segment_path = tmp_path.substr(0, tmp_path.size() - strlen(".tmp"));
+        bool ok = log_file::prepare_segment(tmp_path, _max_log_file_size_in_bytes) &&
+                  utils::filesystem::rename_path(tmp_path, segment_path);
+        if (ok) {
+            ddebug("%s segment file %s succeed, size = %" PRId64 ", time_used = %" PRIu64 " ns",
+                   is_recycled ? "clear recycled" : "pre-allocate",
+                   segment_path.c_str(),
+                   _max_log_file_size_in_bytes,
+                   dsn_now_ns() - start);
+        } else {
+            derror("%s segment file %s failed",
+                   is_recycled ? "clear recycled" : "pre-allocate",
+                   segment_path.c_str());
+            utils::filesystem::remove_path(tmp_path);
+        }
+
+        zauto_lock l(_lock);
+        if (is_recycled) {
+            _recycled_segments.pop_front();
+        }
+        if (ok) {
+            _segment_pool.push_back(segment_path);
+        } else if (!is_recycled) {
+            _is_filling_segment_pool = false;
+            return;
+        }
+    }
+}
+
+bool mutation_log::recycle_or_remove_log_file(const std::string &fpath)
+{
+    std::string tmp_path;
+    {
+        zauto_lock l(_lock);
+        if (static_cast<int>(_segment_pool.size() + _recycled_segments.size()) <
+            _segment_pool_size) {
+            tmp_path = utils::filesystem::path_combine(
+                segment_pool_dir(),
+                "segment." + std::to_string(_segment_pool_next_id++) + ".tmp");
+        }
+    }
+
+    // the file is moved out of the log dir at once, while clearing its first block header
+    // takes a sync write which is left to fill_segment_pool(); a tmp file is removed
+    // instead of being pooled if we crash before that
+    if (!tmp_path.empty()) {
+        if (utils::filesystem::rename_path(fpath, tmp_path)) {
+            ddebug("recycle log file %s to %s", fpath.c_str(), tmp_path.c_str());
+            zauto_lock l(_lock);
+            _recycled_segments.push_back(tmp_path);
+            return true;
+        }
+        dwarn("recycle log file %s failed, remove it instead", fpath.c_str());
+    }
+
+    return utils::filesystem::remove_path(fpath);
+}
+
+// pooled buffers aligned to LOG_FILE_ALIGNMENT for direct io, which are rounded up to
+// power-of-two size classes, and each class keeps at most max_cached_bytes_per_class
+// bytes of free buffers
+class aligned_buffer_pool
+{
+public:
+    static aligned_buffer_pool &instance()
+    {
+        // never destroyed, as buffers may be released during static destruction
+        static aligned_buffer_pool *pool = new aligned_buffer_pool();
+        return *pool;
+    }
+
+    std::shared_ptr<char> allocate(size_t size)
+    {
+        int cls = size_class(size);
+        char *buffer = nullptr;
+        {
+            std::lock_guard<std::mutex> l(_lock);
+            auto &free_list = _free_lists[cls];
+            if (!free_list.empty()) {
+                buffer = free_list.back();
+                free_list.pop_back();
+            }
+        }
+
+        if (buffer == nullptr) {
+#ifdef _WIN32
+            buffer = (char *)_aligned_malloc(class_bytes(cls), LOG_FILE_ALIGNMENT);
+            dassert(buffer != nullptr, "_aligned_malloc %" PRIu64 " bytes failed", class_bytes(cls));
+#else
+            void *ptr = nullptr;
+            int r = posix_memalign(&ptr, LOG_FILE_ALIGNMENT, class_bytes(cls));
+            dassert(r == 0, "posix_memalign %" PRIu64 " bytes failed, err = %d", class_bytes(cls), r);
+            buffer = (char *)ptr;
+#endif
+        }
+        return std::shared_ptr<char>(buffer, [this, cls](char *p) { release(p, cls); });
+    }
+
+private:
+    static const int max_size_class = 24;
+    static const uint64_t max_cached_bytes_per_class = 16 * 1024 * 1024;
+
+    static uint64_t class_bytes(int cls) { return (uint64_t)LOG_FILE_ALIGNMENT << cls; }
+
+    static int size_class(size_t size)
+    {
+        int cls = 0;
+        while (class_bytes(cls) < size) {
+            cls++;
+        }
+        dassert(cls < max_size_class, "buffer size is too large: %" PRIu64, (uint64_t)size);
+        return cls;
+    }
+
+    void release(char *buffer, int cls)
+    {
+        {
+            std::lock_guard<std::mutex> l(_lock);
+            auto &free_list = _free_lists[cls];
+            if ((free_list.size() + 1) * class_bytes(cls) <= max_cached_bytes_per_class) {
+                free_list.push_back(buffer);
+                return;
+            }
+        }
+#ifdef _WIN32
+        _aligned_free(buffer);
+#else
+        free(buffer);
+#endif
+    }
+
+    std::mutex _lock;
+    std::vector<char *> _free_lists[max_size_class];
+};
+
 // log_file::file_streamer
 class log_file::file_streamer
 {
@@ -1793,27 +2388,18 @@ public:
             _current_buffer->_begin += size;
         } else {
             _current_buffer->drain(writer);
-            // we can now assign result since writer must have allocated a buffer.
-            dassert(writer.total_size() != 0, "writer.total_size = %d", writer.total_size());
-            if (size > writer.total_size()) {
-                TRY(_next_buffer->wait_ongoing_task());
-                _next_buffer->consume(writer,
-                                      std::min(size - writer.total_size(), _next_buffer->length()));
-                // We hope that this never happens, it would deteriorate performance
-                if (size > writer.total_size()) {
-                    auto task =
-                        file::read(_file_handle,
-                                   writer.get_current_buffer().buffer().get() + writer.total_size(),
-                                   size - writer.total_size(),
-                                   _file_dispatched_bytes,
-                                   LPC_AIO_IMMEDIATE_CALLBACK,
-                                   nullptr,
-                                   nullptr);
-                    task->wait();
-                    writer.write_empty(task->get_transferred_size());
-                    _file_dispatched_bytes += task->get_transferred_size();
-                    TRY(task->error());
+            // keep reading whole buffers rather than the remaining bytes at an arbitrary
+            // offset, so that the reads are always aligned for direct io;
+            // we hope that more than one buffer is rarely needed.
+            while (size > writer.total_size()) {
+                fill_buffers();
+                TRY(_current_buffer->wait_ongoing_task());
+                if (_current_buffer->empty()) {
+                    result = writer.get_current_buffer();
+                    return ERR_HANDLE_EOF;
                 }
+                _current_buffer->consume(
+                    writer, std::min(size - writer.total_size(), _current_buffer->length()));
             }
             result = writer.get_current_buffer();
         }
@@ -1845,14 +2431,14 @@ private:
     static const size_t block_size_bytes = 1024 * 1024;
     struct buffer_t
     {
-        std::unique_ptr<char[]> _buffer; // with block_size
+        std::shared_ptr<char> _buffer;  // with block_size, aligned for direct io
         size_t _begin, _end;             // [buffer[begin]..buffer[end]) contains unconsumed_data
         size_t _file_offset_of_buffer;   // file offset projected to buffer[0]
         bool _have_ongoing_task;
         aio_task_ptr _task;
 
         buffer_t()
-            : _buffer(new char[block_size_bytes]),
+            : _buffer(aligned_buffer_pool::instance().allocate(block_size_bytes)),
               _begin(0),
               _end(0),
               _file_offset_of_buffer(0),
@@ -1894,7 +2480,9 @@ private:
 
 //------------------- log_file --------------------------
 log_file::~log_file() { close(); }
-/*static */ log_file_ptr log_file::open_read(const char *path, /*out*/ error_code &err)
+/*static */ log_file_ptr log_file::open_read(const char *path,
+                                             /*out*/ error_code &err,
+                                             bool direct_io /*= false*/)
 {
     char splitters[] = {'\\', '/', 0};
     std::string name = utils::get_last_component(std::string(path), splitters);
@@ -1938,7 +2526,16 @@ log_file::~log_file() { close(); }
         return nullptr;
     }
 
-    disk_file *hfile = file::open(path, O_RDONLY | O_BINARY, 0);
+    disk_file *hfile = nullptr;
+    if (direct_io && O_DIRECT != 0) {
+        hfile = file::open(path, O_RDONLY | O_BINARY | O_DIRECT, 0);
+        if (!hfile) {
+            dwarn("open log file %s with direct io failed, fall back to buffered io", path);
+        }
+    }
+    if (!hfile) {
+        hfile = file::open(path, O_RDONLY | O_BINARY, 0);
+    }
     if (!hfile) {
         err = ERR_FILE_OPERATION_FAILED;
         dwarn("open log file %s failed", path);
@@ -1984,7 +2581,11 @@ log_file::~log_file() { close(); }
     return lf;
 }
 
-/*static*/ log_file_ptr log_file::create_write(const char *dir, int index, int64_t start_offset)
+/*static*/ log_file_ptr log_file::create_write(const char *dir,
+                                               int index,
+                                               int64_t start_offset,
+                                               const char *segment_path /*= nullptr*/,
+                                               bool direct_io /*= false*/)
 {
     char path[512];
     sprintf(path, "%s/log.%d.%" PRId64, dir, index, start_offset);
@@ -1994,13 +2595,82 @@ log_file::~log_file() { close(); }
         return nullptr;
     }
 
-    disk_file *hfile = file::open(path, O_RDWR | O_CREAT | O_BINARY, 0666);
+    bool is_preallocated = false;
+    if (segment_path != nullptr) {
+        is_preallocated = dsn::utils::filesystem::rename_path(segment_path, path);
+        if (!is_preallocated) {
+            dwarn("reuse segment file %s as log %s failed, create a new one", segment_path, path);
+            dsn::utils::filesystem::remove_path(segment_path);
+        }
+    }
+
+    // the blocks are padded even if falling back to buffered io, because their offsets
+    // are already aligned in the global space
+    disk_file *hfile = nullptr;
+    if (direct_io && O_DIRECT != 0) {
+        hfile = file::open(path, O_RDWR | O_CREAT | O_BINARY | O_DIRECT, 0666);
+        if (!hfile) {
+            dwarn("create log %s with direct io failed, fall back to buffered io", path);
+        }
+    }
+    if (!hfile) {
+        hfile = file::open(path, O_RDWR | O_CREAT | O_BINARY, 0666);
+    }
     if (!hfile) {
         dwarn("create log %s failed", path);
         return nullptr;
     }
 
-    return new log_file(path, hfile, index, start_offset, false);
+    auto lf = new log_file(path, hfile, index, start_offset, false);
+    lf->_is_preallocated = is_preallocated;
+    lf->_is_aligned = direct_io;
+    return lf;
+}
+
+/*static*/ bool log_file::prepare_segment(const std::string &path, int64_t size)
+{
+#ifdef __linux__
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0666);
+    if (fd < 0) {
+        derror("open segment file %s failed, err = %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    bool ok = (::fstat(fd, &st) == 0);
+    int64_t old_size = ok ? static_cast<int64_t>(st.st_size) : 0;
+
+    // fallocate is only a hint, the space is zero-filled anyway so that no extent
+    // conversion is needed when it is written as the log later
+    if (ok && size > old_size && ::fallocate(fd, 0, old_size, size - old_size) != 0) {
+        dwarn("fallocate segment file %s failed, err = %s", path.c_str(), strerror(errno));
+    }
+
+    const int64_t zero_buffer_size = 1024 * 1024;
+    std::unique_ptr<char[]> zeros(new char[zero_buffer_size]());
+    auto zero_fill = [&](int64_t begin, int64_t end) {
+        while (begin < end) {
+            ssize_t n = ::pwrite(fd, zeros.get(), std::min(zero_buffer_size, end - begin), begin);
+            if (n <= 0) {
+                return false;
+            }
+            begin += n;
+        }
+        return true;
+    };
+
+    int64_t header_size = static_cast<int64_t>(sizeof(log_block_header));
+    ok = ok && zero_fill(0, header_size) && zero_fill(std::max(old_size, header_size), size) &&
+         ::fdatasync(fd) == 0;
+    if (!ok) {
+        derror("prepare segment file %s failed, err = %s", path.c_str(), strerror(errno));
+    }
+
+    ::close(fd);
+    return ok;
+#else
+    return false;
+#endif
 }
 
 log_file::log_file(
@@ -2013,6 +2683,9 @@ log_file::log_file(
     _path = path;
     _index = index;
     _crc32 = 0;
+    _read_offset = 0;
+    _is_preallocated = false;
+    _is_aligned = false;
     _last_write_time = 0;
     memset(&_header, 0, sizeof(_header));
 
@@ -2048,9 +2721,33 @@ void log_file::flush() const
     }
 }
 
+aio_task_ptr log_file::flush_async(dsn::task_code evt,
+                                   dsn::task_tracker *tracker,
+                                   aio_handler &&callback,
+                                   int hash) const
+{
+    dassert(!_is_read, "log file must be of write mode");
+    dassert(_handle, "log file must be opened");
+
+    return file::flush(_handle, evt, tracker, std::forward<aio_handler>(callback), hash);
+}
+
 error_code log_file::read_next_log_block(/*out*/ ::dsn::blob &bb)
 {
     dassert(_is_read, "log file must be of read mode");
+
+    // skip the padding of the previous block
+    int64_t padding = _is_aligned ? (LOG_FILE_ALIGNMENT - _read_offset % LOG_FILE_ALIGNMENT) %
+                                        LOG_FILE_ALIGNMENT
+                                  : 0;
+    if (padding > 0) {
+        auto err = _stream->read_next(padding, bb);
+        if (err != ERR_OK || bb.length() != padding) {
+            bb = blob();
+            return (err == ERR_OK || err == ERR_HANDLE_EOF) ? ERR_HANDLE_EOF : err;
+        }
+        _read_offset += padding;
+    }
     auto err = _stream->read_next(sizeof(log_block_header), bb);
     if (err != ERR_OK || bb.length() != sizeof(log_block_header)) {
         if (err == ERR_OK || err == ERR_HANDLE_EOF) {
@@ -2067,11 +2764,26 @@ error_code log_file::read_next_log_block(/*out*/ ::dsn::blob &bb)
     }
     log_block_header hdr = *reinterpret_cast<const log_block_header *>(bb.data());
 
+    if ((_is_preallocated || _read_offset == 0) && hdr.magic == 0 && hdr.length == 0 &&
+        hdr.body_crc == 0 && hdr.local_offset == 0) {
+        // the zero-filled space of a pre-allocated segment is never written, which may also
+        // be the first block if we crash before the file header of a reused segment is written
+        return on_read_end_of_segment("zero block header");
+    }
+
     if (hdr.magic != 0xdeadbeef) {
+        if (_is_preallocated) {
+            return on_read_end_of_segment("invalid data header magic");
+        }
         derror("invalid data header magic: 0x%x", hdr.magic);
         return ERR_INVALID_DATA;
     }
 
+    if (_is_preallocated && static_cast<int64_t>(hdr.local_offset) != _read_offset) {
+        // stale block of the previous use of the recycled segment
+        return on_read_end_of_segment("local offset mismatch");
+    }
+
     err = _stream->read_next(hdr.length, bb);
     if (err != ERR_OK || hdr.length != bb.length()) {
         derror("read data block body failed, size = %d vs %d, err = %s",
@@ -2090,14 +2802,36 @@ error_code log_file::read_next_log_block(/*out*/ ::dsn::blob &bb)
     auto crc = dsn::utils::crc32_calc(
         static_cast<const void *>(bb.data()), static_cast<size_t>(hdr.length), _crc32);
     if (crc != hdr.body_crc) {
+        if (_is_preallocated) {
+            return on_read_end_of_segment("crc checking failed");
+        }
         derror("crc checking failed");
         return ERR_INVALID_DATA;
     }
     _crc32 = crc;
+    _read_offset += sizeof(log_block_header) + hdr.length;
 
     return ERR_OK;
 }
 
+error_code log_file::on_read_end_of_segment(const char *reason)
+{
+    dinfo("meet the end of log file %s at local offset %" PRId64 " for %s",
+          _path.c_str(),
+          _read_offset,
+          reason);
+    _end_offset.store(_start_offset + _read_offset);
+    return ERR_HANDLE_EOF;
+}
+
+void log_file::on_next_file_opened(int64_t next_start_offset)
+{
+    if (_is_preallocated && next_start_offset >= _start_offset &&
+        next_start_offset < _end_offset.load()) {
+        _end_offset.store(next_start_offset);
+    }
+}
+
 log_block *log_file::prepare_log_block()
 {
     log_block_header hdr;
@@ -2147,6 +2881,42 @@ aio_task_ptr log_file::commit_log_block(log_block &block,
     }
     _crc32 = hdr->body_crc;
 
+    if (_is_aligned) {
+        // direct io requires the buffer, size and offset to be aligned, so copy the block
+        // into an aligned buffer with zero padding, which is released after the write
+        size_t aligned_size =
+            (size + LOG_FILE_ALIGNMENT - 1) / LOG_FILE_ALIGNMENT * LOG_FILE_ALIGNMENT;
+        dassert(local_offset % LOG_FILE_ALIGNMENT == 0,
+                "block offset is not aligned: %" PRId64,
+                local_offset);
+        std::shared_ptr<char> buffer = aligned_buffer_pool::instance().allocate(aligned_size);
+        char *ptr = buffer.get();
+        for (int i = 0; i < vec_size; i++) {
+            memcpy(ptr, buffer_vector[i].buffer, buffer_vector[i].size);
+            ptr += buffer_vector[i].size;
+        }
+        memset(ptr, 0, aligned_size - size);
+
+        aio_task_ptr tsk = file::write(
+            _handle,
+            buffer.get(),
+            static_cast<int>(aligned_size),
+            static_cast<uint64_t>(local_offset),
+            evt,
+            tracker,
+            [ buffer, size, aligned_size, cb = std::move(callback) ](error_code err,
+                                                                      size_t sz) mutable {
+                // the padding is invisible to the caller
+                if (cb) {
+                    cb(err, sz == aligned_size ? size : std::min(sz, (size_t)size));
+                }
+            },
+            hash);
+
+        _end_offset.fetch_add(aligned_size);
+        return tsk;
+    }
+
     aio_task_ptr tsk;
     if (callback) {
         tsk = file::write_vector(_handle,
@@ -2180,6 +2950,7 @@ void log_file::reset_stream()
         _stream->reset(0);
     }
     _crc32 = 0;
+    _read_offset = 0;
 }
 
 decree log_file::previous_log_max_decree(const dsn::gpid &pid)
@@ -2196,6 +2967,8 @@ int log_file::read_file_header(binary_reader &reader)
      *   count + count * (gpid + replica_log_info)
      */
     reader.read_pod(_header);
+    _is_preallocated = (_header.version & LOG_FILE_FLAG_PREALLOCATED) != 0;
+    _is_aligned = (_header.version & LOG_FILE_FLAG_ALIGNED) != 0;
 
     int count;
     reader.read(count);
@@ -2235,6 +3008,12 @@ int log_file::write_file_header(binary_writer &writer, const replica_log_info_ma
 
     _header.magic = 0xdeadbeef;
     _header.version = 0x1;
+    if (_is_preallocated) {
+        _header.version |= LOG_FILE_FLAG_PREALLOCATED;
+    }
+    if (_is_aligned) {
+        _header.version |= LOG_FILE_FLAG_ALIGNED;
+    }
     _header.start_global_offset = start_offset();
 
     writer.write_pod(_header);
@@ -38,7 +38,9 @@
 #include "dist/replication/common/replication_common.h"
 #include "mutation.h"
 #include <atomic>
+#include <deque>
 #include <dsn/tool-api/zlocks.h>
+#include <dsn/perf_counter/perf_counter_wrapper.h>
 
 namespace dsn {
 namespace replication {
@@ -83,11 +85,22 @@ struct log_block_header
 struct log_file_header
 {
     int32_t magic;   // 0xdeadbeef
-    int32_t version; // current 0x1
+    int32_t version; // 0x1, with the LOG_FILE_FLAG_* bits below
     int64_t
         start_global_offset; // start offset in the global space, equals to the file name's postfix
 };
 
+// the file is written into a pre-allocated (zero-filled or recycled) segment, so the space
+// after the last written block holds zeros or stale blocks of the previous use.
+// when reading such a file, the first block whose magic, local_offset or crc does not match
+// marks the end of the file, instead of being reported as corrupted data.
+const int32_t LOG_FILE_FLAG_PREALLOCATED = 0x2;
+
+// the file is written with direct io, so each block is zero-padded to LOG_FILE_ALIGNMENT,
+// and the next block starts at the aligned offset.
+const int32_t LOG_FILE_FLAG_ALIGNED = 0x4;
+const size_t LOG_FILE_ALIGNMENT = 4096;
+
 // a memory structure holding data which belongs to one block.
 class log_block /* : public ::dsn::transient_object*/
 {
@@ -287,6 +300,28 @@ public:
     void hint_switch_file() { _switch_file_hint = true; }
     void demand_switch_file() { _switch_file_demand = true; }
 
+    //
+    // segment pool, only used for shared log
+    //
+
+    // keep at most 'count' pre-allocated segment files under '{dir}/segment_pool', which
+    // are renamed to new log files instead of creating files from scratch; log files
+    // removed by garbage_collection() are recycled into the pool while it is not full.
+    // must be called before open(), 0 means disabled
+    void set_segment_pool_size(int count);
+
+    // write (and replay) log files with direct io, bypassing the page cache; each block
+    // is copied into an aligned buffer and zero-padded to LOG_FILE_ALIGNMENT.
+    // must be called before open()
+    void set_direct_io(bool direct_io);
+
+    // clear the recycled log files, and pre-allocate zero-filled segment files until the
+    // pool is full, which may be slow and should be called in background; it is enqueued
+    // to the log's own tracker by garbage_collection(), and returns immediately if another
+    // call is filling the pool
+    // thread safe
+    void fill_segment_pool();
+
 protected:
     // thread-safe
     // 'size' is data size to write; the '_global_end_offset' will be updated by 'size'.
@@ -304,17 +339,25 @@ protected:
     // init memory states
     virtual void init_states();
 
+    // size of a block in the file, including the tail padding for direct io
+    size_t block_size_on_disk(size_t size) const;
+
 private:
     //
     //  internal helpers
     //
+    class parallel_log_decoder;
+
     static error_code replay(log_file_ptr log,
                              replay_callback callback,
                              /*out*/ int64_t &end_offset);
 
+    // the log files are read and decoded by 'thread_count' threads in parallel if greater
+    // than 1, while the callback is still called in the log order on the calling thread
     static error_code replay(std::map<int, log_file_ptr> &log_files,
                              replay_callback callback,
-                             /*out*/ int64_t &end_offset);
+                             /*out*/ int64_t &end_offset,
+                             int thread_count = 1);
 
     // update max decree without lock
     void update_max_decree_no_lock(gpid gpid, decree d);
@@ -332,10 +375,21 @@ private:
     // get total size ithout lock.
     int64_t total_size_no_lock() const;
 
+    // load the existing segment files on open
+    error_code load_segment_pool();
+
+    std::string segment_pool_dir() const;
+
+    // move the removed log file into the segment pool if it is not full, or else delete it;
+    // the recycled file is cleared later by fill_segment_pool()
+    // returns false if the file is not removed
+    bool recycle_or_remove_log_file(const std::string &fpath);
+
 protected:
     std::string _dir;
     bool _is_private;
-    gpid _private_gpid;      // only used for private log
+    int _replay_thread_count; // thread number to read and decode log files on open
+    gpid _private_gpid;       // only used for private log
     replica *_owner_replica; // only used for private log
     io_failure_callback _io_error_callback;
 
@@ -343,6 +397,7 @@ protected:
     int64_t _max_log_file_size_in_bytes;
     int64_t _min_log_file_size_in_bytes;
     bool _force_flush;
+    bool _direct_io;
 
     dsn::task_tracker _tracker;
 
@@ -363,6 +418,13 @@ private:
                                             // invalid if _log_files.size() == 0.
     int64_t _global_end_offset;             // global end offset currently
 
+    // segment pool
+    int _segment_pool_size;                     // max segment count in pool, 0 if disabled
+    int _segment_pool_next_id;                  // new segment file name is segment.{id}
+    std::deque<std::string> _segment_pool;      // paths of the pooled segment files
+    std::deque<std::string> _recycled_segments; // recycled files to be cleared, segment.{id}.tmp
+    bool _is_filling_segment_pool;              // if fill_segment_pool() is running
+
     // replica log info
     // - log_info.max_decree: the max decree of mutations up to now
     // - log_info.valid_start_offset: the same with replica_init_info::init_offset
@@ -382,13 +444,12 @@ typedef dsn::ref_ptr<mutation_log> mutation_log_ptr;
 class mutation_log_shared : public mutation_log
 {
 public:
-    mutation_log_shared(const std::string &dir, int32_t max_log_file_mb, bool force_flush)
-        : mutation_log(dir, max_log_file_mb, dsn::gpid(), nullptr),
-          _is_writing(false),
-          _pending_write_start_offset(0),
-          _force_flush(force_flush)
-    {
-    }
+    mutation_log_shared(const std::string &dir,
+                        int32_t max_log_file_mb,
+                        bool force_flush,
+                        int replay_thread_count = 1,
+                        uint32_t group_commit_max_bytes = 0,
+                        uint64_t group_commit_max_wait_us = 0);
 
     virtual ~mutation_log_shared() override { _tracker.cancel_outstanding_tasks(); }
     virtual ::dsn::task_ptr append(mutation_ptr &mu,
@@ -413,9 +474,25 @@ private:
     // if count <= 0, means flush until all data is on disk
     void flush_internal(int max_count);
 
+    typedef std::vector<aio_task_ptr> callbacks;
+
+    // called when the issued write is done (and flushed if _force_flush),
+    // notifies the callbacks and starts the next write if possible
+    void on_write_done(std::shared_ptr<callbacks> &cbs, error_code err, size_t sz);
+
+    // group commit, only enabled when _force_flush is true
+    // Preconditions:
+    // - _slock is held
+    // - !_is_writing && _pending_write != nullptr
+    // start the pending write if the group is large or old enough, otherwise
+    // arm the group commit timer; the lock is released in both cases
+    void write_or_wait_pending_mutations();
+    bool group_commit_ready() const;
+    uint64_t group_commit_window_us() const;
+    void on_group_commit_timer();
+
 private:
     // bufferring - only one concurrent write is allowed
-    typedef std::vector<aio_task_ptr> callbacks;
     typedef std::vector<mutation_ptr> mutations;
     mutable zlock _slock;
     std::atomic_bool _is_writing;
@@ -423,8 +500,22 @@ private:
     std::shared_ptr<callbacks> _pending_write_callbacks;
     std::shared_ptr<mutations> _pending_write_mutations;
     int64_t _pending_write_start_offset;
+    uint64_t _pending_write_start_time_us;
 
     bool _force_flush;
+
+    // group commit - a pending group is written (and flushed by a single fdatasync)
+    // once it reaches _group_commit_max_bytes or has waited for the adaptive window,
+    // which is a half of the recent fsync latency and at most _group_commit_max_wait_us
+    bool _group_commit;
+    uint32_t _group_commit_max_bytes;
+    uint64_t _group_commit_max_wait_us;
+    bool _group_commit_timer_armed; // protected by _slock
+    std::atomic<uint64_t> _fsync_latency_avg_us;
+
+    perf_counter_wrapper _counter_group_commit_size;
+    perf_counter_wrapper _counter_group_commit_latency;
+    perf_counter_wrapper _counter_group_commit_mutations;
 };
 
 class mutation_log_private : public mutation_log
@@ -473,6 +564,10 @@ private:
     // if count <= 0, means flush until all data is on disk
     void flush_internal(int max_count);
 
+    // called when the issued write is done and flushed,
+    // updates the max commit on disk and starts the next write if possible
+    void on_write_done(decree max_commit, error_code err);
+
     bool flush_interval_expired()
     {
         return _pending_write_start_time_ms + _batch_buffer_flush_interval_ms <= dsn_now_ms();
@@ -516,17 +611,33 @@ public:
     // 'path' should be in format of log.{index}.{start_offset}, where:
     //   - index: the index of the log file, start from 1
     //   - start_offset: start offset in the global space
+    // if 'direct_io' is true, the file is read with direct io if supported by the file system
     // returns:
     //   - non-null if open succeed
     //   - null if open failed
-    static log_file_ptr open_read(const char *path, /*out*/ error_code &err);
+    static log_file_ptr open_read(const char *path,
+                                  /*out*/ error_code &err,
+                                  bool direct_io = false);
 
     // open the log file for write
     // the file path is '{dir}/log.{index}.{start_offset}'
+    // if 'segment_path' is not null, the pre-allocated segment file is renamed to the path
+    // and reused, instead of creating a new file
+    // if 'direct_io' is true, the blocks are written with direct io and padded, see
+    // LOG_FILE_FLAG_ALIGNED; it falls back to buffered io if not supported by the file system
     // returns:
     //   - non-null if open succeed
     //   - null if open failed
-    static log_file_ptr create_write(const char *dir, int index, int64_t start_offset);
+    static log_file_ptr create_write(const char *dir,
+                                     int index,
+                                     int64_t start_offset,
+                                     const char *segment_path = nullptr,
+                                     bool direct_io = false);
+
+    // make 'path' a segment file which is ready to be reused by create_write(), i.e., it has
+    // at least 'size' bytes allocated, and its first block header is zero-filled so that it
+    // is taken as an empty log file, the space beyond the old content is zero-filled as well
+    static bool prepare_segment(const std::string &path, int64_t size);
 
     // close the log file
     void close();
@@ -534,6 +645,14 @@ public:
     // flush the log file
     void flush() const;
 
+    // async flush the log file, the callback is invoked after the completed writes are durable
+    // 'evt' is to indicate which thread pool to execute the callback
+    // 'hash' helps to choose which thread in the thread pool to execute the callback
+    dsn::aio_task_ptr flush_async(dsn::task_code evt,
+                                  dsn::task_tracker *tracker,
+                                  aio_handler &&callback,
+                                  int hash) const;
+
     //
     // read routines
     //
@@ -579,8 +698,17 @@ public:
     //
     // reset file_streamer to point to the start of this log file.
     void reset_stream();
-    // end offset in the global space: end_offset = start_offset + file_size
+    // local offset of the next block to read, including the padding of the last block
+    int64_t read_offset() const { return _read_offset; }
+    // if the blocks are padded, see LOG_FILE_FLAG_ALIGNED
+    bool is_aligned() const { return _is_aligned; }
+    // end offset in the global space: end_offset = start_offset + file_size; if the file is
+    // pre-allocated, it is the end of the last valid block once the file is read through,
+    // or the start of the next file once set by on_next_file_opened()
     int64_t end_offset() const { return _end_offset.load(); }
+    // the next log file starts at 'next_start_offset', which is where a pre-allocated file
+    // ends, without reading it through
+    void on_next_file_opened(int64_t next_start_offset);
     // start offset in the global space
     int64_t start_offset() const { return _start_offset; }
     // file index
@@ -611,8 +739,15 @@ private:
     // make private, user should create log_file through open_read() or open_write()
     log_file(const char *path, disk_file *handle, int index, int64_t start_offset, bool is_read);
 
+private:
+    // called when the end of the written blocks is met in a pre-allocated file
+    error_code on_read_end_of_segment(const char *reason);
+
 private:
     uint32_t _crc32;
+    int64_t _read_offset;  // local offset of the next block to read
+    bool _is_preallocated; // if the file is written into a pre-allocated segment
+    bool _is_aligned;      // if the blocks are padded for direct io
     int64_t _start_offset; // start offset in the global space
     std::atomic<int64_t>
         _end_offset; // end offset in the global space: end_offset = start_offset + file_size
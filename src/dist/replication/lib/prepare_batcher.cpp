@@ -0,0 +1,301 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     coalesces the prepares of different partitions sent to the same node into one rpc,
+ *     and likewise their acks sent back
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "prepare_batcher.h"
+#include "mutation.h"
+#include <dsn/cpp/rpc_stream.h>
+#include <dsn/cpp/serialization.h>
+#include <dsn/dist/replication/replication.codes.h>
+
+namespace dsn {
+namespace replication {
+
+prepare_batcher::prepare_batcher(int delay_ms, int max_bytes, int sweep_interval_ms)
+    : _delay_ms(delay_ms),
+      _max_bytes(max_bytes),
+      _sweep_interval_ms(sweep_interval_ms),
+      _thread_hash(0),
+      _next_key(0),
+      _sweep_pending(false)
+{
+    _counter_batch_size.init_app_counter("eon.replica_stub",
+                                         "replicas.prepare.batch.size",
+                                         COUNTER_TYPE_NUMBER_PERCENTILES,
+                                         "prepares or acks sent in one batch to a node");
+}
+
+prepare_batcher::~prepare_batcher() { stop(); }
+
+void prepare_batcher::start()
+{
+    // the batches from this node are demuxed one by one on the receiver to keep their order
+    _thread_hash = static_cast<int>(std::hash<::dsn::rpc_address>()(dsn_primary_address()) &
+                                    0x7fffffff);
+}
+
+void prepare_batcher::stop()
+{
+    _tracker.cancel_outstanding_tasks();
+
+    zauto_lock l(_lock);
+    _pending_prepares.clear();
+    _queues.clear();
+    _sweep_pending = false;
+}
+
+void prepare_batcher::send_prepare(::dsn::rpc_address node,
+                                   std::vector<blob> &&body,
+                                   int timeout_ms,
+                                   ack_callback &&callback)
+{
+    int bytes = 0;
+    for (const blob &bb : body) {
+        bytes += bb.length();
+    }
+
+    uint64_t key = ++_next_key;
+    bool full = false;
+    {
+        zauto_lock l(_lock);
+        pending_prepare &pp = _pending_prepares[key];
+        pp.deadline_ms = dsn_now_ms() + timeout_ms;
+        pp.callback = std::move(callback);
+        schedule_sweep();
+
+        node_queue &q = _queues[node];
+        q.prepares.emplace_back(key, std::move(body));
+        q.prepare_bytes += bytes;
+        if (q.prepare_bytes >= _max_bytes) {
+            full = true;
+        } else {
+            schedule_flush(node, q);
+        }
+    }
+
+    if (full) {
+        flush(node, false);
+    }
+}
+
+void prepare_batcher::send_ack(::dsn::rpc_address node, uint64_t key, const prepare_ack &ack)
+{
+    zauto_lock l(_lock);
+    node_queue &q = _queues[node];
+    q.acks.emplace_back(key, ack);
+    schedule_flush(node, q);
+}
+
+void prepare_batcher::schedule_flush(::dsn::rpc_address node, node_queue &q)
+{
+    if (q.flush_pending) {
+        return;
+    }
+    q.flush_pending = true;
+    tasking::enqueue(LPC_PREPARE_BATCH_FLUSH,
+                     &_tracker,
+                     [this, node]() { flush(node, true); },
+                     _thread_hash,
+                     std::chrono::milliseconds(_delay_ms));
+}
+
+void prepare_batcher::schedule_sweep()
+{
+    if (_sweep_pending) {
+        return;
+    }
+    _sweep_pending = true;
+    tasking::enqueue(LPC_PREPARE_BATCH_SWEEP,
+                     &_tracker,
+                     [this]() { sweep(); },
+                     0,
+                     std::chrono::milliseconds(_sweep_interval_ms));
+}
+
+void prepare_batcher::flush(::dsn::rpc_address node, bool scheduled)
+{
+    {
+        zauto_lock l(_lock);
+        auto it = _queues.find(node);
+        if (it == _queues.end()) {
+            return;
+        }
+        node_queue &q = it->second;
+        if (scheduled) {
+            q.flush_pending = false;
+        }
+        if (!q.prepares.empty() || !q.acks.empty()) {
+            q.cut_batches.emplace_back();
+            q.cut_batches.back().prepares.swap(q.prepares);
+            q.cut_batches.back().acks.swap(q.acks);
+            q.prepare_bytes = 0;
+        }
+
+        // the batches of a node are sent by one flush() at a time, or a batch cut later for a
+        // full queue may overtake this one
+        if (q.is_sending) {
+            return;
+        }
+        q.is_sending = true;
+    }
+
+    while (true) {
+        batch b;
+        {
+            zauto_lock l(_lock);
+            auto it = _queues.find(node);
+            if (it == _queues.end()) {
+                return;
+            }
+            node_queue &q = it->second;
+            if (q.cut_batches.empty()) {
+                q.is_sending = false;
+                return;
+            }
+            b = std::move(q.cut_batches.front());
+            q.cut_batches.pop_front();
+        }
+
+        if (!b.prepares.empty()) {
+            _counter_batch_size->set(b.prepares.size());
+            dsn_rpc_call_one_way(node, create_prepare_batch(b.prepares));
+        }
+        if (!b.acks.empty()) {
+            _counter_batch_size->set(b.acks.size());
+            dsn_rpc_call_one_way(node, create_ack_batch(b.acks));
+        }
+    }
+}
+
+dsn::message_ex *prepare_batcher::create_prepare_batch(
+    const std::vector<std::pair<uint64_t, std::vector<blob>>> &prepares)
+{
+    dsn::message_ex *msg = dsn::message_ex::create_request(RPC_PREPARE_BATCH, 0, _thread_hash);
+    {
+        rpc_write_stream writer(msg);
+        writer.write(static_cast<int32_t>(prepares.size()));
+    }
+    for (auto &p : prepares) {
+        int32_t len = 0;
+        for (const blob &bb : p.second) {
+            len += bb.length();
+        }
+        {
+            rpc_write_stream writer(msg);
+            writer.write(p.first);
+            writer.write(len);
+        }
+        mutation::append_to(msg, p.second);
+    }
+    return msg;
+}
+
+dsn::message_ex *
+prepare_batcher::create_ack_batch(const std::vector<std::pair<uint64_t, prepare_ack>> &acks)
+{
+    dsn::message_ex *msg =
+        dsn::message_ex::create_request(RPC_PREPARE_ACK_BATCH, 0, _thread_hash);
+    {
+        rpc_write_stream writer(msg);
+        writer.write(static_cast<int32_t>(acks.size()));
+        for (auto &a : acks) {
+            writer.write(a.first);
+            marshall(writer, a.second, DSF_THRIFT_BINARY);
+        }
+    }
+    return msg;
+}
+
+void prepare_batcher::on_ack_batch(dsn::message_ex *msg)
+{
+    std::vector<std::pair<uint64_t, prepare_ack>> acks;
+    {
+        rpc_read_stream reader(msg);
+        int32_t count = 0;
+        reader.read(count);
+        acks.resize(count);
+        for (auto &a : acks) {
+            reader.read(a.first);
+            unmarshall(reader, a.second, DSF_THRIFT_BINARY);
+        }
+    }
+
+    std::vector<std::pair<ack_callback, prepare_ack>> acked;
+    {
+        zauto_lock l(_lock);
+        for (auto &a : acks) {
+            auto it = _pending_prepares.find(a.first);
+            // timed out already
+            if (it == _pending_prepares.end()) {
+                continue;
+            }
+            acked.emplace_back(std::move(it->second.callback), std::move(a.second));
+            _pending_prepares.erase(it);
+        }
+    }
+
+    for (auto &a : acked) {
+        a.first(ERR_OK, std::move(a.second));
+    }
+}
+
+void prepare_batcher::sweep()
+{
+    uint64_t now_ms = dsn_now_ms();
+    std::vector<ack_callback> expired;
+    {
+        zauto_lock l(_lock);
+        for (auto it = _pending_prepares.begin(); it != _pending_prepares.end();) {
+            if (it->second.deadline_ms <= now_ms) {
+                expired.emplace_back(std::move(it->second.callback));
+                it = _pending_prepares.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // no more sweep until a prepare is sent again
+        _sweep_pending = false;
+        if (!_pending_prepares.empty()) {
+            schedule_sweep();
+        }
+    }
+
+    for (auto &callback : expired) {
+        callback(ERR_TIMEOUT, prepare_ack());
+    }
+}
+}
+} // namespace
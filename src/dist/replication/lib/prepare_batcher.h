@@ -0,0 +1,134 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     coalesces the prepares of different partitions sent to the same node into one rpc,
+ *     and likewise their acks sent back
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#pragma once
+
+#include <dsn/tool-api/zlocks.h>
+#include <dsn/perf_counter/perf_counter_wrapper.h>
+#include "dist/replication/common/replication_common.h"
+#include <functional>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <unordered_map>
+
+class replication_service_test_app;
+
+namespace dsn {
+namespace replication {
+
+//
+// the prepares of a batch are keyed by the sender, and the receiver demuxes them to the
+// replicas, whose acks are sent back in batches with the keys; both rpcs are one-way, so the
+// sender fails the prepares not acked before their deadlines with ERR_TIMEOUT, by a sweep task
+// armed only while any prepare is pending; the batches to a node are sent in the order they
+// are cut, whether by the flush task or by a full queue, by one sender at a time
+//
+class prepare_batcher
+{
+public:
+    typedef std::function<void(error_code, prepare_ack &&)> ack_callback;
+
+    prepare_batcher(int delay_ms, int max_bytes, int sweep_interval_ms);
+    ~prepare_batcher();
+
+    void start();
+    void stop();
+
+    // on the sender, body is the prepare request body with the gpid ahead
+    void send_prepare(::dsn::rpc_address node,
+                      std::vector<blob> &&body,
+                      int timeout_ms,
+                      ack_callback &&callback);
+    void on_ack_batch(dsn::message_ex *msg);
+
+    // on the receiver
+    void send_ack(::dsn::rpc_address node, uint64_t key, const prepare_ack &ack);
+
+private:
+    friend class ::replication_service_test_app;
+
+    struct pending_prepare
+    {
+        uint64_t deadline_ms;
+        ack_callback callback;
+    };
+
+    struct batch
+    {
+        std::vector<std::pair<uint64_t, std::vector<blob>>> prepares;
+        std::vector<std::pair<uint64_t, prepare_ack>> acks;
+    };
+
+    struct node_queue
+    {
+        std::vector<std::pair<uint64_t, std::vector<blob>>> prepares;
+        int prepare_bytes = 0;
+        std::vector<std::pair<uint64_t, prepare_ack>> acks;
+        bool flush_pending = false;
+        // the batches cut but not sent yet, which are sent out of _lock by the flush() with
+        // is_sending set, while the others only append their batches here
+        std::deque<batch> cut_batches;
+        bool is_sending = false;
+    };
+
+    // under _lock
+    void schedule_flush(::dsn::rpc_address node, node_queue &q);
+    void schedule_sweep();
+    // scheduled is false if flushed for a full queue, with the scheduled flush still pending
+    void flush(::dsn::rpc_address node, bool scheduled);
+    dsn::message_ex *
+    create_prepare_batch(const std::vector<std::pair<uint64_t, std::vector<blob>>> &prepares);
+    dsn::message_ex *create_ack_batch(const std::vector<std::pair<uint64_t, prepare_ack>> &acks);
+    void sweep();
+
+private:
+    int _delay_ms;
+    int _max_bytes;
+    int _sweep_interval_ms;
+    int _thread_hash;
+
+    ::dsn::zlock _lock;
+    std::map<uint64_t, pending_prepare> _pending_prepares;
+    std::unordered_map<::dsn::rpc_address, node_queue> _queues;
+    std::atomic<uint64_t> _next_key;
+    bool _sweep_pending; // under _lock
+
+    perf_counter_wrapper _counter_batch_size;
+    dsn::task_tracker _tracker;
+};
+}
+} // namespace
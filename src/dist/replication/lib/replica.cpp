@@ -60,12 +60,28 @@ replica::replica(
     _options = &stub->options();
     init_state();
     _config.pid = gpid;
+    _stale_read_max_decree_gap = _options->stale_read_max_decree_gap;
+    update_stale_read_max_decree_gap(_app_info.envs);
 
     std::stringstream ss;
     ss << "private.log.size(MB)"
        << "@" << gpid.get_app_id() << "." << gpid.get_partition_index();
     _counter_private_log_size.init_app_counter(
         "eon.replica", ss.str().c_str(), COUNTER_TYPE_NUMBER, "private log size(MB)");
+
+    if (_options->mutation_2pc_adaptive_enabled) {
+        _primary_states.write_queue.enable_adaptive(_options->mutation_2pc_max_batch_bytes);
+
+        std::string suffix = fmt::format("@{}.{}", gpid.get_app_id(), gpid.get_partition_index());
+        _counter_2pc_depth.init_app_counter("eon.replica",
+                                            ("2pc.depth" + suffix).c_str(),
+                                            COUNTER_TYPE_NUMBER,
+                                            "max concurrent mutations in 2pc of the primary");
+        _counter_2pc_batch_bytes.init_app_counter("eon.replica",
+                                                  ("2pc.batch.bytes" + suffix).c_str(),
+                                                  COUNTER_TYPE_NUMBER,
+                                                  "max bytes batched in one mutation");
+    }
     if (need_restore) {
         // add an extra env for restore
         _extra_envs.insert(
@@ -134,6 +150,23 @@ void replica::on_client_read(task_code code, dsn::message_ex *request)
         return;
     }
 
+    if (status() == partition_status::PS_SECONDARY &&
+        request->header->context.u.allow_stale_read) {
+        stale_read_action action = check_stale_read(request);
+        if (action == stale_read_action::SERVE) {
+            _stub->_counter_replicas_stale_read_qps->increment();
+            dassert(_app != nullptr, "");
+            _app->on_request(request);
+            return;
+        }
+
+        if (action == stale_read_action::FORWARD) {
+            _stub->_counter_replicas_stale_read_forward_qps->increment();
+            dsn_rpc_forward(request, _config.primary);
+            return;
+        }
+    }
+
     if (status() != partition_status::PS_PRIMARY ||
 
         // a small window where the state is not the latest yet
@@ -155,10 +188,42 @@ void replica::on_client_read(task_code code, dsn::message_ex *request)
         }
     }
 
+    if (_options->primary_read_lease_enabled &&
+        !_primary_states.is_read_lease_valid(dsn_now_ms(), _stub->meta_server_lease_expire_ms())) {
+        derror("%s: read lease is not valid, maybe a new primary is being elected", name());
+        response_client_message(true, request, ERR_INVALID_STATE);
+        return;
+    }
+
     dassert(_app != nullptr, "");
     _app->on_request(request);
 }
 
+bool replica::is_stale_read_servable() const
+{
+    if (_stale_read_max_decree_gap < 0 ||
+        _secondary_states.primary_last_committed_decree == invalid_decree ||
+        dsn_now_ms() > _secondary_states.primary_heard_ts_ms + _options->stale_read_max_lag_ms) {
+        return false;
+    }
+    return last_committed_decree() + _stale_read_max_decree_gap >=
+           _secondary_states.primary_last_committed_decree;
+}
+
+replica::stale_read_action replica::check_stale_read(dsn::message_ex *request) const
+{
+    if (is_stale_read_servable()) {
+        return stale_read_action::SERVE;
+    }
+
+    // too stale to serve it, let the primary do
+    if (!_config.primary.is_invalid() && request->header->context.u.is_forward_supported &&
+        !request->header->context.u.is_forwarded) {
+        return stale_read_action::FORWARD;
+    }
+    return stale_read_action::REJECT;
+}
+
 void replica::response_client_message(bool is_read, dsn::message_ex *request, error_code error)
 {
     if (nullptr == request) {
@@ -333,6 +398,13 @@ void replica::execute_mutation(mutation_ptr &mu)
     }
 
     if (status() == partition_status::PS_PRIMARY) {
+        if (_options->mutation_2pc_adaptive_enabled && mu->prepare_ts_us() > 0) {
+            mutation_queue &queue = _primary_states.write_queue;
+            queue.on_mutation_committed(dsn_now_us() - mu->prepare_ts_us());
+            _counter_2pc_depth->set(queue.max_concurrent_op());
+            _counter_2pc_batch_bytes->set(queue.batch_bytes());
+        }
+
         mutation_ptr next = _primary_states.write_queue.check_possible_work(
             static_cast<int>(_prepare_list->max_decree() - d));
 
@@ -439,6 +511,8 @@ void replica::close()
     }
 
     _counter_private_log_size.clear();
+    _counter_2pc_depth.clear();
+    _counter_2pc_batch_bytes.clear();
 
     ddebug("%s: replica closed, time_used = %" PRIu64 "ms", name(), dsn_now_ms() - start_time);
 }
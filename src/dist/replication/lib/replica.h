@@ -180,12 +180,17 @@ private:
                               partition_status::type status,
                               const mutation_ptr &mu,
                               int timeout_milliseconds,
-                              int64_t learn_signature = invalid_signature);
+                              int64_t learn_signature = invalid_signature,
+                              const std::vector<blob> *serialized_mutation = nullptr);
     void on_append_log_completed(mutation_ptr &mu, error_code err, size_t size);
     void on_prepare_reply(std::pair<mutation_ptr, partition_status::type> pr,
                           error_code err,
                           dsn::message_ex *request,
                           dsn::message_ex *reply);
+    // the ack of the prepare sent to node, in a reply or in a batch of acks
+    void on_prepare_ack(std::pair<mutation_ptr, partition_status::type> pr,
+                        ::dsn::rpc_address node,
+                        const prepare_ack &resp);
     void do_possible_commit_on_primary(mutation_ptr &mu);
     void ack_prepare_message(error_code err, mutation_ptr &mu);
     void cleanup_preparing_mutations(bool wait);
@@ -236,6 +241,17 @@ private:
 
     // return false when update fails or replica is going to be closed
     bool update_app_envs(const std::map<std::string, std::string> &envs);
+    void update_stale_read_max_decree_gap(const std::map<std::string, std::string> &envs);
+    bool is_stale_read_servable() const;
+
+    // how a secondary handles a read allowing stale data
+    enum class stale_read_action
+    {
+        SERVE,   // fresh enough to serve it
+        FORWARD, // too stale, so forward it to the primary
+        REJECT   // too stale and not forwardable, so reject it as any read on a secondary
+    };
+    stale_read_action check_stale_read(dsn::message_ex *request) const;
     bool query_app_envs(/*out*/ std::map<std::string, std::string> &envs);
     bool update_configuration(const partition_configuration &config);
     bool update_local_configuration(const replica_configuration &config, bool same_ballot = false);
@@ -246,7 +262,14 @@ private:
     void broadcast_group_check();
     void on_group_check_reply(error_code err,
                               const std::shared_ptr<group_check_request> &req,
-                              const std::shared_ptr<group_check_response> &resp);
+                              const std::shared_ptr<group_check_response> &resp,
+                              uint64_t send_ts_ms);
+
+    /////////////////////////////////////////////////////////////////
+    // primary read lease
+    void init_read_lease();
+    // a secondary acked a prepare or group check sent at send_ts_ms
+    void renew_read_lease(::dsn::rpc_address node, uint64_t send_ts_ms);
 
     /////////////////////////////////////////////////////////////////
     // check timer for gc, checkpointing etc.
@@ -309,6 +332,7 @@ private:
     friend class ::dsn::replication::mutation_queue;
     friend class ::dsn::replication::replica_stub;
     friend class mock_replica;
+    friend class ::replication_service_test_app;
 
     // replica configuration, updated by update_local_configuration ONLY
     replica_configuration _config;
@@ -336,6 +360,10 @@ private:
     const app_info _app_info;
     std::map<std::string, std::string> _extra_envs;
 
+    // reads allowing stale results are served by the secondary when its last committed decree
+    // lags behind the primary's by at most this, see replica_envs::STALE_READ_MAX_DECREE_GAP
+    int32_t _stale_read_max_decree_gap;
+
     // uniq timestamp generator for this replica.
     //
     // we use it to generate an increasing timestamp for current replica
@@ -379,6 +407,8 @@ private:
 
     // perf counters
     perf_counter_wrapper _counter_private_log_size;
+    perf_counter_wrapper _counter_2pc_depth;
+    perf_counter_wrapper _counter_2pc_batch_bytes;
 
     dsn::task_tracker _tracker;
     // the thread access checker
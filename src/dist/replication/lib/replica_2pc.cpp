@@ -78,6 +78,7 @@ void replica::init_prepare(mutation_ptr &mu, bool reconciliation)
 
     error_code err = ERR_OK;
     uint8_t count = 0;
+    std::vector<blob> serialized_mutation;
     mu->data.header.last_committed_decree = last_committed_decree();
 
     dsn_log_level_t level = LOG_LEVEL_INFORMATION;
@@ -125,14 +126,19 @@ void replica::init_prepare(mutation_ptr &mu, bool reconciliation)
         goto ErrOut;
     }
 
-    // remote prepare
+    // remote prepare, the mutation is serialized once and shared by all the prepare messages
     mu->set_prepare_ts();
     mu->set_left_secondary_ack_count((unsigned int)_primary_states.membership.secondaries.size());
+    serialized_mutation = mu->serialize();
     for (auto it = _primary_states.membership.secondaries.begin();
          it != _primary_states.membership.secondaries.end();
          ++it) {
-        send_prepare_message(
-            *it, partition_status::PS_SECONDARY, mu, _options->prepare_timeout_ms_for_secondaries);
+        send_prepare_message(*it,
+                             partition_status::PS_SECONDARY,
+                             mu,
+                             _options->prepare_timeout_ms_for_secondaries,
+                             invalid_signature,
+                             &serialized_mutation);
     }
 
     count = 0;
@@ -143,7 +149,8 @@ void replica::init_prepare(mutation_ptr &mu, bool reconciliation)
                                  partition_status::PS_POTENTIAL_SECONDARY,
                                  mu,
                                  _options->prepare_timeout_ms_for_potential_secondaries,
-                                 it->second.signature);
+                                 it->second.signature,
+                                 &serialized_mutation);
             count++;
         }
     }
@@ -182,18 +189,66 @@ void replica::send_prepare_message(::dsn::rpc_address addr,
                                    partition_status::type status,
                                    const mutation_ptr &mu,
                                    int timeout_milliseconds,
-                                   int64_t learn_signature)
+                                   int64_t learn_signature,
+                                   const std::vector<blob> *serialized_mutation)
 {
-    dsn::message_ex *msg = dsn::message_ex::create_request(
-        RPC_PREPARE, timeout_milliseconds, get_gpid().thread_hash());
     replica_configuration rconfig;
     _primary_states.get_replica_config(status, rconfig, learn_signature);
 
+    // the potential secondaries are few and far between, so they are not worth batching
+    if (_options->prepare_batch_enabled && rconfig.status == partition_status::PS_SECONDARY) {
+        std::vector<blob> body;
+        {
+            binary_writer writer;
+            marshall(writer, get_gpid(), DSF_THRIFT_BINARY);
+            marshall(writer, rconfig, DSF_THRIFT_BINARY);
+            body.push_back(writer.get_buffer());
+        }
+        if (serialized_mutation != nullptr) {
+            body.insert(body.end(), serialized_mutation->begin(), serialized_mutation->end());
+        } else {
+            std::vector<blob> blobs = mu->serialize();
+            body.insert(body.end(), blobs.begin(), blobs.end());
+        }
+
+        replica_ptr rep(this);
+        partition_status::type target_status = rconfig.status;
+        _stub->_prepare_batcher->send_prepare(
+            addr,
+            std::move(body),
+            timeout_milliseconds,
+            [rep, mu, target_status, addr](error_code err, prepare_ack &&ack) {
+                if (err != ERR_OK) {
+                    ack.err = err;
+                }
+                tasking::enqueue(LPC_PREPARE_ACK_IN_BATCH,
+                                 rep->tracker(),
+                                 [rep, mu, target_status, addr, ack]() {
+                                     rep->on_prepare_ack(
+                                         std::make_pair(mu, target_status), addr, ack);
+                                 },
+                                 rep->get_gpid().thread_hash());
+            });
+
+        dinfo("%s: mutation %s send_prepare_message to %s as %s in batch",
+              name(),
+              mu->name(),
+              addr.to_string(),
+              enum_to_string(rconfig.status));
+        return;
+    }
+
+    dsn::message_ex *msg = dsn::message_ex::create_request(
+        RPC_PREPARE, timeout_milliseconds, get_gpid().thread_hash());
     {
         rpc_write_stream writer(msg);
         marshall(writer, get_gpid(), DSF_THRIFT_BINARY);
         marshall(writer, rconfig, DSF_THRIFT_BINARY);
-        mu->write_to(writer, msg);
+    }
+    if (serialized_mutation != nullptr) {
+        mutation::append_to(msg, *serialized_mutation);
+    } else {
+        mutation::append_to(msg, mu->serialize());
     }
 
     mu->remote_tasks()[addr] =
@@ -223,6 +278,23 @@ void replica::do_possible_commit_on_primary(mutation_ptr &mu)
             enum_to_string(status()));
 
     if (mu->is_ready_for_commit()) {
+        uint64_t now_ms = dsn_now_ms();
+        if (now_ms < _primary_states.read_lease_wait_until_ms) {
+            // the former primary may still serve reads under the lease granted by this replica
+            tasking::enqueue(LPC_DELAY_COMMIT_FOR_READ_LEASE,
+                             &_tracker,
+                             [this, mu]() mutable {
+                                 if (status() == partition_status::PS_PRIMARY &&
+                                     get_ballot() == mu->data.header.ballot &&
+                                     mu->get_decree() > last_committed_decree()) {
+                                     do_possible_commit_on_primary(mu);
+                                 }
+                             },
+                             get_gpid().thread_hash(),
+                             std::chrono::milliseconds(
+                                 _primary_states.read_lease_wait_until_ms - now_ms));
+            return;
+        }
         _prepare_list->commit(mu->data.header.decree, COMMIT_ALL_READY);
     }
 }
@@ -323,6 +395,9 @@ void replica::on_prepare(dsn::message_ex *request)
             "invalid status, %s VS %s",
             enum_to_string(rconfig.status),
             enum_to_string(status()));
+    if (partition_status::PS_SECONDARY == status()) {
+        _secondary_states.on_primary_heard(mu->data.header.last_committed_decree);
+    }
     if (decree <= last_committed_decree()) {
         ack_prepare_message(ERR_OK, mu);
         return;
@@ -442,6 +517,19 @@ void replica::on_prepare_reply(std::pair<mutation_ptr, partition_status::type> p
                                error_code err,
                                dsn::message_ex *request,
                                dsn::message_ex *reply)
+{
+    prepare_ack resp;
+    if (err != ERR_OK) {
+        resp.err = err;
+    } else {
+        ::dsn::unmarshall(reply, resp);
+    }
+    on_prepare_ack(pr, request->to_address, resp);
+}
+
+void replica::on_prepare_ack(std::pair<mutation_ptr, partition_status::type> pr,
+                             ::dsn::rpc_address node,
+                             const prepare_ack &resp)
 {
     _checker.only_one_thread_access();
 
@@ -459,19 +547,8 @@ void replica::on_prepare_reply(std::pair<mutation_ptr, partition_status::type> p
             mu->data.header.ballot,
             get_ballot());
 
-    ::dsn::rpc_address node = request->to_address;
     partition_status::type st = _primary_states.get_node_status(node);
 
-    // handle reply
-    prepare_ack resp;
-
-    // handle error
-    if (err != ERR_OK) {
-        resp.err = err;
-    } else {
-        ::dsn::unmarshall(reply, resp);
-    }
-
     if (resp.err == ERR_OK) {
         dinfo("%s: mutation %s on_prepare_reply from %s, appro_data_bytes = %d, "
               "target_status = %s, err = %s",
@@ -507,6 +584,7 @@ void replica::on_prepare_reply(std::pair<mutation_ptr, partition_status::type> p
             dassert(_primary_states.check_exist(node, partition_status::PS_SECONDARY),
                     "invalid secondary node address, address = %s",
                     node.to_string());
+            renew_read_lease(node, mu->prepare_ts_ms());
             dassert(mu->left_secondary_ack_count() > 0, "%u", mu->left_secondary_ack_count());
             if (0 == mu->decrease_left_secondary_ack_count()) {
                 do_possible_commit_on_primary(mu);
@@ -612,7 +690,7 @@ void replica::ack_prepare_message(error_code err, mutation_ptr &mu)
     const std::vector<dsn::message_ex *> &prepare_requests = mu->prepare_requests();
     dassert(!prepare_requests.empty(), "mutation = %s", mu->name());
     for (auto &request : prepare_requests) {
-        reply(request, resp);
+        _stub->reply_prepare(request, resp);
     }
 
     if (err == ERR_OK) {
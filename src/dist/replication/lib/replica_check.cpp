@@ -51,12 +51,18 @@ void replica::init_group_check()
     if (partition_status::PS_PRIMARY != status() || _options->group_check_disabled)
         return;
 
+    // the read lease is renewed by the group checks if there are no writes
+    int interval_ms = _options->group_check_interval_ms;
+    if (_options->primary_read_lease_enabled) {
+        interval_ms = std::min(interval_ms, std::max(_options->primary_read_lease_ms / 3, 1));
+    }
+
     dassert(nullptr == _primary_states.group_check_task, "");
     _primary_states.group_check_task =
         tasking::enqueue_timer(LPC_GROUP_CHECK,
                                &_tracker,
                                [this] { broadcast_group_check(); },
-                               std::chrono::milliseconds(_options->group_check_interval_ms),
+                               std::chrono::milliseconds(interval_ms),
                                get_gpid().thread_hash());
 }
 
@@ -104,6 +110,7 @@ void replica::broadcast_group_check()
                addr.to_string(),
                enum_to_string(it->second));
 
+        uint64_t send_ts_ms = dsn_now_ms();
         dsn::task_ptr callback_task =
             rpc::call(addr,
                       RPC_GROUP_CHECK,
@@ -111,7 +118,7 @@ void replica::broadcast_group_check()
                       &_tracker,
                       [=](error_code err, group_check_response &&resp) {
                           auto alloc = std::make_shared<group_check_response>(std::move(resp));
-                          on_group_check_reply(err, request, alloc);
+                          on_group_check_reply(err, request, alloc, send_ts_ms);
                       },
                       std::chrono::milliseconds(0),
                       get_gpid().thread_hash());
@@ -162,6 +169,7 @@ void replica::on_group_check(const group_check_request &request,
         if (request.last_committed_decree > last_committed_decree()) {
             _prepare_list->commit(request.last_committed_decree, COMMIT_TO_DECREE_HARD);
         }
+        _secondary_states.on_primary_heard(request.last_committed_decree);
         break;
     case partition_status::PS_POTENTIAL_SECONDARY:
         init_learn(request.config.learner_signature);
@@ -188,7 +196,8 @@ void replica::on_group_check(const group_check_request &request,
 
 void replica::on_group_check_reply(error_code err,
                                    const std::shared_ptr<group_check_request> &req,
-                                   const std::shared_ptr<group_check_response> &resp)
+                                   const std::shared_ptr<group_check_response> &resp,
+                                   uint64_t send_ts_ms)
 {
     _checker.only_one_thread_access();
 
@@ -203,6 +212,9 @@ void replica::on_group_check_reply(error_code err,
         handle_remote_failure(req->config.status, req->node, err, "group check");
     } else {
         if (resp->err == ERR_OK) {
+            if (req->config.status == partition_status::PS_SECONDARY) {
+                renew_read_lease(req->node, send_ts_ms);
+            }
             if (resp->learner_status_ == learner_status::LearningSucceeded &&
                 req->config.status == partition_status::PS_POTENTIAL_SECONDARY) {
                 handle_learning_succeeded_on_primary(req->node, resp->learner_signature);
@@ -213,6 +225,24 @@ void replica::on_group_check_reply(error_code err,
     }
 }
 
+void replica::init_read_lease()
+{
+    _primary_states.read_lease_expire_ms.clear();
+    _primary_states.read_lease_wait_until_ms =
+        _options->primary_read_lease_enabled ? dsn_now_ms() + _options->primary_read_lease_ms : 0;
+}
+
+void replica::renew_read_lease(::dsn::rpc_address node, uint64_t send_ts_ms)
+{
+    if (!_options->primary_read_lease_enabled) {
+        return;
+    }
+
+    // the secondary starts its lease later than send_ts_ms, leave a margin for the clock drift
+    int lease_ms = _options->primary_read_lease_ms;
+    _primary_states.renew_read_lease(node, send_ts_ms + lease_ms - lease_ms / 10);
+}
+
 // for testing purpose only
 void replica::send_group_check_once_for_test(int delay_milliseconds)
 {
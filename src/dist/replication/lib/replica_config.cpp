@@ -34,6 +34,7 @@
  */
 
 #include <boost/lexical_cast.hpp>
+#include <dsn/utility/string_conv.h>
 #include "replica.h"
 #include "mutation.h"
 #include "mutation_log.h"
@@ -529,8 +530,30 @@ void replica::on_update_configuration_on_meta_server_reply(
     _primary_states.reconfiguration_task = nullptr;
 }
 
+void replica::update_stale_read_max_decree_gap(const std::map<std::string, std::string> &envs)
+{
+    int32_t gap = _options->stale_read_max_decree_gap;
+    auto iter = envs.find(replica_envs::STALE_READ_MAX_DECREE_GAP);
+    if (iter != envs.end() && !buf2int32(iter->second, gap)) {
+        dwarn("%s: invalid value of app env %s: %s",
+              name(),
+              replica_envs::STALE_READ_MAX_DECREE_GAP.c_str(),
+              iter->second.c_str());
+        gap = _options->stale_read_max_decree_gap;
+    }
+
+    if (gap != _stale_read_max_decree_gap) {
+        ddebug("%s: update stale_read_max_decree_gap from %d to %d",
+               name(),
+               _stale_read_max_decree_gap,
+               gap);
+        _stale_read_max_decree_gap = gap;
+    }
+}
+
 bool replica::update_app_envs(const std::map<std::string, std::string> &envs)
 {
+    update_stale_read_max_decree_gap(envs);
     if (_app) {
         _app->update_app_envs(envs);
         return true;
@@ -775,6 +798,7 @@ bool replica::update_local_configuration(const replica_configuration &config,
         }
         switch (config.status) {
         case partition_status::PS_PRIMARY:
+            init_read_lease();
             init_group_check();
             replay_prepare_list();
             break;
@@ -833,6 +857,7 @@ bool replica::update_local_configuration(const replica_configuration &config,
         case partition_status::PS_PRIMARY:
             dassert(_inactive_is_transient, "must be in transient state for being primary next");
             _inactive_is_transient = false;
+            init_read_lease();
             init_group_check();
             replay_prepare_list();
             break;
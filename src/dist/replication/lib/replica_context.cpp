@@ -91,9 +91,36 @@ void primary_context::cleanup(bool clean_pending_mutations)
     // clean up checkpoint
     CLEANUP_TASK_ALWAYS(checkpoint_task)
 
+    read_lease_expire_ms.clear();
+
     membership.ballot = 0;
 }
 
+void primary_context::renew_read_lease(::dsn::rpc_address node, uint64_t expire_ms)
+{
+    uint64_t &lease = read_lease_expire_ms[node];
+    lease = std::max(lease, expire_ms);
+}
+
+bool primary_context::is_read_lease_valid(uint64_t now_ms, uint64_t meta_lease_expire_ms) const
+{
+    if (now_ms < read_lease_wait_until_ms) {
+        return false;
+    }
+    if (membership.secondaries.empty()) {
+        // no secondary to grant a lease, while the primary may be deposed once the meta server
+        // takes this node as dead, which is not before the lease from the meta server expires
+        return now_ms < meta_lease_expire_ms;
+    }
+    for (const ::dsn::rpc_address &node : membership.secondaries) {
+        auto it = read_lease_expire_ms.find(node);
+        if (it == read_lease_expire_ms.end() || it->second <= now_ms) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool primary_context::is_cleaned()
 {
     return nullptr == group_check_task && nullptr == reconfiguration_task &&
@@ -164,6 +191,9 @@ bool primary_context::check_exist(::dsn::rpc_address node, partition_status::typ
 
 bool secondary_context::cleanup(bool force)
 {
+    primary_last_committed_decree = invalid_decree;
+    primary_heard_ts_ms = 0;
+
     CLEANUP_TASK(checkpoint_task, force)
 
     if (!force) {
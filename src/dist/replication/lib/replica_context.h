@@ -66,7 +66,8 @@ public:
         : next_learning_version(0),
           write_queue(gpid, max_concurrent_2pc_count, batch_write_disabled),
           last_prepare_decree_on_new_primary(0),
-          last_prepare_ts_ms(dsn_now_ms())
+          last_prepare_ts_ms(dsn_now_ms()),
+          read_lease_wait_until_ms(0)
     {
     }
 
@@ -82,6 +83,11 @@ public:
 
     void do_cleanup_pending_mutations(bool clean_pending_mutations = true);
 
+    void renew_read_lease(::dsn::rpc_address node, uint64_t expire_ms);
+    // 'meta_lease_expire_ms' is the lease of this node granted by the meta server, which is
+    // the only one taken if there is no secondary
+    bool is_read_lease_valid(uint64_t now_ms, uint64_t meta_lease_expire_ms) const;
+
 public:
     // membership mgr, including learners
     partition_configuration membership;
@@ -111,17 +117,41 @@ public:
     dsn::task_ptr checkpoint_task;
 
     uint64_t last_prepare_ts_ms;
+
+    // the read lease granted by each secondary, the primary serves reads only if all of the
+    // current secondaries' are unexpired
+    std::unordered_map<::dsn::rpc_address, uint64_t> read_lease_expire_ms;
+    // a new primary neither commits nor serves reads before this, so that the read lease, which
+    // it may have granted to the former primary as a secondary, has expired
+    uint64_t read_lease_wait_until_ms;
 };
 
 class secondary_context
 {
 public:
-    secondary_context() : checkpoint_is_running(false) {}
+    secondary_context()
+        : checkpoint_is_running(false),
+          primary_last_committed_decree(invalid_decree),
+          primary_heard_ts_ms(0)
+    {
+    }
     bool cleanup(bool force);
     bool is_cleaned();
 
+    // called when the primary of the current ballot shows its last committed decree
+    void on_primary_heard(decree last_committed_decree)
+    {
+        primary_last_committed_decree =
+            std::max(primary_last_committed_decree, last_committed_decree);
+        primary_heard_ts_ms = dsn_now_ms();
+    }
+
 public:
     bool checkpoint_is_running;
+
+    // bound the staleness of the reads served by this secondary
+    decree primary_last_committed_decree;
+    uint64_t primary_heard_ts_ms;
     ::dsn::task_ptr checkpoint_task;
     ::dsn::task_ptr checkpoint_completed_task;
     ::dsn::task_ptr catchup_with_private_log_task;
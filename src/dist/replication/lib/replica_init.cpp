@@ -225,6 +225,7 @@ error_code replica::init_app_and_prepare_list(bool create_new)
                                          _options->log_private_batch_buffer_kb * 1024,
                                          _options->log_private_batch_buffer_count,
                                          _options->log_private_batch_buffer_flush_interval_ms);
+            _private_log->set_direct_io(_options->log_private_direct_io);
             ddebug("%s: plog_dir = %s", name(), log_dir.c_str());
 
             // sync valid_start_offset between app and logs
@@ -325,6 +326,7 @@ error_code replica::init_app_and_prepare_list(bool create_new)
                                          _options->log_private_batch_buffer_kb * 1024,
                                          _options->log_private_batch_buffer_count,
                                          _options->log_private_batch_buffer_flush_interval_ms);
+            _private_log->set_direct_io(_options->log_private_direct_io);
             ddebug("%s: plog_dir = %s", name(), log_dir.c_str());
 
             err = _private_log->open(nullptr, [this](error_code err) {
@@ -66,6 +66,10 @@ replica_stub::replica_stub(replica_state_subscriber subscriber /*= nullptr*/,
       _learn_app_concurrent_count(0),
       _fs_manager(false)
 {
+    _config_sync_epoch = 0;
+    _config_sync_version = 0;
+    _last_full_config_sync_ms = 0;
+    _config_sync_full_required = true;
     _replica_state_subscriber = subscriber;
     _is_long_subscriber = is_long_subscriber;
     _failure_detector = nullptr;
@@ -170,6 +174,15 @@ void replica_stub::install_perf_counters()
         "replicas.recent.prepare.fail.count",
         COUNTER_TYPE_VOLATILE_NUMBER,
         "prepare fail count in the recent period");
+    _counter_replicas_stale_read_qps.init_app_counter("eon.replica_stub",
+                                                      "replicas.stale.read.qps",
+                                                      COUNTER_TYPE_RATE,
+                                                      "reads served by the secondaries per second");
+    _counter_replicas_stale_read_forward_qps.init_app_counter(
+        "eon.replica_stub",
+        "replicas.stale.read.forward.qps",
+        COUNTER_TYPE_RATE,
+        "reads forwarded to the primaries by the too stale secondaries per second");
     _counter_replicas_recent_replica_move_error_count.init_app_counter(
         "eon.replica_stub",
         "replicas.recent.replica.move.error.count",
@@ -197,6 +210,20 @@ void replica_stub::install_perf_counters()
 
     _counter_shared_log_size.init_app_counter(
         "eon.replica_stub", "shared.log.size(MB)", COUNTER_TYPE_NUMBER, "shared log size(MB)");
+    _counter_replicas_load_time_ms.init_app_counter("eon.replica_stub",
+                                                    "replicas.load.time(ms)",
+                                                    COUNTER_TYPE_NUMBER,
+                                                    "time used to load replicas on startup");
+    _counter_shared_log_replay_time_ms.init_app_counter(
+        "eon.replica_stub",
+        "shared.log.replay.time(ms)",
+        COUNTER_TYPE_NUMBER,
+        "time used to replay shared log on startup");
+    _counter_shared_log_replay_throughput.init_app_counter(
+        "eon.replica_stub",
+        "shared.log.replay.throughput(KB/s)",
+        COUNTER_TYPE_NUMBER,
+        "throughput of replaying shared log on startup");
     _counter_recent_trigger_emergency_checkpoint_count.init_app_counter(
         "eon.replica_stub",
         "recent.trigger.emergency.checkpoint.count",
@@ -325,8 +352,16 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
         dassert(err == dsn::ERR_OK, "initialize fs manager failed, err(%s)", err.to_string());
     }
 
-    _log = new mutation_log_shared(
-        _options.slog_dir, _options.log_shared_file_size_mb, _options.log_shared_force_flush);
+    _log = new mutation_log_shared(_options.slog_dir,
+                                   _options.log_shared_file_size_mb,
+                                   _options.log_shared_force_flush,
+                                   _options.log_shared_replay_thread_count,
+                                   (uint32_t)_options.log_shared_group_commit_max_kb * 1024,
+                                   _options.log_shared_group_commit
+                                       ? (uint64_t)_options.log_shared_group_commit_max_wait_us
+                                       : 0);
+    _log->set_segment_pool_size(_options.log_shared_segment_pool_count);
+    _log->set_direct_io(_options.log_shared_direct_io);
     ddebug("slog_dir = %s", _options.slog_dir.c_str());
 
     // init rps
@@ -395,6 +430,7 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
     ddebug("load replicas succeed, replica_count = %d, time_used = %" PRIu64 " ms",
            static_cast<int>(rps.size()),
            finish_time - start_time);
+    _counter_replicas_load_time_ms->set(finish_time - start_time);
 
     // init shared prepare log
     ddebug("start to replay shared log");
@@ -404,9 +440,11 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
         replay_condition[it->first] = it->second->last_committed_decree();
     }
 
+    uint64_t replay_bytes = 0;
     start_time = dsn_now_ms();
     error_code err = _log->open(
-        [&rps](int log_length, mutation_ptr &mu) {
+        [&rps, &replay_bytes](int log_length, mutation_ptr &mu) {
+            replay_bytes += log_length;
             auto it = rps.find(mu->data.header.pid);
             if (it != rps.end()) {
                 return it->second->replay_mutation(mu, false);
@@ -417,9 +455,14 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
         [this](error_code err) { this->handle_log_failure(err); },
         replay_condition);
     finish_time = dsn_now_ms();
+    _counter_shared_log_replay_time_ms->set(finish_time - start_time);
+    _counter_shared_log_replay_throughput->set(replay_bytes * 1000 / 1024 /
+                                               std::max(finish_time - start_time, (uint64_t)1));
 
     if (err == ERR_OK) {
-        ddebug("replay shared log succeed, time_used = %" PRIu64 " ms", finish_time - start_time);
+        ddebug("replay shared log succeed, size = %" PRIu64 ", time_used = %" PRIu64 " ms",
+               replay_bytes,
+               finish_time - start_time);
     } else {
         derror("replay shared log failed, err = %s, time_used = %" PRIu64 " ms, clear all logs ...",
                err.to_string(),
@@ -453,8 +496,16 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
         if (!utils::filesystem::remove_path(_options.slog_dir)) {
             dassert(false, "remove directory %s failed", _options.slog_dir.c_str());
         }
-        _log = new mutation_log_shared(
-            _options.slog_dir, _options.log_shared_file_size_mb, _options.log_shared_force_flush);
+        _log = new mutation_log_shared(_options.slog_dir,
+                                       _options.log_shared_file_size_mb,
+                                       _options.log_shared_force_flush,
+                                       _options.log_shared_replay_thread_count,
+                                       (uint32_t)_options.log_shared_group_commit_max_kb * 1024,
+                                       _options.log_shared_group_commit
+                                           ? (uint64_t)_options.log_shared_group_commit_max_wait_us
+                                           : 0);
+        _log->set_segment_pool_size(_options.log_shared_segment_pool_count);
+        _log->set_direct_io(_options.log_shared_direct_io);
         auto lerr = _log->open(nullptr, [this](error_code err) { this->handle_log_failure(err); });
         dassert(lerr == ERR_OK, "restart log service must succeed");
     }
@@ -562,6 +613,13 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
     _cli_service = std::move(dsn::cli_service::create_service());
     _cli_service->open_service();
 
+    // always there to ack the prepares batched by the peers, see prepare_batch_enabled
+    _prepare_batcher.reset(
+        new prepare_batcher(_options.prepare_batch_delay_ms,
+                            _options.prepare_batch_max_bytes,
+                            std::max(1, _options.prepare_timeout_ms_for_secondaries / 10)));
+    _prepare_batcher->start();
+
     if (_options.delay_for_fd_timeout_on_start) {
         uint64_t now_time_ms = dsn_now_ms();
         uint64_t delay_time_ms =
@@ -859,7 +917,60 @@ void replica_stub::on_prepare(dsn::message_ex *request)
         prepare_ack resp;
         resp.pid = id;
         resp.err = ERR_OBJECT_NOT_FOUND;
-        reply(request, resp);
+        reply_prepare(request, resp);
+    }
+}
+
+void replica_stub::on_prepare_batch(dsn::message_ex *request)
+{
+    rpc_read_stream reader(request);
+    int32_t count = 0;
+    reader.read(count);
+    for (int32_t i = 0; i < count; i++) {
+        uint64_t key;
+        int32_t len;
+        blob body;
+        reader.read(key);
+        reader.read(len);
+        reader.read(body, len);
+
+        // peek the gpid to dispatch the prepare to the thread of the replica
+        gpid id;
+        {
+            binary_reader peeker(body);
+            unmarshall(peeker, id, DSF_THRIFT_BINARY);
+        }
+
+        // the prepare is acked with its key in a batch, see reply_prepare
+        dsn::message_ex *prepare = message_ex::create_receive_message_with_standalone_header(body);
+        prepare->local_rpc_code = RPC_PREPARE_BATCH;
+        prepare->header->id = key;
+        prepare->header->from_address = request->header->from_address;
+        prepare->header->gpid = id;
+        prepare->header->client.thread_hash = id.thread_hash();
+        prepare->header->context.u.serialize_format = DSF_THRIFT_BINARY;
+        prepare->add_ref(); // released after on_prepare
+        tasking::enqueue(LPC_PREPARE_IN_BATCH,
+                         &_tracker,
+                         [this, prepare]() {
+                             on_prepare(prepare);
+                             prepare->release_ref();
+                         },
+                         id.thread_hash());
+    }
+}
+
+void replica_stub::on_prepare_ack_batch(dsn::message_ex *msg)
+{
+    _prepare_batcher->on_ack_batch(msg);
+}
+
+void replica_stub::reply_prepare(dsn::message_ex *request, const prepare_ack &ack)
+{
+    if (request->local_rpc_code == RPC_PREPARE_BATCH) {
+        _prepare_batcher->send_ack(request->header->from_address, request->header->id, ack);
+    } else {
+        reply(request, ack);
     }
 }
 
@@ -1031,14 +1142,21 @@ void replica_stub::query_configuration_by_node()
     configuration_query_by_node_request req;
     req.node = _primary_address;
 
-    // TODO: send stored replicas may cost network, we shouldn't config the frequency
-    get_local_replicas(req.stored_replicas);
-    req.__isset.stored_replicas = true;
+    if (is_full_config_sync_needed()) {
+        // TODO: send stored replicas may cost network, we shouldn't config the frequency
+        get_local_replicas(req.stored_replicas);
+        req.__isset.stored_replicas = true;
+    } else {
+        req.__set_last_sync_epoch(_config_sync_epoch);
+        req.__set_last_sync_version(_config_sync_version);
+    }
 
     ::dsn::marshall(msg, req);
 
-    ddebug("send query node partitions request to meta server, stored_replicas_count = %d",
-           (int)req.stored_replicas.size());
+    ddebug("send query node partitions request to meta server, stored_replicas_count = %d, "
+           "last_sync_version = %" PRId64,
+           (int)req.stored_replicas.size(),
+           req.last_sync_version);
 
     rpc_address target(_failure_detector->get_servers());
     _config_query_task =
@@ -1050,6 +1168,25 @@ void replica_stub::query_configuration_by_node()
                   });
 }
 
+uint64_t replica_stub::meta_server_lease_expire_ms() const
+{
+    if (!is_connected() || _failure_detector == nullptr) {
+        return 0;
+    }
+    return _failure_detector->get_master_lease_expire_ms(
+        _failure_detector->current_server_contact());
+}
+
+bool replica_stub::is_full_config_sync_needed()
+{
+    // ask for the changed configurations only, and leave the stored replicas to the periodical
+    // full sync, which also recovers anything missed by the delta sync
+    bool full_required = _config_sync_full_required.exchange(false);
+    return full_required || _config_sync_version <= 0 ||
+           _options.config_sync_full_interval_ms <= 0 ||
+           dsn_now_ms() >= _last_full_config_sync_ms + _options.config_sync_full_interval_ms;
+}
+
 void replica_stub::on_meta_server_connected()
 {
     ddebug("meta server connected");
@@ -1074,6 +1211,7 @@ void replica_stub::on_node_query_reply(error_code err,
     zauto_lock l(_state_lock);
     _config_query_task = nullptr;
     if (err != ERR_OK) {
+        _config_sync_full_required = true;
         if (_state == NS_Connecting) {
             query_configuration_by_node();
         }
@@ -1106,13 +1244,27 @@ void replica_stub::on_node_query_reply(error_code err,
         }
         if (resp.err != ERR_OK) {
             ddebug("ignore query node partitions response for resp.err = %s", resp.err.to_string());
+            _config_sync_full_required = true;
             return;
         }
 
+        // no more than one query is in flight, so the delta is always based on our version
+        bool is_delta = resp.__isset.is_delta && resp.is_delta;
+        if (resp.__isset.sync_version) {
+            _config_sync_epoch = resp.sync_epoch;
+            _config_sync_version = resp.sync_version;
+            if (!is_delta) {
+                _last_full_config_sync_ms = dsn_now_ms();
+            }
+        }
+
         ddebug("process query node partitions response for resp.err = ERR_OK, "
-               "partitions_count(%d), gc_replicas_count(%d)",
+               "partitions_count(%d), gc_replicas_count(%d), is_delta(%s), sync_version(%" PRId64
+               ")",
                (int)resp.partitions.size(),
-               (int)resp.gc_replicas.size());
+               (int)resp.gc_replicas.size(),
+               is_delta ? "true" : "false",
+               _config_sync_version);
 
         replicas rs;
         {
@@ -1128,7 +1280,10 @@ void replica_stub::on_node_query_reply(error_code err,
                              it->config.pid.thread_hash());
         }
 
-        // for rps not exist on meta_servers
+        // for rps not exist on meta_servers, which can only be told by the full sync
+        if (is_delta) {
+            rs.clear();
+        }
         for (auto it = rs.begin(); it != rs.end(); ++it) {
             tasking::enqueue(
                 LPC_QUERY_NODE_CONFIGURATION_SCATTER2,
@@ -1252,6 +1407,7 @@ void replica_stub::on_meta_server_disconnected()
         return;
 
     _state = NS_Disconnected;
+    _config_sync_full_required = true;
 
     replicas rs;
     {
@@ -1637,6 +1793,7 @@ void replica_stub::on_disk_stat()
 
             _replicas.emplace(id, rep);
             _counter_replicas_count->increment();
+            _config_sync_full_required = true;
 
             _closed_replicas.erase(id);
 
@@ -1736,6 +1893,7 @@ void replica_stub::open_replica(const app_info &app,
         dassert(it == _replicas.end(), "replica %s is already in _replicas", id.to_string());
         _replicas.insert(replicas::value_type(rep->get_gpid(), rep));
         _counter_replicas_count->increment();
+        _config_sync_full_required = true;
 
         _closed_replicas.erase(id);
     }
@@ -1814,6 +1972,13 @@ void replica_stub::close_replica(replica_ptr r)
 
 void replica_stub::notify_replica_state_update(const replica_configuration &config, bool is_closing)
 {
+    // a replica stuck in inactive or error is repaired by replica::on_config_sync(), while its
+    // configuration is left out of the delta config sync if unchanged on the meta server
+    if (config.status == partition_status::PS_INACTIVE ||
+        config.status == partition_status::PS_ERROR) {
+        _config_sync_full_required = true;
+    }
+
     if (nullptr != _replica_state_subscriber) {
         if (_is_long_subscriber) {
             tasking::enqueue(
@@ -1844,6 +2009,9 @@ void replica_stub::open_service()
     register_rpc_handler(RPC_CONFIG_PROPOSAL, "ProposeConfig", &replica_stub::on_config_proposal);
 
     register_rpc_handler(RPC_PREPARE, "prepare", &replica_stub::on_prepare);
+    register_rpc_handler(RPC_PREPARE_BATCH, "prepare_batch", &replica_stub::on_prepare_batch);
+    register_rpc_handler(
+        RPC_PREPARE_ACK_BATCH, "prepare_ack_batch", &replica_stub::on_prepare_ack_batch);
     register_rpc_handler(RPC_LEARN, "Learn", &replica_stub::on_learn);
     register_rpc_handler(RPC_LEARN_COMPLETION_NOTIFY,
                          "LearnNotify",
@@ -2132,6 +2300,11 @@ void replica_stub::close()
         }
     }
 
+    // kept for the late replies of the prepares still being handled
+    if (_prepare_batcher != nullptr) {
+        _prepare_batcher->stop();
+    }
+
     if (_failure_detector != nullptr) {
         _failure_detector->stop();
         delete _failure_detector;
@@ -43,6 +43,7 @@
 #include "dist/replication/common/fs_manager.h"
 #include "dist/replication/common/block_service_manager.h"
 #include "replica.h"
+#include "prepare_batcher.h"
 
 namespace dsn {
 namespace replication {
@@ -105,6 +106,8 @@ public:
     //        - learn
     //
     void on_prepare(dsn::message_ex *request);
+    void on_prepare_batch(dsn::message_ex *request);
+    void on_prepare_ack_batch(dsn::message_ex *msg);
     void on_learn(dsn::message_ex *msg);
     void on_learn_completion_notification(const group_check_response &report,
                                           /*out*/ learn_notify_response &response);
@@ -136,6 +139,8 @@ public:
     replica_ptr get_replica(gpid id);
     replication_options &options() { return _options; }
     bool is_connected() const { return NS_Connected == _state; }
+    // till when this node is not taken as dead by the meta server, 0 if not connected
+    uint64_t meta_server_lease_expire_ms() const;
 
     std::string get_replica_dir(const char *app_type, gpid id, bool create_new = true);
 
@@ -171,6 +176,9 @@ private:
 
     void initialize_start();
     void query_configuration_by_node();
+    // if the next config sync should send the stored replicas and get all the partitions,
+    // rather than a delta; the requirement of a full one is reset
+    bool is_full_config_sync_needed();
     void on_meta_server_disconnected_scatter(replica_stub_ptr this_, gpid id);
     void on_node_query_reply(error_code err, dsn::message_ex *request, dsn::message_ex *response);
     void on_node_query_reply_scatter(replica_stub_ptr this_,
@@ -190,6 +198,8 @@ private:
     void notify_replica_state_update(const replica_configuration &config, bool is_closing);
     void trigger_checkpoint(replica_ptr r, bool is_emergency);
     void handle_log_failure(error_code err);
+    // reply the prepare to the primary, in a batch of acks if it came in a batch of prepares
+    void reply_prepare(dsn::message_ex *request, const prepare_ack &ack);
 
     void install_perf_counters();
     dsn::error_code on_kill_replica(gpid id);
@@ -205,6 +215,7 @@ private:
     friend class ::dsn::replication::replica;
     friend class ::dsn::replication::potential_secondary_context;
     friend class ::dsn::replication::cold_backup_context;
+    friend class ::replication_service_test_app;
     typedef std::unordered_map<gpid, ::dsn::task_ptr> opening_replicas;
     typedef std::unordered_map<gpid, std::tuple<task_ptr, replica_ptr, app_info, replica_info>>
         closing_replicas; // <gpid, <close_task, replica, app_info, replica_info> >
@@ -231,6 +242,13 @@ private:
 
     // temproal states
     ::dsn::task_ptr _config_query_task;
+    // for delta config sync, protected by _state_lock
+    int64_t _config_sync_epoch;
+    int64_t _config_sync_version;
+    uint64_t _last_full_config_sync_ms;
+    // replicas opened, or become inactive or error since the last sync need all the
+    // configurations, as the unchanged ones are not in the delta
+    std::atomic<bool> _config_sync_full_required;
     ::dsn::task_ptr _config_sync_timer_task;
     ::dsn::task_ptr _gc_timer_task;
     ::dsn::task_ptr _disk_stat_timer_task;
@@ -265,6 +283,10 @@ private:
     // cli service
     std::unique_ptr<dsn::cli_service> _cli_service;
 
+    // batches the prepares and acks of different partitions to the same node, while the prepares
+    // are batched only if prepare_batch_enabled
+    std::unique_ptr<prepare_batcher> _prepare_batcher;
+
     // performance counters
     perf_counter_wrapper _counter_replicas_count;
     perf_counter_wrapper _counter_replicas_opening_count;
@@ -287,6 +309,8 @@ private:
     perf_counter_wrapper _counter_replicas_learning_recent_learn_succ_count;
 
     perf_counter_wrapper _counter_replicas_recent_prepare_fail_count;
+    perf_counter_wrapper _counter_replicas_stale_read_qps;
+    perf_counter_wrapper _counter_replicas_stale_read_forward_qps;
     perf_counter_wrapper _counter_replicas_recent_replica_move_error_count;
     perf_counter_wrapper _counter_replicas_recent_replica_move_garbage_count;
     perf_counter_wrapper _counter_replicas_recent_replica_remove_dir_count;
@@ -294,6 +318,9 @@ private:
     perf_counter_wrapper _counter_replicas_garbage_replica_dir_count;
 
     perf_counter_wrapper _counter_shared_log_size;
+    perf_counter_wrapper _counter_replicas_load_time_ms;
+    perf_counter_wrapper _counter_shared_log_replay_time_ms;
+    perf_counter_wrapper _counter_shared_log_replay_throughput;
     perf_counter_wrapper _counter_recent_trigger_emergency_checkpoint_count;
 
     perf_counter_wrapper _counter_cold_backup_running_count;
@@ -365,6 +365,7 @@ void app_state_helper::on_init_partitions()
     context.msg = nullptr;
 
     context.prefered_dropped = -1;
+    context.sync_version = 0;
     contexts.assign(owner->partition_count, context);
 
     std::vector<partition_configuration> &partitions = owner->partitions;
@@ -402,7 +403,11 @@ std::shared_ptr<app_state> app_state::create(const app_info &info)
 }
 
 node_state::node_state()
-    : total_primaries(0), total_partitions(0), is_alive(false), has_collected_replicas(false)
+    : total_primaries(0),
+      total_partitions(0),
+      is_alive(false),
+      has_collected_replicas(false),
+      removed_sync_version(0)
 {
 }
 
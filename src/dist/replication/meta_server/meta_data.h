@@ -209,6 +209,9 @@ public:
     // TODO: a more clear implementation
     int32_t prefered_dropped;
     //]
+
+    // the config sync version when the partition is changed lastly
+    int64_t sync_version;
 public:
     void check_size();
     void cancel_sync();
@@ -358,6 +361,9 @@ private:
     // status
     bool is_alive;
     bool has_collected_replicas;
+    // the config sync version when a partition is removed from the node lastly, which can't
+    // be told by the delta config sync
+    int64_t removed_sync_version;
     dsn::rpc_address address;
 
     const partition_set *get_partitions(app_id id, bool only_primary) const;
@@ -382,6 +388,8 @@ public:
     void set_alive(bool alive) { is_alive = alive; }
     bool has_collected() { return has_collected_replicas; }
     void set_replicas_collect_flag(bool has_collected) { has_collected_replicas = has_collected; }
+    int64_t get_removed_sync_version() const { return removed_sync_version; }
+    void set_removed_sync_version(int64_t version) { removed_sync_version = version; }
     dsn::rpc_address addr() const { return address; }
     void set_addr(const dsn::rpc_address &addr) { address = addr; }
 
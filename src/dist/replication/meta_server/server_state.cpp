@@ -38,6 +38,7 @@
 #include <dsn/tool-api/task.h>
 #include <dsn/tool-api/command_manager.h>
 #include <dsn/tool-api/async_calls.h>
+#include <dsn/utility/rand.h>
 #include <sstream>
 #include <cinttypes>
 #include <string>
@@ -58,6 +59,10 @@ static const char *unlock_state = "unlock";
 
 server_state::server_state()
     : _meta_svc(nullptr),
+      _config_sync_epoch(
+          (int64_t)dsn::rand::next_u64(1, std::numeric_limits<int64_t>::max())),
+      _config_sync_version(0),
+      _config_sync_full_version(0),
       _add_secondary_enable_flow_control(false),
       _add_secondary_max_count_for_one_node(0),
       _cli_dump_handle(nullptr),
@@ -237,6 +242,7 @@ void server_state::transition_staging_state(std::shared_ptr<app_state> &app)
     } while (0)
 
     app_status::type old_status = app->status;
+    invalidate_config_sync_deltas();
     if (app->status == app_status::AS_CREATING) {
         app->status = app_status::AS_AVAILABLE;
         configuration_create_app_response resp;
@@ -798,9 +804,22 @@ void server_state::on_config_sync(dsn::message_ex *msg)
             response.err = ERR_OBJECT_NOT_FOUND;
         } else {
             response.err = ERR_OK;
-            unsigned int i = 0;
-            response.partitions.resize(ns->partition_count());
-            ns->for_each_partition([&, this](const gpid &pid) {
+
+            // only the partitions changed since the last sync are replied, unless the replica
+            // server synced with another meta server, or something untracked is changed since
+            bool is_delta = request.__isset.last_sync_version &&
+                            request.last_sync_epoch == _config_sync_epoch &&
+                            request.last_sync_version <= _config_sync_version &&
+                            request.last_sync_version >= _config_sync_full_version &&
+                            request.last_sync_version >= ns->get_removed_sync_version();
+            response.__set_sync_epoch(_config_sync_epoch);
+            response.__set_sync_version(_config_sync_version);
+            response.__set_is_delta(is_delta);
+            if (!is_delta) {
+                response.partitions.reserve(ns->partition_count());
+            }
+
+            reject_this_request = !ns->for_each_partition([&, this](const gpid &pid) {
                 std::shared_ptr<app_state> app = get_app(pid.get_app_id());
                 dassert(app != nullptr, "invalid app_id, app_id = %d", pid.get_app_id());
                 config_context &cc = app->helpers->contexts[pid.get_partition_index()];
@@ -814,15 +833,17 @@ void server_state::on_config_sync(dsn::message_ex *msg)
                         return false;
                 }
 
-                response.partitions[i].info = *app;
-                response.partitions[i].config = app->partitions[pid.get_partition_index()];
-                response.partitions[i].host_node = request.node;
-                ++i;
+                if (is_delta && cc.sync_version <= request.last_sync_version) {
+                    return true;
+                }
+
+                response.partitions.emplace_back();
+                configuration_update_request &update = response.partitions.back();
+                update.info = *app;
+                update.config = app->partitions[pid.get_partition_index()];
+                update.host_node = request.node;
                 return true;
             });
-            if (i < response.partitions.size()) {
-                reject_this_request = true;
-            }
         }
 
         // handle the stored replicas & the gc replicas
@@ -1153,6 +1174,7 @@ void server_state::drop_app(dsn::message_ex *msg)
             case app_status::AS_AVAILABLE:
                 do_dropping = true;
                 app->status = app_status::AS_DROPPING;
+                invalidate_config_sync_deltas();
                 app->drop_second = dsn_now_ms() / 1000;
                 if (request.options.__isset.reserve_seconds &&
                     request.options.reserve_seconds > 0) {
@@ -1240,6 +1262,7 @@ void server_state::recall_app(dsn::message_ex *msg)
                     do_recalling = true;
                     target_app->app_name = new_app_name;
                     target_app->status = app_status::AS_RECALLING;
+                    invalidate_config_sync_deltas();
                     dassert(target_app->helpers->partitions_in_progress.load() == 0,
                             "partition_in_progress_cnt = %d",
                             target_app->helpers->partitions_in_progress.load());
@@ -1369,6 +1392,7 @@ void server_state::update_configuration_locally(
     partition_configuration &old_cfg = app.partitions[gpid.get_partition_index()];
     partition_configuration &new_cfg = config_request->config;
 
+    int64_t sync_version = ++_config_sync_version;
     int min_2pc_count = _meta_svc->get_options().mutation_2pc_min_replica_count;
     health_status old_health_status = partition_health_status(old_cfg, min_2pc_count);
     health_status new_health_status = partition_health_status(new_cfg, min_2pc_count);
@@ -1407,6 +1431,7 @@ void server_state::update_configuration_locally(
         case config_type::CT_DOWNGRADE_TO_INACTIVE:
         case config_type::CT_REMOVE:
             ns->remove_partition(gpid, false);
+            ns->set_removed_sync_version(sync_version);
             break;
         // nothing to handle, the ballot will updated in below
         case config_type::CT_PRIMARY_FORCE_UPDATE_BALLOT:
@@ -1415,8 +1440,10 @@ void server_state::update_configuration_locally(
         case config_type::CT_DROP_PARTITION:
             for (const rpc_address &node : new_cfg.last_drops) {
                 ns = get_node_state(_nodes, node, false);
-                if (ns != nullptr)
+                if (ns != nullptr) {
                     ns->remove_partition(gpid, false);
+                    ns->set_removed_sync_version(sync_version);
+                }
             }
             break;
 
@@ -1454,6 +1481,7 @@ void server_state::update_configuration_locally(
                 config_request->host_node.to_string());
         if (config_type::CT_REMOVE == config_request->type) {
             it->second.remove_partition(gpid, false);
+            it->second.set_removed_sync_version(sync_version);
         } else {
             it->second.put_partition(gpid, false);
         }
@@ -1463,6 +1491,7 @@ void server_state::update_configuration_locally(
     // as we sync to remote storage according to it
     std::string old_config_str = boost::lexical_cast<std::string>(old_cfg);
     old_cfg = config_request->config;
+    app.helpers->contexts[gpid.get_partition_index()].sync_version = sync_version;
     auto find_name = _config_type_VALUES_TO_NAMES.find(config_request->type);
     if (find_name != _config_type_VALUES_TO_NAMES.end()) {
         ddebug("meta update config ok: type(%s), old_config=%s, %s",
@@ -2620,6 +2649,7 @@ void server_state::set_app_envs(const app_env_rpc &env_rpc)
         for (int idx = 0; idx < keys.size(); idx++) {
             app->envs[keys[idx]] = values[idx];
         }
+        invalidate_config_sync_deltas();
         std::string new_envs = dsn::utils::kv_map_to_string(app->envs, ',', '=');
         ddebug("app envs changed: old_envs = {%s}, new_envs = {%s}",
                old_envs.c_str(),
@@ -2693,6 +2723,7 @@ void server_state::del_app_envs(const app_env_rpc &env_rpc)
         for (const auto &key : keys) {
             app->envs.erase(key);
         }
+        invalidate_config_sync_deltas();
         std::string new_envs = dsn::utils::kv_map_to_string(app->envs, ',', '=');
         ddebug("app envs changed: old_envs = {%s}, new_envs = {%s}",
                old_envs.c_str(),
@@ -2791,6 +2822,7 @@ void server_state::clear_app_envs(const app_env_rpc &env_rpc)
                     app->envs.erase(key);
                 }
             }
+            invalidate_config_sync_deltas();
             std::string new_envs = dsn::utils::kv_map_to_string(app->envs, ',', '=');
             ddebug("app envs changed: old_envs = {%s}, new_envs = {%s}",
                    old_envs.c_str(),
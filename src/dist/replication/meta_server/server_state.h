@@ -296,6 +296,11 @@ private:
     void process_one_partition(std::shared_ptr<app_state> &app);
     void transition_staging_state(std::shared_ptr<app_state> &app);
 
+    // the app infos are replied along with the partition configs in config sync, so the
+    // deltas can't be trusted after any of them is changed
+    // assert(_lock.locked() for write)
+    void invalidate_config_sync_deltas() { _config_sync_full_version = ++_config_sync_version; }
+
 private:
     friend class replication_checker;
     friend class test::test_checker;
@@ -317,6 +322,11 @@ private:
     // for load balancer
     migration_list _temporary_list;
 
+    // for delta config sync, protected by _lock
+    int64_t _config_sync_epoch;
+    int64_t _config_sync_version;
+    int64_t _config_sync_full_version;
+
     // for test
     config_change_subscriber _config_change_subscriber;
     replica_migration_subscriber _replica_migration_subscriber;
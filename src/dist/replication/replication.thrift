@@ -229,6 +229,11 @@ struct configuration_query_by_node_request
     1:dsn.rpc_address  node;
     2:optional list<replica_info> stored_replicas;
     3:optional replica_server_info info;
+
+    // the epoch and version of the last config sync response, with which the meta server
+    // replies only the partitions changed since then
+    4:optional i64 last_sync_epoch;
+    5:optional i64 last_sync_version;
 }
 
 struct configuration_query_by_node_response
@@ -236,6 +241,13 @@ struct configuration_query_by_node_response
     1:dsn.error_code err;
     2:list<configuration_update_request> partitions;
     3:optional list<replica_info> gc_replicas;
+
+    // the epoch is generated at the start of the meta server, and the version increases
+    // whenever a config is changed
+    4:optional i64 sync_epoch;
+    5:optional i64 sync_version;
+    // true if only the changed partitions are replied
+    6:optional bool is_delta;
 }
 
 struct create_app_options
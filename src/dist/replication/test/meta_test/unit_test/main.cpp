@@ -57,6 +57,8 @@ TEST(meta, json_compacity) { g_app->json_compacity(); }
 
 TEST(meta, adjust_dropped_size) { g_app->adjust_dropped_size(); }
 
+TEST(meta, config_sync_delta) { g_app->config_sync_delta_test(); }
+
 TEST(meta, policy_context_test) { g_app->policy_context_test(); }
 
 TEST(meta, backup_service_test) { g_app->backup_service_test(); }
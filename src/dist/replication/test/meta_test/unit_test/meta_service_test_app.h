@@ -99,6 +99,9 @@ public:
     // test for bug found
     void adjust_dropped_size();
 
+    // test server_state replies only the changed partitions in config sync
+    void config_sync_delta_test();
+
     void call_update_configuration(
         dsn::replication::meta_service *svc,
         std::shared_ptr<dsn::replication::configuration_update_request> &request);
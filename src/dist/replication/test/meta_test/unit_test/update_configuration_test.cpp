@@ -326,6 +326,139 @@ void meta_service_test_app::adjust_dropped_size()
     spin_wait_condition(status_check, 10);
 }
 
+class config_sync_meta_service : public null_meta_service
+{
+public:
+    virtual void reply_message(dsn::message_ex *request, dsn::message_ex *response) override
+    {
+        dsn::message_ex *recv_response = create_corresponding_receive(response);
+        ::dsn::unmarshall(recv_response, last_response);
+        destroy_message(response);
+        destroy_message(recv_response);
+    }
+
+    configuration_query_by_node_response last_response;
+};
+
+static configuration_query_by_node_response
+config_sync(config_sync_meta_service *svc,
+            server_state *ss,
+            const configuration_query_by_node_request &request)
+{
+    dsn::message_ex *fake_request = dsn::message_ex::create_request(RPC_CM_CONFIG_SYNC);
+    ::dsn::marshall(fake_request, request);
+    dsn::message_ex *recvd_request = create_corresponding_receive(fake_request);
+    recvd_request->add_ref();
+    destroy_message(fake_request);
+
+    ss->on_config_sync(recvd_request);
+    return svc->last_response;
+}
+
+void meta_service_test_app::config_sync_delta_test()
+{
+    dsn::error_code ec;
+    std::shared_ptr<config_sync_meta_service> svc(new config_sync_meta_service());
+    svc->_failure_detector.reset(new dsn::replication::meta_server_failure_detector(svc.get()));
+    ec = svc->remote_storage_initialize();
+    ASSERT_EQ(ec, dsn::ERR_OK);
+    svc->_balancer.reset(new simple_load_balancer(svc.get()));
+
+    server_state *ss = svc->_state.get();
+    ss->initialize(svc.get(), meta_options::concat_path_unix_style(svc->_cluster_root, "apps"));
+    dsn::app_info info;
+    info.is_stateful = true;
+    info.status = dsn::app_status::AS_CREATING;
+    info.app_id = 1;
+    info.app_name = "simple_kv.instance0";
+    info.app_type = "simple_kv";
+    info.max_replica_count = 3;
+    info.partition_count = 2;
+    std::shared_ptr<app_state> app = app_state::create(info);
+
+    ss->_all_apps.emplace(1, app);
+
+    std::vector<dsn::rpc_address> nodes;
+    generate_node_list(nodes, 3, 3);
+    for (int i = 0; i < 2; ++i) {
+        dsn::partition_configuration &pc = app->partitions[i];
+        pc.primary = nodes[i];
+        pc.secondaries = {nodes[1 - i], nodes[2]};
+        pc.ballot = 3;
+    }
+
+    ss->sync_apps_to_remote_storage();
+    ASSERT_TRUE(ss->spin_wait_staging(30));
+    ss->initialize_node_state();
+
+    // the first sync replies all the partitions
+    configuration_query_by_node_request request;
+    request.node = nodes[0];
+    configuration_query_by_node_response response = config_sync(svc.get(), ss, request);
+    ASSERT_EQ(dsn::ERR_OK, response.err);
+    ASSERT_FALSE(response.is_delta);
+    ASSERT_EQ(2, response.partitions.size());
+
+    // nothing is changed since then
+    request.__set_last_sync_epoch(response.sync_epoch);
+    request.__set_last_sync_version(response.sync_version);
+    response = config_sync(svc.get(), ss, request);
+    ASSERT_TRUE(response.is_delta);
+    ASSERT_EQ(0, response.partitions.size());
+    ASSERT_EQ(request.last_sync_version, response.sync_version);
+
+    // only the changed partition is replied
+    std::shared_ptr<configuration_update_request> update =
+        std::make_shared<configuration_update_request>();
+    update->info = *app;
+    update->config = app->partitions[0];
+    update->config.ballot++;
+    update->node = nodes[0];
+    update->type = config_type::CT_PRIMARY_FORCE_UPDATE_BALLOT;
+    ss->update_configuration_locally(*app, update);
+
+    response = config_sync(svc.get(), ss, request);
+    ASSERT_TRUE(response.is_delta);
+    ASSERT_EQ(1, response.partitions.size());
+    ASSERT_EQ(app->partitions[0].pid, response.partitions[0].config.pid);
+    ASSERT_EQ(4, response.partitions[0].config.ballot);
+    ASSERT_LT(request.last_sync_version, response.sync_version);
+
+    // the other nodes are not affected
+    configuration_query_by_node_request request2 = request;
+    request2.node = nodes[1];
+    response = config_sync(svc.get(), ss, request2);
+    ASSERT_TRUE(response.is_delta);
+    ASSERT_EQ(1, response.partitions.size());
+    request.last_sync_version = response.sync_version;
+
+    // a removed partition can only be told by the full sync
+    update->config = app->partitions[1];
+    update->config.ballot++;
+    update->config.secondaries = {nodes[2]};
+    update->node = nodes[0];
+    update->type = config_type::CT_REMOVE;
+    int64_t before_remove_version = request.last_sync_version;
+    ss->update_configuration_locally(*app, update);
+
+    response = config_sync(svc.get(), ss, request);
+    ASSERT_FALSE(response.is_delta);
+    ASSERT_EQ(1, response.partitions.size());
+    ASSERT_EQ(app->partitions[0].pid, response.partitions[0].config.pid);
+    request.last_sync_version = response.sync_version;
+    response = config_sync(svc.get(), ss, request);
+    ASSERT_TRUE(response.is_delta);
+    ASSERT_EQ(0, response.partitions.size());
+
+    // so does a changed app info, and a sync with another meta server
+    request2.last_sync_version = before_remove_version;
+    ASSERT_TRUE(config_sync(svc.get(), ss, request2).is_delta);
+    ss->invalidate_config_sync_deltas();
+    ASSERT_FALSE(config_sync(svc.get(), ss, request2).is_delta);
+    request.last_sync_epoch ^= 1;
+    ASSERT_FALSE(config_sync(svc.get(), ss, request).is_delta);
+}
+
 static void clone_app_mapper(app_mapper &output, const app_mapper &input)
 {
     output.clear();
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include <dsn/dist/replication/replica_test_utils.h>
+#include "dist/replication/lib/replica_stub.h"
+#include "dist/replication/test/replica_test/unit_test/replication_service_test_app.h"
+
+using namespace ::dsn;
+using namespace ::dsn::replication;
+
+void replication_service_test_app::config_sync_full_on_inactive_test()
+{
+    replica_stub *stub = create_test_replica_stub();
+
+    // the first sync is a full one
+    ASSERT_TRUE(stub->is_full_config_sync_needed());
+
+    // delta syncs until the full sync interval is reached
+    stub->_config_sync_epoch = 1;
+    stub->_config_sync_version = 10;
+    stub->_last_full_config_sync_ms = dsn_now_ms();
+    ASSERT_FALSE(stub->is_full_config_sync_needed());
+    stub->_last_full_config_sync_ms =
+        dsn_now_ms() - stub->_options.config_sync_full_interval_ms - 1;
+    ASSERT_TRUE(stub->is_full_config_sync_needed());
+    stub->_last_full_config_sync_ms = dsn_now_ms();
+
+    replica_configuration config;
+    config.pid = gpid(5, 1);
+    config.ballot = 3;
+    config.status = partition_status::PS_SECONDARY;
+    stub->notify_replica_state_update(config, false);
+    ASSERT_FALSE(stub->is_full_config_sync_needed());
+
+    // a replica becoming inactive or error asks for a full sync at once, as its configuration
+    // is not in the delta if unchanged on the meta server, while on_config_sync() is needed
+    // to remove it if it is stuck
+    config.status = partition_status::PS_INACTIVE;
+    stub->notify_replica_state_update(config, false);
+    ASSERT_TRUE(stub->is_full_config_sync_needed());
+    ASSERT_FALSE(stub->is_full_config_sync_needed());
+
+    config.status = partition_status::PS_ERROR;
+    stub->notify_replica_state_update(config, true);
+    ASSERT_TRUE(stub->is_full_config_sync_needed());
+    ASSERT_FALSE(stub->is_full_config_sync_needed());
+
+    destroy_replica_stub(stub);
+}
@@ -5,6 +5,7 @@
 
 #include <gtest/gtest.h>
 #include <dsn/dist/replication/replication_service_app.h>
+#include <dsn/dist/replication/replica_test_utils.h>
 
 #include "replication_service_test_app.h"
 
@@ -28,6 +29,50 @@ TEST(cold_backup_context, write_metadata_file) { app->write_backup_metadata_test
 
 TEST(cold_backup_context, write_current_chkpt_file) { app->write_current_chkpt_file_test(); }
 
+TEST(mutation_queue, decrease) { app->mutation_queue_decrease_test(); }
+
+TEST(mutation_queue, increase) { app->mutation_queue_increase_test(); }
+
+TEST(mutation_queue, batch_growth) { app->mutation_queue_batch_growth_test(); }
+
+TEST(mutation_queue, not_adaptive) { app->mutation_queue_not_adaptive_test(); }
+
+TEST(stale_read, servable) { app->stale_read_servable_test(); }
+
+TEST(stale_read, forward) { app->stale_read_forward_test(); }
+
+TEST(stale_read, spread) { app->stale_read_spread_test(); }
+
+TEST(read_lease, expire) { app->read_lease_expire_test(); }
+
+TEST(read_lease, missing_secondary) { app->read_lease_missing_secondary_test(); }
+
+TEST(read_lease, new_primary_wait) { app->read_lease_new_primary_wait_test(); }
+
+TEST(read_lease, delay_commit) { app->read_lease_delay_commit_test(); }
+
+TEST(prepare_batcher, ack_match) { app->prepare_batcher_ack_match_test(); }
+
+TEST(prepare_batcher, sweep_timeout) { app->prepare_batcher_sweep_timeout_test(); }
+
+TEST(prepare_batcher, max_bytes) { app->prepare_batcher_max_bytes_test(); }
+
+TEST(prepare_batcher, demux) { app->prepare_batcher_demux_test(); }
+
+TEST(config_sync, full_on_inactive) { app->config_sync_full_on_inactive_test(); }
+
+/*static*/ dsn::replication::replica *replication_service_test_app::new_test_replica(dsn::gpid pid)
+{
+    static dsn::replication::replica_stub *stub = dsn::replication::create_test_replica_stub();
+
+    dsn::app_info info;
+    info.app_type = "replica";
+    info.app_name = "test";
+    info.app_id = pid.get_app_id();
+    info.partition_count = 8;
+    return dsn::replication::create_test_replica(stub, pid, info, "./test-replica", false);
+}
+
 error_code replication_service_test_app::start(const std::vector<std::string> &args)
 {
     int argc = args.size();
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include <dsn/cpp/serialization.h>
+#include <dsn/dist/replication/replica_test_utils.h>
+#include "dist/replication/lib/mutation.h"
+#include "dist/replication/lib/replica.h"
+#include "dist/replication/test/replica_test/unit_test/replication_service_test_app.h"
+
+using namespace ::dsn;
+using namespace ::dsn::replication;
+
+DEFINE_STORAGE_WRITE_RPC_CODE(RPC_MUTATION_QUEUE_TEST_WRITE, ALLOW_BATCH, IS_IDEMPOTENT)
+
+static const int min_batch_bytes = 1024 * 1024;
+static const int max_batch_bytes = 8 * 1024 * 1024;
+
+// the commits of one round, i.e., as many as the mutations in flight
+static void commit_round(mutation_queue &queue, uint64_t latency_us)
+{
+    int depth = queue.max_concurrent_op();
+    for (int i = 0; i < depth; i++) {
+        queue.on_mutation_committed(latency_us);
+    }
+}
+
+// leave a write waiting in the queue, as all the allowed mutations are running
+static void add_backlog(mutation_queue &queue, replica *r)
+{
+    ASSERT_EQ(nullptr, queue.check_possible_work(queue.max_concurrent_op()).get());
+    message_ex *request = message_ex::create_request(RPC_MUTATION_QUEUE_TEST_WRITE);
+    ::dsn::marshall(request, std::string("hello"));
+    ASSERT_EQ(nullptr, queue.add_work(RPC_MUTATION_QUEUE_TEST_WRITE, request, r).get());
+}
+
+void replication_service_test_app::mutation_queue_decrease_test()
+{
+    mutation_queue queue(gpid(1, 1), 4);
+    queue.enable_adaptive(max_batch_bytes);
+    ASSERT_EQ(4, queue.max_concurrent_op());
+    ASSERT_EQ(min_batch_bytes, queue.batch_bytes());
+
+    // nothing changes without backlog, nor when the latency is within twice the base
+    commit_round(queue, 1000);
+    ASSERT_EQ(4, queue.max_concurrent_op());
+    commit_round(queue, 2000);
+    ASSERT_EQ(4, queue.max_concurrent_op());
+
+    // a quarter of the depth is cut each round, down to 1
+    for (int expected : {3, 2, 1, 1}) {
+        commit_round(queue, 5000);
+        ASSERT_EQ(expected, queue.max_concurrent_op());
+        ASSERT_EQ(min_batch_bytes, queue.batch_bytes());
+    }
+
+    // the latencies below one millisecond are told apart as well
+    mutation_queue fast_queue(gpid(1, 1), 4);
+    fast_queue.enable_adaptive(max_batch_bytes);
+    commit_round(fast_queue, 400);
+    commit_round(fast_queue, 700);
+    ASSERT_EQ(4, fast_queue.max_concurrent_op());
+    commit_round(fast_queue, 900);
+    ASSERT_EQ(3, fast_queue.max_concurrent_op());
+}
+
+void replication_service_test_app::mutation_queue_increase_test()
+{
+    replica *r = new_test_replica(gpid(1, 2));
+    {
+        mutation_queue queue(gpid(1, 2), 4);
+        queue.enable_adaptive(max_batch_bytes);
+        commit_round(queue, 1000);
+        while (queue.max_concurrent_op() > 1) {
+            commit_round(queue, 5000);
+        }
+
+        // the depth grows by one each round while there is backlog, up to the limit, and then
+        // the batch size grows instead
+        add_backlog(queue, r);
+        for (int expected : {2, 3, 4}) {
+            commit_round(queue, 1000);
+            ASSERT_EQ(expected, queue.max_concurrent_op());
+            ASSERT_EQ(min_batch_bytes, queue.batch_bytes());
+        }
+        commit_round(queue, 1000);
+        ASSERT_EQ(4, queue.max_concurrent_op());
+        ASSERT_EQ(2 * min_batch_bytes, queue.batch_bytes());
+        commit_round(queue, 2500);
+        ASSERT_EQ(3, queue.max_concurrent_op());
+        ASSERT_EQ(min_batch_bytes, queue.batch_bytes());
+    }
+    destroy_replica(r);
+}
+
+void replication_service_test_app::mutation_queue_batch_growth_test()
+{
+    replica *r = new_test_replica(gpid(1, 3));
+    {
+        mutation_queue queue(gpid(1, 3), 2);
+        queue.enable_adaptive(max_batch_bytes);
+        add_backlog(queue, r);
+
+        // the batch size doubles each round at the max depth, up to the max batch size
+        for (int expected : {2, 4, 8, 8}) {
+            commit_round(queue, 1000);
+            ASSERT_EQ(2, queue.max_concurrent_op());
+            ASSERT_EQ(expected * min_batch_bytes, queue.batch_bytes());
+        }
+
+        // and is halved with the depth cut, down to the min batch size
+        for (int expected : {4, 2, 1, 1}) {
+            commit_round(queue, 5000);
+            ASSERT_EQ(1, queue.max_concurrent_op());
+            ASSERT_EQ(expected * min_batch_bytes, queue.batch_bytes());
+        }
+    }
+    {
+        // the max batch size is never below the min one
+        mutation_queue queue(gpid(1, 3), 1);
+        queue.enable_adaptive(min_batch_bytes / 2);
+        add_backlog(queue, r);
+        commit_round(queue, 1000);
+        commit_round(queue, 1000);
+        ASSERT_EQ(1, queue.max_concurrent_op());
+        ASSERT_EQ(min_batch_bytes, queue.batch_bytes());
+    }
+    destroy_replica(r);
+}
+
+void replication_service_test_app::mutation_queue_not_adaptive_test()
+{
+    replica *r = new_test_replica(gpid(1, 4));
+    {
+        mutation_queue queue(gpid(1, 4), 2);
+        add_backlog(queue, r);
+        for (uint64_t latency_us : {1000, 5000, 1000, 1000}) {
+            commit_round(queue, latency_us);
+            ASSERT_EQ(2, queue.max_concurrent_op());
+            ASSERT_EQ(min_batch_bytes, queue.batch_bytes());
+        }
+    }
+    destroy_replica(r);
+}
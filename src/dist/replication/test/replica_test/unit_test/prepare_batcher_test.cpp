@@ -0,0 +1,222 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <map>
+#include <dsn/cpp/serialization.h>
+#include <dsn/dist/replication/replica_test_utils.h>
+#include "dist/replication/lib/prepare_batcher.h"
+#include "dist/replication/lib/replica_stub.h"
+#include "dist/replication/test/replica_test/unit_test/replication_service_test_app.h"
+
+using namespace ::dsn;
+using namespace ::dsn::replication;
+
+// long enough for the batches not to be flushed by the flush task in a test
+static const int no_flush_delay_ms = 3600 * 1000;
+
+// the prepare body with the gpid ahead, followed by the padding bytes
+static std::vector<blob> prepare_body(gpid pid, int padding)
+{
+    std::vector<blob> body;
+    binary_writer writer;
+    marshall(writer, pid, DSF_THRIFT_BINARY);
+    body.push_back(writer.get_buffer());
+    if (padding > 0) {
+        std::shared_ptr<char> buf(new char[padding], std::default_delete<char[]>());
+        memset(buf.get(), 'p', padding);
+        body.push_back(blob(buf, padding));
+    }
+    return body;
+}
+
+static prepare_ack ack_of(gpid pid, error_code err)
+{
+    prepare_ack ack;
+    ack.pid = pid;
+    ack.err = err;
+    return ack;
+}
+
+void replication_service_test_app::prepare_batcher_ack_match_test()
+{
+    prepare_batcher batcher(no_flush_delay_ms, 1024 * 1024, 1000);
+    rpc_address node("127.0.0.1", 34801);
+    std::map<int, std::pair<error_code, gpid>> acked;
+    for (int i = 1; i <= 3; i++) {
+        batcher.send_prepare(node,
+                             prepare_body(gpid(4, i), 0),
+                             no_flush_delay_ms,
+                             [&acked, i](error_code err, prepare_ack &&ack) {
+                                 acked[i] = std::make_pair(err, ack.pid);
+                             });
+    }
+    ASSERT_EQ(3u, batcher._pending_prepares.size());
+    ASSERT_EQ(3u, batcher._queues[node].prepares.size());
+
+    // the keys are in the order of the prepares
+    std::vector<uint64_t> keys;
+    for (auto &kv : batcher._pending_prepares) {
+        keys.push_back(kv.first);
+    }
+
+    // out of order, with an unknown key and a duplicated one
+    std::vector<std::pair<uint64_t, prepare_ack>> acks;
+    acks.emplace_back(keys[2], ack_of(gpid(4, 3), ERR_OK));
+    acks.emplace_back(keys[2] + 100, ack_of(gpid(4, 9), ERR_OK));
+    acks.emplace_back(keys[0], ack_of(gpid(4, 1), ERR_INVALID_STATE));
+    acks.emplace_back(keys[0], ack_of(gpid(4, 1), ERR_OK));
+    message_ex *msg = batcher.create_ack_batch(acks);
+    msg->add_ref();
+    message_ex *received = msg->copy(true, true);
+    received->add_ref();
+    batcher.on_ack_batch(received);
+    received->release_ref();
+    msg->release_ref();
+
+    ASSERT_EQ(2u, acked.size());
+    ASSERT_EQ(ERR_INVALID_STATE, acked[1].first);
+    ASSERT_EQ(gpid(4, 1), acked[1].second);
+    ASSERT_EQ(ERR_OK, acked[3].first);
+    ASSERT_EQ(gpid(4, 3), acked[3].second);
+    ASSERT_EQ(1u, batcher._pending_prepares.size());
+    ASSERT_EQ(keys[1], batcher._pending_prepares.begin()->first);
+}
+
+void replication_service_test_app::prepare_batcher_sweep_timeout_test()
+{
+    prepare_batcher batcher(no_flush_delay_ms, 1024 * 1024, 1000);
+    rpc_address node("127.0.0.1", 34801);
+    std::map<int, error_code> acked;
+
+    // the sweep is armed only when a prepare is pending
+    ASSERT_FALSE(batcher._sweep_pending);
+    batcher.send_prepare(node,
+                         prepare_body(gpid(4, 1), 0),
+                         0,
+                         [&acked](error_code err, prepare_ack &&) { acked[1] = err; });
+    batcher.send_prepare(node,
+                         prepare_body(gpid(4, 2), 0),
+                         no_flush_delay_ms,
+                         [&acked](error_code err, prepare_ack &&) { acked[2] = err; });
+    uint64_t expired_key = batcher._pending_prepares.begin()->first;
+    ASSERT_TRUE(batcher._sweep_pending);
+
+    batcher.sweep();
+    ASSERT_EQ(1u, acked.size());
+    ASSERT_EQ(ERR_TIMEOUT, acked[1]);
+    ASSERT_EQ(1u, batcher._pending_prepares.size());
+    ASSERT_TRUE(batcher._sweep_pending);
+
+    // a late ack of the expired prepare is dropped
+    std::vector<std::pair<uint64_t, prepare_ack>> acks;
+    acks.emplace_back(expired_key, ack_of(gpid(4, 1), ERR_OK));
+    message_ex *msg = batcher.create_ack_batch(acks);
+    msg->add_ref();
+    message_ex *received = msg->copy(true, true);
+    received->add_ref();
+    batcher.on_ack_batch(received);
+    received->release_ref();
+    msg->release_ref();
+    ASSERT_EQ(1u, acked.size());
+    ASSERT_EQ(ERR_TIMEOUT, acked[1]);
+
+    batcher.sweep();
+    ASSERT_EQ(1u, acked.size());
+    ASSERT_EQ(1u, batcher._pending_prepares.size());
+
+    // and disarmed once nothing is pending
+    batcher._pending_prepares.begin()->second.deadline_ms = 0;
+    batcher.sweep();
+    ASSERT_EQ(2u, acked.size());
+    ASSERT_EQ(ERR_TIMEOUT, acked[2]);
+    ASSERT_TRUE(batcher._pending_prepares.empty());
+    ASSERT_FALSE(batcher._sweep_pending);
+}
+
+void replication_service_test_app::prepare_batcher_max_bytes_test()
+{
+    std::vector<blob> body = prepare_body(gpid(4, 1), 60);
+    int body_bytes = 0;
+    for (const blob &bb : body) {
+        body_bytes += bb.length();
+    }
+
+    prepare_batcher batcher(no_flush_delay_ms, body_bytes * 2, 1000);
+    rpc_address node("127.0.0.1", 34801);
+    auto ignore = [](error_code, prepare_ack &&) {};
+
+    batcher.send_prepare(node, std::move(body), no_flush_delay_ms, ignore);
+    prepare_batcher::node_queue &q = batcher._queues[node];
+    ASSERT_EQ(1u, q.prepares.size());
+    ASSERT_EQ(body_bytes, q.prepare_bytes);
+    ASSERT_TRUE(q.flush_pending);
+
+    // flushed at once when full, while the prepares are still waiting for their acks
+    batcher.send_prepare(node, prepare_body(gpid(4, 2), 60), no_flush_delay_ms, ignore);
+    ASSERT_TRUE(q.prepares.empty());
+    ASSERT_EQ(0, q.prepare_bytes);
+    ASSERT_TRUE(q.flush_pending);
+    ASSERT_EQ(2u, batcher._pending_prepares.size());
+
+    // the scheduled flush is not repeated until it runs
+    batcher.send_prepare(node, prepare_body(gpid(4, 3), 0), no_flush_delay_ms, ignore);
+    ASSERT_EQ(1u, q.prepares.size());
+    ASSERT_TRUE(q.flush_pending);
+    batcher.flush(node, true);
+    ASSERT_TRUE(q.prepares.empty());
+    ASSERT_FALSE(q.flush_pending);
+    ASSERT_TRUE(q.cut_batches.empty());
+    ASSERT_FALSE(q.is_sending);
+
+    // while another flush is sending, the batches are cut in order and left to it
+    q.is_sending = true;
+    batcher.send_prepare(node, prepare_body(gpid(4, 4), 0), no_flush_delay_ms, ignore);
+    batcher.flush(node, false);
+    batcher.send_ack(node, 7, ack_of(gpid(4, 5), ERR_OK));
+    batcher.flush(node, false);
+    ASSERT_EQ(2u, q.cut_batches.size());
+    ASSERT_EQ(1u, q.cut_batches[0].prepares.size());
+    ASSERT_TRUE(q.cut_batches[0].acks.empty());
+    ASSERT_TRUE(q.cut_batches[1].prepares.empty());
+    ASSERT_EQ(1u, q.cut_batches[1].acks.size());
+    q.is_sending = false;
+    batcher.flush(node, true);
+    ASSERT_TRUE(q.cut_batches.empty());
+    ASSERT_FALSE(q.is_sending);
+}
+
+void replication_service_test_app::prepare_batcher_demux_test()
+{
+    replica_stub *stub = create_test_replica_stub();
+    stub->_prepare_batcher.reset(new prepare_batcher(no_flush_delay_ms, 1024 * 1024, 1000));
+    prepare_batcher *batcher = stub->_prepare_batcher.get();
+    rpc_address node("127.0.0.1", 34801);
+
+    std::vector<std::pair<uint64_t, std::vector<blob>>> prepares;
+    prepares.emplace_back(7, prepare_body(gpid(4, 1), 100));
+    prepares.emplace_back(8, prepare_body(gpid(4, 2), 0));
+    prepares.emplace_back(9, prepare_body(gpid(4, 1), 10000));
+    message_ex *msg = batcher->create_prepare_batch(prepares);
+    msg->add_ref();
+    message_ex *received = msg->copy(true, true);
+    received->add_ref();
+    received->header->from_address = node;
+    stub->on_prepare_batch(received);
+    received->release_ref();
+    msg->release_ref();
+    stub->_tracker.wait_outstanding_tasks();
+
+    // each prepare goes to its partition, which is not on the stub, and is acked with its key
+    std::map<uint64_t, prepare_ack> acks;
+    for (auto &a : batcher->_queues[node].acks) {
+        acks[a.first] = a.second;
+    }
+    ASSERT_EQ(3u, acks.size());
+    ASSERT_EQ(gpid(4, 1), acks[7].pid);
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND, acks[7].err);
+    ASSERT_EQ(gpid(4, 2), acks[8].pid);
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND, acks[8].err);
+    ASSERT_EQ(gpid(4, 1), acks[9].pid);
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND, acks[9].err);
+
+    destroy_replica_stub(stub);
+}
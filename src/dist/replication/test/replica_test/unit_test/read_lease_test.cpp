@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <dsn/dist/replication/replica_test_utils.h>
+#include "dist/replication/lib/mutation.h"
+#include "dist/replication/lib/replica.h"
+#include "dist/replication/lib/replica_stub.h"
+#include "dist/replication/test/replica_test/unit_test/replication_service_test_app.h"
+
+using namespace ::dsn;
+using namespace ::dsn::replication;
+
+void replication_service_test_app::read_lease_expire_test()
+{
+    rpc_address a("127.0.0.1", 34801);
+    rpc_address b("127.0.0.1", 34802);
+    primary_context pc(gpid(3, 1));
+    pc.membership.secondaries = {a, b};
+
+    pc.renew_read_lease(a, 1000);
+    pc.renew_read_lease(b, 2000);
+    ASSERT_TRUE(pc.is_read_lease_valid(500, 0));
+    ASSERT_TRUE(pc.is_read_lease_valid(999, 0));
+
+    // expired as soon as the earliest lease of the secondaries is reached
+    ASSERT_FALSE(pc.is_read_lease_valid(1000, 0));
+    ASSERT_FALSE(pc.is_read_lease_valid(3000, 0));
+
+    // a late reply of an older prepare never shortens the lease
+    pc.renew_read_lease(a, 900);
+    ASSERT_EQ(1000u, pc.read_lease_expire_ms[a]);
+    pc.renew_read_lease(a, 1500);
+    ASSERT_TRUE(pc.is_read_lease_valid(1200, 0));
+    ASSERT_FALSE(pc.is_read_lease_valid(1500, 0));
+
+    pc.cleanup(true);
+    ASSERT_TRUE(pc.read_lease_expire_ms.empty());
+}
+
+void replication_service_test_app::read_lease_missing_secondary_test()
+{
+    rpc_address a("127.0.0.1", 34801);
+    rpc_address b("127.0.0.1", 34802);
+    primary_context pc(gpid(3, 2));
+
+    // no secondary to grant a lease, so only the lease from the meta server counts
+    ASSERT_FALSE(pc.is_read_lease_valid(1000, 0));
+    ASSERT_TRUE(pc.is_read_lease_valid(1000, 1500));
+    ASSERT_FALSE(pc.is_read_lease_valid(1500, 1500));
+    pc.read_lease_wait_until_ms = 1200;
+    ASSERT_FALSE(pc.is_read_lease_valid(1000, 1500));
+    pc.read_lease_wait_until_ms = 0;
+
+    pc.membership.secondaries = {a, b};
+    ASSERT_FALSE(pc.is_read_lease_valid(1000, 0));
+    pc.renew_read_lease(a, 2000);
+    ASSERT_FALSE(pc.is_read_lease_valid(1000, 0));
+    pc.renew_read_lease(b, 2000);
+    ASSERT_TRUE(pc.is_read_lease_valid(1000, 0));
+
+    // a lease of a node which is no more a secondary does not count, nor does the lease
+    // from the meta server if there are secondaries
+    pc.membership.secondaries = {a};
+    ASSERT_TRUE(pc.is_read_lease_valid(1000, 0));
+    ASSERT_FALSE(pc.is_read_lease_valid(2000, 3000));
+    pc.membership.secondaries = {a, rpc_address("127.0.0.1", 34803)};
+    ASSERT_FALSE(pc.is_read_lease_valid(1000, 0));
+
+    pc.cleanup(true);
+}
+
+void replication_service_test_app::read_lease_new_primary_wait_test()
+{
+    replica *r = new_test_replica(gpid(3, 3));
+    replication_options *options = r->_options;
+    bool old_enabled = options->primary_read_lease_enabled;
+    int32_t old_lease_ms = options->primary_read_lease_ms;
+    rpc_address a("127.0.0.1", 34801);
+
+    // no lease from the meta server before it is connected
+    ASSERT_EQ(0u, r->_stub->meta_server_lease_expire_ms());
+
+    // disabled
+    options->primary_read_lease_enabled = false;
+    r->init_read_lease();
+    ASSERT_EQ(0u, r->_primary_states.read_lease_wait_until_ms);
+    r->renew_read_lease(a, 1000);
+    ASSERT_TRUE(r->_primary_states.read_lease_expire_ms.empty());
+
+    // a new primary waits for the leases granted to the former one to expire
+    options->primary_read_lease_enabled = true;
+    options->primary_read_lease_ms = 1000;
+    r->_primary_states.membership.secondaries = {a};
+    r->_primary_states.renew_read_lease(a, 1000);
+    uint64_t now_ms = dsn_now_ms();
+    r->init_read_lease();
+    ASSERT_TRUE(r->_primary_states.read_lease_expire_ms.empty());
+    ASSERT_LE(now_ms + 1000, r->_primary_states.read_lease_wait_until_ms);
+    ASSERT_GE(dsn_now_ms() + 1000, r->_primary_states.read_lease_wait_until_ms);
+
+    // the lease of a secondary starts from the send time of the prepare, minus a margin
+    r->renew_read_lease(a, now_ms);
+    ASSERT_EQ(now_ms + 900, r->_primary_states.read_lease_expire_ms[a]);
+    uint64_t wait_until_ms = r->_primary_states.read_lease_wait_until_ms;
+    ASSERT_FALSE(r->_primary_states.is_read_lease_valid(wait_until_ms - 1, 0));
+    r->renew_read_lease(a, wait_until_ms);
+    ASSERT_TRUE(r->_primary_states.is_read_lease_valid(wait_until_ms, 0));
+
+    options->primary_read_lease_enabled = old_enabled;
+    options->primary_read_lease_ms = old_lease_ms;
+    r->_primary_states.cleanup(true);
+    destroy_replica(r);
+}
+
+void replication_service_test_app::read_lease_delay_commit_test()
+{
+    replica *r = new_test_replica(gpid(3, 4));
+    std::atomic<int> committed(0);
+    prepare_list *old_list = r->_prepare_list;
+    r->_prepare_list =
+        new prepare_list(0, 10, [&committed](mutation_ptr &) { committed.fetch_add(1); });
+    r->_config.ballot = 1;
+    r->_config.status = partition_status::PS_PRIMARY;
+
+    auto prepare_ready = [r](decree d) {
+        mutation_ptr mu = r->new_mutation(d);
+        mu->set_logged();
+        EXPECT_EQ(ERR_OK, r->_prepare_list->prepare(mu, partition_status::PS_PRIMARY));
+        return mu;
+    };
+    auto wait_committed = [r](decree d) {
+        for (int i = 0; i < 500 && r->last_committed_decree() < d; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    };
+
+    // committed at once without any wait
+    r->_primary_states.read_lease_wait_until_ms = 0;
+    mutation_ptr mu = prepare_ready(1);
+    r->do_possible_commit_on_primary(mu);
+    ASSERT_EQ(1, r->last_committed_decree());
+    ASSERT_EQ(1, committed.load());
+
+    // deferred until the wait of the new primary ends
+    uint64_t wait_until_ms = dsn_now_ms() + 200;
+    r->_primary_states.read_lease_wait_until_ms = wait_until_ms;
+    mu = prepare_ready(2);
+    r->do_possible_commit_on_primary(mu);
+    ASSERT_EQ(1, r->last_committed_decree());
+    wait_committed(2);
+    ASSERT_LE(wait_until_ms, dsn_now_ms());
+    ASSERT_EQ(2, r->last_committed_decree());
+    ASSERT_EQ(2, committed.load());
+
+    // dropped if the replica is no more the primary when the wait ends
+    r->_primary_states.read_lease_wait_until_ms = dsn_now_ms() + 100;
+    mu = prepare_ready(3);
+    r->do_possible_commit_on_primary(mu);
+    r->_config.status = partition_status::PS_INACTIVE;
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    ASSERT_EQ(2, r->last_committed_decree());
+    ASSERT_EQ(2, committed.load());
+
+    r->_tracker.wait_outstanding_tasks();
+    r->_config.ballot = 0;
+    delete r->_prepare_list;
+    r->_prepare_list = old_list;
+    r->_primary_states.cleanup(true);
+    destroy_replica(r);
+}
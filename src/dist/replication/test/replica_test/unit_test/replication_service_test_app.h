@@ -4,6 +4,12 @@
 using ::dsn::replication::replication_service_app;
 using ::dsn::error_code;
 
+namespace dsn {
+namespace replication {
+class replica;
+}
+}
+
 class replication_service_test_app : public replication_service_app
 {
 public:
@@ -23,4 +29,33 @@ public:
     void on_upload_chkpt_dir_test();
     void write_backup_metadata_test();
     void write_current_chkpt_file_test();
+
+    // test for mutation_queue
+    void mutation_queue_decrease_test();
+    void mutation_queue_increase_test();
+    void mutation_queue_batch_growth_test();
+    void mutation_queue_not_adaptive_test();
+
+    // test for stale read
+    void stale_read_servable_test();
+    void stale_read_forward_test();
+    void stale_read_spread_test();
+
+    // test for read lease
+    void read_lease_expire_test();
+    void read_lease_missing_secondary_test();
+    void read_lease_new_primary_wait_test();
+    void read_lease_delay_commit_test();
+
+    // test for prepare_batcher
+    void prepare_batcher_ack_match_test();
+    void prepare_batcher_sweep_timeout_test();
+    void prepare_batcher_max_bytes_test();
+    void prepare_batcher_demux_test();
+
+    // test for config sync
+    void config_sync_full_on_inactive_test();
+
+    // a replica of the partition on a stub without any app, deleted by destroy_replica()
+    static dsn::replication::replica *new_test_replica(dsn::gpid pid);
 };
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <dsn/dist/replication/replica_test_utils.h>
+#include "core/core/partition_resolver_simple.h"
+#include "dist/replication/lib/replica.h"
+#include "dist/replication/test/replica_test/unit_test/replication_service_test_app.h"
+
+using namespace ::dsn;
+using namespace ::dsn::replication;
+
+DEFINE_STORAGE_READ_RPC_CODE(RPC_STALE_READ_TEST_READ)
+
+// the app envs with the gap, or without it if empty
+static std::map<std::string, std::string> stale_read_envs(const std::string &gap)
+{
+    std::map<std::string, std::string> envs;
+    if (!gap.empty()) {
+        envs[replica_envs::STALE_READ_MAX_DECREE_GAP] = gap;
+    }
+    return envs;
+}
+
+void replication_service_test_app::stale_read_servable_test()
+{
+    replica *r = new_test_replica(gpid(2, 1));
+    replication_options *options = r->_options;
+    int32_t old_gap = options->stale_read_max_decree_gap;
+    int32_t old_lag_ms = options->stale_read_max_lag_ms;
+    options->stale_read_max_decree_gap = -1;
+    options->stale_read_max_lag_ms = 30000;
+    r->update_stale_read_max_decree_gap(stale_read_envs(""));
+
+    // not before the primary is heard
+    r->_prepare_list->reset(100);
+    r->update_stale_read_max_decree_gap(stale_read_envs("5"));
+    ASSERT_FALSE(r->is_stale_read_servable());
+
+    // within the gap
+    r->_secondary_states.on_primary_heard(105);
+    ASSERT_TRUE(r->is_stale_read_servable());
+    r->_secondary_states.on_primary_heard(106);
+    ASSERT_FALSE(r->is_stale_read_servable());
+    r->_prepare_list->reset(101);
+    ASSERT_TRUE(r->is_stale_read_servable());
+
+    // not if the primary is not heard for too long
+    r->_secondary_states.primary_heard_ts_ms = dsn_now_ms() - options->stale_read_max_lag_ms - 1;
+    ASSERT_FALSE(r->is_stale_read_servable());
+    r->_secondary_states.on_primary_heard(106);
+    ASSERT_TRUE(r->is_stale_read_servable());
+
+    // the app env overrides the option, and is ignored if invalid
+    r->update_stale_read_max_decree_gap(stale_read_envs("-1"));
+    ASSERT_FALSE(r->is_stale_read_servable());
+    options->stale_read_max_decree_gap = 10;
+    r->update_stale_read_max_decree_gap(stale_read_envs("invalid"));
+    ASSERT_TRUE(r->is_stale_read_servable());
+    r->update_stale_read_max_decree_gap(stale_read_envs("0"));
+    ASSERT_FALSE(r->is_stale_read_servable());
+    r->update_stale_read_max_decree_gap(stale_read_envs(""));
+    ASSERT_TRUE(r->is_stale_read_servable());
+
+    // disabled by the option without the app env
+    options->stale_read_max_decree_gap = -1;
+    r->update_stale_read_max_decree_gap(stale_read_envs(""));
+    ASSERT_FALSE(r->is_stale_read_servable());
+
+    options->stale_read_max_decree_gap = old_gap;
+    options->stale_read_max_lag_ms = old_lag_ms;
+    r->_secondary_states.cleanup(true);
+    destroy_replica(r);
+}
+
+void replication_service_test_app::stale_read_forward_test()
+{
+    replica *r = new_test_replica(gpid(2, 2));
+    message_ex *request = message_ex::create_request(RPC_STALE_READ_TEST_READ);
+    request->add_ref();
+    request->header->context.u.allow_stale_read = true;
+    request->header->context.u.is_forward_supported = true;
+    request->header->context.u.is_forwarded = false;
+
+    r->_prepare_list->reset(100);
+    r->_secondary_states.on_primary_heard(110);
+    r->update_stale_read_max_decree_gap(stale_read_envs("20"));
+    ASSERT_EQ(replica::stale_read_action::SERVE, r->check_stale_read(request));
+
+    // too stale, so forwarded to the primary if it is known
+    r->update_stale_read_max_decree_gap(stale_read_envs("5"));
+    ASSERT_EQ(replica::stale_read_action::REJECT, r->check_stale_read(request));
+    r->_config.primary = rpc_address("127.0.0.1", 34801);
+    ASSERT_EQ(replica::stale_read_action::FORWARD, r->check_stale_read(request));
+
+    // the same for the secondaries not serving stale reads
+    r->update_stale_read_max_decree_gap(stale_read_envs("-1"));
+    ASSERT_EQ(replica::stale_read_action::FORWARD, r->check_stale_read(request));
+
+    // but never forwarded twice, or to the clients not supporting it
+    request->header->context.u.is_forwarded = true;
+    ASSERT_EQ(replica::stale_read_action::REJECT, r->check_stale_read(request));
+    request->header->context.u.is_forwarded = false;
+    request->header->context.u.is_forward_supported = false;
+    ASSERT_EQ(replica::stale_read_action::REJECT, r->check_stale_read(request));
+
+    request->release_ref();
+    r->_config.primary.set_invalid();
+    r->_secondary_states.cleanup(true);
+    destroy_replica(r);
+}
+
+void replication_service_test_app::stale_read_spread_test()
+{
+    dsn::dist::partition_resolver_simple resolver(rpc_address("127.0.0.1", 34601), "test");
+    partition_configuration config;
+    config.pid = gpid(3, 0);
+    config.primary = rpc_address("127.0.0.1", 34801);
+    config.secondaries = {rpc_address("127.0.0.1", 34802), rpc_address("127.0.0.1", 34803)};
+
+    // the reads not allowing stale data always go to the primary
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(config.primary, resolver.get_address(config, false));
+    }
+
+    // while the others are spread over all the replicas
+    std::map<rpc_address, int> counts;
+    for (int i = 0; i < 3000; i++) {
+        counts[resolver.get_address(config, true)]++;
+    }
+    ASSERT_EQ(3u, counts.size());
+    for (auto &kv : counts) {
+        ASSERT_GT(kv.second, 500) << kv.first.to_string();
+    }
+
+    // and go to the primary if there is no secondary, or nowhere if there is no primary
+    partition_configuration primary_only = config;
+    primary_only.secondaries.clear();
+    ASSERT_EQ(config.primary, resolver.get_address(primary_only, true));
+    partition_configuration no_primary = config;
+    no_primary.primary.set_invalid();
+    ASSERT_TRUE(resolver.get_address(no_primary, true).is_invalid());
+
+    // resolve() spreads the reads by the cached configuration
+    resolver._app_id = 3;
+    resolver._app_partition_count = 1;
+    resolver._config_cache[0].reset(
+        new dsn::dist::partition_resolver_simple::partition_info{0, config});
+    counts.clear();
+    for (int i = 0; i < 300; i++) {
+        resolver.resolve(i,
+                         true,
+                         [&counts](dsn::dist::partition_resolver::resolve_result &&result) {
+                             ASSERT_EQ(ERR_OK, result.err);
+                             counts[result.address]++;
+                         },
+                         1000);
+    }
+    ASSERT_EQ(3u, counts.size());
+}
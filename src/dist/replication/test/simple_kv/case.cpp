@@ -627,9 +627,19 @@ bool event_on_aio::check_satisfied(const event *ev) const
 void event_on_aio::init(aio_task *tsk)
 {
     event_on_task::init(tsk);
-    if (tsk->aio()->type == dsn::AIO_Invalid)
-        return; // for flush task, the type is AIO_Invalid
-    _type = (tsk->aio()->type == dsn::AIO_Read ? "READ" : "WRITE");
+    switch (tsk->aio()->type) {
+    case dsn::AIO_Read:
+        _type = "READ";
+        break;
+    case dsn::AIO_Write:
+        _type = "WRITE";
+        break;
+    case dsn::AIO_Flush:
+        _type = "FLUSH"; // no offset or size for a flush
+        return;
+    default:
+        return;
+    }
     _file_offset = boost::lexical_cast<std::string>(tsk->aio()->file_offset);
     _buffer_size = boost::lexical_cast<std::string>(tsk->aio()->buffer_size);
 }
@@ -0,0 +1,150 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     What is this file about?
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "benchmark.h"
+#include <dsn/c/api_utilities.h>
+#include <dsn/utility/config_api.h>
+#include <dsn/utility/utils.h>
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+namespace dsn {
+namespace benchmark {
+
+benchmark_state::benchmark_state(uint64_t iterations)
+    : _iterations(iterations), _bytes_processed(0), _start_ns(0), _elapsed_ns(0), _running(false)
+{
+}
+
+void benchmark_state::pause_timing()
+{
+    dassert(_running, "benchmark timer is not running");
+    _elapsed_ns += utils::get_current_physical_time_ns() - _start_ns;
+    _running = false;
+}
+
+void benchmark_state::resume_timing()
+{
+    dassert(!_running, "benchmark timer is already running");
+    _start_ns = utils::get_current_physical_time_ns();
+    _running = true;
+}
+
+uint64_t benchmark_state::elapsed_ns() const
+{
+    return _running ? _elapsed_ns + (utils::get_current_physical_time_ns() - _start_ns)
+                    : _elapsed_ns;
+}
+
+static std::map<std::string, benchmark_function> &benchmarks()
+{
+    static std::map<std::string, benchmark_function> s_benchmarks;
+    return s_benchmarks;
+}
+
+benchmark_registerer::benchmark_registerer(const char *name, benchmark_function func)
+{
+    bool ok = benchmarks().emplace(name, std::move(func)).second;
+    dassert(ok, "benchmark %s is registered more than once", name);
+}
+
+static bool match_filters(const std::string &name, const std::vector<std::string> &filters)
+{
+    if (filters.empty()) {
+        return true;
+    }
+    for (const std::string &f : filters) {
+        if (name.find(f) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void run_benchmarks(const std::vector<std::string> &filters)
+{
+    uint64_t min_time_ms = dsn_config_get_value_uint64(
+        "benchmark", "min_time_ms", 1000, "min time of the measured run of each benchmark");
+    uint64_t max_iterations = dsn_config_get_value_uint64(
+        "benchmark", "max_iterations", 1000000000, "max iterations of each benchmark");
+    uint64_t min_time_ns = min_time_ms * 1000000;
+
+    printf("%-40s %14s %14s %14s %12s\n", "benchmark", "iterations", "ns/op", "ops/s", "MB/s");
+    for (auto &kv : benchmarks()) {
+        if (!match_filters(kv.first, filters)) {
+            continue;
+        }
+
+        // grow the iteration count until the run is long enough to be measured
+        uint64_t iterations = 1;
+        while (true) {
+            benchmark_state state(iterations);
+            state.resume_timing();
+            kv.second(state);
+            uint64_t elapsed_ns = std::max(state.elapsed_ns(), (uint64_t)1);
+
+            if (!state.skip_reason().empty()) {
+                printf("%-40s skipped: %s\n", kv.first.c_str(), state.skip_reason().c_str());
+                fflush(stdout);
+                break;
+            }
+
+            if (elapsed_ns >= min_time_ns || iterations >= max_iterations) {
+                double ns_per_op = (double)elapsed_ns / iterations;
+                double ops_per_second = 1e9 / ns_per_op;
+                double mb_per_second =
+                    (double)state.bytes_processed() * 1e9 / elapsed_ns / (1024 * 1024);
+                printf("%-40s %14" PRIu64 " %14.1f %14.0f %12.1f\n",
+                       kv.first.c_str(),
+                       iterations,
+                       ns_per_op,
+                       ops_per_second,
+                       mb_per_second);
+                fflush(stdout);
+                break;
+            }
+
+            // aim at 1.4 times of the min time, and grow by 1.2 to 10 times per round
+            double multiplier = 1.4 * min_time_ns / elapsed_ns;
+            multiplier = std::min(std::max(multiplier, 1.2), 10.0);
+            iterations = std::min(std::max((uint64_t)(iterations * multiplier), iterations + 1),
+                                  max_iterations);
+        }
+    }
+}
+
+} // namespace benchmark
+} // namespace dsn
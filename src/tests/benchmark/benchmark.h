@@ -0,0 +1,104 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     a tiny benchmark harness: each benchmark runs its body for state.iterations()
+ *     rounds, the runner grows the iteration count until one run takes at least
+ *     min_time_ms, and reports the cost of one iteration.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#pragma once
+
+#include <dsn/utility/ports.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace dsn {
+namespace benchmark {
+
+class benchmark_state
+{
+public:
+    explicit benchmark_state(uint64_t iterations);
+
+    uint64_t iterations() const { return _iterations; }
+
+    // exclude setup and teardown code from the measured time
+    void pause_timing();
+    void resume_timing();
+
+    // used to report the throughput in MB/s
+    void set_bytes_processed(uint64_t bytes) { _bytes_processed = bytes; }
+    uint64_t bytes_processed() const { return _bytes_processed; }
+
+    // the benchmark can not run in this environment, stop growing the iterations
+    void skip(const char *reason) { _skip_reason = reason; }
+    const std::string &skip_reason() const { return _skip_reason; }
+
+    uint64_t elapsed_ns() const;
+
+private:
+    uint64_t _iterations;
+    uint64_t _bytes_processed;
+    uint64_t _start_ns;
+    uint64_t _elapsed_ns;
+    bool _running;
+    std::string _skip_reason;
+};
+
+typedef std::function<void(benchmark_state &)> benchmark_function;
+
+struct benchmark_registerer
+{
+    benchmark_registerer(const char *name, benchmark_function func);
+};
+
+// run the registered benchmarks whose names contain one of the filters,
+// or all of them if no filter is given
+extern void run_benchmarks(const std::vector<std::string> &filters);
+
+// prevent the compiler from optimizing away the computation of value
+template <typename T>
+inline void do_not_optimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} // namespace benchmark
+} // namespace dsn
+
+#define DSN_BENCHMARK(name)                                                                        \
+    static void benchmark_##name(::dsn::benchmark::benchmark_state &state);                        \
+    static ::dsn::benchmark::benchmark_registerer benchmark_registerer_##name(#name,               \
+                                                                              benchmark_##name);   \
+    static void benchmark_##name(::dsn::benchmark::benchmark_state &state)
@@ -0,0 +1,76 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     cost of binary_writer growing its buffers while serializing a 64 KB message.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "benchmark.h"
+#include <dsn/utility/binary_writer.h>
+#include <string>
+
+using namespace ::dsn;
+using namespace ::dsn::benchmark;
+
+static const int message_size = 64 * 1024;
+
+static void write_message(benchmark_state &state, int reserved_buffer_size, int chunk_size)
+{
+    std::string chunk(chunk_size, 'x');
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        binary_writer writer(reserved_buffer_size);
+        for (int written = 0; written < message_size; written += chunk_size) {
+            writer.write(chunk.data(), chunk_size);
+        }
+        blob buffer = writer.get_buffer();
+        do_not_optimize(buffer.data());
+    }
+    state.set_bytes_processed((uint64_t)message_size * state.iterations());
+}
+
+DSN_BENCHMARK(binary_writer_grow_16b_chunks) { write_message(state, 0, 16); }
+
+DSN_BENCHMARK(binary_writer_grow_1kb_chunks) { write_message(state, 0, 1024); }
+
+DSN_BENCHMARK(binary_writer_reserved_16b_chunks) { write_message(state, message_size, 16); }
+
+DSN_BENCHMARK(binary_writer_write_pod)
+{
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        binary_writer writer;
+        for (int32_t v = 0; v < message_size / (int)sizeof(int64_t); ++v) {
+            writer.write((int64_t)v);
+        }
+        blob buffer = writer.get_buffer();
+        do_not_optimize(buffer.data());
+    }
+    state.set_bytes_processed((uint64_t)message_size * state.iterations());
+}
@@ -0,0 +1,130 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     crc32/crc64 throughput of the automatically chosen and each of the implementations.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "benchmark.h"
+#include <dsn/utility/crc.h>
+#include <dsn/utility/rand.h>
+#include <memory>
+
+using namespace ::dsn;
+using namespace ::dsn::benchmark;
+using ::dsn::utils::crc_impl;
+
+static std::unique_ptr<char[]> make_random_bytes(size_t size)
+{
+    std::unique_ptr<char[]> buffer(new char[size]);
+    for (size_t i = 0; i < size; ++i) {
+        buffer[i] = (char)rand::next_u32();
+    }
+    return buffer;
+}
+
+static void crc32_calc_default(benchmark_state &state, size_t size)
+{
+    state.pause_timing();
+    std::unique_ptr<char[]> buffer = make_random_bytes(size);
+    state.resume_timing();
+
+    uint32_t crc = 0;
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        crc = utils::crc32_calc(buffer.get(), size, crc);
+    }
+    do_not_optimize(crc);
+    state.set_bytes_processed(size * state.iterations());
+}
+
+static void crc32_calc_with_impl(benchmark_state &state, crc_impl impl, size_t size = 4096)
+{
+    if (!utils::crc32_impl_supported(impl)) {
+        state.skip("not supported by the cpu");
+        return;
+    }
+
+    state.pause_timing();
+    std::unique_ptr<char[]> buffer = make_random_bytes(size);
+    state.resume_timing();
+
+    uint32_t crc = 0;
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        crc = utils::crc32_calc(impl, buffer.get(), size, crc);
+    }
+    do_not_optimize(crc);
+    state.set_bytes_processed(size * state.iterations());
+}
+
+static void crc64_calc_with_impl(benchmark_state &state, crc_impl impl, size_t size = 4096)
+{
+    if (!utils::crc64_impl_supported(impl)) {
+        state.skip("not supported by the cpu");
+        return;
+    }
+
+    state.pause_timing();
+    std::unique_ptr<char[]> buffer = make_random_bytes(size);
+    state.resume_timing();
+
+    uint64_t crc = 0;
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        crc = utils::crc64_calc(impl, buffer.get(), size, crc);
+    }
+    do_not_optimize(crc);
+    state.set_bytes_processed(size * state.iterations());
+}
+
+DSN_BENCHMARK(crc32_calc_64b) { crc32_calc_default(state, 64); }
+
+DSN_BENCHMARK(crc32_calc_4kb) { crc32_calc_default(state, 4096); }
+
+DSN_BENCHMARK(crc32_calc_64kb) { crc32_calc_default(state, 65536); }
+
+DSN_BENCHMARK(crc32_calc_4kb_table) { crc32_calc_with_impl(state, crc_impl::table); }
+
+DSN_BENCHMARK(crc32_calc_4kb_slicing_by_8) { crc32_calc_with_impl(state, crc_impl::slicing_by_8); }
+
+DSN_BENCHMARK(crc32_calc_4kb_sse42) { crc32_calc_with_impl(state, crc_impl::sse42); }
+
+DSN_BENCHMARK(crc32_calc_4kb_pclmul) { crc32_calc_with_impl(state, crc_impl::pclmul); }
+
+DSN_BENCHMARK(crc32_calc_64b_sse42) { crc32_calc_with_impl(state, crc_impl::sse42, 64); }
+
+DSN_BENCHMARK(crc32_calc_64kb_pclmul) { crc32_calc_with_impl(state, crc_impl::pclmul, 65536); }
+
+DSN_BENCHMARK(crc64_calc_4kb_table) { crc64_calc_with_impl(state, crc_impl::table); }
+
+DSN_BENCHMARK(crc64_calc_4kb_slicing_by_8) { crc64_calc_with_impl(state, crc_impl::slicing_by_8); }
+
+DSN_BENCHMARK(crc64_calc_4kb_pclmul) { crc64_calc_with_impl(state, crc_impl::pclmul); }
+
+DSN_BENCHMARK(crc64_calc_64kb_pclmul) { crc64_calc_with_impl(state, crc_impl::pclmul, 65536); }
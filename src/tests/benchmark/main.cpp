@@ -0,0 +1,76 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     microbenchmarks of the runtime hot paths, run as:
+ *         ./dsn.benchmark [config.ini] [name-filter ...]
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "benchmark.h"
+#include <dsn/service_api_cpp.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+static std::vector<std::string> g_filters;
+static std::atomic<bool> g_done(false);
+
+class benchmark_app : public ::dsn::service_app
+{
+public:
+    benchmark_app(const dsn::service_app_info *info) : ::dsn::service_app(info) {}
+
+    ::dsn::error_code start(const std::vector<std::string> &args) override
+    {
+        dsn::benchmark::run_benchmarks(g_filters);
+        g_done = true;
+        return ::dsn::ERR_OK;
+    }
+
+    ::dsn::error_code stop(bool cleanup = false) override { return ::dsn::ERR_OK; }
+};
+
+int main(int argc, char **argv)
+{
+    const char *config_file = argc > 1 ? argv[1] : "config.ini";
+    for (int i = 2; i < argc; ++i) {
+        g_filters.emplace_back(argv[i]);
+    }
+
+    dsn::service_app::register_factory<benchmark_app>("benchmark");
+    dsn_run_config(config_file, false);
+    while (!g_done) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    dsn_exit(0);
+    return 0;
+}
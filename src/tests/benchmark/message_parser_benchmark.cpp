@@ -0,0 +1,150 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     cost of parsing received requests in the dsn, compact dsn and thrift header formats.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "benchmark.h"
+#include "benchmark_common.h"
+#include "core/tools/common/dsn_message_parser.h"
+#include "core/tools/common/thrift_message_parser.h"
+#include <dsn/cpp/serialization.h>
+#include <dsn/cpp/serialization_helper/thrift_helper.h>
+
+using namespace ::dsn;
+using namespace ::dsn::benchmark;
+
+// the bytes of a request in the dsn format, as they are received from the network
+static blob make_dsn_request_bytes(dsn_message_parser &parser)
+{
+    message_ptr msg = message_ex::create_request(RPC_BENCHMARK, 1000);
+    marshall(msg.get(), make_benchmark_request());
+
+    parser.prepare_on_send(msg.get());
+    std::vector<message_parser::send_buf> buffers(parser.get_buffer_count_on_send(msg.get()));
+    int count = parser.get_buffers_on_send(msg.get(), buffers.data());
+
+    binary_writer writer;
+    for (int i = 0; i < count; ++i) {
+        writer.write((const char *)buffers[i].buf, (int)buffers[i].sz);
+    }
+    return writer.get_buffer();
+}
+
+// the bytes of a request in the thrift format, as they are sent by a thrift client
+static blob make_thrift_request_bytes()
+{
+    binary_writer body_writer;
+    binary_writer_transport body_trans(body_writer);
+    boost::shared_ptr<binary_writer_transport> body_trans_ptr(&body_trans,
+                                                              [](binary_writer_transport *) {});
+    ::apache::thrift::protocol::TBinaryProtocol body_proto(body_trans_ptr);
+    body_proto.writeMessageBegin("RPC_BENCHMARK", ::apache::thrift::protocol::T_CALL, 1);
+    make_benchmark_request().write(&body_proto);
+    body_proto.writeMessageEnd();
+    blob body = body_writer.get_buffer();
+
+    binary_writer writer;
+    writer.write_pod(THRIFT_HDR_SIG);
+    writer.write_pod(htobe32(0));                             // hdr_version
+    writer.write_pod(htobe32(sizeof(thrift_message_header))); // hdr_length
+    writer.write_pod(htobe32(0));                             // hdr_crc32
+    writer.write_pod(htobe32(body.length()));                 // body_length
+    writer.write_pod(htobe32(0));                             // body_crc32
+    writer.write_pod(htobe32(1));                             // app_id
+    writer.write_pod(htobe32(0));                             // partition_index
+    writer.write_pod(htobe32(1000));                          // client_timeout
+    writer.write_pod(htobe32(0));                             // client_thread_hash
+    writer.write_pod(htobe64(0));                             // client_partition_hash
+    writer.write(body.data(), body.length());
+    return writer.get_buffer();
+}
+
+static void parse_requests(benchmark_state &state, message_parser &parser, const blob &bytes)
+{
+    message_reader reader(4096);
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        reader._buffer = bytes;
+        reader._buffer_occupied = bytes.length();
+
+        int read_next;
+        message_ptr msg = parser.get_message_on_receive(&reader, read_next);
+        dassert(msg != nullptr, "parse request failed, read_next = %d", read_next);
+    }
+    state.set_bytes_processed(bytes.length() * state.iterations());
+}
+
+DSN_BENCHMARK(message_parser_dsn)
+{
+    state.pause_timing();
+    dsn_message_parser sender;
+    blob bytes = make_dsn_request_bytes(sender);
+    dsn_message_parser parser;
+    state.resume_timing();
+
+    parse_requests(state, parser, bytes);
+}
+
+DSN_BENCHMARK(message_parser_dsn_compact)
+{
+    state.pause_timing();
+    dsn_message_parser client, server;
+    client.enable_compact_header();
+    server.enable_compact_header();
+
+    // negotiate, and let the server intern the codes with the first compact request
+    message_reader reader(4096);
+    for (dsn_message_parser *p : {&server, &client, &server}) {
+        blob handshake = make_dsn_request_bytes(p == &server ? client : server);
+        reader._buffer = handshake;
+        reader._buffer_occupied = handshake.length();
+        int read_next;
+        message_ptr msg = p->get_message_on_receive(&reader, read_next);
+        dassert(msg != nullptr, "parse handshake failed, read_next = %d", read_next);
+    }
+    dassert(client.is_sending_compact_header(), "compact header is not negotiated");
+
+    blob bytes = make_dsn_request_bytes(client);
+    state.resume_timing();
+
+    parse_requests(state, server, bytes);
+}
+
+DSN_BENCHMARK(message_parser_thrift)
+{
+    state.pause_timing();
+    blob bytes = make_thrift_request_bytes();
+    thrift_message_parser parser;
+    state.resume_timing();
+
+    parse_requests(state, parser, bytes);
+}
@@ -0,0 +1,187 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     append throughput of the private and shared mutation logs, including the cost of
+ *     building the mutations and of flushing all of them to disk.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "benchmark.h"
+#include "dist/replication/lib/mutation_log.h"
+#include <dsn/utility/filesystem.h>
+#include <atomic>
+#include <thread>
+
+using namespace ::dsn;
+using namespace ::dsn::replication;
+using namespace ::dsn::benchmark;
+
+static const char *log_dir = "./benchmark-mutation-log";
+
+static blob make_payload()
+{
+    int size = (int)dsn_config_get_value_uint64(
+        "benchmark", "mutation_payload_bytes", 1024, "payload size of each appended mutation");
+    std::string str(size, 'x');
+    return blob::create_from_bytes(std::move(str));
+}
+
+static mutation_ptr make_mutation(gpid pid, int64_t decree, const blob &payload)
+{
+    mutation_ptr mu(new mutation());
+    mu->data.header.ballot = 1;
+    mu->data.header.decree = decree;
+    mu->data.header.pid = pid;
+    mu->data.header.last_committed_decree = decree - 1;
+    mu->data.header.log_offset = 0;
+    mu->data.updates.push_back(mutation_update());
+    mu->data.updates.back().code = RPC_REPLICATION_WRITE_EMPTY;
+    mu->data.updates.back().data = payload;
+    mu->client_requests.push_back(nullptr);
+    return mu;
+}
+
+static void reset_log_dir()
+{
+    utils::filesystem::remove_path(log_dir);
+    utils::filesystem::create_directory(log_dir);
+}
+
+static void append_to_private_log(benchmark_state &state, bool direct_io)
+{
+    state.pause_timing();
+    gpid pid(1, 0);
+    blob payload = make_payload();
+    reset_log_dir();
+    mutation_log_ptr mlog = new mutation_log_private(log_dir, 32, pid, nullptr, 1024, 512, 10000);
+    mlog->set_direct_io(direct_io);
+    dassert(mlog->open(nullptr, nullptr) == ERR_OK, "open private log failed");
+    state.resume_timing();
+
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        mutation_ptr mu = make_mutation(pid, 1 + i, payload);
+        mlog->append(mu, LPC_AIO_IMMEDIATE_CALLBACK, nullptr, nullptr, 0);
+    }
+    mlog->close();
+
+    state.pause_timing();
+    state.set_bytes_processed(payload.length() * state.iterations());
+    utils::filesystem::remove_path(log_dir);
+    state.resume_timing();
+}
+
+static void append_to_shared_log(benchmark_state &state, bool force_flush, bool group_commit)
+{
+    state.pause_timing();
+    gpid pid(1, 0);
+    blob payload = make_payload();
+    reset_log_dir();
+    mutation_log_ptr mlog =
+        group_commit ? new mutation_log_shared(log_dir, 32, force_flush, 1, 1024 * 1024, 2000)
+                     : new mutation_log_shared(log_dir, 32, force_flush);
+    dassert(mlog->open(nullptr, nullptr) == ERR_OK, "open shared log failed");
+    state.resume_timing();
+
+    // count the mutations persisted instead of just buffered
+    std::atomic<uint64_t> done(0);
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        mutation_ptr mu = make_mutation(pid, 1 + i, payload);
+        mlog->append(mu,
+                     LPC_AIO_IMMEDIATE_CALLBACK,
+                     nullptr,
+                     [&done](error_code err, size_t) {
+                         dassert(err == ERR_OK,
+                                 "append shared log failed, err = %s",
+                                 err.to_string());
+                         done.fetch_add(1, std::memory_order_release);
+                     },
+                     0);
+    }
+    mlog->flush();
+    while (done.load(std::memory_order_acquire) < state.iterations()) {
+        std::this_thread::yield();
+    }
+    mlog->close();
+
+    state.pause_timing();
+    state.set_bytes_processed(payload.length() * state.iterations());
+    utils::filesystem::remove_path(log_dir);
+    state.resume_timing();
+}
+
+static void replay_private_log(benchmark_state &state, bool direct_io)
+{
+    state.pause_timing();
+    gpid pid(1, 0);
+    blob payload = make_payload();
+    reset_log_dir();
+    mutation_log_ptr mlog = new mutation_log_private(log_dir, 32, pid, nullptr, 1024, 512, 10000);
+    mlog->set_direct_io(direct_io);
+    dassert(mlog->open(nullptr, nullptr) == ERR_OK, "open private log failed");
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        mutation_ptr mu = make_mutation(pid, 1 + i, payload);
+        mlog->append(mu, LPC_AIO_IMMEDIATE_CALLBACK, nullptr, nullptr, 0);
+    }
+    mlog->close();
+    mlog = new mutation_log_private(log_dir, 32, pid, nullptr, 1024, 512, 10000);
+    mlog->set_direct_io(direct_io);
+    state.resume_timing();
+
+    uint64_t count = 0;
+    dassert(mlog->open(
+                [&count](int, mutation_ptr &) {
+                    ++count;
+                    return true;
+                },
+                nullptr) == ERR_OK,
+            "replay private log failed");
+    mlog->close();
+    do_not_optimize(count);
+
+    state.pause_timing();
+    state.set_bytes_processed(payload.length() * state.iterations());
+    utils::filesystem::remove_path(log_dir);
+    state.resume_timing();
+}
+
+DSN_BENCHMARK(mutation_log_private_append) { append_to_private_log(state, false); }
+
+DSN_BENCHMARK(mutation_log_private_append_direct_io) { append_to_private_log(state, true); }
+
+DSN_BENCHMARK(mutation_log_shared_append) { append_to_shared_log(state, false, false); }
+
+DSN_BENCHMARK(mutation_log_shared_append_force_flush) { append_to_shared_log(state, true, false); }
+
+DSN_BENCHMARK(mutation_log_shared_append_group_commit) { append_to_shared_log(state, true, true); }
+
+DSN_BENCHMARK(mutation_log_private_replay) { replay_private_log(state, false); }
+
+DSN_BENCHMARK(mutation_log_private_replay_direct_io) { replay_private_log(state, true); }
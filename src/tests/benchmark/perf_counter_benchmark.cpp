@@ -0,0 +1,96 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     cost of updating one perf counter from many threads at the same time.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "benchmark.h"
+#include <dsn/perf_counter/perf_counter_wrapper.h>
+#include <dsn/utility/config_api.h>
+#include <thread>
+#include <vector>
+
+using namespace ::dsn;
+using namespace ::dsn::benchmark;
+
+// the total updates of all the threads is state.iterations()
+template <typename TOp>
+static void update_counter_concurrently(benchmark_state &state,
+                                        dsn_perf_counter_type_t type,
+                                        const TOp &op)
+{
+    int thread_count = (int)dsn_config_get_value_uint64(
+        "benchmark", "perf_counter_thread_count", 8, "thread count updating one perf counter");
+
+    state.pause_timing();
+    perf_counter_wrapper counter;
+    counter.init_global_counter("benchmark", "benchmark", "perf_counter", type, "benchmark");
+    state.resume_timing();
+
+    uint64_t per_thread = state.iterations() / thread_count + 1;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; ++i) {
+        threads.emplace_back([&counter, &op, per_thread]() {
+            for (uint64_t j = 0; j < per_thread; ++j) {
+                op(counter.get(), j);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+}
+
+DSN_BENCHMARK(perf_counter_number_increment)
+{
+    update_counter_concurrently(
+        state, COUNTER_TYPE_NUMBER, [](perf_counter *c, uint64_t) { c->increment(); });
+}
+
+DSN_BENCHMARK(perf_counter_volatile_number_increment)
+{
+    update_counter_concurrently(
+        state, COUNTER_TYPE_VOLATILE_NUMBER, [](perf_counter *c, uint64_t) { c->increment(); });
+}
+
+DSN_BENCHMARK(perf_counter_rate_add)
+{
+    update_counter_concurrently(
+        state, COUNTER_TYPE_RATE, [](perf_counter *c, uint64_t v) { c->add((int64_t)v); });
+}
+
+DSN_BENCHMARK(perf_counter_percentile_set)
+{
+    update_counter_concurrently(state,
+                                COUNTER_TYPE_NUMBER_PERCENTILES,
+                                [](perf_counter *c, uint64_t v) { c->set((int64_t)v); });
+}
@@ -0,0 +1,85 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     contention of rpc_client_matcher with many client threads issuing small rpcs,
+ *     each of which is matched with an empty reply right after it is registered.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "benchmark.h"
+#include "benchmark_common.h"
+#include "core/core/rpc_engine.h"
+#include <dsn/utility/config_api.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace ::dsn;
+using namespace ::dsn::benchmark;
+
+DSN_BENCHMARK(rpc_client_matcher_concurrent_calls)
+{
+    int thread_count = (int)dsn_config_get_value_uint64(
+        "benchmark", "rpc_client_thread_count", 8, "thread count issuing rpcs concurrently");
+
+    state.pause_timing();
+    service_node *node = task::get_current_node();
+    rpc_client_matcher *matcher = task::get_current_rpc()->matcher();
+    std::atomic<uint64_t> done(0);
+    state.resume_timing();
+
+    uint64_t per_thread = state.iterations() / thread_count + 1;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; ++i) {
+        threads.emplace_back([node, matcher, per_thread, &done]() {
+            task::set_tls_dsn_context(node, nullptr);
+            for (uint64_t j = 0; j < per_thread; ++j) {
+                message_ex *msg = message_ex::create_request(RPC_BENCHMARK, 1000, 0);
+                rpc_response_task_ptr call(new rpc_response_task(
+                    msg,
+                    [&done](error_code, message_ex *, message_ex *) {
+                        done.fetch_add(1, std::memory_order_release);
+                    },
+                    0));
+                matcher->on_call(msg, call);
+                matcher->on_recv_reply(nullptr, msg->header->id, nullptr, 0);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    uint64_t count = per_thread * thread_count;
+    while (done.load(std::memory_order_acquire) < count) {
+        std::this_thread::yield();
+    }
+}
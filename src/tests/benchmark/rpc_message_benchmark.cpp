@@ -0,0 +1,76 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     cost of creating, marshalling and unmarshalling rpc messages.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "benchmark.h"
+#include "benchmark_common.h"
+#include <dsn/cpp/serialization.h>
+
+using namespace ::dsn;
+using namespace ::dsn::benchmark;
+
+DSN_BENCHMARK(rpc_message_create_request)
+{
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        message_ptr msg = message_ex::create_request(RPC_BENCHMARK, 1000, (int)i, i);
+        do_not_optimize(msg.get());
+    }
+}
+
+DSN_BENCHMARK(rpc_message_create_request_and_marshall)
+{
+    configuration_query_by_index_request request = make_benchmark_request();
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        message_ptr msg = message_ex::create_request(RPC_BENCHMARK, 1000, (int)i, i);
+        marshall(msg.get(), request);
+        do_not_optimize(msg.get());
+    }
+}
+
+// unmarshall from a received copy of the request, just like what a server does
+DSN_BENCHMARK(rpc_message_copy_and_unmarshall)
+{
+    configuration_query_by_index_request request = make_benchmark_request();
+    message_ptr msg = message_ex::create_request(RPC_BENCHMARK);
+    marshall(msg.get(), request);
+
+    uint64_t body_length = msg->header->body_length;
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        message_ptr received = msg->copy(true, true);
+        configuration_query_by_index_request response;
+        unmarshall(received.get(), response);
+        do_not_optimize(response);
+    }
+    state.set_bytes_processed(body_length * state.iterations());
+}
@@ -0,0 +1,8 @@
+#!/bin/bash
+#
+# usage: ./run.sh [name-filter ...]
+#   e.g. ./run.sh crc32 mutation_log
+#
+
+rm -rf data benchmark-mutation-log
+./dsn.benchmark config.ini "$@"
@@ -0,0 +1,114 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     enqueue/dequeue cost of the task_queue providers, each of which serves one of
+ *     the THREAD_POOL_BENCHMARK_* pools (see config.ini).
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "benchmark.h"
+#include <dsn/tool-api/async_calls.h>
+#include <atomic>
+#include <thread>
+
+DEFINE_THREAD_POOL_CODE(THREAD_POOL_BENCHMARK_SIMPLE)
+DEFINE_THREAD_POOL_CODE(THREAD_POOL_BENCHMARK_HPC)
+DEFINE_THREAD_POOL_CODE(THREAD_POOL_BENCHMARK_WORK_STEALING)
+
+DEFINE_TASK_CODE(LPC_BENCHMARK_SIMPLE, TASK_PRIORITY_COMMON, THREAD_POOL_BENCHMARK_SIMPLE)
+DEFINE_TASK_CODE(LPC_BENCHMARK_HPC, TASK_PRIORITY_COMMON, THREAD_POOL_BENCHMARK_HPC)
+DEFINE_TASK_CODE(LPC_BENCHMARK_WORK_STEALING,
+                 TASK_PRIORITY_COMMON,
+                 THREAD_POOL_BENCHMARK_WORK_STEALING)
+
+using namespace ::dsn;
+using namespace ::dsn::benchmark;
+
+static void wait_for(const std::atomic<uint64_t> &done, uint64_t count)
+{
+    while (done.load(std::memory_order_acquire) < count) {
+        std::this_thread::yield();
+    }
+}
+
+// tasks are enqueued by a thread out of the pool
+static void enqueue_from_outside(benchmark_state &state, task_code code)
+{
+    std::atomic<uint64_t> done(0);
+    uint64_t count = state.iterations();
+    for (uint64_t i = 0; i < count; ++i) {
+        tasking::enqueue(
+            code, nullptr, [&done]() { done.fetch_add(1, std::memory_order_release); });
+    }
+    wait_for(done, count);
+}
+
+// tasks are enqueued by a worker of the pool, which goes to the local queue of the worker
+// if the provider has one
+static void enqueue_from_worker(benchmark_state &state, task_code code)
+{
+    std::atomic<uint64_t> done(0);
+    uint64_t count = state.iterations();
+    tasking::enqueue(code, nullptr, [&done, count, code]() {
+        for (uint64_t i = 0; i < count; ++i) {
+            tasking::enqueue(
+                code, nullptr, [&done]() { done.fetch_add(1, std::memory_order_release); });
+        }
+    });
+    wait_for(done, count);
+}
+
+DSN_BENCHMARK(task_queue_simple_enqueue_from_outside)
+{
+    enqueue_from_outside(state, LPC_BENCHMARK_SIMPLE);
+}
+
+DSN_BENCHMARK(task_queue_simple_enqueue_from_worker)
+{
+    enqueue_from_worker(state, LPC_BENCHMARK_SIMPLE);
+}
+
+DSN_BENCHMARK(task_queue_hpc_enqueue_from_outside)
+{
+    enqueue_from_outside(state, LPC_BENCHMARK_HPC);
+}
+
+DSN_BENCHMARK(task_queue_hpc_enqueue_from_worker) { enqueue_from_worker(state, LPC_BENCHMARK_HPC); }
+
+DSN_BENCHMARK(task_queue_work_stealing_enqueue_from_outside)
+{
+    enqueue_from_outside(state, LPC_BENCHMARK_WORK_STEALING);
+}
+
+DSN_BENCHMARK(task_queue_work_stealing_enqueue_from_worker)
+{
+    enqueue_from_worker(state, LPC_BENCHMARK_WORK_STEALING);
+}
@@ -0,0 +1,117 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     cost of the timer_service providers, scheduling timers at the rate they can
+ *     sustain, e.g., ~1M timers/s when one timer costs ~1us.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "benchmark.h"
+#include "core/tools/common/simple_task_queue.h"
+#include "core/tools/common/timing_wheel_timer_service.h"
+#include <atomic>
+#include <thread>
+
+DEFINE_TASK_CODE(LPC_BENCHMARK_TIMER, TASK_PRIORITY_COMMON, ::dsn::THREAD_POOL_DEFAULT)
+
+using namespace ::dsn;
+using namespace ::dsn::benchmark;
+
+static void add_timer(timer_service &svc, task *t, int delay_ms)
+{
+    t->set_delay(delay_ms);
+    t->add_ref(); // released by the timer service, just like what task::enqueue does
+    svc.add_timer(t);
+}
+
+// most timers are rpc timeouts, which are cancelled long before they expire
+template <typename T>
+static void add_and_cancel(benchmark_state &state)
+{
+    state.pause_timing();
+    T svc(task::get_current_node(), nullptr);
+    svc.start();
+    std::vector<task_ptr> tasks;
+    tasks.reserve(state.iterations());
+    state.resume_timing();
+
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        task_ptr t(new raw_task(LPC_BENCHMARK_TIMER, []() {}));
+        add_timer(svc, t, 100);
+        t->cancel(false);
+        tasks.emplace_back(std::move(t));
+    }
+
+    // the cancelled timers are still in the provider if it can not remove them
+    state.pause_timing();
+    for (auto &t : tasks) {
+        while (t->get_count() > 1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+template <typename T>
+static void add_and_fire(benchmark_state &state)
+{
+    state.pause_timing();
+    T svc(task::get_current_node(), nullptr);
+    svc.start();
+    std::atomic<uint64_t> done(0);
+    uint64_t count = state.iterations();
+    state.resume_timing();
+
+    for (uint64_t i = 0; i < count; ++i) {
+        task_ptr t(new raw_task(LPC_BENCHMARK_TIMER,
+                                [&done]() { done.fetch_add(1, std::memory_order_release); }));
+        add_timer(svc, t, 1 + (int)(i % 10));
+    }
+    while (done.load(std::memory_order_acquire) < count) {
+        std::this_thread::yield();
+    }
+}
+
+DSN_BENCHMARK(timer_service_asio_add_and_cancel)
+{
+    add_and_cancel<tools::simple_timer_service>(state);
+}
+
+DSN_BENCHMARK(timer_service_timing_wheel_add_and_cancel)
+{
+    add_and_cancel<tools::timing_wheel_timer_service>(state);
+}
+
+DSN_BENCHMARK(timer_service_asio_add_and_fire) { add_and_fire<tools::simple_timer_service>(state); }
+
+DSN_BENCHMARK(timer_service_timing_wheel_add_and_fire)
+{
+    add_and_fire<tools::timing_wheel_timer_service>(state);
+}
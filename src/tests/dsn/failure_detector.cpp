@@ -660,3 +660,38 @@ TEST(fd, update_stability)
     ASSERT_EQ(msg.start_time, ws.last_start_time_ms);
     ASSERT_EQ(0, ws.unstable_restart_count);
 }
+
+TEST(fd, many_workers_expired)
+{
+    test_worker *worker;
+    std::vector<test_master *> masters;
+    ASSERT_TRUE(get_worker_and_master(worker, masters));
+    clear(worker, masters);
+
+    master_group_set_leader(masters, 0);
+    master_fd_test *fd = masters[0]->fd();
+
+    // the registered workers never send beacons, so all of them are expired by the wheel
+    const int worker_count = 200;
+    std::atomic_int wait_count;
+    wait_count.store(worker_count);
+    fd->when_disconnected([&wait_count](const std::vector<rpc_address> &addr_list) mutable {
+        wait_count -= static_cast<int>(addr_list.size());
+    });
+
+    for (int i = 0; i < worker_count; ++i) {
+        fd->test_register_worker(rpc_address("localhost", 20000 + i));
+    }
+    ASSERT_EQ(worker_count, fd->worker_count());
+    ASSERT_TRUE(fd->is_worker_connected(rpc_address("localhost", 20000)));
+
+    ASSERT_TRUE(spin_wait_condition([&wait_count] { return wait_count == 0; }, 20));
+    ASSERT_EQ(worker_count, fd->worker_count());
+    for (int i = 0; i < worker_count; ++i) {
+        ASSERT_FALSE(fd->is_worker_connected(rpc_address("localhost", 20000 + i)));
+    }
+
+    fd->clear();
+    fd->clear_workers();
+    ASSERT_EQ(0, fd->worker_count());
+}
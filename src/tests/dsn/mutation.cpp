@@ -0,0 +1,65 @@
+#include "dist/replication/lib/mutation.h"
+#include <dsn/cpp/rpc_stream.h>
+#include <gtest/gtest.h>
+
+using namespace ::dsn;
+using namespace ::dsn::replication;
+
+TEST(replication, mutation_append_to_and_read_from)
+{
+    // the update data below and above the threshold for being appended without copy
+    std::vector<std::string> payloads = {std::string(100, 'a'), std::string(8192, 'b'), ""};
+
+    mutation_ptr mu(new mutation());
+    mu->data.header.pid = gpid(1, 2);
+    mu->data.header.ballot = 3;
+    mu->data.header.decree = 4;
+    mu->data.header.last_committed_decree = 3;
+    mu->data.header.log_offset = 0;
+    mu->data.header.timestamp = 5;
+    for (auto &payload : payloads) {
+        mu->data.updates.push_back(mutation_update());
+        mu->data.updates.back().code = RPC_REPLICATION_WRITE_EMPTY;
+        mu->data.updates.back().data = blob::create_from_bytes(std::string(payload));
+        mu->client_requests.push_back(nullptr);
+    }
+
+    message_ex *msg = message_ex::create_request(RPC_PREPARE);
+    msg->add_ref();
+    mutation::append_to(msg, mu->serialize());
+
+    // only the large data are shared with the message
+    auto shares = [msg](const blob &bb) {
+        for (auto &buf : msg->buffers) {
+            if (buf.data() == bb.data()) {
+                return true;
+            }
+        }
+        return false;
+    };
+    ASSERT_FALSE(shares(mu->data.updates[0].data));
+    ASSERT_TRUE(shares(mu->data.updates[1].data));
+
+    message_ex *received = msg->copy(true, true);
+    received->add_ref();
+    mutation_ptr read;
+    {
+        rpc_read_stream reader(received);
+        read = mutation::read_from(reader, received);
+    }
+
+    ASSERT_EQ(mu->data.header.pid, read->data.header.pid);
+    ASSERT_EQ(mu->data.header.ballot, read->data.header.ballot);
+    ASSERT_EQ(mu->data.header.decree, read->data.header.decree);
+    ASSERT_EQ(mu->data.header.last_committed_decree, read->data.header.last_committed_decree);
+    ASSERT_EQ(mu->data.header.timestamp, read->data.header.timestamp);
+    ASSERT_EQ(payloads.size(), read->data.updates.size());
+    for (size_t i = 0; i < payloads.size(); i++) {
+        ASSERT_EQ(RPC_REPLICATION_WRITE_EMPTY, read->data.updates[i].code);
+        ASSERT_EQ(payloads[i], read->data.updates[i].data.to_string());
+    }
+
+    read = nullptr;
+    received->release_ref();
+    msg->release_ref();
+}
@@ -36,6 +36,11 @@
 #include <dsn/utility/filesystem.h>
 #include <gtest/gtest.h>
 #include <cstdio>
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
 
 using namespace ::dsn;
 using namespace ::dsn::replication;
@@ -269,6 +274,132 @@ TEST(replication, log_file)
     utils::filesystem::remove_path(fpath);
 }
 
+static void write_log_blocks(log_file_ptr lf,
+                             const replica_log_info_map &mdecrees,
+                             int count,
+                             /*inout*/ int64_t &offset)
+{
+    std::string str = "hello, world!";
+    for (int i = 0; i < count; i++) {
+        auto writer = lf->prepare_log_block();
+
+        if (i == 0) {
+            binary_writer temp_writer;
+            lf->write_file_header(temp_writer, mdecrees);
+            writer->add(temp_writer.get_buffer());
+        }
+
+        binary_writer temp_writer;
+        temp_writer.write(str);
+        writer->add(temp_writer.get_buffer());
+
+        aio_task_ptr task =
+            lf->commit_log_block(*writer, offset, LPC_AIO_IMMEDIATE_CALLBACK, nullptr, nullptr, 0);
+        task->wait();
+        ASSERT_EQ(ERR_OK, task->error());
+        ASSERT_EQ(writer->size(), task->get_transferred_size());
+
+        offset += writer->size();
+        delete writer;
+    }
+    lf->flush();
+    ASSERT_EQ(offset, lf->end_offset());
+}
+
+static void read_log_blocks(log_file_ptr lf, int count, int64_t end_offset)
+{
+    lf->reset_stream();
+    for (int i = 0; i < count; i++) {
+        blob bb;
+        ASSERT_EQ(ERR_OK, lf->read_next_log_block(bb));
+
+        binary_reader reader(bb);
+        if (i == 0) {
+            lf->read_file_header(reader);
+            ASSERT_TRUE(lf->is_right_header());
+        }
+
+        std::string ss;
+        reader.read(ss);
+        ASSERT_EQ("hello, world!", ss);
+    }
+
+    blob bb;
+    ASSERT_EQ(ERR_HANDLE_EOF, lf->read_next_log_block(bb));
+    ASSERT_EQ(end_offset, lf->end_offset());
+}
+
+TEST(replication, log_file_segment)
+{
+    replica_log_info_map mdecrees;
+    mdecrees[gpid(1, 0)] = replica_log_info(3, 0);
+    std::string segment = "./segment.0";
+    const int64_t segment_size = 1024 * 1024;
+    int64_t sz;
+    int64_t offset;
+    error_code err;
+    log_file_ptr lf;
+
+    // pre-allocate a zero-filled segment
+    ASSERT_TRUE(log_file::prepare_segment(segment, segment_size));
+    ASSERT_TRUE(dsn::utils::filesystem::file_size(segment, sz));
+    ASSERT_EQ(segment_size, sz);
+
+    // write a log file into the segment
+    offset = 100;
+    lf = log_file::create_write(".", 1, offset, segment.c_str());
+    ASSERT_NE(nullptr, lf);
+    ASSERT_FALSE(dsn::utils::filesystem::file_exists(segment));
+    write_log_blocks(lf, mdecrees, 100, offset);
+    lf->close();
+    ASSERT_TRUE(dsn::utils::filesystem::file_size("./log.1.100", sz));
+    ASSERT_EQ(segment_size, sz);
+
+    // the zero-filled space is not taken as corrupted data, and the end offset is found
+    // once the file is read through, or set by the start of the next file
+    lf = log_file::open_read("./log.1.100", err);
+    ASSERT_NE(nullptr, lf);
+    ASSERT_EQ(ERR_OK, err);
+    ASSERT_EQ(100 + segment_size, lf->end_offset());
+    read_log_blocks(lf, 100, offset);
+    lf = nullptr;
+
+    lf = log_file::open_read("./log.1.100", err);
+    ASSERT_NE(nullptr, lf);
+    lf->on_next_file_opened(segment_size * 2);
+    ASSERT_EQ(100 + segment_size, lf->end_offset());
+    lf->on_next_file_opened(offset);
+    ASSERT_EQ(offset, lf->end_offset());
+    lf = nullptr;
+
+    // recycle the log file, which is taken as empty once the first block header is cleared
+    ASSERT_TRUE(log_file::prepare_segment("./log.1.100", segment_size));
+    ASSERT_TRUE(dsn::utils::filesystem::rename_path("./log.1.100", segment));
+
+    // write a shorter log file into the recycled segment, the stale blocks after it
+    // have the same local offsets but different crc, which are not taken as data either
+    offset = 200;
+    lf = log_file::create_write(".", 2, offset, segment.c_str());
+    ASSERT_NE(nullptr, lf);
+    write_log_blocks(lf, mdecrees, 10, offset);
+    lf->close();
+
+    lf = log_file::open_read("./log.2.200", err);
+    ASSERT_NE(nullptr, lf);
+    ASSERT_EQ(ERR_OK, err);
+    read_log_blocks(lf, 10, offset);
+    lf = nullptr;
+
+    // a reused segment whose file header is not written yet is taken as an empty file
+    ASSERT_TRUE(log_file::prepare_segment("./log.2.200", segment_size));
+    lf = log_file::open_read("./log.2.200", err);
+    ASSERT_EQ(nullptr, lf);
+    ASSERT_EQ(ERR_HANDLE_EOF, err);
+    ASSERT_TRUE(dsn::utils::filesystem::file_exists("./log.2.200.removed"));
+
+    utils::filesystem::remove_path("./log.2.200.removed");
+}
+
 TEST(replication, mutation_log)
 {
     gpid gpid(1, 0);
@@ -335,3 +466,237 @@ TEST(replication, mutation_log)
     // clear all
     utils::filesystem::remove_path(logp);
 }
+
+static mutation_ptr create_test_mutation(gpid pid, decree d, const std::string &str)
+{
+    mutation_ptr mu(new mutation());
+    mu->data.header.ballot = 1;
+    mu->data.header.decree = d;
+    mu->data.header.pid = pid;
+    mu->data.header.last_committed_decree = d - 1;
+    mu->data.header.log_offset = 0;
+
+    binary_writer writer;
+    for (int j = 0; j < 100; j++) {
+        writer.write(str);
+    }
+    mu->data.updates.push_back(mutation_update());
+    mu->data.updates.back().code = RPC_REPLICATION_WRITE_EMPTY;
+    mu->data.updates.back().data = writer.get_buffer();
+
+    mu->client_requests.push_back(nullptr);
+    return mu;
+}
+
+TEST(replication, mutation_log_parallel_replay)
+{
+    std::string str = "hello, world!";
+    std::string logp = "./test-log-parallel";
+    std::vector<gpid> pids = {gpid(1, 0), gpid(1, 1), gpid(2, 0)};
+    std::vector<mutation_ptr> mutations;
+
+    utils::filesystem::remove_path(logp);
+    utils::filesystem::create_directory(logp);
+
+    // write a shared log spanning several files
+    mutation_log_ptr mlog = new mutation_log_shared(logp, 1, false);
+    ASSERT_EQ(ERR_OK, mlog->open(nullptr, nullptr));
+    for (int i = 0; i < 3000; i++) {
+        mutation_ptr mu = create_test_mutation(pids[i % pids.size()], 2 + i / pids.size(), str);
+        mutations.push_back(mu);
+        mlog->append(mu, LPC_AIO_IMMEDIATE_CALLBACK, nullptr, nullptr, 0);
+    }
+    mlog->close();
+
+    std::vector<std::string> files;
+    ASSERT_TRUE(utils::filesystem::get_subfiles(logp, files, false));
+    ASSERT_GE(files.size(), 4u);
+
+    // more threads than files are capped, and fewer ones keep at most a window of files
+    // decoded ahead; either way the mutations are replayed in the log order on this thread
+    for (int thread_count : {1, 2, 4, 64}) {
+        std::thread::id replay_thread = std::this_thread::get_id();
+        std::vector<mutation_ptr> replayed;
+        bool on_replay_thread = true;
+        mlog = new mutation_log_shared(logp, 1, false, thread_count);
+        ASSERT_EQ(ERR_OK,
+                  mlog->open(
+                      [&](int log_length, mutation_ptr &mu) -> bool {
+                          on_replay_thread &= (std::this_thread::get_id() == replay_thread);
+                          replayed.push_back(mu);
+                          return true;
+                      },
+                      nullptr));
+        mlog->close();
+
+        ASSERT_TRUE(on_replay_thread) << "thread_count = " << thread_count;
+        ASSERT_EQ(mutations.size(), replayed.size()) << "thread_count = " << thread_count;
+        for (size_t i = 0; i < mutations.size(); i++) {
+            ASSERT_TRUE(mutations[i]->data.header == replayed[i]->data.header)
+                << "thread_count = " << thread_count << ", index = " << i;
+            ASSERT_EQ(mutations[i]->data.updates[0].data.length(),
+                      replayed[i]->data.updates[0].data.length());
+        }
+    }
+
+    utils::filesystem::remove_path(logp);
+}
+
+static bool wait_until(const std::function<bool()> &done, int timeout_ms)
+{
+    uint64_t deadline = dsn_now_ms() + timeout_ms;
+    while (!done()) {
+        if (dsn_now_ms() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+TEST(replication, mutation_log_group_commit)
+{
+    gpid pid(1, 0);
+    std::string str = "hello, world!";
+    std::string logp = "./test-log-group-commit";
+    std::vector<mutation_ptr> mutations;
+    std::atomic<int> done_count(0);
+    std::atomic<int> fail_count(0);
+    auto append = [&](mutation_log_ptr &mlog) {
+        mutation_ptr mu = create_test_mutation(pid, 2 + (int)mutations.size(), str);
+        mutations.push_back(mu);
+        mlog->append(mu,
+                     LPC_AIO_IMMEDIATE_CALLBACK,
+                     nullptr,
+                     [&done_count, &fail_count](error_code err, size_t) {
+                         if (err != ERR_OK) {
+                             ++fail_count;
+                         }
+                         ++done_count;
+                     },
+                     0);
+    };
+
+    utils::filesystem::remove_path(logp);
+    utils::filesystem::create_directory(logp);
+
+    // groups of at most 16KB, waiting at most 20ms for more mutations
+    mutation_log_ptr mlog = new mutation_log_shared(logp, 32, true, 1, 16 * 1024, 20000);
+    ASSERT_EQ(ERR_OK, mlog->open(nullptr, nullptr));
+
+    // a burst is split into groups by size, and all of them are committed without flush()
+    for (int i = 0; i < 500; i++) {
+        append(mlog);
+    }
+    ASSERT_TRUE(wait_until([&]() { return done_count.load() == 500; }, 10000));
+
+    // a lone mutation is committed once its group has waited long enough, the window is no
+    // longer zero now that the fsync latency is measured
+    for (int i = 0; i < 5; i++) {
+        int expected = done_count.load() + 1;
+        append(mlog);
+        ASSERT_TRUE(wait_until([&]() { return done_count.load() == expected; }, 5000));
+    }
+    ASSERT_EQ(0, fail_count.load());
+
+    // flush() writes the pending group immediately
+    append(mlog);
+    mlog->flush();
+    ASSERT_TRUE(wait_until([&]() { return done_count.load() == (int)mutations.size(); }, 5000));
+    mlog->close();
+
+    // all the groups are replayed in order
+    mlog = new mutation_log_shared(logp, 32, true, 1, 16 * 1024, 20000);
+    size_t replayed = 0;
+    ASSERT_EQ(ERR_OK,
+              mlog->open(
+                  [&](int log_length, mutation_ptr &mu) -> bool {
+                      EXPECT_TRUE(replayed < mutations.size() &&
+                                  mutations[replayed]->data.header == mu->data.header);
+                      replayed++;
+                      return true;
+                  },
+                  nullptr));
+    mlog->close();
+    ASSERT_EQ(mutations.size(), replayed);
+
+    utils::filesystem::remove_path(logp);
+}
+
+static mutation_log_ptr create_test_log(bool is_private, const std::string &dir, bool direct_io)
+{
+    mutation_log_ptr mlog;
+    if (is_private) {
+        mlog = new mutation_log_private(dir, 1, gpid(1, 0), nullptr, 1024, 512, 10000);
+    } else {
+        mlog = new mutation_log_shared(dir, 1, false);
+    }
+    mlog->set_direct_io(direct_io);
+    return mlog;
+}
+
+TEST(replication, mutation_log_direct_io)
+{
+    std::string str = "hello, world!";
+    std::string logp = "./test-log-direct-io";
+    const int count = 2000;
+
+    // the alignment is recorded in the file header, so the logs written with direct io can
+    // be replayed without it and vice versa
+    for (bool is_private : {true, false}) {
+        for (bool write_direct_io : {false, true}) {
+            for (bool read_direct_io : {false, true}) {
+                std::string name = std::string(is_private ? "private" : "shared") +
+                                   ", write direct io = " + (write_direct_io ? "true" : "false") +
+                                   ", read direct io = " + (read_direct_io ? "true" : "false");
+                std::vector<mutation_ptr> mutations;
+                utils::filesystem::remove_path(logp);
+                utils::filesystem::create_directory(logp);
+
+                mutation_log_ptr mlog = create_test_log(is_private, logp, write_direct_io);
+                ASSERT_EQ(ERR_OK, mlog->open(nullptr, nullptr)) << name;
+                for (int i = 0; i < count; i++) {
+                    mutation_ptr mu = create_test_mutation(gpid(1, 0), 2 + i, str);
+                    mutations.push_back(mu);
+                    mlog->append(mu, LPC_AIO_IMMEDIATE_CALLBACK, nullptr, nullptr, 0);
+                }
+                mlog->close();
+
+                // every block is padded to the alignment with direct io
+                std::vector<std::string> files;
+                ASSERT_TRUE(utils::filesystem::get_subfiles(logp, files, false));
+                ASSERT_GE(files.size(), 2u) << name;
+                for (auto &f : files) {
+                    int64_t sz = 0;
+                    ASSERT_TRUE(utils::filesystem::file_size(f, sz));
+                    if (write_direct_io) {
+                        ASSERT_EQ(0, sz % (int64_t)LOG_FILE_ALIGNMENT) << name << ", " << f;
+                    }
+                }
+
+                mlog = create_test_log(is_private, logp, read_direct_io);
+                size_t replayed = 0;
+                ASSERT_EQ(ERR_OK,
+                          mlog->open(
+                              [&](int log_length, mutation_ptr &mu) -> bool {
+                                  if (replayed >= mutations.size()) {
+                                      replayed++;
+                                      return true;
+                                  }
+                                  mutation_ptr &wmu = mutations[replayed++];
+                                  EXPECT_TRUE(wmu->data.header == mu->data.header) << name;
+                                  EXPECT_EQ(wmu->data.updates[0].data.to_string(),
+                                            mu->data.updates[0].data.to_string())
+                                      << name;
+                                  return true;
+                              },
+                              nullptr))
+                    << name;
+                mlog->close();
+                ASSERT_EQ(mutations.size(), replayed) << name;
+            }
+        }
+    }
+
+    utils::filesystem::remove_path(logp);
+}